@@ -0,0 +1,225 @@
+// Replays noisy 10-bit control traces, one sample per millisecond, through
+// applyMapping() and the 1 ms MappingManager::tick() under each input filter
+// setting. Reports how many MIDI messages a CC and a mod wheel mapping send,
+// the reduction against no filter, and how far the CC output trails the
+// noise-free movement (mean and worst |sent - clean| in CC steps). Exits
+// non-zero if any filter sends more than no filter on some trace.
+//
+// Without arguments the traces are synthetic: a fader ramp and hold, a knob
+// at rest, and slow sweeps, each with +/-2 LSB noise from a fixed seed.
+// Recorded traces replay the same way: one value (0-1023) per line, 1 kHz.
+//
+//   bench_filters [trace.txt ...]
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "host_sim.h"
+#include "mapping.h"
+
+namespace
+{
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+    constexpr int32_t MAX = 1023;
+
+    struct Trace
+    {
+        std::string name;
+        std::vector<int32_t> clean; // intended position, empty when recorded
+        std::vector<int32_t> noisy; // what the module reports
+    };
+
+    struct Setting
+    {
+        const char *name;
+        MappingOptions options;
+    };
+
+    const Setting SETTINGS[] = {
+        {"none", {0, 0, 0, 0}},
+        {"deadband 5", {5, 0, 0, 0}},
+        {"smoothing 3", {0, 3, 0, 0}},
+        {"slew 8", {0, 0, 8, 0}},
+        {"deadband 5 + smoothing 3", {5, 3, 0, 0}},
+        {"deadband 5 + slew 8", {5, 0, 8, 0}},
+    };
+
+    uint32_t g_seed = 12345;
+
+    // -2..2, from a fixed-seed LCG so every run replays the same noise
+    int32_t noise()
+    {
+        g_seed = g_seed * 1103515245u + 12345u;
+        return (int32_t)((g_seed >> 16) % 5) - 2;
+    }
+
+    int32_t clamp(int32_t v)
+    {
+        return v < 0 ? 0 : (v > MAX ? MAX : v);
+    }
+
+    Trace synthetic(const char *name, const std::vector<int32_t> &clean)
+    {
+        Trace t{name, clean, {}};
+        for (int32_t v : clean)
+            t.noisy.push_back(clamp(v + noise()));
+        return t;
+    }
+
+    std::vector<Trace> syntheticTraces()
+    {
+        std::vector<int32_t> fader;
+        for (int ms = 0; ms < 2000; ms++)
+            fader.push_back(ms * 700 / 2000);
+        fader.insert(fader.end(), 2000, 700);
+
+        const std::vector<int32_t> knob(5000, 512);
+
+        std::vector<int32_t> sweep;
+        for (int ms = 0; ms < 6000; ms++)
+            sweep.push_back((int32_t)lround(511.5 - 511.5 * cos(2 * M_PI * ms / 3000.0)));
+
+        return {synthetic("fader: 2 s ramp, 2 s hold", fader), synthetic("knob at rest, 5 s", knob),
+                synthetic("sweep: 3 s period, 6 s", sweep)};
+    }
+
+    bool load(const char *path, Trace &t)
+    {
+        FILE *f = fopen(path, "r");
+        if (!f)
+        {
+            perror(path);
+            return false;
+        }
+        t.name = path;
+        long v;
+        while (fscanf(f, "%ld", &v) == 1)
+            t.noisy.push_back(clamp((int32_t)v));
+        fclose(f);
+        return !t.noisy.empty();
+    }
+
+    Port::State g_port{};
+
+    // CC value a linear mapping gives for `v`, as applyMapping computes it
+    int ccOf(int32_t v)
+    {
+        return (int)((((int64_t)v * 65535 + MAX / 2) / MAX) >> 9);
+    }
+
+    struct Result
+    {
+        long sent;
+        double meanError; // CC steps, -1 without a clean trace
+        int worstError;
+    };
+
+    Result replay(const Trace &t, ActionType type, const MappingOptions &options)
+    {
+        MappingManager::clearAll();
+        MappingManager::updateMapping(ROW, COL, 0, type, 1, 20);
+        MappingManager::updateMappingOptions(ROW, COL, 0, options);
+        HostSim::midiTakeSent();
+
+        Result r{0, -1, 0};
+        int lastCc = -1;
+        double errorSum = 0;
+        int32_t previous = -1;
+        for (size_t ms = 0; ms < t.noisy.size(); ms++)
+        {
+            HostSim::advanceMs(1);
+            // Modules report a parameter when it changes
+            if (t.noisy[ms] != previous)
+            {
+                ModuleParameterValue value{};
+                value.intValue = t.noisy[ms];
+                MappingManager::applyMapping(&g_port, 0, ModuleParameterDataType::PARAM_TYPE_INT, value);
+                previous = t.noisy[ms];
+            }
+            MappingManager::tick();
+            for (const HostSim::MidiEvent &e : HostSim::midiTakeSent())
+            {
+                r.sent++;
+                if (e.kind == 0xB0 && e.data1 == 20)
+                    lastCc = e.data2;
+            }
+            if (type == ACTION_MIDI_CC && !t.clean.empty() && lastCc >= 0)
+            {
+                const int error = abs(lastCc - ccOf(t.clean[ms]));
+                errorSum += error;
+                if (error > r.worstError)
+                    r.worstError = error;
+            }
+        }
+        if (type == ACTION_MIDI_CC && !t.clean.empty())
+            r.meanError = errorSum / (double)t.noisy.size();
+        return r;
+    }
+
+    double reduction(long sent, long unfiltered)
+    {
+        return unfiltered ? 100.0 * (1.0 - (double)sent / (double)unfiltered) : 0;
+    }
+
+    // Returns false if a filter setting sent more than "none"
+    bool report(const Trace &t)
+    {
+        bool ok = true;
+        long changes = 0;
+        for (size_t i = 0; i < t.noisy.size(); i++)
+            changes += i == 0 || t.noisy[i] != t.noisy[i - 1];
+        printf("%s (%zu ms, %ld input changes)\n", t.name.c_str(), t.noisy.size(), changes);
+        printf("  %-26s %8s %7s %9s %7s  %s\n", "filter", "CC sent", "cut", "CC14 sent", "cut", "CC error mean/max");
+        long ccNone = 0, cc14None = 0;
+        for (const Setting &s : SETTINGS)
+        {
+            const Result cc = replay(t, ACTION_MIDI_CC, s.options);
+            // A 14-bit CC is two messages; count values
+            const long cc14 = replay(t, ACTION_MIDI_MOD_WHEEL, s.options).sent / 2;
+            if (&s == &SETTINGS[0])
+            {
+                ccNone = cc.sent;
+                cc14None = cc14;
+            }
+            ok &= cc.sent <= ccNone && cc14 <= cc14None;
+            printf("  %-26s %8ld %6.1f%% %9ld %6.1f%%", s.name, cc.sent, reduction(cc.sent, ccNone), cc14,
+                   reduction(cc14, cc14None));
+            if (cc.meanError >= 0)
+                printf("  %.2f / %d", cc.meanError, cc.worstError);
+            printf("\n");
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    HostSim::reset();
+    MappingManager::init();
+    g_port.row = ROW;
+    g_port.col = COL;
+    g_port.hasModule = true;
+    g_port.module.parameterCount = 1;
+    g_port.module.parameters[0].dataType = ModuleParameterDataType::PARAM_TYPE_INT;
+    g_port.module.parameters[0].minMax.intMax = MAX;
+
+    std::vector<Trace> traces;
+    for (int i = 1; i < argc; i++)
+    {
+        Trace t;
+        if (!load(argv[i], t))
+            return 1;
+        traces.push_back(t);
+    }
+    if (traces.empty())
+        traces = syntheticTraces();
+    bool ok = true;
+    for (const Trace &t : traces)
+        ok &= report(t);
+    if (!ok)
+        printf("a filter sent more messages than no filter\n");
+    return ok ? 0 : 1;
+}
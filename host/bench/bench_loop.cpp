@@ -0,0 +1,110 @@
+// Main-loop passes under traffic, for comparing builds with different log
+// settings (PICONTROL_LOG_LEVEL, PICONTROL_LOG_MASK, DEBUG_MODULE_MESSAGES).
+// A core1 pass is Port::task() with one module frame received; a core0 pass
+// is usb::task() with one config command (MAP SET, then LOG GET) received.
+// Debug output is formatted as on the device and then dropped by the stub
+// Serial. Each figure is the best of five rounds. Host numbers only compare
+// builds; they do not predict RP2040 loop times.
+//
+// Build with -DPICONTROL_HOST_SANITIZE=OFF -DCMAKE_BUILD_TYPE=Release.
+//
+//   bench_loop [passes]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "debug_printf.h"
+#include "frames.h"
+#include "host_sim.h"
+#include "ipc.hpp"
+#include "mapping.h"
+#include "port.h"
+#include "usb_device.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+
+    double nsPer(Clock::time_point since, long n)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - since).count() / (double)n;
+    }
+
+    constexpr int ROUNDS = 5;
+
+    double benchCore1(long passes)
+    {
+        InterruptSerialPIO *serial = modulePorts[ROW][COL];
+        ispio_set_port_location(serial, ROW, COL);
+        ispio_end(serial);
+        ispio_begin(serial, ISPIO_FIXED_BAUD);
+        const unsigned pio = pio_get_index(serial->rxPIO);
+        const unsigned sm = (unsigned)serial->rxSM;
+
+        Frames::Bytes value{0};
+        Frames::appendValue(value, (int32_t)512);
+        const Frames::Bytes frame = Frames::moduleResponse(LINK_MODE_SUM8, CMD_GET_PARAMETER, MODULE_STATUS_OK, value);
+
+        HostSim::setCore(1);
+        const Clock::time_point start = Clock::now();
+        for (long i = 0; i < passes; i++)
+        {
+            for (size_t pos = 0; pos < frame.size(); pos += 8)
+            {
+                HostSim::pushRx(pio, sm, &frame[pos], frame.size() - pos < 8 ? frame.size() - pos : 8);
+                HostSim::runPioIrq(pio);
+            }
+            Port::task();
+            HostSim::advanceUs(100);
+        }
+        const double ns = nsPer(start, passes);
+        HostSim::setCore(0);
+        return ns;
+    }
+
+    double benchCore0(long passes)
+    {
+        const Frames::Bytes set = Frames::configFrame(Frames::CFG_MAP, 0, 1, {0, 1, 0, ACTION_MIDI_CC, 1, 20});
+        const Frames::Bytes log = Frames::configFrame(Frames::CFG_LOG, 0, 2, {});
+
+        const Clock::time_point start = Clock::now();
+        for (long i = 0; i < passes; i++)
+        {
+            const Frames::Bytes &f = (i & 1) ? log : set;
+            HostSim::cdcFeed(f.data(), f.size());
+            usb::task();
+            HostSim::cdcTakeOutput();
+            IPC::SyncMappingRequest sync;
+            while (IPC::tryDequeueSyncMapping(sync))
+            {
+            }
+        }
+        return nsPer(start, passes);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const long passes = argc > 1 ? atol(argv[1]) : 200000;
+    HostSim::reset();
+    dbg_printf_init();
+    IPC::init();
+    MappingManager::init();
+    Port::init();
+    usb::init();
+
+    printf("PICONTROL_LOG_LEVEL %d, PICONTROL_LOG_MASK 0x%02X\n", PICONTROL_LOG_LEVEL, PICONTROL_LOG_MASK);
+    double core1 = 0, core0 = 0;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        const double ns1 = benchCore1(passes);
+        const double ns0 = benchCore0(passes);
+        core1 = round == 0 || ns1 < core1 ? ns1 : core1;
+        core0 = round == 0 || ns0 < core0 ? ns0 : core0;
+    }
+    printf("core1 pass %8.1f ns (Port::task, one module frame)\n", core1);
+    printf("core0 pass %8.1f ns (usb::task, one config command)\n", core0);
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Cost of the mapping pipeline per input value: the curve alone for a
+// linear, a steep h and a piecewise curve, the whole normalize/curve/scale
+// path next to the 8-bit path it replaced, and applyMapping() end to end.
+// Host numbers only compare changes against each other; they do not predict
+// RP2040 cycle counts.
+//
+// Build with -DPICONTROL_HOST_SANITIZE=OFF -DCMAKE_BUILD_TYPE=Release.
+//
+//   bench_mapping [iterations]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "host_sim.h"
+#include "mapping.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+    constexpr int32_t MAX = 1023; // a 10-bit fader
+
+    volatile uint32_t g_sink;
+
+    double nsPer(Clock::time_point since, long n)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - since).count() / (double)n;
+    }
+
+    Curve hCurve(int16_t h)
+    {
+        Curve c{};
+        c.h = h;
+        return c;
+    }
+
+    Curve knee()
+    {
+        Curve c{};
+        c.count = 3;
+        c.points[0] = {0, 0};
+        c.points[1] = {40, 200};
+        c.points[2] = {255, 255};
+        c.controls[0] = {10, 120};
+        c.controls[1] = {60, 250};
+        return c;
+    }
+
+    // Normalize as applyMapping does
+    uint16_t normalize16(int32_t v)
+    {
+        return (uint16_t)(((int64_t)v * 65535 + MAX / 2) / MAX);
+    }
+
+    // The path before the 16-bit pipeline: normalize to 8 bits, evaluate the
+    // LUT at x * 257, round back to 8 bits, upscale to 14
+    uint16_t legacy8(const CurveLut &lut, int32_t v)
+    {
+        const uint8_t x = (uint8_t)(((int64_t)v * 255) / MAX);
+        const uint32_t y = CurveEvaluator::eval(lut, (uint16_t)(x * 257));
+        const uint8_t y8 = (uint8_t)((y + 128) / 257);
+        return (uint16_t)(((uint32_t)y8 * 16383u + 127u) / 255u);
+    }
+
+    uint16_t pipeline16(const CurveLut &lut, int32_t v)
+    {
+        return (uint16_t)(CurveEvaluator::eval(lut, normalize16(v)) >> 2);
+    }
+
+    void benchCurves(long iterations)
+    {
+        const struct
+        {
+            const char *name;
+            Curve curve;
+        } curves[] = {{"linear", hCurve(16384)}, {"h=500", hCurve(500)}, {"h=32267", hCurve(32267)}, {"knee", knee()}};
+        for (const auto &c : curves)
+        {
+            CurveLut lut;
+            CurveEvaluator::compile(c.curve, lut);
+            const int exact = __builtin_popcount(lut.exact[0]) + __builtin_popcount(lut.exact[1]);
+
+            uint32_t sum = 0;
+            Clock::time_point start = Clock::now();
+            for (long it = 0; it < iterations; it++)
+            {
+                for (uint32_t x = 0; x < 65536; x += 61)
+                    sum += CurveEvaluator::eval(lut, (uint16_t)x);
+            }
+            const double evalNs = nsPer(start, iterations * ((65536 + 60) / 61));
+
+            start = Clock::now();
+            for (long it = 0; it < iterations; it++)
+            {
+                for (int32_t v = 0; v <= MAX; v++)
+                    sum += legacy8(lut, v);
+            }
+            const double legacyNs = nsPer(start, iterations * (MAX + 1));
+
+            start = Clock::now();
+            for (long it = 0; it < iterations; it++)
+            {
+                for (int32_t v = 0; v <= MAX; v++)
+                    sum += pipeline16(lut, v);
+            }
+            const double pipelineNs = nsPer(start, iterations * (MAX + 1));
+            g_sink = sum;
+            printf("curve %-8s %2d exact segments  eval %6.2f ns  8-bit path %6.2f ns  16-bit path %6.2f ns\n", c.name,
+                   exact, evalNs, legacyNs, pipelineNs);
+        }
+    }
+
+    void benchApplyMapping(long iterations)
+    {
+        static Port::State port{};
+        port.row = ROW;
+        port.col = COL;
+        port.hasModule = true;
+        port.module.parameterCount = 1;
+        port.module.parameters[0].dataType = ModuleParameterDataType::PARAM_TYPE_INT;
+        port.module.parameters[0].minMax.intMax = MAX;
+
+        MappingManager::clearAll();
+        MappingManager::updateMapping(ROW, COL, 0, ACTION_MIDI_MOD_WHEEL, 1, 0);
+        MappingManager::updateMappingCurve(ROW, COL, 0, hCurve(500));
+
+        long events = 0;
+        const Clock::time_point start = Clock::now();
+        for (long it = 0; it < iterations; it++)
+        {
+            for (int32_t v = 0; v <= MAX; v++)
+            {
+                ModuleParameterValue value{};
+                value.intValue = v;
+                MappingManager::applyMapping(&port, 0, ModuleParameterDataType::PARAM_TYPE_INT, value);
+            }
+            events += (long)HostSim::midiTakeSent().size();
+        }
+        printf("applyMapping mod wheel h=500  %6.2f ns per value (%ld MIDI messages)\n", nsPer(start, iterations * (MAX + 1)),
+               events);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const long iterations = argc > 1 ? atol(argv[1]) : 2000;
+    HostSim::reset();
+    MappingManager::init();
+    benchCurves(iterations);
+    benchApplyMapping(iterations / 10 + 1);
+    return 0;
+}
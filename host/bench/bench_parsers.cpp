@@ -0,0 +1,121 @@
+// Throughput of the two wire parsers on the host: the module link receiver
+// (RX IRQ -> processByte) per link mode, and the config protocol (usb::task
+// framing + processMessage). Host numbers only compare changes to the
+// parsers against each other; they do not predict RP2040 cycle counts.
+//
+// Build with -DPICONTROL_HOST_SANITIZE=OFF -DCMAKE_BUILD_TYPE=Release.
+//
+//   bench_parsers [iterations]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "frames.h"
+#include "host_sim.h"
+#include "ipc.hpp"
+#include "mapping.h"
+#include "port.h"
+#include "usb_device.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr size_t FIFO_DEPTH = 8;
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+
+    double seconds(Clock::time_point since)
+    {
+        return std::chrono::duration<double>(Clock::now() - since).count();
+    }
+
+    void benchModuleParser(long iterations)
+    {
+        const char *names[] = {"sum8", "crc16", "cobs"};
+        InterruptSerialPIO *serial = modulePorts[ROW][COL];
+        ispio_set_port_location(serial, ROW, COL);
+        for (uint8_t mode = LINK_MODE_SUM8; mode <= LINK_MODE_COBS; mode++)
+        {
+            // A typical autoupdate burst: parameter values, 9 data bytes each
+            Frames::Bytes wire;
+            for (uint8_t pid = 0; pid < 8; pid++)
+            {
+                Frames::Bytes value{pid};
+                Frames::appendValue(value, (int32_t)(pid * 100));
+                const Frames::Bytes f = Frames::moduleResponse(mode, CMD_GET_PARAMETER, MODULE_STATUS_OK, value);
+                wire.insert(wire.end(), f.begin(), f.end());
+            }
+
+            ispio_end(serial);
+            ispio_begin(serial, ISPIO_FIXED_BAUD);
+            ispio_set_link_mode(serial, mode);
+            const unsigned pio = pio_get_index(serial->rxPIO);
+            const unsigned sm = (unsigned)serial->rxSM;
+
+            long frames = 0;
+            const Clock::time_point start = Clock::now();
+            for (long it = 0; it < iterations; it++)
+            {
+                for (size_t pos = 0; pos < wire.size(); pos += FIFO_DEPTH)
+                {
+                    const size_t n = wire.size() - pos < FIFO_DEPTH ? wire.size() - pos : FIFO_DEPTH;
+                    HostSim::pushRx(pio, sm, &wire[pos], n);
+                    HostSim::runPioIrq(pio);
+                }
+                ModuleMessage msg;
+                while (Port::getNextMessage(msg))
+                    frames++;
+            }
+            const double s = seconds(start);
+            printf("module %-5s %8.2f MB/s %10.0f frames/s (%ld frames, %zu bytes per burst)\n", names[mode],
+                   (double)wire.size() * (double)iterations / s / 1e6, (double)frames / s, frames, wire.size());
+        }
+    }
+
+    void benchConfigParser(long iterations)
+    {
+        // LOG GET: smallest command with a non-trivial reply; MAP SET: a write
+        const Frames::Bytes log = Frames::configFrame(Frames::CFG_LOG, 0, 1, {});
+        const Frames::Bytes set = Frames::configFrame(Frames::CFG_MAP, 0, 2, {0, 1, 0, ACTION_MIDI_CC, 1, 20});
+        Frames::Bytes burst;
+        for (int i = 0; i < 4; i++)
+        {
+            burst.insert(burst.end(), log.begin(), log.end());
+            burst.insert(burst.end(), set.begin(), set.end());
+        }
+
+        long responses = 0;
+        const Clock::time_point start = Clock::now();
+        for (long it = 0; it < iterations; it++)
+        {
+            for (size_t pos = 0; pos < burst.size(); pos += 64)
+                HostSim::cdcFeed(&burst[pos], burst.size() - pos < 64 ? burst.size() - pos : 64);
+            while (HostSim::cdcPendingIn() > 0)
+                usb::task();
+            responses += (long)Frames::parseConfigResponses(HostSim::cdcTakeOutput()).size();
+            IPC::SyncMappingRequest sync;
+            while (IPC::tryDequeueSyncMapping(sync))
+            {
+            }
+        }
+        const double s = seconds(start);
+        printf("config       %8.2f MB/s %10.0f frames/s (%ld responses)\n",
+               (double)burst.size() * (double)iterations / s / 1e6, (double)responses / s, responses);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const long iterations = argc > 1 ? atol(argv[1]) : 20000;
+    HostSim::reset();
+    IPC::init();
+    MappingManager::init();
+    Port::init();
+    usb::init();
+
+    HostSim::setCore(1);
+    benchModuleParser(iterations);
+    HostSim::setCore(0);
+    benchConfigParser(iterations / 4);
+    return 0;
+}
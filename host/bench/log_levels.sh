@@ -0,0 +1,27 @@
+#!/bin/sh
+# Host proxy for what each log level costs: the size of the firmware objects
+# and the bench_loop pass times, one MinSizeRel (-Os) build per setting.
+# x86-64 sizes and times only compare the settings with each other; they do
+# not predict the RP2040 image or loop.
+#
+#   host/bench/log_levels.sh [build dir prefix] [passes]
+set -e
+
+src=$(cd "$(dirname "$0")/.." && pwd)
+prefix=${1:-build-loglevels}
+passes=${2:-200000}
+
+for setting in 0 1 2 3 4 modmsg; do
+    if [ "$setting" = modmsg ]; then
+        flags="-DDEBUG_MODULE_MESSAGES"
+    else
+        flags="-DPICONTROL_LOG_LEVEL=$setting"
+    fi
+    dir="$prefix-$setting"
+    cmake -S "$src" -B "$dir" -DPICONTROL_HOST_SANITIZE=OFF -DCMAKE_BUILD_TYPE=MinSizeRel \
+        -DCMAKE_CXX_FLAGS="$flags" >/dev/null
+    cmake --build "$dir" --target bench_loop >/dev/null
+    echo "== $flags"
+    size -t "$dir/libfirmware.a" | tail -n 1 | awk '{ printf "firmware objects: text %d, data %d, bss %d\n", $1, $2, $3 }'
+    "$dir/bench_loop" "$passes" | tail -n 2
+done
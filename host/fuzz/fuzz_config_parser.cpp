@@ -0,0 +1,118 @@
+// Fuzz target for the config protocol on the CDC interface: framing in
+// usb::task() and the command handlers behind usb::processMessage().
+//
+// Input: one mode byte, then data.
+//   mode & 1 == 0    the data arrives on the CDC in chunks of (mode >> 1) + 1
+//                    bytes, one usb::task() call each, 20 ms apart
+//   mode & 1 == 1    the data is a single command frame; its length field and
+//                    CRC are fixed up so it reaches the handlers, and it goes
+//                    straight to processMessage()
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "host_sim.h"
+#include "usb_device.h"
+#include "ipc.hpp"
+#include "mapping.h"
+#include "port.h"
+
+namespace usb
+{
+    void processMessage(uint8_t *messageBuffer, size_t length);
+}
+
+namespace
+{
+    constexpr size_t HEADER_SIZE = 6;
+    constexpr size_t MAX_INPUT = 4096;
+
+    bool setup()
+    {
+        HostSim::reset();
+        IPC::init();
+        MappingManager::init();
+        Port::init();
+        usb::init();
+        return true;
+    }
+
+    uint16_t crc16(uint16_t crc, const uint8_t *data, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            crc ^= (uint16_t)(data[i] << 8);
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        return crc;
+    }
+
+    // Core 1's side of IPC, so the queues keep accepting requests
+    void drainIpc()
+    {
+        IPC::SyncMappingRequest sync;
+        while (IPC::tryDequeueSyncMapping(sync))
+        {
+        }
+        IPC::SelectBankRequest bank;
+        while (IPC::tryDequeueSelectBank(bank))
+        {
+            MappingManager::selectBank(bank.bank);
+        }
+        IPC::SetParameterRequest param;
+        while (IPC::tryDequeueSetParameter(param))
+        {
+        }
+        IPC::SetCalibRequest calib;
+        while (IPC::tryDequeueSetCalib(calib))
+        {
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool ready = setup();
+    (void)ready;
+    if (size < 1 || size > MAX_INPUT)
+        return 0;
+    const uint8_t mode = data[0];
+    data++;
+    size--;
+
+    if (mode & 1)
+    {
+        if (size < HEADER_SIZE + 2)
+            return 0;
+        std::vector<uint8_t> frame(data, data + size);
+        const size_t payload = size - HEADER_SIZE - 2;
+        frame[0] = 0; // COMMAND
+        frame[4] = (uint8_t)(payload & 0xFF);
+        frame[5] = (uint8_t)(payload >> 8);
+        uint16_t crc = crc16(0xFFFF, frame.data(), HEADER_SIZE);
+        crc = crc16(crc, frame.data() + HEADER_SIZE + 2, payload);
+        frame[6] = (uint8_t)(crc & 0xFF);
+        frame[7] = (uint8_t)(crc >> 8);
+        usb::processMessage(frame.data(), frame.size());
+    }
+    else
+    {
+        const size_t chunk = (size_t)(mode >> 1) + 1;
+        for (size_t pos = 0; pos < size; pos += chunk)
+        {
+            HostSim::cdcFeed(data + pos, (size - pos < chunk) ? size - pos : chunk);
+            usb::task();
+            HostSim::advanceMs(20);
+        }
+        // Let the receive timeout drop whatever partial frame is left
+        for (int i = 0; i < 4; i++)
+        {
+            HostSim::advanceMs(60);
+            usb::task();
+        }
+    }
+    drainIpc();
+    HostSim::cdcTakeOutput();
+    return 0;
+}
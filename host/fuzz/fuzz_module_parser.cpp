@@ -0,0 +1,86 @@
+// Fuzz target for the module link receiver: bytes come out of the PIO RX
+// FIFO into the RX IRQ (ispio_handle_irq -> processByte) and the frames it
+// accepts land in the Port message queue.
+//
+// Input: one mode byte, then the bytes on the wire.
+//   mode % 3         link mode (LINK_MODE_SUM8, _CRC16, _COBS)
+//   mode & 0x04      a CMD_SET_LINK_MODE to the next mode is pending, so an
+//                    acknowledgement switches the parser mid-stream
+//   mode & 0x08      a 60 ms gap after every 32 bytes (parser timeouts)
+#include <cstdio>
+#include <cstdlib>
+
+#include "host_sim.h"
+#include "boardconfig.h"
+#include "port.h"
+#include "stats.h"
+
+namespace
+{
+    // RX FIFO depth with the TX FIFO joined in: the IRQ sees at most this
+    // many bytes per run
+    constexpr size_t FIFO_DEPTH = 8;
+    constexpr uint32_t BYTE_US = 87; // 10 bits at 115200 baud
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+
+    InterruptSerialPIO *setup()
+    {
+        HostSim::reset();
+        HostSim::setCore(1);
+        Port::init();
+        InterruptSerialPIO *serial = modulePorts[ROW][COL];
+        ispio_set_port_location(serial, ROW, COL);
+        return serial;
+    }
+
+    void check(bool ok, const char *what)
+    {
+        if (!ok)
+        {
+            fprintf(stderr, "fuzz_module_parser: %s\n", what);
+            abort();
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static InterruptSerialPIO *serial = setup();
+    if (size < 1)
+        return 0;
+    const uint8_t mode = data[0];
+    data++;
+    size--;
+
+    ispio_end(serial);
+    ispio_begin(serial, ISPIO_FIXED_BAUD);
+    ispio_set_link_mode(serial, (uint8_t)(mode % 3));
+    if (mode & 0x04)
+        ispio_request_link_mode(serial, (uint8_t)((mode + 1) % 3));
+    const unsigned pio = pio_get_index(serial->rxPIO);
+    const unsigned sm = (unsigned)serial->rxSM;
+
+    for (size_t pos = 0; pos < size;)
+    {
+        const size_t n = (size - pos < FIFO_DEPTH) ? size - pos : FIFO_DEPTH;
+        if ((mode & 0x08) && pos % 32 < n && pos > 0)
+            HostSim::advanceMs(60);
+        HostSim::pushRx(pio, sm, data + pos, n);
+        HostSim::advanceUs(n * BYTE_US);
+        HostSim::runPioIrq(pio);
+        check(HostSim::rxPending(pio, sm) == 0, "RX IRQ left bytes in the FIFO");
+        pos += n;
+
+        ModuleMessage msg;
+        while (Port::getNextMessage(msg))
+        {
+            check(msg.moduleRow == ROW && msg.moduleCol == COL, "message tagged with the wrong port");
+            check(msg.payloadLength <= sizeof(msg.payload), "payload length over the buffer");
+        }
+    }
+
+    check(serial->parser.length <= sizeof(serial->parser.buffer), "parser length over the buffer");
+    check(serial->linkMode <= LINK_MODE_COBS, "unknown link mode");
+    return 0;
+}
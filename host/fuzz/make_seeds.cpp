@@ -0,0 +1,178 @@
+// Writes the seed corpus for the fuzz targets: valid frames of every link
+// mode and config command, so mutations start past the checksums.
+//
+//   make_seeds <corpus dir>
+//
+// The output is checked in under corpus/; rerun after a wire format change.
+#include <cstdio>
+#include <string>
+
+#include "frames.h"
+#include "module_mapping_config.h"
+
+using Frames::Bytes;
+
+namespace
+{
+    std::string g_dir;
+
+    void write(const std::string &target, const std::string &name, uint8_t mode, const Bytes &data)
+    {
+        const std::string path = g_dir + "/" + target + "/" + name;
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            perror(path.c_str());
+            return;
+        }
+        fputc(mode, f);
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+    }
+
+    Bytes cat(std::initializer_list<Bytes> parts)
+    {
+        Bytes out;
+        for (const Bytes &p : parts)
+            out.insert(out.end(), p.begin(), p.end());
+        return out;
+    }
+
+    Bytes paramValue(uint8_t pid, int32_t value)
+    {
+        Bytes b{pid};
+        Frames::appendValue(b, value);
+        return b;
+    }
+
+    Bytes properties()
+    {
+        Module m{};
+        snprintf(m.name, sizeof(m.name), "Fader");
+        snprintf(m.manufacturer, sizeof(m.manufacturer), "Picontrol");
+        snprintf(m.fwVersion, sizeof(m.fwVersion), "1.0");
+        m.capabilities = MODULE_CAP_AUTOUPDATE | MODULE_CAP_CRC16 | MODULE_CAP_COBS;
+        m.parameterCount = 1;
+        m.parameters[0].id = 0;
+        snprintf(m.parameters[0].name, sizeof(m.parameters[0].name), "Position");
+        m.parameters[0].dataType = ModuleParameterDataType::PARAM_TYPE_INT;
+        m.parameters[0].access = ACCESS_READ;
+        m.parameters[0].minMax.intMin = 0;
+        m.parameters[0].minMax.intMax = 1023;
+        Bytes b{0}; // request id
+        Frames::append(b, &m, offsetof(Module, parameters) + sizeof(ModuleParameter));
+        return b;
+    }
+
+    void moduleSeeds()
+    {
+        const std::string t = "fuzz_module_parser";
+        const char *names[] = {"sum8", "crc16", "cobs"};
+        for (uint8_t mode = LINK_MODE_SUM8; mode <= LINK_MODE_COBS; mode++)
+        {
+            const std::string n = names[mode];
+            write(t, n + "_param.bin", mode, Frames::moduleResponse(mode, CMD_GET_PARAMETER, MODULE_STATUS_OK, paramValue(0, 512)));
+            write(t, n + "_properties.bin", mode, Frames::moduleResponse(mode, CMD_GET_PROPERTIES, MODULE_STATUS_OK, properties()));
+            write(t, n + "_burst.bin", mode,
+                  cat({Frames::moduleResponse(mode, CMD_GET_PARAMETER, MODULE_STATUS_OK, paramValue(0, 1)), {0x13, 0x37},
+                       Frames::moduleResponse(mode, CMD_SET_PARAMETER, MODULE_STATUS_OK, {}),
+                       Frames::moduleResponse(mode, CMD_GET_PARAMETER, MODULE_STATUS_OK, paramValue(1, -5))}));
+            // Split by a 60 ms gap after 32 bytes
+            write(t, n + "_gap.bin", (uint8_t)(mode | 0x08),
+                  cat({Frames::moduleResponse(mode, CMD_GET_PROPERTIES, MODULE_STATUS_OK, properties()),
+                       Frames::moduleResponse(mode, CMD_GET_PARAMETER, MODULE_STATUS_OK, paramValue(0, 7))}));
+        }
+        // Link mode acknowledged mid-stream: the next frame is in the new framing
+        for (uint8_t mode = LINK_MODE_SUM8; mode <= LINK_MODE_CRC16; mode++)
+        {
+            const uint8_t next = (uint8_t)(mode + 1);
+            write(t, std::string("switch_to_") + names[next] + ".bin", (uint8_t)(mode | 0x04),
+                  cat({Frames::moduleResponse(mode, CMD_SET_LINK_MODE, MODULE_STATUS_OK, {}),
+                       Frames::moduleResponse(next, CMD_GET_PARAMETER, MODULE_STATUS_OK, paramValue(0, 99))}));
+        }
+        write(t, "switch_refused.bin", 0x04,
+              cat({Frames::moduleResponse(LINK_MODE_SUM8, CMD_SET_LINK_MODE, MODULE_STATUS_ERROR, {}),
+                   Frames::moduleResponse(LINK_MODE_SUM8, CMD_GET_PARAMETER, MODULE_STATUS_OK, paramValue(0, 3))}));
+    }
+
+    Bytes mapping(int row, int col, uint8_t pid, uint8_t target)
+    {
+        ModuleMapping m{};
+        m.row = row;
+        m.col = col;
+        m.paramId = pid;
+        m.type = ACTION_MIDI_CC;
+        m.curve.h = 16384;
+        m.target.midiCC.channel = 1;
+        m.target.midiCC.ccNumber = (uint8_t)(20 + pid);
+        m.targetIndex = target;
+        Bytes b;
+        Frames::appendValue(b, m);
+        return b;
+    }
+
+    void configSeeds()
+    {
+        using namespace Frames;
+        const std::string t = "fuzz_config_parser";
+        Curve curve{};
+        curve.h = 16384;
+        Bytes setCurve{0, 1, 0};
+        appendValue(setCurve, curve);
+        Bytes bulk{2};
+        bulk = cat({bulk, mapping(0, 1, 0, 0), mapping(0, 1, 0, 1)});
+        const uint8_t since[4] = {1, 0, 0, 0};
+
+        const struct
+        {
+            const char *name;
+            Bytes frame;
+        } frames[] = {
+            {"map_set", configFrame(CFG_MAP, 0, 1, {0, 1, 0, ACTION_MIDI_CC, 1, 20})},
+            {"map_set_target", configFrame(CFG_MAP, 0, 2, {0, 1, 0, ACTION_MIDI_NRPN, 1, 2, 3, 1})},
+            {"map_set_curve", configFrame(CFG_MAP, 1, 3, setCurve)},
+            {"map_del", configFrame(CFG_MAP, 2, 4, {0, 1, 0})},
+            {"map_list", configFrame(CFG_MAP, 3, 5, {})},
+            {"map_clear", configFrame(CFG_MAP, 4, 6, {})},
+            {"map_bulk_set", configFrame(CFG_MAP, 5, 7, bulk)},
+            {"map_bank_query", configFrame(CFG_MAP, 6, 8, {})},
+            {"map_bank_select", configFrame(CFG_MAP, 6, 9, {2, 1})},
+            {"map_set_options", configFrame(CFG_MAP, 7, 10, {0, 1, 0, 4, 3, 10, MAPPING_OPTION_PICKUP})},
+            {"modules_list", configFrame(CFG_MODULES, 0, 11, {})},
+            {"modules_param_set", configFrame(CFG_MODULES, 1, 12, {0, 1, 0, 0, '5', '1', '2'})},
+            {"modules_calib_set", configFrame(CFG_MODULES, 2, 13, {0, 1, 0, 0, 0, 0, 0xFF, 0x03})},
+            {"modules_list_since", configFrame(CFG_MODULES, 3, 14, Bytes(since, since + 4))},
+            {"log_get", configFrame(CFG_LOG, 0, 15, {})},
+            {"log_set", configFrame(CFG_LOG, 1, 16, {3, 0x3F})},
+            {"stats_get", configFrame(CFG_STATS, 0, 17, {1})},
+            {"stats_profile", configFrame(CFG_STATS, 1, 18, {})},
+        };
+        Bytes pipelined;
+        for (const auto &f : frames)
+        {
+            // Sealed: straight to processMessage()
+            write(t, std::string(f.name) + ".bin", 1, f.frame);
+            pipelined = cat({pipelined, f.frame});
+        }
+        // Streamed through usb::task(): 64-byte USB packets, and byte by byte
+        write(t, "pipelined_64.bin", (uint8_t)(63 << 1), pipelined);
+        write(t, "pipelined_1.bin", 0, cat({configFrame(CFG_MAP, 0, 1, {0, 1, 0, ACTION_MIDI_CC, 1, 20}), configFrame(CFG_LOG, 0, 2, {})}));
+        // A frame cut short, then a good one after the timeout
+        Bytes cut = configFrame(CFG_MAP, 3, 3, {});
+        cut.resize(5);
+        write(t, "truncated_then_ok.bin", (uint8_t)(7 << 1), cat({cut, configFrame(CFG_LOG, 0, 4, {})}));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <corpus dir>\n", argv[0]);
+        return 1;
+    }
+    g_dir = argv[1];
+    moduleSeeds();
+    configSeeds();
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Driver for fuzz targets when libFuzzer is not available (GCC builds).
+//
+//   fuzz_x FILE|DIR...             run every input once (AFL: fuzz_x @@)
+//   fuzz_x -runs=N [-seed=S] DIR   also run N mutations of the inputs: bit
+//                                  flips, byte changes, truncation, splices
+//
+// Crashes and sanitizer reports abort the process like under libFuzzer.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace
+{
+    using Input = std::vector<uint8_t>;
+
+    bool readFile(const std::string &path, Input &out)
+    {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        out.clear();
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            out.insert(out.end(), buf, buf + n);
+        fclose(f);
+        return true;
+    }
+
+    void collect(const std::string &path, std::vector<Input> &inputs)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+        {
+            fprintf(stderr, "cannot open %s\n", path.c_str());
+            exit(1);
+        }
+        if (!S_ISDIR(st.st_mode))
+        {
+            Input in;
+            if (readFile(path, in))
+                inputs.push_back(in);
+            return;
+        }
+        DIR *dir = opendir(path.c_str());
+        std::vector<std::string> names;
+        while (dirent *e = readdir(dir))
+        {
+            if (e->d_name[0] != '.')
+                names.push_back(e->d_name);
+        }
+        closedir(dir);
+        for (const std::string &name : names)
+            collect(path + "/" + name, inputs);
+    }
+
+    Input mutate(const std::vector<Input> &inputs, std::mt19937 &rng)
+    {
+        Input in = inputs[rng() % inputs.size()];
+        const int edits = 1 + (int)(rng() % 4);
+        for (int e = 0; e < edits; e++)
+        {
+            switch (rng() % 5)
+            {
+            case 0: // bit flip
+                if (!in.empty())
+                    in[rng() % in.size()] ^= (uint8_t)(1u << (rng() % 8));
+                break;
+            case 1: // random byte
+                if (!in.empty())
+                    in[rng() % in.size()] = (uint8_t)rng();
+                break;
+            case 2: // truncate
+                if (!in.empty())
+                    in.resize(rng() % in.size());
+                break;
+            case 3: // drop a byte
+                if (in.size() > 1)
+                    in.erase(in.begin() + (long)(rng() % in.size()));
+                break;
+            default: // append part of another input
+            {
+                const Input &other = inputs[rng() % inputs.size()];
+                if (!other.empty())
+                {
+                    const size_t from = rng() % other.size();
+                    in.insert(in.end(), other.begin() + (long)from, other.end());
+                }
+                break;
+            }
+            }
+        }
+        return in;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long runs = 0;
+    unsigned seed = 1;
+    std::vector<Input> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+            runs = atol(argv[i] + 6);
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+            seed = (unsigned)atol(argv[i] + 6);
+        else if (argv[i][0] == '-')
+            continue; // other libFuzzer flags
+        else
+            collect(argv[i], inputs);
+    }
+    if (inputs.empty())
+    {
+        fprintf(stderr, "usage: %s [-runs=N] [-seed=S] FILE|DIR...\n", argv[0]);
+        return 1;
+    }
+
+    for (const Input &in : inputs)
+        LLVMFuzzerTestOneInput(in.data(), in.size());
+    std::mt19937 rng(seed);
+    for (long r = 0; r < runs; r++)
+    {
+        const Input in = mutate(inputs, rng);
+        LLVMFuzzerTestOneInput(in.data(), in.size());
+    }
+    printf("%zu inputs, %ld mutations: ok\n", inputs.size(), runs);
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for the TinyUSB Arduino classes; MIDI packets in and HID
+// reports out go through host_sim.h
+#include <Arduino.h>
+#include "tusb.h"
+struct TinyUSBDeviceStub { void setConfigurationBuffer(uint8_t*, size_t); bool isInitialized(); void begin(int); bool mounted(); void detach(); void attach(); };
+extern TinyUSBDeviceStub TinyUSBDevice;
+struct Adafruit_USBD_MIDI { void setStringDescriptor(const char*); int available(); int read(); size_t write(uint8_t); bool readPacket(uint8_t p[4]); bool writePacket(const uint8_t p[4]); void begin(unsigned long=0);};
+struct Adafruit_USBD_HID { void setBootProtocol(int); void setPollInterval(int); void setReportDescriptor(const uint8_t*, size_t); void setStringDescriptor(const char*); void begin(); bool ready(); bool keyboardReport(uint8_t, uint8_t, uint8_t*); };
@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: the config CDC reads what tests feed and collects what the
+// firmware writes (host_sim.h)
+#include <Arduino.h>
+struct Adafruit_USBD_CDC { void setStringDescriptor(const char*); void begin(unsigned long); explicit operator bool() const; int available(); int read(); size_t read(uint8_t*, size_t); size_t write(const uint8_t*, size_t); size_t write(uint8_t); void flush(); int availableForWrite(); };
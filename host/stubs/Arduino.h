@@ -0,0 +1,35 @@
+#pragma once
+// Host stand-in for the Arduino-Pico core: time, pins and Serial come from
+// the simulation in host_sim.cpp
+#include <cstdint>
+#include <cstddef>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pico/time.h"
+#include "pico/sync.h"
+#include "hardware/gpio.h"
+#define HIGH 1
+#define LOW 0
+#define INPUT_PULLDOWN 3
+#define INPUT 0
+#define OUTPUT 1
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t);
+void pinMode(uint8_t, int);
+int digitalRead(uint8_t);
+void noInterrupts();
+void interrupts();
+void yield();
+struct HardwareSerialStub {
+  void begin(unsigned long);
+  int availableForWrite();
+  size_t write(const uint8_t*, size_t);
+  size_t write(uint8_t);
+  int available(); int read(); void flush();
+  explicit operator bool() const;
+};
+extern HardwareSerialStub Serial;
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in for the MIDI library: sent messages are recorded (host_sim.h)
+#include <cstdint>
+#define MIDI_CHANNEL_OMNI 0
+struct MidiStub { void begin(int); void sendNoteOn(uint8_t,uint8_t,uint8_t); void sendNoteOff(uint8_t,uint8_t,uint8_t); void sendControlChange(uint8_t,uint8_t,uint8_t); void sendPitchBend(int,uint8_t); bool read(); uint8_t getType(); uint8_t getChannel(); uint8_t getData1(); uint8_t getData2(); void setHandleControlChange(void(*)(uint8_t,uint8_t,uint8_t)); void turnThruOff();};
+#define MIDI_CREATE_INSTANCE(T, port, name) static MidiStub name;
@@ -0,0 +1,4 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include "pico/types.h"
+enum { clk_sys }; uint32_t clock_get_hz(int);
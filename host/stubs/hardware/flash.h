@@ -0,0 +1,10 @@
+#pragma once
+// Host stand-in: flash is a RAM array that starts at the filesystem partition
+// (_FS_start, see host_sim.cpp), so partition offsets are array offsets
+#include "pico/types.h"
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define FLASH_BLOCK_SIZE (1u << 16)
+extern "C" uint8_t _FS_start;
+#define XIP_BASE ((uintptr_t)&_FS_start)
+void flash_range_erase(uint32_t, size_t); void flash_range_program(uint32_t, const uint8_t*, size_t);
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include "pico/types.h"
+void gpio_init(uint); void gpio_set_dir(uint, bool); void gpio_put(uint, bool); void gpio_pull_down(uint);
+#define GPIO_OUT 1
+void gpio_pull_up(uint); void gpio_set_function(uint, int);
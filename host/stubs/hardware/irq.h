@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: handlers are stored and run by tests (host_sim.h)
+#include "pico/types.h"
+enum { TIMER_IRQ_0 = 0, TIMER_IRQ_1 = 1, TIMER_IRQ_2 = 2, TIMER_IRQ_3 = 3, PIO0_IRQ_0 = 7, PIO1_IRQ_0 = 9 };
+void irq_set_exclusive_handler(uint, void (*)()); void irq_set_enabled(uint, bool);
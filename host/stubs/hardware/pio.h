@@ -0,0 +1,24 @@
+#pragma once
+// Host stand-in: RX FIFOs are fed by tests (host_sim.h), the rest only keeps
+// the state the firmware reads back
+#include "pico/types.h"
+typedef struct { volatile uint32_t pinctrl; volatile uint32_t execctrl; } pio_sm_hw_t;
+typedef struct pio_hw_t_ { pio_sm_hw_t sm[4]; } *PIO;
+void hw_write_masked(volatile uint32_t*, uint32_t, uint32_t); void hw_set_bits(volatile uint32_t*, uint32_t);
+enum { PIO_SM0_PINCTRL_IN_BASE_LSB=15, PIO_SM0_PINCTRL_IN_BASE_BITS=0xf8000, PIO_SM0_EXECCTRL_JMP_PIN_LSB=24, PIO_SM0_EXECCTRL_JMP_PIN_BITS=0x1f000000 };
+uint8_t pio_sm_get_pc(PIO, uint);
+extern PIO pio0; extern PIO pio1;
+typedef struct { uint in_base; uint jmp_pin; } pio_sm_config;
+struct pio_program { const uint16_t* instructions; uint8_t length; int8_t origin; uint8_t pio_version; };
+enum pio_interrupt_source { pis_sm0_rx_fifo_not_empty, pis_sm1_rx_fifo_not_empty, pis_sm2_rx_fifo_not_empty, pis_sm3_rx_fifo_not_empty };
+enum { PIO_FIFO_JOIN_RX };
+int pio_claim_unused_sm(PIO, bool); uint pio_add_program(PIO, const pio_program*);
+void sm_config_set_in_pins(pio_sm_config*, uint); void sm_config_set_jmp_pin(pio_sm_config*, uint);
+void sm_config_set_in_shift(pio_sm_config*, bool, bool, uint); void sm_config_set_fifo_join(pio_sm_config*, int);
+void sm_config_set_clkdiv(pio_sm_config*, float); pio_sm_config pio_get_default_sm_config();
+void sm_config_set_wrap(pio_sm_config*, uint, uint);
+void pio_sm_init(PIO, uint, uint, const pio_sm_config*); void pio_sm_set_consecutive_pindirs(PIO, uint, uint, uint, bool);
+void pio_gpio_init(PIO, uint); void pio_sm_clear_fifos(PIO, uint); void pio_set_irq0_source_enabled(PIO, pio_interrupt_source, bool);
+uint pio_get_index(PIO); void pio_sm_set_enabled(PIO, uint, bool); void pio_sm_unclaim(PIO, uint); bool pio_sm_is_claimed(PIO, uint);
+void pio_sm_claim(PIO, uint); bool pio_sm_is_rx_fifo_empty(PIO, uint); uint32_t pio_sm_get_blocking(PIO, uint); uint32_t pio_sm_get(PIO, uint);
+void pio_sm_restart(PIO, uint); void pio_sm_exec(PIO, uint, uint); uint pio_encode_jmp(uint);
@@ -0,0 +1,10 @@
+#pragma once
+// Host stand-in. SysTick follows the simulated clock at 125 MHz, and each read
+// of CVR lets a microsecond pass so busy-waits on it (the soft UART) finish.
+// SIO GPIO writes are recorded per pin so tests can decode soft UART output.
+#include <cstdint>
+struct HostSysTickCvr { operator uint32_t() const volatile; void operator=(uint32_t) volatile; };
+struct systick_hw_t { volatile uint32_t csr, rvr; HostSysTickCvr cvr; volatile uint32_t calib; }; extern systick_hw_t *systick_hw;
+struct HostGpioSet { void operator=(uint32_t) volatile; };
+struct HostGpioClr { void operator=(uint32_t) volatile; };
+struct sio_hw_t { HostGpioSet gpio_set; HostGpioClr gpio_clr; volatile uint32_t cpuid; }; extern sio_hw_t *sio_hw;
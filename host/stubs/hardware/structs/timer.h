@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include "pico/types.h"
+typedef struct { volatile uint32_t alarm[4]; volatile uint32_t timerawl; volatile uint32_t intr; volatile uint32_t inte; } timer_hw_t;
+extern timer_hw_t *timer_hw;
@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include "pico/sync.h"
@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include "pico/types.h"
+uint64_t time_us_64(); uint32_t time_us_32();
+int hardware_alarm_claim_unused(bool);
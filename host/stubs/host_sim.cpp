@@ -0,0 +1,556 @@
+#include "host_sim.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+
+#include <Arduino.h>
+#include <Adafruit_TinyUSB.h>
+#include <Adafruit_USBD_CDC.h>
+#include <MIDI.h>
+#include <tusb.h>
+#include <hardware/clocks.h>
+#include <hardware/flash.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/pio.h>
+#include <hardware/structs/systick.h>
+#include <hardware/structs/timer.h>
+#include <hardware/timer.h>
+#include <pico/multicore.h>
+#include <pico/util/queue.h>
+
+// Filesystem partition, board_build.filesystem_size = 0.5m. Defined in asm so
+// _FS_end lands right after it, as with the firmware's linker symbols.
+static constexpr size_t FLASH_FS_SIZE = 512 * 1024;
+__asm__(".pushsection .bss\n"
+        ".globl _FS_start\n"
+        ".globl _FS_end\n"
+        ".balign 4096\n"
+        "_FS_start:\n"
+        ".skip 524288\n"
+        "_FS_end:\n"
+        ".popsection\n");
+extern "C" uint8_t _FS_end;
+
+namespace
+{
+    constexpr uint32_t CPU_HZ = 125000000;
+    constexpr int GPIO_COUNT = 30;
+    constexpr int IRQ_COUNT = 32;
+
+    std::atomic<uint64_t> g_nowUs{0};
+
+    // The partition as an opaque pointer: _FS_start is declared as one byte
+    uint8_t *fsBase()
+    {
+        uint8_t *p = &_FS_start;
+        __asm__("" : "+r"(p));
+        return p;
+    }
+    thread_local unsigned g_core = 0;
+
+    struct SimSM
+    {
+        std::deque<uint8_t> fifo;
+        bool claimed;
+        bool enabled;
+        uint pc;
+    };
+    pio_hw_t_ g_pioHw[2];
+    SimSM g_sm[2][4];
+
+    void (*g_irqHandler[IRQ_COUNT])() = {};
+    bool g_irqEnabled[IRQ_COUNT] = {};
+    bool g_alarmClaimed[4] = {};
+
+    int g_pinLevel[GPIO_COUNT] = {};
+
+    // Soft UART decoding: start bit, 8 data bits LSB first, stop bit, one SIO
+    // write each
+    struct TxPin
+    {
+        int bit; // 0 = waiting for a start bit
+        uint8_t value;
+        std::vector<uint8_t> bytes;
+    };
+    TxPin g_tx[GPIO_COUNT];
+
+    std::deque<uint8_t> g_cdcIn;
+    std::vector<uint8_t> g_cdcOut;
+    std::deque<std::array<uint8_t, 4>> g_midiIn;
+    std::vector<HostSim::MidiEvent> g_midiSent;
+
+    uint32_t g_flashErases = 0;
+    uint32_t g_flashPrograms = 0;
+
+    void gpioWrite(uint32_t mask, int level)
+    {
+        for (int pin = 0; pin < GPIO_COUNT; pin++)
+        {
+            if (!(mask & (1u << pin)))
+                continue;
+            TxPin &t = g_tx[pin];
+            if (t.bit == 0)
+            {
+                if (level == 0)
+                {
+                    t.bit = 1;
+                    t.value = 0;
+                }
+            }
+            else if (t.bit <= 8)
+            {
+                t.value = (uint8_t)(t.value | (level << (t.bit - 1)));
+                t.bit++;
+            }
+            else
+            {
+                if (level)
+                    t.bytes.push_back(t.value);
+                t.bit = 0;
+            }
+        }
+    }
+
+    uint8_t *flashAt(uint32_t offset, size_t len)
+    {
+        if (offset > FLASH_FS_SIZE || len > FLASH_FS_SIZE - offset)
+        {
+            fprintf(stderr, "host_sim: flash access outside the partition (offset %u, %zu bytes)\n", offset, len);
+            abort();
+        }
+        return fsBase() + offset;
+    }
+}
+
+// pico/time.h, hardware/timer.h, Arduino time
+absolute_time_t get_absolute_time() { return g_nowUs.load(); }
+uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+uint64_t time_us_64() { return g_nowUs.load(); }
+uint32_t time_us_32() { return (uint32_t)g_nowUs.load(); }
+uint32_t millis() { return (uint32_t)(g_nowUs.load() / 1000); }
+uint32_t micros() { return (uint32_t)g_nowUs.load(); }
+void delay(uint32_t ms) { g_nowUs += (uint64_t)ms * 1000; }
+void yield() {}
+
+// Locks and interrupt masking
+void critical_section_init(critical_section_t *) {}
+void critical_section_enter_blocking(critical_section_t *) {}
+void critical_section_exit(critical_section_t *) {}
+uint32_t save_and_disable_interrupts() { return 0; }
+void restore_interrupts(uint32_t) {}
+void restore_interrupts_from_disabled(uint32_t) {}
+void __dmb() { std::atomic_thread_fence(std::memory_order_seq_cst); }
+void __compiler_memory_barrier() { std::atomic_signal_fence(std::memory_order_seq_cst); }
+uint get_core_num() { return g_core; }
+void noInterrupts() {}
+void interrupts() {}
+void mutex_init(mutex_t *) {}
+bool mutex_try_enter(mutex_t *, uint32_t *) { return true; }
+void mutex_exit(mutex_t *) {}
+void mutex_enter_blocking(mutex_t *) {}
+void multicore_lockout_start_blocking() {}
+void multicore_lockout_end_blocking() {}
+void multicore_lockout_victim_init() {}
+
+// pico/util/queue.h
+void queue_init(queue_t *q, uint elementSize, uint count)
+{
+    q->data = static_cast<uint8_t *>(calloc(count, elementSize));
+    q->elementSize = elementSize;
+    q->capacity = count;
+    q->head = 0;
+    q->level = 0;
+}
+
+bool queue_try_add(queue_t *q, const void *item)
+{
+    if (q->level == q->capacity)
+        return false;
+    const uint slot = (q->head + q->level) % q->capacity;
+    memcpy(q->data + slot * q->elementSize, item, q->elementSize);
+    q->level++;
+    return true;
+}
+
+bool queue_try_peek(queue_t *q, void *item)
+{
+    if (q->level == 0)
+        return false;
+    memcpy(item, q->data + q->head * q->elementSize, q->elementSize);
+    return true;
+}
+
+bool queue_try_remove(queue_t *q, void *item)
+{
+    if (!queue_try_peek(q, item))
+        return false;
+    q->head = (q->head + 1) % q->capacity;
+    q->level--;
+    return true;
+}
+
+uint queue_get_level(queue_t *q) { return q->level; }
+bool queue_is_full(queue_t *q) { return q->level == q->capacity; }
+
+// GPIO, clocks, IRQs
+uint32_t clock_get_hz(int) { return CPU_HZ; }
+void gpio_init(uint) {}
+void gpio_set_dir(uint, bool) {}
+void gpio_put(uint, bool) {}
+void gpio_pull_down(uint) {}
+void gpio_pull_up(uint) {}
+void gpio_set_function(uint, int) {}
+void pinMode(uint8_t, int) {}
+int digitalRead(uint8_t pin) { return pin < GPIO_COUNT ? g_pinLevel[pin] : LOW; }
+
+void irq_set_exclusive_handler(uint irq, void (*handler)())
+{
+    if (irq < IRQ_COUNT)
+        g_irqHandler[irq] = handler;
+}
+
+void irq_set_enabled(uint irq, bool enabled)
+{
+    if (irq < IRQ_COUNT)
+        g_irqEnabled[irq] = enabled;
+}
+
+static systick_hw_t g_systick{};
+systick_hw_t *systick_hw = &g_systick;
+static sio_hw_t g_sio{};
+sio_hw_t *sio_hw = &g_sio;
+static timer_hw_t g_timer{};
+timer_hw_t *timer_hw = &g_timer;
+
+HostSysTickCvr::operator uint32_t() const volatile
+{
+    const uint64_t us = ++g_nowUs;
+    return 0x00FFFFFFu - (uint32_t)((us * (CPU_HZ / 1000000u)) & 0x00FFFFFFu);
+}
+
+void HostSysTickCvr::operator=(uint32_t) volatile {}
+void HostGpioSet::operator=(uint32_t mask) volatile { gpioWrite(mask, 1); }
+void HostGpioClr::operator=(uint32_t mask) volatile { gpioWrite(mask, 0); }
+
+int hardware_alarm_claim_unused(bool)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (!g_alarmClaimed[i])
+        {
+            g_alarmClaimed[i] = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void hw_write_masked(volatile uint32_t *addr, uint32_t values, uint32_t mask) { *addr = (*addr & ~mask) | (values & mask); }
+void hw_set_bits(volatile uint32_t *addr, uint32_t mask) { *addr = *addr | mask; }
+
+// PIO
+PIO pio0 = &g_pioHw[0];
+PIO pio1 = &g_pioHw[1];
+
+uint pio_get_index(PIO pio) { return pio == pio1 ? 1 : 0; }
+static SimSM &sm(PIO pio, uint index) { return g_sm[pio_get_index(pio)][index & 3]; }
+
+int pio_claim_unused_sm(PIO pio, bool)
+{
+    for (uint i = 0; i < 4; i++)
+    {
+        if (!sm(pio, i).claimed)
+        {
+            sm(pio, i).claimed = true;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void pio_sm_claim(PIO pio, uint index) { sm(pio, index).claimed = true; }
+void pio_sm_unclaim(PIO pio, uint index) { sm(pio, index).claimed = false; }
+bool pio_sm_is_claimed(PIO pio, uint index) { return sm(pio, index).claimed; }
+uint pio_add_program(PIO, const pio_program *) { return 0; }
+pio_sm_config pio_get_default_sm_config() { return pio_sm_config{}; }
+void sm_config_set_in_pins(pio_sm_config *c, uint pin) { c->in_base = pin; }
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) { c->jmp_pin = pin; }
+void sm_config_set_in_shift(pio_sm_config *, bool, bool, uint) {}
+void sm_config_set_fifo_join(pio_sm_config *, int) {}
+void sm_config_set_clkdiv(pio_sm_config *, float) {}
+void sm_config_set_wrap(pio_sm_config *, uint, uint) {}
+
+void pio_sm_init(PIO pio, uint index, uint offset, const pio_sm_config *c)
+{
+    pio->sm[index].pinctrl = c->in_base << PIO_SM0_PINCTRL_IN_BASE_LSB;
+    pio->sm[index].execctrl = c->jmp_pin << PIO_SM0_EXECCTRL_JMP_PIN_LSB;
+    sm(pio, index).pc = offset;
+    sm(pio, index).enabled = false;
+}
+
+void pio_sm_set_consecutive_pindirs(PIO, uint, uint, uint, bool) {}
+void pio_gpio_init(PIO, uint) {}
+void pio_sm_clear_fifos(PIO pio, uint index) { sm(pio, index).fifo.clear(); }
+void pio_set_irq0_source_enabled(PIO, pio_interrupt_source, bool) {}
+void pio_sm_set_enabled(PIO pio, uint index, bool enabled) { sm(pio, index).enabled = enabled; }
+void pio_sm_restart(PIO, uint) {}
+uint pio_encode_jmp(uint addr) { return addr; }
+void pio_sm_exec(PIO pio, uint index, uint instr) { sm(pio, index).pc = instr & 0x1F; }
+uint8_t pio_sm_get_pc(PIO pio, uint index) { return (uint8_t)sm(pio, index).pc; }
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint index) { return sm(pio, index).fifo.empty(); }
+
+uint32_t pio_sm_get(PIO pio, uint index)
+{
+    SimSM &s = sm(pio, index);
+    if (s.fifo.empty())
+        return 0;
+    const uint8_t b = s.fifo.front();
+    s.fifo.pop_front();
+    return (uint32_t)b << 24; // shifted in from the left
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint index) { return pio_sm_get(pio, index); }
+
+// Flash: erase sets bytes to 0xFF, programming can only clear bits. Both take
+// the W25Q16JV's typical time on the simulated clock (tSE 45 ms per sector,
+// tPP 0.4 ms per page).
+void flash_range_erase(uint32_t offset, size_t len)
+{
+    memset(flashAt(offset, len), 0xFF, len);
+    g_nowUs += (uint64_t)(len / FLASH_SECTOR_SIZE) * 45000;
+    g_flashErases++;
+}
+
+void flash_range_program(uint32_t offset, const uint8_t *data, size_t len)
+{
+    uint8_t *dst = flashAt(offset, len);
+    for (size_t i = 0; i < len; i++)
+        dst[i] &= data[i];
+    g_nowUs += (uint64_t)(len / FLASH_PAGE_SIZE) * 400;
+    g_flashPrograms++;
+}
+
+// Serial: debug output, shown with PICONTROL_HOST_LOG set
+HardwareSerialStub Serial;
+static bool hostLogOn()
+{
+    static const bool on = getenv("PICONTROL_HOST_LOG") != nullptr;
+    return on;
+}
+void HardwareSerialStub::begin(unsigned long) {}
+int HardwareSerialStub::availableForWrite() { return 4096; }
+size_t HardwareSerialStub::write(const uint8_t *data, size_t len)
+{
+    if (hostLogOn())
+        fwrite(data, 1, len, stderr);
+    return len;
+}
+size_t HardwareSerialStub::write(uint8_t b) { return write(&b, 1); }
+int HardwareSerialStub::available() { return 0; }
+int HardwareSerialStub::read() { return -1; }
+void HardwareSerialStub::flush() {}
+HardwareSerialStub::operator bool() const { return true; }
+
+// TinyUSB
+TinyUSBDeviceStub TinyUSBDevice;
+void TinyUSBDeviceStub::setConfigurationBuffer(uint8_t *, size_t) {}
+bool TinyUSBDeviceStub::isInitialized() { return true; }
+void TinyUSBDeviceStub::begin(int) {}
+bool TinyUSBDeviceStub::mounted() { return true; }
+void TinyUSBDeviceStub::detach() {}
+void TinyUSBDeviceStub::attach() {}
+uint32_t tud_cdc_n_write_available(uint8_t) { return 4096; }
+
+void Adafruit_USBD_CDC::setStringDescriptor(const char *) {}
+void Adafruit_USBD_CDC::begin(unsigned long) {}
+Adafruit_USBD_CDC::operator bool() const { return true; }
+int Adafruit_USBD_CDC::available() { return (int)g_cdcIn.size(); }
+int Adafruit_USBD_CDC::read()
+{
+    if (g_cdcIn.empty())
+        return -1;
+    const uint8_t b = g_cdcIn.front();
+    g_cdcIn.pop_front();
+    return b;
+}
+size_t Adafruit_USBD_CDC::read(uint8_t *buf, size_t len)
+{
+    size_t n = 0;
+    for (; n < len && !g_cdcIn.empty(); n++)
+    {
+        buf[n] = g_cdcIn.front();
+        g_cdcIn.pop_front();
+    }
+    return n;
+}
+size_t Adafruit_USBD_CDC::write(const uint8_t *data, size_t len)
+{
+    g_cdcOut.insert(g_cdcOut.end(), data, data + len);
+    return len;
+}
+size_t Adafruit_USBD_CDC::write(uint8_t b) { return write(&b, 1); }
+void Adafruit_USBD_CDC::flush() {}
+int Adafruit_USBD_CDC::availableForWrite() { return 4096; }
+
+void Adafruit_USBD_MIDI::setStringDescriptor(const char *) {}
+int Adafruit_USBD_MIDI::available() { return 0; }
+int Adafruit_USBD_MIDI::read() { return -1; }
+size_t Adafruit_USBD_MIDI::write(uint8_t) { return 1; }
+bool Adafruit_USBD_MIDI::readPacket(uint8_t p[4])
+{
+    if (g_midiIn.empty())
+        return false;
+    memcpy(p, g_midiIn.front().data(), 4);
+    g_midiIn.pop_front();
+    return true;
+}
+bool Adafruit_USBD_MIDI::writePacket(const uint8_t *) { return true; }
+void Adafruit_USBD_MIDI::begin(unsigned long) {}
+
+void Adafruit_USBD_HID::setBootProtocol(int) {}
+void Adafruit_USBD_HID::setPollInterval(int) {}
+void Adafruit_USBD_HID::setReportDescriptor(const uint8_t *, size_t) {}
+void Adafruit_USBD_HID::setStringDescriptor(const char *) {}
+void Adafruit_USBD_HID::begin() {}
+bool Adafruit_USBD_HID::ready() { return true; }
+bool Adafruit_USBD_HID::keyboardReport(uint8_t, uint8_t, uint8_t *) { return true; }
+
+void MidiStub::begin(int) {}
+void MidiStub::sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel) { g_midiSent.push_back({0x90, channel, note, velocity, 0}); }
+void MidiStub::sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel) { g_midiSent.push_back({0x80, channel, note, velocity, 0}); }
+void MidiStub::sendControlChange(uint8_t cc, uint8_t value, uint8_t channel) { g_midiSent.push_back({0xB0, channel, cc, value, 0}); }
+void MidiStub::sendPitchBend(int bend, uint8_t channel) { g_midiSent.push_back({0xE0, channel, 0, 0, bend}); }
+
+namespace HostSim
+{
+    void reset()
+    {
+        g_nowUs = 0;
+        for (auto &pio : g_sm)
+        {
+            for (SimSM &s : pio)
+                s.fifo.clear();
+        }
+        for (int pin = 0; pin < GPIO_COUNT; pin++)
+        {
+            g_pinLevel[pin] = LOW;
+            g_tx[pin] = TxPin{};
+        }
+        g_cdcIn.clear();
+        g_cdcOut.clear();
+        g_midiIn.clear();
+        g_midiSent.clear();
+        memset(fsBase(), 0xFF, FLASH_FS_SIZE);
+        g_flashErases = 0;
+        g_flashPrograms = 0;
+    }
+
+    uint64_t nowUs() { return g_nowUs.load(); }
+    void advanceUs(uint64_t us) { g_nowUs += us; }
+    void advanceMs(uint32_t ms) { g_nowUs += (uint64_t)ms * 1000; }
+    void setCore(unsigned core) { g_core = core; }
+
+    void pushRx(unsigned pio, unsigned index, const uint8_t *data, size_t len)
+    {
+        SimSM &s = g_sm[pio & 1][index & 3];
+        s.fifo.insert(s.fifo.end(), data, data + len);
+    }
+
+    size_t pinRx(unsigned pin, const uint8_t *data, size_t len)
+    {
+        for (unsigned pio = 0; pio < 2; pio++)
+        {
+            for (unsigned index = 0; index < 4; index++)
+            {
+                if (g_sm[pio][index].enabled && smInPin(pio, index) == pin)
+                {
+                    pushRx(pio, index, data, len);
+                    return len;
+                }
+            }
+        }
+        return 0;
+    }
+
+    size_t rxPending(unsigned pio, unsigned index) { return g_sm[pio & 1][index & 3].fifo.size(); }
+    void clearRx(unsigned pio, unsigned index) { g_sm[pio & 1][index & 3].fifo.clear(); }
+
+    void runPioIrq(unsigned pio)
+    {
+        const uint irq = pio ? PIO1_IRQ_0 : PIO0_IRQ_0;
+        if (g_irqEnabled[irq] && g_irqHandler[irq])
+            g_irqHandler[irq]();
+    }
+
+    unsigned smInPin(unsigned pio, unsigned index)
+    {
+        return (g_pioHw[pio & 1].sm[index & 3].pinctrl & PIO_SM0_PINCTRL_IN_BASE_BITS) >> PIO_SM0_PINCTRL_IN_BASE_LSB;
+    }
+
+    bool smEnabled(unsigned pio, unsigned index) { return g_sm[pio & 1][index & 3].enabled; }
+
+    void runTimers()
+    {
+        const uint32_t now = time_us_32();
+        for (int alarm = 0; alarm < 4; alarm++)
+        {
+            const uint irq = TIMER_IRQ_0 + alarm;
+            if (g_irqEnabled[irq] && g_irqHandler[irq] && (timer_hw->inte & (1u << alarm)) &&
+                (int32_t)(now - timer_hw->alarm[alarm]) >= 0)
+            {
+                g_irqHandler[irq]();
+            }
+        }
+    }
+
+    void setPinLevel(unsigned pin, int level)
+    {
+        if (pin < GPIO_COUNT)
+            g_pinLevel[pin] = level;
+    }
+
+    std::vector<uint8_t> takeTx(unsigned pin)
+    {
+        std::vector<uint8_t> out;
+        if (pin < GPIO_COUNT)
+            out.swap(g_tx[pin].bytes);
+        return out;
+    }
+
+    size_t txBytes(unsigned pin) { return pin < GPIO_COUNT ? g_tx[pin].bytes.size() : 0; }
+
+    void cdcFeed(const uint8_t *data, size_t len) { g_cdcIn.insert(g_cdcIn.end(), data, data + len); }
+    size_t cdcPendingIn() { return g_cdcIn.size(); }
+
+    std::vector<uint8_t> cdcTakeOutput()
+    {
+        std::vector<uint8_t> out;
+        out.swap(g_cdcOut);
+        return out;
+    }
+
+    void midiFeed(const uint8_t packet[4])
+    {
+        std::array<uint8_t, 4> p;
+        memcpy(p.data(), packet, 4);
+        g_midiIn.push_back(p);
+    }
+
+    std::vector<MidiEvent> midiTakeSent()
+    {
+        std::vector<MidiEvent> out;
+        out.swap(g_midiSent);
+        return out;
+    }
+
+    uint8_t *flash() { return fsBase(); }
+    size_t flashSize() { return (size_t)(&_FS_end - &_FS_start); }
+    uint32_t flashErases() { return g_flashErases; }
+    uint32_t flashPrograms() { return g_flashPrograms; }
+}
@@ -0,0 +1,74 @@
+#pragma once
+// Host simulation of the RP2040 peripherals the firmware touches. Tests,
+// fuzz targets and benchmarks drive the firmware sources through it:
+//
+// - Time is a simulated microsecond clock that only moves when told to (or
+//   when the soft UART busy-waits on SysTick, one microsecond per read).
+// - PIO RX FIFOs are fed per state machine; the installed PIO IRQ handler
+//   runs when a test calls runPioIrq(), the timer alarm IRQs on runTimers().
+// - Soft UART output (SIO GPIO writes) is decoded back into bytes per pin.
+// - The config CDC, MIDI and HID endpoints are byte/packet queues.
+// - Flash is a RAM array holding the filesystem partition.
+//
+// get_core_num() reports the core set for the calling thread (default 0).
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HostSim
+{
+    // Back to power-on state: clock at 0, queues and captures empty, pins low,
+    // flash erased. Firmware statics are not touched.
+    void reset();
+
+    uint64_t nowUs();
+    void advanceUs(uint64_t us);
+    void advanceMs(uint32_t ms);
+
+    void setCore(unsigned core);
+
+    // Module link (PIO RX)
+    void pushRx(unsigned pio, unsigned sm, const uint8_t *data, size_t len);
+    // Bytes a module sends on `pin`: they reach the FIFO of the enabled state
+    // machine reading that pin, if any, and are lost otherwise. Returns the
+    // number of bytes received.
+    size_t pinRx(unsigned pin, const uint8_t *data, size_t len);
+    size_t rxPending(unsigned pio, unsigned sm);
+    void clearRx(unsigned pio, unsigned sm);
+    // Runs the handler installed for PIOn_IRQ_0, if any
+    void runPioIrq(unsigned pio);
+    // Pin a state machine reads (IN base), as set by the firmware
+    unsigned smInPin(unsigned pio, unsigned sm);
+    bool smEnabled(unsigned pio, unsigned sm);
+    // Runs the handlers of enabled timer alarms that are due
+    void runTimers();
+
+    void setPinLevel(unsigned pin, int level);
+
+    // Soft UART bytes written on `pin` since the last call
+    std::vector<uint8_t> takeTx(unsigned pin);
+    size_t txBytes(unsigned pin);
+
+    // Config CDC
+    void cdcFeed(const uint8_t *data, size_t len);
+    size_t cdcPendingIn();
+    std::vector<uint8_t> cdcTakeOutput();
+
+    // USB MIDI: packets from the host, and messages the firmware sent
+    struct MidiEvent
+    {
+        uint8_t kind; // 0x90 note on, 0x80 note off, 0xB0 CC, 0xE0 pitch bend
+        uint8_t channel; // 1-16
+        uint8_t data1;
+        uint8_t data2;
+        int bend;
+    };
+    void midiFeed(const uint8_t packet[4]);
+    std::vector<MidiEvent> midiTakeSent();
+
+    // Flash partition (_FS_start.._FS_end) and operation counters
+    uint8_t *flash();
+    size_t flashSize();
+    uint32_t flashErases();
+    uint32_t flashPrograms();
+}
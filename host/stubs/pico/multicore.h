@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include "pico/types.h"
+void multicore_lockout_start_blocking(); void multicore_lockout_end_blocking();
+void multicore_lockout_victim_init();
@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in for the pico-sdk header of the same name
+#include "pico/types.h"
+typedef struct { int unused; } mutex_t;
+void mutex_init(mutex_t*); bool mutex_try_enter(mutex_t*, uint32_t*); void mutex_exit(mutex_t*); void mutex_enter_blocking(mutex_t*);
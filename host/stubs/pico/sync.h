@@ -0,0 +1,16 @@
+#pragma once
+// Host stand-in: a single simulated core runs at a time, so locks and
+// interrupt masking do nothing
+#include "pico/types.h"
+#include "pico/mutex.h"
+typedef struct { int unused; } critical_section_t;
+void critical_section_init(critical_section_t*);
+void critical_section_enter_blocking(critical_section_t*);
+void critical_section_exit(critical_section_t*);
+typedef struct { int unused; } spin_lock_t;
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t);
+void restore_interrupts_from_disabled(uint32_t);
+void __dmb();
+void __compiler_memory_barrier();
+uint get_core_num();
@@ -0,0 +1,8 @@
+#pragma once
+// Host stand-in: time comes from the simulated clock (see host_sim.h)
+#include "pico/types.h"
+absolute_time_t get_absolute_time();
+uint32_t to_ms_since_boot(absolute_time_t);
+uint64_t to_us_since_boot(absolute_time_t);
+uint64_t time_us_64();
+uint32_t time_us_32();
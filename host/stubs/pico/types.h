@@ -0,0 +1,11 @@
+#pragma once
+// Host stand-in for the pico-sdk header of the same name
+#include <cstdint>
+#include <cstddef>
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+#ifndef __not_in_flash_func
+#define __not_in_flash_func(f) f
+#define __time_critical_func(f) f
+#endif
+static inline void tight_loop_contents() {}
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in: a plain ring buffer with the pico-sdk queue interface
+#include "pico/types.h"
+typedef struct { uint8_t *data; uint elementSize; uint capacity; uint head; uint level; } queue_t;
+void queue_init(queue_t*, uint, uint); bool queue_try_add(queue_t*, const void*); bool queue_try_remove(queue_t*, void*); bool queue_try_peek(queue_t*, void*); uint queue_get_level(queue_t*);
+bool queue_is_full(queue_t*);
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in for the SDK header of the same name
+#include <cstdint>
+#define HID_ITF_PROTOCOL_KEYBOARD 1
+#define TUD_HID_REPORT_DESC_KEYBOARD() 0
+uint32_t tud_cdc_n_write_available(uint8_t);
@@ -0,0 +1,243 @@
+#pragma once
+// Wire formats for host tests, fuzz seeds and benchmarks: module link frames
+// in each ModuleLinkMode, and config protocol frames on the CDC. Written from
+// the protocol descriptions (common.hpp, usb_device.cpp), not from the
+// firmware encoders, so the firmware is checked against an independent copy.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common.hpp"
+#include "InterruptSerialPIO.h"
+
+namespace Frames
+{
+    using Bytes = std::vector<uint8_t>;
+
+    inline void append(Bytes &out, const void *data, size_t len)
+    {
+        if (len == 0)
+            return;
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        out.insert(out.end(), p, p + len);
+    }
+
+    template <typename T>
+    inline void appendValue(Bytes &out, const T &v)
+    {
+        append(out, &v, sizeof(v));
+    }
+
+    inline Bytes cobsEncode(const Bytes &in)
+    {
+        Bytes out;
+        size_t codePos = out.size();
+        out.push_back(0);
+        uint8_t code = 1;
+        for (uint8_t b : in)
+        {
+            if (b == 0)
+            {
+                out[codePos] = code;
+                codePos = out.size();
+                out.push_back(0);
+                code = 1;
+                continue;
+            }
+            out.push_back(b);
+            if (++code == 0xFF)
+            {
+                out[codePos] = code;
+                codePos = out.size();
+                out.push_back(0);
+                code = 1;
+            }
+        }
+        out[codePos] = code;
+        out.push_back(0); // delimiter
+        return out;
+    }
+
+    // One module link frame in link mode `mode`
+    inline Bytes moduleFrame(uint8_t mode, uint8_t commandId, const Bytes &payload)
+    {
+        const uint16_t len = static_cast<uint16_t>(payload.size());
+        Bytes body;
+        if (mode != LINK_MODE_COBS)
+            body.push_back(mode == LINK_MODE_CRC16 ? MODULE_FRAME_START_CRC16 : MODULE_FRAME_START_SUM8);
+        body.push_back(commandId);
+        body.push_back(static_cast<uint8_t>(len & 0xFF));
+        body.push_back(static_cast<uint8_t>(len >> 8));
+        append(body, payload.data(), payload.size());
+        if (mode == LINK_MODE_SUM8)
+        {
+            uint8_t sum = 0;
+            for (uint8_t b : body)
+                sum = static_cast<uint8_t>(sum + b);
+            body.push_back(sum);
+            return body;
+        }
+        const uint16_t crc = ispio_crc16(0xFFFF, body.data(), body.size());
+        body.push_back(static_cast<uint8_t>(crc & 0xFF));
+        body.push_back(static_cast<uint8_t>(crc >> 8));
+        return mode == LINK_MODE_COBS ? cobsEncode(body) : body;
+    }
+
+    // CMD_RESPONSE frame answering `inResponseTo`
+    inline Bytes moduleResponse(uint8_t mode, uint8_t inResponseTo, uint8_t status, const Bytes &data)
+    {
+        Bytes payload;
+        payload.push_back(status);
+        payload.push_back(inResponseTo);
+        payload.push_back(static_cast<uint8_t>(data.size() & 0xFF));
+        payload.push_back(static_cast<uint8_t>(data.size() >> 8));
+        append(payload, data.data(), data.size());
+        return moduleFrame(mode, CMD_RESPONSE, payload);
+    }
+
+    struct ModuleFrame
+    {
+        uint8_t commandId;
+        Bytes payload;
+    };
+
+    // Frames the host sent on a module link, as decoded by a module. Bytes
+    // that do not form a valid frame are skipped.
+    inline std::vector<ModuleFrame> decodeModuleFrames(uint8_t mode, const Bytes &wire)
+    {
+        std::vector<ModuleFrame> frames;
+        size_t i = 0;
+        while (i < wire.size())
+        {
+            Bytes body;
+            size_t next;
+            if (mode == LINK_MODE_COBS)
+            {
+                size_t end = i;
+                while (end < wire.size() && wire[end] != 0)
+                    end++;
+                if (end == wire.size())
+                    break;
+                next = end + 1;
+                for (size_t p = i; p < end;)
+                {
+                    const uint8_t code = wire[p++];
+                    for (uint8_t k = 1; k < code && p < end; k++)
+                        body.push_back(wire[p++]);
+                    if (code != 0xFF && p < end)
+                        body.push_back(0);
+                }
+                if (body.size() < 5)
+                {
+                    i = next;
+                    continue;
+                }
+                const uint16_t crc = ispio_crc16(0xFFFF, body.data(), body.size() - 2);
+                const uint16_t len = static_cast<uint16_t>(body[1] | (body[2] << 8));
+                if (body.size() != 5u + len || crc != (uint16_t)(body[body.size() - 2] | (body[body.size() - 1] << 8)))
+                {
+                    i = next;
+                    continue;
+                }
+                frames.push_back({body[0], Bytes(body.begin() + 3, body.begin() + 3 + len)});
+                i = next;
+                continue;
+            }
+
+            const uint8_t start = mode == LINK_MODE_CRC16 ? MODULE_FRAME_START_CRC16 : MODULE_FRAME_START_SUM8;
+            if (wire[i] != start || i + 4 > wire.size())
+            {
+                i++;
+                continue;
+            }
+            const uint16_t len = static_cast<uint16_t>(wire[i + 2] | (wire[i + 3] << 8));
+            const size_t check = mode == LINK_MODE_CRC16 ? 2 : 1;
+            if (i + 4 + len + check > wire.size())
+                break;
+            bool ok;
+            if (mode == LINK_MODE_CRC16)
+            {
+                const uint16_t crc = ispio_crc16(0xFFFF, &wire[i], 4u + len);
+                ok = crc == (uint16_t)(wire[i + 4 + len] | (wire[i + 5 + len] << 8));
+            }
+            else
+            {
+                uint8_t sum = 0;
+                for (size_t k = 0; k < 4u + len; k++)
+                    sum = static_cast<uint8_t>(sum + wire[i + k]);
+                ok = sum == wire[i + 4 + len];
+            }
+            if (!ok)
+            {
+                i++;
+                continue;
+            }
+            frames.push_back({wire[i + 1], Bytes(wire.begin() + (long)i + 4, wire.begin() + (long)i + 4 + len)});
+            i += 4 + len + check;
+        }
+        return frames;
+    }
+
+    inline uint16_t configCrc(uint16_t crc, const uint8_t *data, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            crc ^= static_cast<uint16_t>(data[i] << 8);
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+        return crc;
+    }
+
+    // Config protocol command: type(1) command(1) sub(1) seq(1) length(2)
+    // checksum(2) payload. The CRC covers the header and the payload.
+    enum ConfigCommand : uint8_t
+    {
+        CFG_INFO = 0,
+        CFG_VERSION,
+        CFG_MAP,
+        CFG_MODULES,
+        CFG_LOG,
+        CFG_STATS
+    };
+
+    inline Bytes configFrame(uint8_t command, uint8_t sub, uint8_t seq, const Bytes &payload)
+    {
+        Bytes f = {0, command, sub, seq, static_cast<uint8_t>(payload.size() & 0xFF), static_cast<uint8_t>(payload.size() >> 8)};
+        uint16_t crc = configCrc(0xFFFF, f.data(), f.size());
+        crc = configCrc(crc, payload.data(), payload.size());
+        f.push_back(static_cast<uint8_t>(crc & 0xFF));
+        f.push_back(static_cast<uint8_t>(crc >> 8));
+        append(f, payload.data(), payload.size());
+        return f;
+    }
+
+    struct ConfigResponse
+    {
+        uint8_t response; // Message::ResponseType, 0 = ACK, 1 = NACK
+        uint8_t sub;
+        uint8_t seq;
+        bool crcOk;
+        Bytes data;
+    };
+
+    // Splits the device's CDC output into responses
+    inline std::vector<ConfigResponse> parseConfigResponses(const Bytes &out)
+    {
+        std::vector<ConfigResponse> responses;
+        size_t i = 0;
+        while (i + 8 <= out.size())
+        {
+            const uint16_t len = static_cast<uint16_t>(out[i + 4] | (out[i + 5] << 8));
+            if (i + 8 + len > out.size())
+                break;
+            uint16_t crc = configCrc(0xFFFF, &out[i], 6);
+            crc = configCrc(crc, &out[i + 8], len);
+            const uint16_t sent = static_cast<uint16_t>(out[i + 6] | (out[i + 7] << 8));
+            responses.push_back({out[i + 1], out[i + 2], out[i + 3], crc == sent, Bytes(out.begin() + (long)i + 8, out.begin() + (long)i + 8 + len)});
+            i += 8 + len;
+        }
+        return responses;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Minimal assertions for the host tests: CHECK() reports the failed condition
+// and carries on, main() returns checkResult() so ctest sees the failure.
+#include <cstdio>
+
+namespace Check
+{
+    inline int &failures()
+    {
+        static int n = 0;
+        return n;
+    }
+
+    inline void fail(const char *file, int line, const char *what)
+    {
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", file, line, what);
+        failures()++;
+    }
+}
+
+#define CHECK(cond)                                    \
+    do                                                 \
+    {                                                  \
+        if (!(cond))                                   \
+            Check::fail(__FILE__, __LINE__, #cond);    \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                        \
+    do                                                                                        \
+    {                                                                                         \
+        const long long check_a_ = (long long)(a), check_b_ = (long long)(b);                 \
+        if (check_a_ != check_b_)                                                             \
+        {                                                                                     \
+            fprintf(stderr, "    %s = %lld, %s = %lld\n", #a, check_a_, #b, check_b_);       \
+            Check::fail(__FILE__, __LINE__, #a " == " #b);                                    \
+        }                                                                                     \
+    } while (0)
+
+inline int checkResult(const char *name)
+{
+    if (Check::failures() == 0)
+    {
+        printf("%s: ok\n", name);
+        return 0;
+    }
+    printf("%s: %d check(s) failed\n", name, Check::failures());
+    return 1;
+}
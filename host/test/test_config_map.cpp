@@ -0,0 +1,153 @@
+// MAP commands on the config CDC: a curve or options for a mapping that does
+// not exist, or for a target index out of range, is refused and does not
+// queue a module sync; the same command for an existing mapping is applied.
+// BULK_SET takes up to MappingManager::MAX_BATCH mappings, so a full bank
+// goes in two frames.
+#include <cstring>
+#include <initializer_list>
+
+#include "check.h"
+#include "frames.h"
+#include "host_sim.h"
+#include "ipc.hpp"
+#include "mapping.h"
+#include "usb_device.h"
+
+namespace
+{
+    constexpr uint8_t ROW = 0;
+    constexpr uint8_t COL = 1;
+    constexpr uint8_t SUB_SET = 0;
+    constexpr uint8_t SUB_SET_CURVE = 1;
+    constexpr uint8_t SUB_BULK_SET = 5;
+    constexpr uint8_t SUB_SET_OPTIONS = 7;
+    constexpr uint8_t ACK = 0;
+    constexpr uint8_t NACK = 1;
+
+    uint8_t g_seq = 0;
+
+    // Sends one MAP command and returns the response type
+    int command(uint8_t sub, const Frames::Bytes &payload)
+    {
+        const Frames::Bytes f = Frames::configFrame(Frames::CFG_MAP, sub, ++g_seq, payload);
+        HostSim::cdcFeed(f.data(), f.size());
+        usb::task();
+        const std::vector<Frames::ConfigResponse> responses = Frames::parseConfigResponses(HostSim::cdcTakeOutput());
+        CHECK_EQ(responses.size(), 1);
+        if (responses.size() != 1)
+            return -1;
+        CHECK(responses[0].crcOk);
+        CHECK_EQ(responses[0].seq, g_seq);
+        return responses[0].response;
+    }
+
+    int syncsQueued()
+    {
+        int n = 0;
+        IPC::SyncMappingRequest sync;
+        while (IPC::tryDequeueSyncMapping(sync))
+            n++;
+        return n;
+    }
+
+    Frames::Bytes curvePayload(uint8_t pid, int16_t h, int target)
+    {
+        Curve curve{};
+        curve.h = h;
+        Frames::Bytes p{ROW, COL, pid};
+        Frames::appendValue(p, curve);
+        if (target >= 0)
+            p.push_back((uint8_t)target);
+        return p;
+    }
+
+    Frames::Bytes optionsPayload(uint8_t pid, int target)
+    {
+        Frames::Bytes p{ROW, COL, pid, 2, 1, 0, 0};
+        if (target >= 0)
+            p.push_back((uint8_t)target);
+        return p;
+    }
+
+    // Mappings one port can hold
+    constexpr int PER_PORT = MappingManager::PARAMS_PER_MODULE * MAPPING_TARGETS_PER_PARAM;
+
+    // `count` mappings in key order from `first` on, filling port (ROW, COL)
+    // and then the slots after it
+    Frames::Bytes bulkPayload(int first, int count)
+    {
+        Frames::Bytes p{(uint8_t)count};
+        for (int i = first; i < first + count; i++)
+        {
+            ModuleMapping m{};
+            const int slot = ROW * MODULE_PORT_COLS + COL + i / PER_PORT;
+            m.row = slot / MODULE_PORT_COLS;
+            m.col = slot % MODULE_PORT_COLS;
+            m.paramId = (uint8_t)(i % PER_PORT / MAPPING_TARGETS_PER_PARAM);
+            m.targetIndex = (uint8_t)(i % MAPPING_TARGETS_PER_PARAM);
+            m.type = ACTION_MIDI_CC;
+            m.curve.h = 16384;
+            m.target.midiCC.channel = 1;
+            m.target.midiCC.ccNumber = (uint8_t)i;
+            Frames::appendValue(p, m);
+        }
+        return p;
+    }
+
+    void testCurve()
+    {
+        MappingManager::clearAll();
+        syncsQueued();
+        CHECK_EQ(command(SUB_SET, {ROW, COL, 0, ACTION_MIDI_CC, 1, 20}), ACK);
+        CHECK_EQ(syncsQueued(), 1);
+
+        // No mapping on parameter 1, nor on target 1 of parameter 0
+        CHECK_EQ(command(SUB_SET_CURVE, curvePayload(1, 500, -1)), NACK);
+        CHECK_EQ(command(SUB_SET_CURVE, curvePayload(0, 500, 1)), NACK);
+        // Target index past MAPPING_TARGETS_PER_PARAM
+        CHECK_EQ(command(SUB_SET_CURVE, curvePayload(0, 500, MAPPING_TARGETS_PER_PARAM)), NACK);
+        CHECK_EQ(command(SUB_SET_CURVE, curvePayload(0, 500, 0xFF)), NACK);
+        CHECK_EQ(syncsQueued(), 0);
+
+        CHECK_EQ(command(SUB_SET_CURVE, curvePayload(0, 500, 0)), ACK);
+        CHECK_EQ(syncsQueued(), 1);
+        const ModuleMapping *m = MappingManager::findMapping(ROW, COL, 0);
+        CHECK(m != nullptr);
+        CHECK(m && m->curve.h == 500);
+    }
+
+    void testOptions()
+    {
+        CHECK_EQ(command(SUB_SET_OPTIONS, optionsPayload(1, -1)), NACK);
+        CHECK_EQ(command(SUB_SET_OPTIONS, optionsPayload(0, MAPPING_TARGETS_PER_PARAM)), NACK);
+        CHECK_EQ(command(SUB_SET_OPTIONS, optionsPayload(0, 0)), ACK);
+        CHECK_EQ(syncsQueued(), 0);
+    }
+
+    void testBulkSet()
+    {
+        MappingManager::clearAll();
+        syncsQueued();
+        CHECK_EQ(command(SUB_BULK_SET, bulkPayload(0, MappingManager::MAX_BATCH + 1)), NACK);
+        CHECK_EQ(MappingManager::bankCount(0), 0);
+        CHECK_EQ(syncsQueued(), 0);
+
+        for (int first = 0; first < MappingManager::BANK_CAPACITY; first += MappingManager::MAX_BATCH)
+            CHECK_EQ(command(SUB_BULK_SET, bulkPayload(first, MappingManager::MAX_BATCH)), ACK);
+        CHECK_EQ(MappingManager::bankCount(0), MappingManager::BANK_CAPACITY);
+        CHECK_EQ(command(SUB_BULK_SET, bulkPayload(MappingManager::BANK_CAPACITY, 1)), NACK);
+        CHECK_EQ(syncsQueued(), MappingManager::BANK_CAPACITY / PER_PORT);
+    }
+}
+
+int main()
+{
+    HostSim::reset();
+    IPC::init();
+    MappingManager::init();
+    usb::init();
+    testCurve();
+    testOptions();
+    testBulkSet();
+    return checkResult("test_config_map");
+}
@@ -0,0 +1,150 @@
+// CurveEvaluator accuracy: the compiled LUT against the curve computed in
+// double precision, for every input, on curves steep enough that plain
+// 64-segment interpolation is off by thousands.
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+
+#include "check.h"
+#include "curve.h"
+
+namespace
+{
+    // The h curve at x (input 0-65535 on a 0..65536 axis), scaled to 0-65535
+    double rational(int16_t h, uint16_t x)
+    {
+        if (x == 0xFFFF)
+            return 65535; // endpoint pinned to full scale
+        const double t = x / 65536.0;
+        const double H = (uint16_t)h / 32768.0;
+        const double den = t * H + (1 - t) * (1 - H);
+        return den == 0 ? 0 : t * H / den * 65535;
+    }
+
+    double bezier(double a, double c, double b, double t)
+    {
+        return (1 - t) * (1 - t) * a + 2 * (1 - t) * t * c + t * t * b;
+    }
+
+    // The piecewise curve at x, scaled to 0-65535
+    double piecewise(const Curve &c, uint16_t x)
+    {
+        const double X = x == 0xFFFF ? 255.0 : x / 65536.0 * 255;
+        const int last = c.count - 1;
+        if (X <= c.points[0].x)
+            return c.points[0].y / 255.0 * 65535;
+        if (X >= c.points[last].x)
+            return c.points[last].y / 255.0 * 65535;
+        int seg = 0;
+        while (seg < last - 1 && X > c.points[seg + 1].x)
+            seg++;
+        const double x0 = c.points[seg].x, x1 = c.points[seg + 1].x;
+        const double cx = fmin(fmax(c.controls[seg].x, x0), x1);
+        double lo = 0, hi = 1;
+        for (int i = 0; i < 60; i++)
+        {
+            const double mid = (lo + hi) / 2;
+            (bezier(x0, cx, x1, mid) < X ? lo : hi) = mid;
+        }
+        return bezier(c.points[seg].y, c.controls[seg].y, c.points[seg + 1].y, lo) / 255.0 * 65535;
+    }
+
+    double reference(const Curve &c, uint16_t x)
+    {
+        return c.count == 0 ? rational(c.h, x) : piecewise(c, x);
+    }
+
+    // Largest |eval - reference| over all 65536 inputs
+    double maxError(const Curve &c)
+    {
+        CurveLut lut;
+        CurveEvaluator::compile(c, lut);
+        double worst = 0;
+        for (uint32_t x = 0; x <= 0xFFFF; x++)
+        {
+            const double e = fabs(CurveEvaluator::eval(lut, (uint16_t)x) - reference(c, (uint16_t)x));
+            if (e > worst)
+                worst = e;
+        }
+        return worst;
+    }
+
+    int exactSegments(const Curve &c)
+    {
+        CurveLut lut;
+        CurveEvaluator::compile(c, lut);
+        return __builtin_popcount(lut.exact[0]) + __builtin_popcount(lut.exact[1]);
+    }
+
+    Curve hCurve(int16_t h)
+    {
+        Curve c{};
+        c.h = h;
+        return c;
+    }
+
+    void testSteepHCurves()
+    {
+        // Strongly concave and strongly convex: slope ~65 at one end
+        for (int16_t h : {(int16_t)500, (int16_t)32267})
+        {
+            const double e = maxError(hCurve(h));
+            printf("h=%d: max error %.1f, %d exact segments\n", h, e, exactSegments(hCurve(h)));
+            CHECK(e <= CURVE_LUT_MAX_ERROR);
+        }
+        // Only the steep segments pay for exact evaluation
+        CHECK(exactSegments(hCurve(500)) < CURVE_LUT_SEGMENTS / 2);
+        CHECK(exactSegments(hCurve(32267)) < CURVE_LUT_SEGMENTS / 2);
+    }
+
+    void testGentleCurvesStayInterpolated()
+    {
+        CHECK_EQ(exactSegments(hCurve(16384)), 0);
+        CHECK(maxError(hCurve(16384)) <= 1);
+        for (int16_t h : {(int16_t)2000, (int16_t)8192, (int16_t)24576, (int16_t)30000})
+            CHECK(maxError(hCurve(h)) <= CURVE_LUT_MAX_ERROR);
+    }
+
+    void testPiecewiseCorners()
+    {
+        // Dead zone and saturation: corners at 20 and 235
+        Curve deadZone{};
+        deadZone.count = 2;
+        deadZone.points[0] = {20, 0};
+        deadZone.points[1] = {235, 255};
+        deadZone.controls[0] = {128, 128};
+        // A knee: steep then flat, bent segments
+        Curve knee{};
+        knee.count = 3;
+        knee.points[0] = {0, 0};
+        knee.points[1] = {40, 200};
+        knee.points[2] = {255, 255};
+        knee.controls[0] = {10, 120};
+        knee.controls[1] = {60, 250};
+        // A step: 128 -> 255 over two input units
+        Curve step{};
+        step.count = 4;
+        step.points[0] = {0, 0};
+        step.points[1] = {100, 128};
+        step.points[2] = {102, 255};
+        step.points[3] = {255, 255};
+        step.controls[0] = {50, 64};
+        step.controls[1] = {101, 191};
+        step.controls[2] = {178, 255};
+
+        for (const Curve *c : {&deadZone, &knee, &step})
+        {
+            const double e = maxError(*c);
+            printf("piecewise %d points: max error %.1f, %d exact segments\n", c->count, e, exactSegments(*c));
+            CHECK(e <= CURVE_LUT_MAX_ERROR);
+        }
+    }
+}
+
+int main()
+{
+    testSteepHCurves();
+    testGentleCurvesStayInterpolated();
+    testPiecewiseCorners();
+    return checkResult("test_curve");
+}
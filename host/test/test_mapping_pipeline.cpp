@@ -0,0 +1,186 @@
+// The 16-bit mapping pipeline end to end: a parameter value through
+// applyMapping() (normalize, curve, scale) to the MIDI message sent.
+// Monotonic for every curve, exact at the ends of the range, and a 14-bit
+// control keeps all 14 bits through a linear curve.
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include "check.h"
+#include "host_sim.h"
+#include "mapping.h"
+
+namespace
+{
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+    constexpr int32_t MAX = 16383; // a 14-bit parameter
+
+    Port::State g_port{};
+
+    void setupPort()
+    {
+        g_port.row = ROW;
+        g_port.col = COL;
+        g_port.hasModule = true;
+        g_port.module.parameterCount = 1;
+        ModuleParameter &p = g_port.module.parameters[0];
+        p.id = 0;
+        p.dataType = ModuleParameterDataType::PARAM_TYPE_INT;
+        p.minMax.intMin = 0;
+        p.minMax.intMax = MAX;
+    }
+
+    void install(ActionType type, const Curve &curve)
+    {
+        MappingManager::clearAll();
+        CHECK(MappingManager::updateMapping(ROW, COL, 0, type, 1, 20));
+        MappingManager::updateMappingCurve(ROW, COL, 0, curve);
+        HostSim::midiTakeSent();
+    }
+
+    // The value the mapping sends for parameter value `v`: 0-16383 for mod
+    // wheel and pitch bend (bend + 8192), 0-127 for CC. -1 if nothing was sent.
+    int apply(int32_t v)
+    {
+        ModuleParameterValue value{};
+        value.intValue = v;
+        MappingManager::applyMapping(&g_port, 0, ModuleParameterDataType::PARAM_TYPE_INT, value);
+        const std::vector<HostSim::MidiEvent> sent = HostSim::midiTakeSent();
+        if (sent.size() == 2 && sent[0].kind == 0xB0 && sent[0].data1 == 1 && sent[1].data1 == 33)
+            return sent[0].data2 << 7 | sent[1].data2;
+        if (sent.size() == 1 && sent[0].kind == 0xE0)
+            return sent[0].bend + 8192;
+        if (sent.size() == 1 && sent[0].kind == 0xB0)
+            return sent[0].data2;
+        return -1;
+    }
+
+    Curve hCurve(int16_t h)
+    {
+        Curve c{};
+        c.h = h;
+        return c;
+    }
+
+    std::vector<Curve> curves()
+    {
+        std::vector<Curve> out;
+        for (int16_t h : {(int16_t)1, (int16_t)500, (int16_t)2000, (int16_t)8192, (int16_t)16384, (int16_t)24576,
+                          (int16_t)30000, (int16_t)32267, (int16_t)32767})
+            out.push_back(hCurve(h));
+        Curve deadZone{};
+        deadZone.count = 2;
+        deadZone.points[0] = {20, 0};
+        deadZone.points[1] = {235, 255};
+        deadZone.controls[0] = {128, 128};
+        out.push_back(deadZone);
+        Curve knee{};
+        knee.count = 3;
+        knee.points[0] = {0, 0};
+        knee.points[1] = {40, 200};
+        knee.points[2] = {255, 255};
+        knee.controls[0] = {10, 120};
+        knee.controls[1] = {60, 250};
+        out.push_back(knee);
+        return out;
+    }
+
+    void testMonotonic()
+    {
+        for (const Curve &c : curves())
+        {
+            for (ActionType type : {ACTION_MIDI_MOD_WHEEL, ACTION_MIDI_PITCH_BEND, ACTION_MIDI_CC})
+            {
+                install(type, c);
+                int last = -1;
+                bool monotonic = true;
+                for (int32_t v = 0; v <= MAX; v++)
+                {
+                    const int out = apply(v);
+                    CHECK(out >= 0);
+                    if (out < last)
+                        monotonic = false;
+                    last = out;
+                }
+                if (!monotonic)
+                    fprintf(stderr, "not monotonic: count=%d h=%d type=%d\n", c.count, c.h, type);
+                CHECK(monotonic);
+            }
+        }
+    }
+
+    void testEndpoints()
+    {
+        // Full-range curves: the ends of the input reach the ends of every target
+        for (const Curve &c : {hCurve(1), hCurve(500), hCurve(16384), hCurve(32267), hCurve(32767)})
+        {
+            install(ACTION_MIDI_MOD_WHEEL, c);
+            CHECK_EQ(apply(0), 0);
+            CHECK_EQ(apply(MAX), 16383);
+            install(ACTION_MIDI_PITCH_BEND, c);
+            CHECK_EQ(apply(0), 0);
+            CHECK_EQ(apply(MAX), 16383);
+            install(ACTION_MIDI_CC, c);
+            CHECK_EQ(apply(0), 0);
+            CHECK_EQ(apply(MAX), 127);
+        }
+        // Out-of-range values clamp to the ends
+        install(ACTION_MIDI_MOD_WHEEL, hCurve(16384));
+        CHECK_EQ(apply(-100), 0);
+        CHECK_EQ(apply(MAX + 100), 16383);
+        // Pitch bend centre is exactly zero bend
+        g_port.module.parameters[0].minMax.intMax = 16384;
+        install(ACTION_MIDI_PITCH_BEND, hCurve(16384));
+        CHECK_EQ(apply(8192), 8192);
+        g_port.module.parameters[0].minMax.intMax = MAX;
+    }
+
+    void testResolution()
+    {
+        // A linear curve passes a 14-bit parameter through a 14-bit target
+        install(ACTION_MIDI_MOD_WHEEL, hCurve(16384));
+        std::vector<bool> seen(16384, false);
+        int worst = 0;
+        for (int32_t v = 0; v <= MAX; v++)
+        {
+            const int out = apply(v);
+            CHECK(out >= 0 && out <= 16383);
+            if (out < 0 || out > 16383)
+                continue;
+            seen[(size_t)out] = true;
+            const int d = out > v ? out - v : v - out;
+            if (d > worst)
+                worst = d;
+        }
+        int distinct = 0;
+        for (bool s : seen)
+            distinct += s;
+        printf("linear mod wheel: %d distinct outputs of 16384, max deviation %d\n", distinct, worst);
+        CHECK_EQ(distinct, 16384);
+        CHECK(worst <= 1);
+
+        // CC keeps all 128 steps
+        install(ACTION_MIDI_CC, hCurve(16384));
+        std::vector<bool> cc(128, false);
+        for (int32_t v = 0; v <= MAX; v++)
+        {
+            const int out = apply(v);
+            if (out >= 0 && out < 128)
+                cc[(size_t)out] = true;
+        }
+        for (int i = 0; i < 128; i++)
+            CHECK(cc[(size_t)i]);
+    }
+}
+
+int main()
+{
+    HostSim::reset();
+    MappingManager::init();
+    setupPort();
+    testMonotonic();
+    testEndpoints();
+    testResolution();
+    return checkResult("test_mapping_pipeline");
+}
@@ -0,0 +1,201 @@
+// MappingStore on the simulated flash: replay across reboots after a torn
+// record, and which flash operations core1 is parked for.
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "check.h"
+#include "host_sim.h"
+#include "mapping.h"
+#include "mapping_store.h"
+#include "stats.h"
+
+namespace
+{
+    constexpr uint32_t RECORD_MAGIC = 0x50434D52;
+    constexpr size_t PAGE = 256;
+    constexpr size_t PAGES_PER_SECTOR = 16;
+
+    // Core1: its loop only matters here for the flash park
+    class Core1
+    {
+    public:
+        Core1()
+            : thread_([this]()
+                      {
+                          HostSim::setCore(1);
+                          while (running_)
+                              MappingStore::serviceFlashPark();
+                      })
+        {
+        }
+        ~Core1()
+        {
+            running_ = false;
+            thread_.join();
+        }
+
+    private:
+        std::atomic<bool> running_{true};
+        std::thread thread_;
+    };
+
+    // Power cycle: RAM is lost, flash is kept
+    void reboot()
+    {
+        static const ModuleMapping none{};
+        for (uint8_t bank = 0; bank < MappingManager::BANK_COUNT; bank++)
+            MappingManager::loadBank(bank, &none, 0);
+        MappingManager::takeDirtyBanks();
+        MappingStore::load();
+    }
+
+    void addCc(uint8_t pid, uint8_t cc, uint8_t target = 0)
+    {
+        CHECK(MappingManager::updateMapping(0, 1, pid, ACTION_MIDI_CC, 1, cc, 0, target));
+    }
+
+    bool hasCc(uint8_t pid, uint8_t cc, uint8_t target = 0)
+    {
+        const ModuleMapping *m = MappingManager::findMapping(0, 1, pid, target);
+        return m && m->type == ACTION_MIDI_CC && m->target.midiCC.ccNumber == cc;
+    }
+
+    // Runs the core0 store task for `ms`, one call per 10 ms. With `busy`,
+    // a module frame arrives every 10 ms.
+    void runTask(uint32_t ms, bool busy = false)
+    {
+        for (uint32_t t = 0; t < ms; t += 10)
+        {
+            if (busy)
+                Stats::g_ports[0][0].rxFrames = Stats::g_ports[0][0].rxFrames + 1;
+            MappingStore::task();
+            HostSim::advanceMs(10);
+        }
+    }
+
+    // Page of area 0 where the last record starts, and its length in pages
+    bool lastRecord(size_t &page, size_t &pages)
+    {
+        const uint8_t *flash = HostSim::flash();
+        bool found = false;
+        for (size_t p = 1; p < HostSim::flashSize() / 2 / PAGE; p++)
+        {
+            uint32_t magic;
+            memcpy(&magic, flash + p * PAGE, sizeof(magic));
+            if (magic == RECORD_MAGIC)
+            {
+                page = p;
+                pages = flash[p * PAGE + 15];
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    void testTornRecordThenGoodRecord()
+    {
+        HostSim::reset();
+        reboot();
+        Core1 core1;
+
+        addCc(0, 20);
+        runTask(4000);
+        CHECK_EQ(MappingManager::takeDirtyBanks(), 0);
+
+        // Ten mappings: a two-page record, torn by a power loss after its
+        // first page
+        for (uint8_t i = 0; i < 10; i++)
+            addCc((uint8_t)(i % 8), (uint8_t)(30 + i), (uint8_t)(i / 8));
+        runTask(4000);
+        size_t page = 0, pages = 0;
+        CHECK(lastRecord(page, pages));
+        CHECK_EQ(pages, 2);
+        memset(HostSim::flash() + (page + 1) * PAGE, 0xFF, PAGE);
+
+        // Reboot 1: the torn record is dropped, the one before it is replayed
+        reboot();
+        CHECK(hasCc(0, 20));
+        CHECK(!hasCc(1, 31));
+
+        // The next record goes to the next sector, past the torn one
+        addCc(2, 42);
+        runTask(4000);
+        size_t goodPage = 0, goodPages = 0;
+        CHECK(lastRecord(goodPage, goodPages));
+        CHECK_EQ(goodPage, (page / PAGES_PER_SECTOR + 1) * PAGES_PER_SECTOR);
+
+        // Reboots 2 and 3: load skips the torn record and replays the good one
+        for (int i = 0; i < 2; i++)
+        {
+            reboot();
+            CHECK(hasCc(0, 20));
+            CHECK(hasCc(2, 42));
+        }
+
+        // And the journal carries on behind it
+        addCc(3, 43);
+        runTask(4000);
+        reboot();
+        CHECK(hasCc(2, 42));
+        CHECK(hasCc(3, 43));
+    }
+
+    void testErasesWaitForIdlePorts()
+    {
+        HostSim::reset();
+        reboot();
+        Core1 core1;
+
+        addCc(0, 20);
+        runTask(4000); // first commit: compaction, ports idle
+        const uint32_t programParkUs = MappingStore::programParkMaxUs();
+        CHECK(programParkUs > 0);
+        CHECK(programParkUs <= 400); // one page program (tPP) per park
+
+        // Busy ports: records are only programmed into sectors erased before
+        uint32_t erases = HostSim::flashErases();
+        uint8_t cc = 50;
+        for (int i = 0; i < 20; i++)
+        {
+            addCc(1, cc++);
+            runTask(2500, true);
+        }
+        CHECK_EQ(HostSim::flashErases(), erases);
+        CHECK(MappingStore::programParkMaxUs() <= 400);
+
+        // Out of erased room, the last edit is held back...
+        CHECK(MappingManager::takeDirtyBanks() != 0);
+        MappingManager::markBanksDirty(1);
+        // ...until the ports have been idle for a second
+        runTask(3000);
+        CHECK(HostSim::flashErases() > erases);
+        CHECK_EQ(MappingManager::takeDirtyBanks(), 0);
+        reboot();
+        CHECK(hasCc(1, (uint8_t)(cc - 1)));
+
+        // Traffic that never stops holds a commit back for at most 30 s
+        erases = HostSim::flashErases();
+        for (int i = 0; i < 40 && HostSim::flashErases() == erases; i++)
+        {
+            addCc(1, cc++);
+            runTask(2500, true);
+        }
+        CHECK(HostSim::flashErases() > erases);
+        runTask(40000, true);
+        CHECK_EQ(MappingManager::takeDirtyBanks(), 0);
+        reboot();
+        CHECK(hasCc(1, (uint8_t)(cc - 1)));
+
+        printf("core1 park, longest: page program %lu us, sector erase %lu us (simulated W25Q16JV typical times)\n",
+               (unsigned long)MappingStore::programParkMaxUs(), (unsigned long)MappingStore::eraseParkMaxUs());
+    }
+}
+
+int main()
+{
+    MappingManager::init();
+    testTornRecordThenGoodRecord();
+    testErasesWaitForIdlePorts();
+    return checkResult("test_mapping_store");
+}
@@ -0,0 +1,249 @@
+// Fault injection on a COBS-framed module link: frames with a flipped byte,
+// a truncated block or a lost delimiter go through the RX IRQ
+// (ispio_handle_irq -> processByte). A damaged frame is never delivered,
+// and the parser is back in sync at the next delimiter.
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include "boardconfig.h"
+#include "check.h"
+#include "frames.h"
+#include "host_sim.h"
+#include "port.h"
+#include "stats.h"
+
+namespace
+{
+    constexpr size_t FIFO_DEPTH = 8;
+    constexpr uint32_t BYTE_US = 87; // 10 bits at 115200 baud
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+
+    InterruptSerialPIO *g_serial;
+
+    void setup()
+    {
+        HostSim::reset();
+        HostSim::setCore(1);
+        Port::init();
+        g_serial = modulePorts[ROW][COL];
+        ispio_set_port_location(g_serial, ROW, COL);
+        ispio_end(g_serial);
+        ispio_begin(g_serial, ISPIO_FIXED_BAUD);
+        ispio_set_link_mode(g_serial, LINK_MODE_COBS);
+    }
+
+    // A GET_PARAMETER response tagged with `seq`. Long frames carry a run
+    // over 254 bytes, so they hold a full 0xFF block; the zeros in the
+    // payload end blocks early.
+    Frames::Bytes frame(uint16_t seq, bool longFrame = false)
+    {
+        Frames::Bytes data;
+        Frames::appendValue(data, seq);
+        data.push_back(0);
+        data.push_back(0xFF);
+        for (size_t i = 0; i < (longFrame ? 300u : 5u); i++)
+            data.push_back((uint8_t)(i % 251 + 1));
+        data.push_back(0);
+        return Frames::moduleResponse(LINK_MODE_COBS, CMD_GET_PARAMETER, MODULE_STATUS_OK, data);
+    }
+
+    // Feeds `wire` through the RX FIFO and returns the sequence numbers of
+    // the frames the parser delivered, -1 for a frame that is not ours
+    std::vector<int> receive(const Frames::Bytes &wire)
+    {
+        const unsigned pio = pio_get_index(g_serial->rxPIO);
+        const unsigned sm = (unsigned)g_serial->rxSM;
+        std::vector<int> seqs;
+        for (size_t pos = 0; pos < wire.size();)
+        {
+            const size_t n = wire.size() - pos < FIFO_DEPTH ? wire.size() - pos : FIFO_DEPTH;
+            HostSim::pushRx(pio, sm, &wire[pos], n);
+            HostSim::advanceUs(n * BYTE_US);
+            HostSim::runPioIrq(pio);
+            pos += n;
+
+            ModuleMessage msg;
+            while (Port::getNextMessage(msg))
+            {
+                const bool ours = msg.commandId == CMD_RESPONSE && msg.payloadLength >= 6 && msg.payload[1] == CMD_GET_PARAMETER;
+                seqs.push_back(ours ? (int)(msg.payload[4] | (msg.payload[5] << 8)) : -1);
+            }
+        }
+        return seqs;
+    }
+
+    void append(Frames::Bytes &out, const Frames::Bytes &in)
+    {
+        out.insert(out.end(), in.begin(), in.end());
+    }
+
+    struct Faults
+    {
+        long cases;
+        long recovered;
+    };
+
+    // A bad frame, then a good one: only the good one arrives
+    void expectResync(Faults &f, const Frames::Bytes &bad, uint16_t seq, const char *what, size_t at)
+    {
+        Frames::Bytes wire = bad;
+        append(wire, frame(seq));
+        const std::vector<int> got = receive(wire);
+        f.cases++;
+        if (got.size() == 1 && got[0] == seq)
+        {
+            f.recovered++;
+            return;
+        }
+        fprintf(stderr, "%s at byte %zu: %zu frame(s) delivered\n", what, at, got.size());
+        CHECK(got.size() == 1 && got[0] == seq);
+    }
+
+    void testClean()
+    {
+        Frames::Bytes wire;
+        for (uint16_t seq = 0; seq < 20; seq++)
+            append(wire, frame(seq, seq % 4 == 3));
+        const std::vector<int> got = receive(wire);
+        CHECK_EQ(got.size(), 20);
+        for (size_t i = 0; i < got.size() && i < 20; i++)
+            CHECK_EQ(got[i], (int)i);
+    }
+
+    // Every byte of a short and a long frame, each flipped three ways. A byte
+    // turned into 0x00 is a stray delimiter that splits the frame in two.
+    void testByteFlips(Faults &f)
+    {
+        for (bool longFrame : {false, true})
+        {
+            const Frames::Bytes good = frame(1000, longFrame);
+            for (size_t at = 0; at + 1 < good.size(); at++)
+            {
+                for (uint8_t mask : {(uint8_t)0x01, (uint8_t)0x80, (uint8_t)0xFF})
+                {
+                    Frames::Bytes bad = good;
+                    bad[at] ^= mask;
+                    expectResync(f, bad, (uint16_t)at, "byte flip", at);
+                }
+                Frames::Bytes bad = good;
+                bad[at] = 0;
+                expectResync(f, bad, (uint16_t)at, "stray delimiter", at);
+            }
+        }
+    }
+
+    // The frame stops after `keep` bytes, inside a block or at a block
+    // header, and its delimiter still arrives
+    void testTruncatedBlocks(Faults &f)
+    {
+        for (bool longFrame : {false, true})
+        {
+            const Frames::Bytes good = frame(2000, longFrame);
+            for (size_t keep = 1; keep + 1 < good.size(); keep++)
+            {
+                Frames::Bytes bad(good.begin(), good.begin() + (long)keep);
+                bad.push_back(0);
+                expectResync(f, bad, (uint16_t)keep, "truncated frame", keep);
+            }
+            // One byte dropped from the middle of the frame
+            for (size_t at = 0; at + 1 < good.size(); at++)
+            {
+                Frames::Bytes bad = good;
+                bad.erase(bad.begin() + (long)at);
+                expectResync(f, bad, (uint16_t)at, "dropped byte", at);
+            }
+        }
+    }
+
+    // A lost delimiter merges two frames; both are dropped and the frame
+    // after the next delimiter arrives
+    void testMissingDelimiter(Faults &f)
+    {
+        for (bool longFrame : {false, true})
+        {
+            Frames::Bytes wire = frame(3000, longFrame);
+            wire.pop_back();
+            append(wire, frame(3001, longFrame));
+            const std::vector<int> got = receive(wire);
+            CHECK(got.empty());
+            expectResync(f, {}, 3002, "after merged frames", 0);
+        }
+        // Line noise longer than the frame buffer: the overflow is discarded
+        // up to the next delimiter
+        Frames::Bytes noise(sizeof(g_serial->parser.buffer) + 100, 0x5A);
+        noise.push_back(0);
+        expectResync(f, noise, 3003, "overflow", noise.size());
+    }
+
+    uint32_t g_seed = 4321;
+
+    uint32_t rnd(uint32_t n)
+    {
+        g_seed = g_seed * 1103515245u + 12345u;
+        return (g_seed >> 16) % n;
+    }
+
+    // A long stream with random faults. A frame arrives exactly when it is
+    // intact and the frame before it kept its delimiter.
+    void testRandomStream(Faults &f)
+    {
+        constexpr int FRAMES = 2000;
+        Frames::Bytes wire;
+        std::vector<int> expected;
+        bool previousDelimiter = true;
+        long damaged = 0;
+        for (int seq = 0; seq < FRAMES; seq++)
+        {
+            Frames::Bytes bytes = frame((uint16_t)seq, rnd(8) == 0);
+            const uint32_t fault = rnd(10);
+            bool intact = true;
+            bool delimiter = true;
+            const size_t at = rnd((uint32_t)bytes.size() - 1);
+            if (fault == 0)
+            {
+                bytes[at] ^= (uint8_t)(rnd(255) + 1);
+                intact = false;
+            }
+            else if (fault == 1)
+            {
+                bytes.erase(bytes.begin() + (long)at);
+                intact = false;
+            }
+            else if (fault == 2)
+            {
+                bytes.pop_back();
+                delimiter = false;
+            }
+            if (intact && previousDelimiter && delimiter)
+                expected.push_back(seq);
+            damaged += !intact || !delimiter;
+            previousDelimiter = delimiter;
+            append(wire, bytes);
+        }
+        const std::vector<int> got = receive(wire);
+        CHECK(got == expected);
+        f.cases += damaged;
+        f.recovered += got == expected ? damaged : 0;
+        printf("random stream: %d frames, %ld damaged, %zu delivered, %zu expected\n", FRAMES, damaged, got.size(),
+               expected.size());
+    }
+}
+
+int main()
+{
+    setup();
+    const Stats::PortCounters &counters = Stats::g_ports[ROW][COL];
+    Faults f{0, 0};
+    testClean();
+    testByteFlips(f);
+    testTruncatedBlocks(f);
+    testMissingDelimiter(f);
+    testRandomStream(f);
+    CHECK_EQ(g_serial->linkMode, LINK_MODE_COBS);
+    printf("COBS faults: %ld injected, %ld resynced at the next delimiter; %u frames, %u CRC errors, %u parser resets\n",
+           f.cases, f.recovered, (unsigned)counters.rxFrames, (unsigned)counters.crcErrors,
+           (unsigned)counters.parserResets);
+    return checkResult("test_module_link");
+}
@@ -0,0 +1,249 @@
+// Coalesced parameter writes against a simulated module on one port. The
+// module is detected and brought up over the sum-framed link. It answers
+// SET_PARAMETER and GET_PARAMETER after the wire time of both frames at
+// 115200 baud plus its own turnaround. A burst of writes costs one SET per
+// round trip and one confirming read. A write that finds the port's TX
+// queue full goes out once the queue drains instead of being dropped.
+// Prints the frame counts for each scenario.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "boardconfig.h"
+#include "check.h"
+#include "frames.h"
+#include "host_sim.h"
+#include "ipc.hpp"
+#include "mapping.h"
+#include "port.h"
+
+namespace
+{
+    constexpr int ROW = 0;
+    constexpr int COL = 1;
+    constexpr uint32_t PASS_US = 100;
+    constexpr uint32_t BYTE_US = 87;    // 10 bits at 115200 baud
+    constexpr uint32_t ANSWER_US = 500; // module turnaround
+
+    // The module's side of the link. Its TX is the pin the host detects as
+    // HIGH (host RX); it reads the host's soft UART output on the other one.
+    struct SimModule
+    {
+        uint8_t txPin;
+        uint8_t rxPin;
+        Frames::Bytes rx;
+        int32_t value;
+        long sets;
+        long gets;
+        long others;
+
+        struct Answer
+        {
+            uint64_t dueUs;
+            Frames::Bytes frame;
+        };
+        std::vector<Answer> answers;
+
+        size_t requestBytes = 0;
+
+        void answer(uint8_t inResponseTo, ModuleStatus status, const Frames::Bytes &data)
+        {
+            Frames::Bytes frame = Frames::moduleResponse(LINK_MODE_SUM8, inResponseTo, status, data);
+            const uint64_t due = HostSim::nowUs() + (requestBytes + frame.size()) * BYTE_US + ANSWER_US;
+            answers.push_back({due, frame});
+        }
+
+        void handle(const Frames::ModuleFrame &f)
+        {
+            requestBytes = 5 + f.payload.size();
+            switch (f.commandId)
+            {
+            case CMD_GET_PROPERTIES:
+            {
+                ModuleMessageGetPropertiesPayload props{};
+                strcpy(props.module.name, "fader");
+                props.module.parameterCount = 1;
+                ModuleParameter &p = props.module.parameters[0];
+                p.id = 0;
+                strcpy(p.name, "position");
+                p.dataType = ModuleParameterDataType::PARAM_TYPE_INT;
+                p.access = ACCESS_READ_WRITE;
+                p.minMax.intMin = 0;
+                p.minMax.intMax = 1023;
+                Frames::Bytes data;
+                Frames::appendValue(data, props);
+                answer(CMD_GET_PROPERTIES, MODULE_STATUS_OK, data);
+                break;
+            }
+            case CMD_GET_MAPPINGS:
+                answer(CMD_GET_MAPPINGS, MODULE_STATUS_OK, {0});
+                break;
+            case CMD_SET_PARAMETER:
+            {
+                sets++;
+                ModuleMessageSetParameterPayload p{};
+                memcpy(&p, f.payload.data(), f.payload.size() < sizeof(p) ? f.payload.size() : sizeof(p));
+                if (p.parameterId == 0)
+                    value = p.value.intValue;
+                answer(CMD_SET_PARAMETER, p.parameterId == 0 ? MODULE_STATUS_OK : MODULE_STATUS_ERROR, {});
+                break;
+            }
+            case CMD_GET_PARAMETER:
+            {
+                gets++;
+                const uint8_t pid = f.payload.empty() ? 0xFF : f.payload[0];
+                Frames::Bytes data{pid};
+                Frames::appendValue(data, value);
+                answer(CMD_GET_PARAMETER, pid == 0 ? MODULE_STATUS_OK : MODULE_STATUS_ERROR, data);
+                break;
+            }
+            default:
+                others++;
+                answer(f.commandId, MODULE_STATUS_OK, {});
+                break;
+            }
+        }
+
+        void service()
+        {
+            const std::vector<uint8_t> bytes = HostSim::takeTx(rxPin);
+            rx.insert(rx.end(), bytes.begin(), bytes.end());
+            // Host frames are clean, so the decoded frames are a prefix of rx
+            size_t used = 0;
+            for (const Frames::ModuleFrame &f : Frames::decodeModuleFrames(LINK_MODE_SUM8, rx))
+            {
+                used += 5 + f.payload.size();
+                handle(f);
+            }
+            rx.erase(rx.begin(), rx.begin() + (long)used);
+
+            for (size_t i = 0; i < answers.size();)
+            {
+                if (answers[i].dueUs > HostSim::nowUs())
+                {
+                    i++;
+                    continue;
+                }
+                HostSim::pinRx(txPin, answers[i].frame.data(), answers[i].frame.size());
+                answers.erase(answers.begin() + (long)i);
+            }
+            HostSim::runPioIrq(0);
+            HostSim::runPioIrq(1);
+        }
+
+        void clearCounts()
+        {
+            sets = gets = others = 0;
+        }
+    };
+
+    SimModule g_module{};
+
+    void run(uint32_t ms)
+    {
+        for (uint32_t us = 0; us < ms * 1000u; us += PASS_US)
+        {
+            HostSim::advanceUs(PASS_US);
+            g_module.service();
+            Port::task();
+        }
+    }
+
+    int32_t cached()
+    {
+        return Port::get(ROW, COL)->module.parameters[0].value.intValue;
+    }
+
+    void write(int32_t v)
+    {
+        ModuleParameterValue value{};
+        value.intValue = v;
+        CHECK(Port::sendSetParameter(ROW, COL, 0, ModuleParameterDataType::PARAM_TYPE_INT, value));
+    }
+
+    void bringUp()
+    {
+        HostSim::reset();
+        HostSim::setCore(1);
+        IPC::init();
+        MappingManager::init();
+        Port::init();
+        g_module.txPin = portTxPins[ROW][COL];
+        g_module.rxPin = portRxPins[ROW][COL];
+        HostSim::setPinLevel(g_module.txPin, 1);
+        run(100);
+        const Port::State *port = Port::get(ROW, COL);
+        CHECK(port->configured && port->hasModule);
+        CHECK(port->bringUp == Port::BringUp::LIVE);
+    }
+
+    void report(const char *name, long writes)
+    {
+        printf("%-28s %5ld writes  %5ld SET  %3ld GET  module %4d  cache %4d\n", name, writes, g_module.sets,
+               g_module.gets, (int)g_module.value, (int)cached());
+    }
+
+    // A fader sweep, one write per millisecond: writes during a round trip
+    // replace the pending value
+    void testBurst()
+    {
+        g_module.clearCounts();
+        const long writes = 1000;
+        for (int32_t v = 0; v < writes; v++)
+        {
+            write(v);
+            run(1);
+        }
+        run(200);
+        report("1 kHz sweep", writes);
+        CHECK_EQ(g_module.value, writes - 1);
+        CHECK_EQ(cached(), writes - 1);
+        CHECK(g_module.sets > 0 && g_module.sets < writes / 2);
+        CHECK_EQ(g_module.gets, 1);
+    }
+
+    // The write finds the port's TX queue full (eight reads queued in the
+    // same pass): it waits for a free slot instead of being lost
+    void testQueueFull()
+    {
+        run(200);
+        g_module.clearCounts();
+        for (uint8_t pid = 0; pid < 8; pid++)
+            CHECK(Port::sendGetParameter(ROW, COL, pid));
+        CHECK(!Port::sendGetParameter(ROW, COL, 0x40));
+        write(777);
+        CHECK_EQ(cached(), 777);
+        run(200);
+        report("write behind a full queue", 1);
+        CHECK_EQ(g_module.value, 777);
+        CHECK_EQ(cached(), 777);
+        CHECK_EQ(g_module.sets, 1);
+
+        // A full queue during a burst: the latest value still gets through
+        for (uint8_t pid = 0; pid < 8; pid++)
+            Port::sendGetParameter(ROW, COL, pid);
+        g_module.clearCounts();
+        for (int32_t v = 100; v < 150; v++)
+        {
+            write(v);
+            if (v % 10 == 0)
+            {
+                for (uint8_t pid = 0; pid < 8; pid++)
+                    Port::sendGetParameter(ROW, COL, pid);
+            }
+            run(1);
+        }
+        run(200);
+        report("50 writes, queue kept full", 50);
+        CHECK_EQ(g_module.value, 149);
+        CHECK_EQ(cached(), 149);
+    }
+}
+
+int main()
+{
+    bringUp();
+    testBurst();
+    testQueueFull();
+    return checkResult("test_param_writes");
+}
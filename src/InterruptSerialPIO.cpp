@@ -27,10 +27,12 @@
 #include "pico/time.h"
 #include "pio_uart.pio.h"
 #include "hardware/structs/systick.h"
+#include "hardware/structs/timer.h"
 #include <cstring>
+#include "stats.h"
 
-// Global state for IRQ dispatch
-static InterruptSerialPIO *g_pioInstances[2][4] = {};
+// RX IRQ dispatch table from the board (ispio_set_dispatch), one per PIO
+static const IspioDispatch *g_dispatch = NULL;
 static int rxProgramOffset[2] = {-1, -1};
 static bool irqInit[2] = {false, false};
 static void (*g_messageSink)(ModuleMessage *) = NULL;
@@ -38,6 +40,25 @@ static void (*g_messageSink)(ModuleMessage *) = NULL;
 static const uint32_t PARSER_TIMEOUT_MS = 50;
 static const uint NOPIN = 0xFFFFFFFF;
 
+// Time-shared RX state machines, by PIO and SM. Core1 runs the PIO and the
+// rotation IRQ; thread code touches this with interrupts off.
+typedef struct
+{
+    InterruptSerialPIO *members[ISPIO_SHARED_MAX];
+    uint8_t count;
+    uint8_t current; // member the SM listens to
+    bool running;
+    uint32_t holdUntil; // time_us_32(): `current` keeps the SM until then
+} SharedSM;
+
+static SharedSM g_shared[2][4] = {};
+static int g_rotateAlarm = -1;
+// Rotation tick, turn of each port when nobody talks, and how long a port
+// that was written to keeps the SM waiting for its reply
+static const uint32_t SHARED_TICK_US = 1000;
+static const uint32_t SHARED_DWELL_US = 4000;
+static const uint32_t SHARED_REPLY_US = 10000;
+
 static uint8_t __not_in_flash_func(calcChecksum)(const uint8_t *data, size_t len)
 {
     uint16_t sum = 0;
@@ -48,12 +69,47 @@ static uint8_t __not_in_flash_func(calcChecksum)(const uint8_t *data, size_t len
     return (uint8_t)(sum & 0xFF);
 }
 
+// CRC-16/CCITT lookup table, generated at compile time. Not const so it is
+// placed in RAM: the RX IRQ checks frames while flash may be busy.
+struct Crc16Table
+{
+    uint16_t entry[256];
+};
+
+static constexpr Crc16Table makeCrc16Table()
+{
+    Crc16Table t{};
+    for (int i = 0; i < 256; i++)
+    {
+        uint16_t crc = (uint16_t)(i << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        t.entry[i] = crc;
+    }
+    return t;
+}
+
+static Crc16Table g_crc16Table = makeCrc16Table();
+
+uint16_t __not_in_flash_func(ispio_crc16)(uint16_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = (uint16_t)((crc << 8) ^ g_crc16Table.entry[(uint8_t)((crc >> 8) ^ data[i])]);
+    }
+    return crc;
+}
+
 static inline void __not_in_flash_func(pio_irq_common)(PIO pio)
 {
     uint idx = pio_get_index(pio);
     for (int sm = 0; sm < 4; sm++)
     {
-        InterruptSerialPIO *inst = g_pioInstances[idx][sm];
+        // A shared SM's owner is whichever member it listens to right now
+        const SharedSM *g = &g_shared[idx][sm];
+        InterruptSerialPIO *inst = g->running ? g->members[g->current] : g_dispatch ? g_dispatch[idx].owner[sm] : NULL;
         if (inst)
         {
             ispio_handle_irq(inst);
@@ -87,39 +143,90 @@ void ispio_deinit(InterruptSerialPIO *self)
     ispio_end(self);
 }
 
+void ispio_set_dispatch(const IspioDispatch *table)
+{
+    g_dispatch = table;
+}
+
 void ispio_set_message_sink(void (*handler)(ModuleMessage *))
 {
     g_messageSink = handler;
 }
 
-static bool claim_rx_sm(PIO *outPio, int *outSm, uint *outOffset)
+void ispio_set_link_mode(InterruptSerialPIO *self, uint8_t mode)
+{
+    uint32_t flags = save_and_disable_interrupts();
+    self->linkMode = mode;
+    self->txLinkMode = mode;
+    self->pendingLinkMode = mode;
+    restore_interrupts(flags);
+}
+
+void ispio_request_link_mode(InterruptSerialPIO *self, uint8_t mode)
 {
-    // Try pio0 then pio1
-    int sm = pio_claim_unused_sm(pio0, false);
-    if (sm >= 0)
+    // The reply takes at least a frame time, so it cannot beat this
+    uint32_t flags = save_and_disable_interrupts();
+    self->txLinkMode = mode;
+    self->pendingLinkMode = mode;
+    restore_interrupts(flags);
+}
+
+static void set_rx_irq(PIO pio, int sm, bool enabled)
+{
+    pio_set_irq0_source_enabled(pio, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + sm), enabled);
+}
+
+static void install_pio_irq(uint idx)
+{
+    if (irqInit[idx])
     {
-        *outPio = pio0;
-        *outSm = sm;
-        if (rxProgramOffset[0] < 0)
-        {
-            rxProgramOffset[0] = pio_add_program(pio0, &pio_rx_program);
-        }
-        *outOffset = rxProgramOffset[0];
-        return true;
+        return;
     }
-    sm = pio_claim_unused_sm(pio1, false);
-    if (sm >= 0)
+    if (idx == 0)
     {
-        *outPio = pio1;
-        *outSm = sm;
-        if (rxProgramOffset[1] < 0)
-        {
-            rxProgramOffset[1] = pio_add_program(pio1, &pio_rx_program);
-        }
-        *outOffset = rxProgramOffset[1];
-        return true;
+        irq_set_exclusive_handler(PIO0_IRQ_0, pio0_irq);
+        irq_set_enabled(PIO0_IRQ_0, true);
+    }
+    else
+    {
+        irq_set_exclusive_handler(PIO1_IRQ_0, pio1_irq);
+        irq_set_enabled(PIO1_IRQ_0, true);
     }
-    return false;
+    irqInit[idx] = true;
+}
+
+static uint rx_program_offset(PIO pio)
+{
+    uint idx = pio_get_index(pio);
+    if (rxProgramOffset[idx] < 0)
+    {
+        rxProgramOffset[idx] = pio_add_program(pio, &pio_rx_program);
+    }
+    return rxProgramOffset[idx];
+}
+
+static void init_rx_sm(PIO pio, int sm, uint offset, uint pin)
+{
+    pio_sm_config c = pio_rx_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin);
+    sm_config_set_jmp_pin(&c, pin);
+    sm_config_set_in_shift(&c, true, false, 32); // shift right, no autopush
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+
+    float div = (float)clock_get_hz(clk_sys) / (float)(ISPIO_FIXED_BAUD * 8); // 8x oversample
+    sm_config_set_clkdiv(&c, div);
+
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, false);
+    pio_sm_clear_fifos(pio, sm);
+}
+
+static void init_rx_pin(PIO pio, uint pin)
+{
+    pio_gpio_init(pio, pin);
+    // Bias RX low so a disconnected/floating module doesn't appear as UART-idle HIGH.
+    // The module's TX should actively drive HIGH when present/idle.
+    gpio_pull_down(pin);
 }
 
 static inline void __not_in_flash_func(resetParser)(InterruptSerialPIO *self)
@@ -127,14 +234,223 @@ static inline void __not_in_flash_func(resetParser)(InterruptSerialPIO *self)
     self->parser.length = 0;
     self->parser.expectedLength = 0;
     self->parser.syncing = false;
+    self->parser.discard = false;
     self->parser.lastByteReceivedTime = 0;
     self->lastByteReceivedTime = 0;
 }
 
+// Point a shared SM at another member's RX pin. Only called between frames
+// with interrupts off, so nothing in flight is cut.
+static void __not_in_flash_func(shared_listen)(SharedSM *g, uint8_t member)
+{
+    InterruptSerialPIO *next = g->members[member];
+    PIO pio = next->rxPIO;
+    const uint sm = (uint)next->rxSM;
+    pio_sm_set_enabled(pio, sm, false);
+    hw_write_masked(&pio->sm[sm].pinctrl, next->rx << PIO_SM0_PINCTRL_IN_BASE_LSB, PIO_SM0_PINCTRL_IN_BASE_BITS);
+    hw_write_masked(&pio->sm[sm].execctrl, next->rx << PIO_SM0_EXECCTRL_JMP_PIN_LSB, PIO_SM0_EXECCTRL_JMP_PIN_BITS);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    pio_sm_exec(pio, sm, pio_encode_jmp(next->rxOffset));
+    g->current = member;
+    resetParser(next);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+// The listened port is between frames: its SM waits for a start bit with
+// nothing buffered, and no frame is half parsed.
+static bool __not_in_flash_func(shared_idle)(const InterruptSerialPIO *cur, uint32_t now)
+{
+    if (!pio_sm_is_rx_fifo_empty(cur->rxPIO, cur->rxSM) || pio_sm_get_pc(cur->rxPIO, cur->rxSM) != cur->rxOffset)
+    {
+        return false;
+    }
+    return !cur->parser.syncing || (now - cur->parser.lastByteReceivedTime > PARSER_TIMEOUT_MS * 1000u);
+}
+
+// Round robin between frames for ports nobody is talking to.
+static void __not_in_flash_func(shared_rotate_irq)()
+{
+    timer_hw->intr = 1u << g_rotateAlarm;
+    const uint32_t now = time_us_32();
+    for (int idx = 0; idx < 2; idx++)
+    {
+        for (int sm = 0; sm < 4; sm++)
+        {
+            SharedSM *g = &g_shared[idx][sm];
+            if (!g->running || g->count < 2 || (int32_t)(now - g->holdUntil) < 0 || !shared_idle(g->members[g->current], now))
+            {
+                continue;
+            }
+            // No `%`: division calls the SDK divider routines, which live in flash
+            const uint8_t next = (uint8_t)(g->current + 1 < g->count ? g->current + 1 : 0);
+            shared_listen(g, next);
+            g->holdUntil = now + SHARED_DWELL_US;
+        }
+    }
+    timer_hw->alarm[g_rotateAlarm] = time_us_32() + SHARED_TICK_US;
+}
+
+static void start_rotation()
+{
+    if (g_rotateAlarm >= 0)
+    {
+        return;
+    }
+    g_rotateAlarm = hardware_alarm_claim_unused(false);
+    if (g_rotateAlarm < 0)
+    {
+        return; // Ports still switch when written to
+    }
+    irq_set_exclusive_handler(TIMER_IRQ_0 + g_rotateAlarm, shared_rotate_irq);
+    hw_set_bits(&timer_hw->inte, 1u << g_rotateAlarm);
+    irq_set_enabled(TIMER_IRQ_0 + g_rotateAlarm, true);
+    timer_hw->alarm[g_rotateAlarm] = time_us_32() + SHARED_TICK_US;
+}
+
+static void shared_begin(InterruptSerialPIO *self)
+{
+    const uint idx = pio_get_index(self->rxPIO);
+    SharedSM *g = &g_shared[idx][self->rxSM];
+    init_rx_pin(self->rxPIO, self->rx);
+
+    uint32_t flags = save_and_disable_interrupts();
+    int member = -1;
+    for (int i = 0; i < g->count; i++)
+    {
+        if (g->members[i] == self)
+        {
+            member = i;
+        }
+    }
+    if (member < 0 && g->count < ISPIO_SHARED_MAX)
+    {
+        member = g->count;
+        g->members[g->count++] = self;
+    }
+    if (member >= 0 && !g->running)
+    {
+        init_rx_sm(self->rxPIO, self->rxSM, self->rxOffset, self->rx);
+        set_rx_irq(self->rxPIO, self->rxSM, true);
+        install_pio_irq(idx);
+        g->current = (uint8_t)member;
+        g->holdUntil = time_us_32();
+        pio_sm_set_enabled(self->rxPIO, self->rxSM, true);
+        g->running = true;
+    }
+    restore_interrupts(flags);
+    start_rotation();
+}
+
+static void shared_end(InterruptSerialPIO *self)
+{
+    const uint idx = pio_get_index(self->rxPIO);
+    SharedSM *g = &g_shared[idx][self->rxSM];
+
+    uint32_t flags = save_and_disable_interrupts();
+    for (int i = 0; i < g->count; i++)
+    {
+        if (g->members[i] != self)
+        {
+            continue;
+        }
+        const bool wasListening = g->running && g->current == i;
+        for (int k = i; k + 1 < g->count; k++)
+        {
+            g->members[k] = g->members[k + 1];
+        }
+        g->count--;
+        if (g->current > i)
+        {
+            g->current--;
+        }
+        if (g->count == 0)
+        {
+            set_rx_irq(self->rxPIO, self->rxSM, false);
+            pio_sm_set_enabled(self->rxPIO, self->rxSM, false);
+            pio_sm_clear_fifos(self->rxPIO, self->rxSM);
+            g->running = false;
+        }
+        else if (wasListening)
+        {
+            shared_listen(g, (uint8_t)(i % g->count));
+            g->holdUntil = time_us_32() + SHARED_DWELL_US;
+        }
+        break;
+    }
+    restore_interrupts(flags);
+}
+
+// Before writing to a shared port: the SM is free once the last port written
+// to got its reply or ran out of time (counted from `start`, when this port
+// began waiting) and no frame is in flight. Then it listens to this port until
+// its reply arrives. With `force` it switches even if the SM is busy.
+static bool __not_in_flash_func(shared_try_talk)(InterruptSerialPIO *self, uint32_t start, bool force)
+{
+    SharedSM *g = &g_shared[pio_get_index(self->rxPIO)][self->rxSM];
+    uint32_t flags = save_and_disable_interrupts();
+    const uint32_t now = time_us_32();
+    bool ready = false;
+    if (!g->running || g->count == 0)
+    {
+        ready = true;
+    }
+    else if (g->members[g->current] == self)
+    {
+        g->holdUntil = now + SHARED_REPLY_US;
+        ready = true;
+    }
+    else
+    {
+        const bool free = (int32_t)(now - g->holdUntil) >= 0 || now - start > SHARED_REPLY_US;
+        if (force || (free && shared_idle(g->members[g->current], now)))
+        {
+            for (int i = 0; i < g->count; i++)
+            {
+                if (g->members[i] == self)
+                {
+                    shared_listen(g, (uint8_t)i);
+                    g->holdUntil = now + SHARED_REPLY_US;
+                }
+            }
+            ready = true;
+        }
+    }
+    restore_interrupts(flags);
+    return ready;
+}
+
+static void __not_in_flash_func(shared_talk)(InterruptSerialPIO *self)
+{
+    const uint32_t start = time_us_32();
+    while (!shared_try_talk(self, start, false))
+    {
+        if (time_us_32() - start > 2 * SHARED_REPLY_US)
+        {
+            return; // Another module keeps sending: write anyway, its reply is likely lost
+        }
+    }
+}
+
+// A frame arrived on a shared port: a reply ends its hold.
+static inline void __not_in_flash_func(shared_frame_done)(InterruptSerialPIO *self)
+{
+    SharedSM *g = &g_shared[pio_get_index(self->rxPIO)][self->rxSM];
+    if (g->running && g->members[g->current] == self)
+    {
+        g->holdUntil = time_us_32();
+    }
+}
+
 void ispio_begin(InterruptSerialPIO *self, unsigned long baud)
 {
     (void)baud; // fixed
     resetParser(self);
+    // A newly attached module talks sum frames until told otherwise
+    self->linkMode = LINK_MODE_SUM8;
+    self->txLinkMode = LINK_MODE_SUM8;
+    self->pendingLinkMode = LINK_MODE_SUM8;
+    self->txWaiting = false;
 
     if ((self->tx == NOPIN) && (self->rx == NOPIN))
     {
@@ -158,77 +474,30 @@ void ispio_begin(InterruptSerialPIO *self, unsigned long baud)
     {
         if (self->rxSM < 0)
         {
-            if (!claim_rx_sm(&self->rxPIO, &self->rxSM, &self->rxOffset))
-            {
-                return; // No PIO available
-            }
+            return; // The board assigns every port its SM (ispio_set_pio_sm)
         }
-        else
+        self->rxOffset = rx_program_offset(self->rxPIO);
+        if (!pio_sm_is_claimed(self->rxPIO, self->rxSM))
         {
-            uint idx = pio_get_index(self->rxPIO);
-            if (rxProgramOffset[idx] < 0)
-            {
-                rxProgramOffset[idx] = pio_add_program(self->rxPIO, &pio_rx_program);
-            }
-            self->rxOffset = rxProgramOffset[idx];
-            if (!pio_sm_is_claimed(self->rxPIO, self->rxSM))
-            {
-                pio_sm_claim(self->rxPIO, self->rxSM);
-            }
+            pio_sm_claim(self->rxPIO, self->rxSM);
         }
 
-        pio_sm_config c = pio_rx_program_get_default_config(self->rxOffset);
-        sm_config_set_in_pins(&c, self->rx);
-        sm_config_set_jmp_pin(&c, self->rx);
-        sm_config_set_in_shift(&c, true, false, 32); // shift right, no autopush
-        sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
-
-        float div = (float)clock_get_hz(clk_sys) / (float)(ISPIO_FIXED_BAUD * 8); // 8x oversample
-        sm_config_set_clkdiv(&c, div);
-
-        pio_sm_init(self->rxPIO, self->rxSM, self->rxOffset, &c);
-        pio_sm_set_consecutive_pindirs(self->rxPIO, self->rxSM, self->rx, 1, false);
-        pio_gpio_init(self->rxPIO, self->rx);
-        // Bias RX low so a disconnected/floating module doesn't appear as UART-idle HIGH.
-        // The module's TX should actively drive HIGH when present/idle.
-        gpio_pull_down(self->rx);
-        pio_sm_clear_fifos(self->rxPIO, self->rxSM);
-
-        // Enable IRQ for RX FIFO not empty
-        switch (self->rxSM)
+        if (self->sharedSM)
         {
-        case 0:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm0_rx_fifo_not_empty, true);
-            break;
-        case 1:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm1_rx_fifo_not_empty, true);
-            break;
-        case 2:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm2_rx_fifo_not_empty, true);
-            break;
-        case 3:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm3_rx_fifo_not_empty, true);
-            break;
+            shared_begin(self);
+            self->running = true;
+            return;
         }
 
+        init_rx_sm(self->rxPIO, self->rxSM, self->rxOffset, self->rx);
+        init_rx_pin(self->rxPIO, self->rx);
+
+        // Enable IRQ for RX FIFO not empty
+        set_rx_irq(self->rxPIO, self->rxSM, true);
         uint idx = pio_get_index(self->rxPIO);
-        if (!irqInit[idx])
-        {
-            if (idx == 0)
-            {
-                irq_set_exclusive_handler(PIO0_IRQ_0, pio0_irq);
-                irq_set_enabled(PIO0_IRQ_0, true);
-            }
-            else
-            {
-                irq_set_exclusive_handler(PIO1_IRQ_0, pio1_irq);
-                irq_set_enabled(PIO1_IRQ_0, true);
-            }
-            irqInit[idx] = true;
-        }
+        install_pio_irq(idx);
 
         pio_sm_set_enabled(self->rxPIO, self->rxSM, true);
-        g_pioInstances[idx][self->rxSM] = self;
     }
 
     self->running = true;
@@ -240,36 +509,15 @@ void ispio_end(InterruptSerialPIO *self)
     {
         return;
     }
-    if (self->rx != NOPIN)
+    if (self->rx != NOPIN && self->sharedSM)
     {
-        uint idx = pio_get_index(self->rxPIO);
-        g_pioInstances[idx][self->rxSM] = NULL;
-
-        switch (self->rxSM)
-        {
-        case 0:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm0_rx_fifo_not_empty, false);
-            pio_sm_clear_fifos(self->rxPIO, 0);
-            break;
-        case 1:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm1_rx_fifo_not_empty, false);
-            pio_sm_clear_fifos(self->rxPIO, 1);
-            break;
-        case 2:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm2_rx_fifo_not_empty, false);
-            pio_sm_clear_fifos(self->rxPIO, 2);
-            break;
-        case 3:
-            pio_set_irq0_source_enabled(self->rxPIO, pis_sm3_rx_fifo_not_empty, false);
-            pio_sm_clear_fifos(self->rxPIO, 3);
-            break;
-        }
-
+        shared_end(self);
+    }
+    else if (self->rx != NOPIN)
+    {
+        set_rx_irq(self->rxPIO, self->rxSM, false);
+        pio_sm_clear_fifos(self->rxPIO, self->rxSM);
         pio_sm_set_enabled(self->rxPIO, self->rxSM, false);
-        if (!self->staticSM)
-        {
-            pio_sm_unclaim(self->rxPIO, self->rxSM);
-        }
     }
     self->running = false;
 }
@@ -290,7 +538,36 @@ void ispio_set_pio_sm(InterruptSerialPIO *self, PIO pio, int sm)
 {
     self->rxPIO = pio;
     self->rxSM = sm;
-    self->staticSM = true;
+    self->sharedSM = false;
+}
+
+void ispio_set_shared_sm(InterruptSerialPIO *self, PIO pio, int sm)
+{
+    ispio_set_pio_sm(self, pio, sm);
+    self->sharedSM = true;
+}
+
+bool ispio_tx_ready(InterruptSerialPIO *self)
+{
+    if (!self->running || !self->sharedSM || self->rx == NOPIN)
+    {
+        return true;
+    }
+    const uint32_t now = time_us_32();
+    if (!self->txWaiting)
+    {
+        self->txWaiting = true;
+        self->txWaitStart = now;
+    }
+    // Past the wait shared_talk() gives up after, cut in: the neighbour's
+    // frame in flight is lost rather than this port's reply
+    const bool force = now - self->txWaitStart > 2 * SHARED_REPLY_US;
+    if (!shared_try_talk(self, self->txWaitStart, force))
+    {
+        return false;
+    }
+    self->txWaiting = false;
+    return true;
 }
 
 // Host TX are small command payloads (~10 bytes) so bit-banging is acceptable
@@ -314,6 +591,11 @@ size_t __not_in_flash_func(ispio_write)(InterruptSerialPIO *self, uint8_t c)
     // Pre-calculate masks
     uint32_t pinMask = 1ul << self->tx;
 
+    if (self->sharedSM && self->rx != NOPIN)
+    {
+        shared_talk(self);
+    }
+
     uint32_t flags = save_and_disable_interrupts();
 
     uint32_t start = systick_hw->cvr;
@@ -385,7 +667,11 @@ static void __not_in_flash_func(emitFrame)(InterruptSerialPIO *self)
     {
         slot->payloadLength = sizeof(slot->payload);
     }
-    memcpy(slot->payload, &self->parser.buffer[4], slot->payloadLength);
+    // Plain loop rather than memcpy: this path must stay in RAM while flash is busy
+    for (uint16_t i = 0; i < slot->payloadLength; i++)
+    {
+        slot->payload[i] = self->parser.buffer[4 + i];
+    }
 
     commitMessageFromIRQ();
 
@@ -395,28 +681,160 @@ static void __not_in_flash_func(emitFrame)(InterruptSerialPIO *self)
     }
 }
 
+// Counted against the grid slot given by ispio_set_port_location()
+static inline void __not_in_flash_func(countPort)(InterruptSerialPIO *self, volatile uint32_t Stats::PortCounters::*field)
+{
+    if (self->row < MODULE_PORT_ROWS && self->col < MODULE_PORT_COLS)
+    {
+        volatile uint32_t &v = Stats::g_ports[self->row][self->col].*field;
+        v = v + 1;
+    }
+}
+
+// A valid frame in parser.buffer (commandId at [1]) may be the module's answer
+// to CMD_SET_LINK_MODE: its next frame already uses the new framing.
+static inline void __not_in_flash_func(checkLinkModeAck)(InterruptSerialPIO *self)
+{
+    if (self->pendingLinkMode == self->linkMode)
+    {
+        return;
+    }
+    const uint8_t *f = self->parser.buffer;
+    const uint16_t payloadLen = (uint16_t)f[2] | ((uint16_t)f[3] << 8);
+    if (f[1] != CMD_RESPONSE || payloadLen < 2 || f[5] != CMD_SET_LINK_MODE)
+    {
+        return;
+    }
+    if (f[4] == MODULE_STATUS_OK)
+    {
+        self->linkMode = self->pendingLinkMode;
+    }
+    else
+    {
+        self->txLinkMode = self->linkMode;
+        self->pendingLinkMode = self->linkMode;
+    }
+}
+
+static inline void __not_in_flash_func(frameReceived)(InterruptSerialPIO *self)
+{
+    countPort(self, &Stats::PortCounters::rxFrames);
+    emitFrame(self);
+    checkLinkModeAck(self);
+    if (self->sharedSM)
+    {
+        shared_frame_done(self);
+    }
+}
+
+// A COBS frame decodes into parser.buffer from [1] on, the layout of the
+// other framings minus the start byte: commandId, length, payload, CRC-16.
+static inline void __not_in_flash_func(finishCobsFrame)(InterruptSerialPIO *self)
+{
+    SerialParser *p = &self->parser;
+    const uint16_t payloadLen = p->length >= 4 ? (uint16_t)((uint16_t)p->buffer[2] | ((uint16_t)p->buffer[3] << 8)) : 0;
+    if (p->cobsRun != 0 || p->length < 6 || p->length != 6u + payloadLen)
+    {
+        countPort(self, &Stats::PortCounters::parserResets);
+        return;
+    }
+    const uint16_t received = (uint16_t)p->buffer[p->length - 2] | ((uint16_t)p->buffer[p->length - 1] << 8);
+    if (received != ispio_crc16(0xFFFF, p->buffer + 1, p->length - 3))
+    {
+        countPort(self, &Stats::PortCounters::crcErrors);
+        return;
+    }
+    frameReceived(self);
+}
+
+static inline void __not_in_flash_func(processCobsByte)(InterruptSerialPIO *self, uint8_t b)
+{
+    SerialParser *p = &self->parser;
+    if (b == 0)
+    {
+        if (p->syncing && !p->discard)
+        {
+            finishCobsFrame(self);
+        }
+        resetParser(self);
+        return;
+    }
+    if (p->discard)
+    {
+        return;
+    }
+
+    uint32_t now = time_us_32();
+    p->lastByteReceivedTime = now;
+    self->lastByteReceivedTime = now;
+    if (!p->syncing)
+    {
+        p->buffer[0] = 0;
+        p->length = 1;
+        p->cobsRun = 0;
+        p->cobsZero = false;
+        p->syncing = true;
+    }
+
+    uint8_t data = b;
+    if (p->cobsRun == 0)
+    {
+        // Block header: the previous block's implied zero is data only if
+        // this one follows it
+        const bool zero = p->cobsZero;
+        p->cobsRun = (uint8_t)(b - 1);
+        p->cobsZero = b != 0xFF;
+        if (!zero)
+        {
+            return;
+        }
+        data = 0;
+    }
+    else
+    {
+        p->cobsRun--;
+    }
+
+    if (p->length >= sizeof(p->buffer))
+    {
+        countPort(self, &Stats::PortCounters::parserResets);
+        p->discard = true;
+        return;
+    }
+    p->buffer[p->length++] = data;
+}
+
 static inline void __not_in_flash_func(processByte)(InterruptSerialPIO *self, uint8_t b)
 {
     SerialParser *p = &self->parser;
+    if (self->linkMode == LINK_MODE_COBS)
+    {
+        processCobsByte(self, b);
+        return;
+    }
     if (!p->syncing)
     {
-        if (b == 0xAA)
+        // Once CRC framing is negotiated, 0xAA no longer starts a frame
+        const bool crc = b == MODULE_FRAME_START_CRC16;
+        if (crc || (b == MODULE_FRAME_START_SUM8 && self->linkMode == LINK_MODE_SUM8))
         {
             p->buffer[0] = b;
             p->length = 1;
             p->syncing = true;
+            p->crc = crc;
         }
         return;
     }
 
     if (p->length >= sizeof(p->buffer))
     {
+        countPort(self, &Stats::PortCounters::parserResets);
         resetParser(self);
         return;
     }
 
     p->buffer[p->length++] = b;
-    uint32_t now = to_ms_since_boot(get_absolute_time());
+    uint32_t now = time_us_32();
     p->lastByteReceivedTime = now;
     self->lastByteReceivedTime = now;
 
@@ -425,12 +843,14 @@ static inline void __not_in_flash_func(processByte)(InterruptSerialPIO *self, ui
         uint16_t payloadLen = (uint16_t)p->buffer[2] | ((uint16_t)p->buffer[3] << 8);
         if (payloadLen > MODULE_MAX_PAYLOAD)
         {
+            countPort(self, &Stats::PortCounters::parserResets);
             resetParser(self);
             return;
         }
-        uint32_t total = 5u + payloadLen; // 4-byte header + payload + checksum
+        uint32_t total = 4u + payloadLen + (p->crc ? 2u : 1u); // header + payload + check
         if (total > sizeof(p->buffer))
         {
+            countPort(self, &Stats::PortCounters::parserResets);
             resetParser(self);
             return;
         }
@@ -439,10 +859,23 @@ static inline void __not_in_flash_func(processByte)(InterruptSerialPIO *self, ui
 
     if (p->expectedLength > 0 && p->length == p->expectedLength)
     {
-        uint8_t checksum = p->buffer[p->length - 1];
-        if (checksum == calcChecksum(p->buffer, p->length - 1))
+        bool valid;
+        if (p->crc)
+        {
+            const uint16_t received = (uint16_t)p->buffer[p->length - 2] | ((uint16_t)p->buffer[p->length - 1] << 8);
+            valid = received == ispio_crc16(0xFFFF, p->buffer, p->length - 2);
+        }
+        else
+        {
+            valid = p->buffer[p->length - 1] == calcChecksum(p->buffer, p->length - 1);
+        }
+        if (valid)
+        {
+            frameReceived(self);
+        }
+        else
         {
-            emitFrame(self);
+            countPort(self, p->crc ? &Stats::PortCounters::crcErrors : &Stats::PortCounters::checksumErrors);
         }
         resetParser(self);
     }
@@ -456,9 +889,11 @@ void inline __not_in_flash_func(ispio_handle_irq)(InterruptSerialPIO *self)
     }
     while (!pio_sm_is_rx_fifo_empty(self->rxPIO, self->rxSM))
     {
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-        if (self->parser.syncing && self->parser.lastByteReceivedTime && (now - self->parser.lastByteReceivedTime > PARSER_TIMEOUT_MS))
+        uint32_t now = time_us_32();
+        // A stalled COBS frame needs no timeout: the next delimiter ends it
+        if (self->parser.syncing && self->linkMode != LINK_MODE_COBS && self->parser.lastByteReceivedTime && (now - self->parser.lastByteReceivedTime > PARSER_TIMEOUT_MS * 1000u))
         {
+            countPort(self, &Stats::PortCounters::parserTimeouts);
             resetParser(self);
         }
         uint8_t val = (uint8_t)((pio_sm_get_blocking(self->rxPIO, self->rxSM) >> 24) & 0xFF);
@@ -32,19 +32,28 @@ extern "C"
 #endif
 
 #define ISPIO_FIXED_BAUD 115200
+// Ports one time-shared RX state machine can serve (ispio_set_shared_sm)
+#define ISPIO_SHARED_MAX 4
 
     typedef struct
     {
-        uint8_t buffer[MODULE_MAX_PAYLOAD + 5];
+        uint8_t buffer[MODULE_MAX_PAYLOAD + 6]; // header, payload, CRC-16
         uint16_t length;
         uint16_t expectedLength;
         bool syncing;
-        uint32_t lastByteReceivedTime;
+        bool crc; // frame started with MODULE_FRAME_START_CRC16
+        // COBS decoding: data bytes left in the current block, whether the
+        // block ends in a zero, and skipping to the next delimiter after an
+        // overflow
+        uint8_t cobsRun;
+        bool cobsZero;
+        bool discard;
+        uint32_t lastByteReceivedTime; // time_us_32()
     } SerialParser;
 
     typedef struct InterruptSerialPIO
     {
-        volatile uint32_t lastByteReceivedTime;
+        volatile uint32_t lastByteReceivedTime; // time_us_32()
         bool running;
         uint tx;
         uint rx;
@@ -54,7 +63,15 @@ extern "C"
         uint rxOffset;
         uint8_t row;
         uint8_t col;
-        bool staticSM;
+        bool sharedSM;
+        bool txWaiting;       // ispio_tx_ready() said no, since txWaitStart
+        uint32_t txWaitStart; // time_us_32()
+        // ModuleLinkMode of received and sent frames, and the receive mode
+        // awaiting the module's acknowledgement. Reset to LINK_MODE_SUM8 by
+        // ispio_begin().
+        volatile uint8_t linkMode;
+        volatile uint8_t txLinkMode;
+        volatile uint8_t pendingLinkMode;
         SerialParser parser;
     } InterruptSerialPIO;
 
@@ -65,7 +82,38 @@ extern "C"
     void ispio_set_port_location(InterruptSerialPIO *self, uint8_t row, uint8_t col);
     void ispio_set_pins(InterruptSerialPIO *self, uint tx, uint rx);
     void ispio_set_pio_sm(InterruptSerialPIO *self, PIO pio, int sm);
+    // Receive through an SM shared with other ports. It listens to one port at
+    // a time: a port that was just written to is held long enough for its
+    // reply, otherwise the ports take turns between frames. Frames a module
+    // sends while another port is listened to are lost, so this suits
+    // low-rate, request/response ports.
+    void ispio_set_shared_sm(InterruptSerialPIO *self, PIO pio, int sm);
+    // RX IRQ dispatch of one PIO, generated by the board at compile time: the
+    // port that owns each dedicated state machine. Shared ones are dispatched
+    // to the member they listen to.
+    typedef struct
+    {
+        InterruptSerialPIO *owner[4];
+    } IspioDispatch;
+    // Install the board's table, indexed by PIO. The RX IRQ reads it while
+    // flash may be busy, so it must be in RAM.
+    void ispio_set_dispatch(const IspioDispatch *table);
     void ispio_set_message_sink(void (*handler)(ModuleMessage *));
+    // Framing for both directions. Outside LINK_MODE_COBS, CRC-16 frames are
+    // accepted in any mode and sum frames only in LINK_MODE_SUM8.
+    void ispio_set_link_mode(InterruptSerialPIO *self, uint8_t mode);
+    // Call right after sending CMD_SET_LINK_MODE: frames are sent in `mode`
+    // from now on, and the RX IRQ switches when the acknowledgement arrives,
+    // so the module's first frame in the new framing is not misread. A
+    // refusal puts sending back to the current mode.
+    void ispio_request_link_mode(InterruptSerialPIO *self, uint8_t mode);
+    // CRC-16/CCITT over the module link framing, table driven and RAM resident
+    uint16_t ispio_crc16(uint16_t crc, const uint8_t *data, size_t len);
+    // Non-blocking form of the wait ispio_write() does on a shared SM: true
+    // once this port may start a frame (it has the SM, or got it now). A port
+    // kept waiting too long by a chatty neighbour takes the SM anyway. Always
+    // true on a dedicated SM.
+    bool ispio_tx_ready(InterruptSerialPIO *self);
     size_t ispio_write(InterruptSerialPIO *self, uint8_t c);
     size_t ispio_write_buffer(InterruptSerialPIO *self, const uint8_t *buffer, size_t size);
     void ispio_handle_irq(InterruptSerialPIO *self);
@@ -1,44 +1,53 @@
 #include "boardconfig.h"
 
-// Definitions for the UART instances referenced via extern in boardconfig.h
-InterruptSerialPIO port1b;
-InterruptSerialPIO port1c;
-InterruptSerialPIO port2a;
-InterruptSerialPIO port2b;
-InterruptSerialPIO port2c;
-InterruptSerialPIO port3a;
-InterruptSerialPIO port3b;
-InterruptSerialPIO port3c;
+// One UART instance per populated slot, in BOARD_LAYOUT order
+static InterruptSerialPIO portSerial[MODULE_PORT_COUNT];
+static constexpr Board::PortIndex portSerialIndex = Board::portIndex();
 
-// Module port pointers using the single-copy UART instances above
-InterruptSerialPIO *modulePorts[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {
-    {nullptr, &port1b, &port1c},
-    {&port2a, &port2b, &port2c},
-    {&port3a, &port3b, &port3c}};
+// Module port pointers into portSerial, filled by initBoardSerial()
+InterruptSerialPIO *modulePorts[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {};
 
-void initBoardSerial()
+// RX IRQ dispatch: the serial instance owning each dedicated state machine
+static constexpr IspioDispatch makeDispatch(int pio)
 {
-    ispio_init(&port1b, 26, 27);
-    ispio_set_pio_sm(&port1b, pio0, 0);
-
-    ispio_init(&port1c, 28, 29);
-    ispio_set_pio_sm(&port1c, pio0, 1);
-
-    ispio_init(&port2a, 20, 21);
-    ispio_set_pio_sm(&port2a, pio0, 2);
-
-    ispio_init(&port2b, 22, 23);
-    ispio_set_pio_sm(&port2b, pio0, 3);
-
-    ispio_init(&port2c, 24, 25);
-    ispio_set_pio_sm(&port2c, pio1, 0);
-
-    ispio_init(&port3a, 12, 13);
-    ispio_set_pio_sm(&port3a, pio1, 1);
+    IspioDispatch d{};
+    for (int r = 0; r < MODULE_PORT_ROWS; r++)
+    {
+        for (int c = 0; c < MODULE_PORT_COLS; c++)
+        {
+            const BoardPort &p = BOARD_LAYOUT[r][c];
+            if (p.mode == PortRx::DEDICATED && p.pio == pio)
+                d.owner[p.sm] = &portSerial[portSerialIndex.index[r][c]];
+        }
+    }
+    return d;
+}
 
-    ispio_init(&port3b, 16, 17);
-    ispio_set_pio_sm(&port3b, pio1, 2);
+// Built at compile time; not const so it is placed in RAM with the IRQ
+static IspioDispatch portDispatch[2] = {makeDispatch(0), makeDispatch(1)};
 
-    ispio_init(&port3c, 18, 19);
-    ispio_set_pio_sm(&port3c, pio1, 3);
+void initBoardSerial()
+{
+    for (int r = 0; r < MODULE_PORT_ROWS; r++)
+    {
+        for (int c = 0; c < MODULE_PORT_COLS; c++)
+        {
+            const BoardPort &p = BOARD_LAYOUT[r][c];
+            if (p.mode == PortRx::NONE)
+            {
+                modulePorts[r][c] = nullptr;
+                continue;
+            }
+
+            InterruptSerialPIO *serial = &portSerial[portSerialIndex.index[r][c]];
+            ispio_init(serial, p.tx, p.rx);
+            PIO pio = p.pio ? pio1 : pio0;
+            if (p.mode == PortRx::SHARED)
+                ispio_set_shared_sm(serial, pio, p.sm);
+            else
+                ispio_set_pio_sm(serial, pio, p.sm);
+            modulePorts[r][c] = serial;
+        }
+    }
+    ispio_set_dispatch(portDispatch);
 }
@@ -2,34 +2,196 @@
 #include "Arduino.h"
 #include "InterruptSerialPIO.h"
 
-// Module port configuration
+// Board description. Each grid slot names its GPIO pair and how its receiver
+// gets a PIO state machine; the pin maps, serial instances and SM assignments
+// below are derived from it at compile time and checked by static_assert.
+//
+// The RP2040 has 8 state machines (pio0/pio1 x 4). A DEDICATED port owns one;
+// SHARED ports time-share one, up to ISPIO_SHARED_MAX each (see
+// ispio_set_shared_sm). Give shared SMs to low-rate modules: their autoupdate
+// is turned off and Port::task() polls them, since a frame sent while the SM
+// listens to a neighbour is lost.
+
+// GPIO pin placeholder for a missing slot
+static constexpr uint8_t PORT_PIN_UNUSED = 0xFF;
+
+enum class PortRx : uint8_t
+{
+    NONE,      // no port in this slot
+    DEDICATED, // own RX state machine
+    SHARED     // RX state machine shared with other ports
+};
+
+struct BoardPort
+{
+    // Which pin of the pair is the host TX is detected per module (orientation)
+    uint8_t tx;
+    uint8_t rx;
+    PortRx mode;
+    uint8_t pio; // 0-1
+    uint8_t sm;  // 0-3
+};
+
+constexpr BoardPort noPort()
+{
+    return {PORT_PIN_UNUSED, PORT_PIN_UNUSED, PortRx::NONE, 0, 0};
+}
+
+constexpr BoardPort dedicatedPort(uint8_t tx, uint8_t rx, uint8_t pio, uint8_t sm)
+{
+    return {tx, rx, PortRx::DEDICATED, pio, sm};
+}
+
+constexpr BoardPort sharedPort(uint8_t tx, uint8_t rx, uint8_t pio, uint8_t sm)
+{
+    return {tx, rx, PortRx::SHARED, pio, sm};
+}
+
+#if defined(PICONTROL_BOARD_4X4)
+
+// 4x4 reference layout: 15 ports on GPIO 0-29, five with their own SM and
+// ten on three shared ones.
+#define MODULE_PORT_ROWS 4
+#define MODULE_PORT_COLS 4
+
+static constexpr BoardPort BOARD_LAYOUT[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {
+    {noPort(), dedicatedPort(0, 1, 0, 0), dedicatedPort(2, 3, 0, 1), dedicatedPort(4, 5, 0, 2)},
+    {dedicatedPort(6, 7, 0, 3), dedicatedPort(8, 9, 1, 0), sharedPort(10, 11, 1, 1), sharedPort(12, 13, 1, 1)},
+    {sharedPort(14, 15, 1, 1), sharedPort(16, 17, 1, 1), sharedPort(18, 19, 1, 2), sharedPort(20, 21, 1, 2)},
+    {sharedPort(22, 23, 1, 2), sharedPort(24, 25, 1, 3), sharedPort(26, 27, 1, 3), sharedPort(28, 29, 1, 3)}};
+
+#else
+
+// Picontrol 3x3: the top-left slot is the host itself
 #define MODULE_PORT_ROWS 3
 #define MODULE_PORT_COLS 3
 
-// GPIO pin map for each port (tx, rx). Use 0xFF to mark a missing slot.
-static constexpr uint8_t PORT_PIN_UNUSED = 0xFF;
+static constexpr BoardPort BOARD_LAYOUT[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {
+    {noPort(), dedicatedPort(26, 27, 0, 0), dedicatedPort(28, 29, 0, 1)},
+    {dedicatedPort(20, 21, 0, 2), dedicatedPort(22, 23, 0, 3), dedicatedPort(24, 25, 1, 0)},
+    {dedicatedPort(12, 13, 1, 1), dedicatedPort(16, 17, 1, 2), dedicatedPort(18, 19, 1, 3)}};
+
+#endif
+
+namespace Board
+{
+    static constexpr int GPIO_COUNT = 30;
+
+    constexpr int portCount()
+    {
+        int n = 0;
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+                n += BOARD_LAYOUT[r][c].mode != PortRx::NONE;
+        return n;
+    }
+
+    // Pin maps indexed [row][col], PORT_PIN_UNUSED for a missing slot
+    struct PinMap
+    {
+        uint8_t pins[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+        constexpr const uint8_t *operator[](int row) const { return pins[row]; }
+    };
+
+    constexpr PinMap pinMap(bool tx)
+    {
+        PinMap m{};
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+                m.pins[r][c] = tx ? BOARD_LAYOUT[r][c].tx : BOARD_LAYOUT[r][c].rx;
+        return m;
+    }
+
+    // Position of each port among the populated ones, -1 for a missing slot
+    struct PortIndex
+    {
+        int8_t index[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    };
+
+    constexpr PortIndex portIndex()
+    {
+        PortIndex p{};
+        int n = 0;
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+                p.index[r][c] = BOARD_LAYOUT[r][c].mode != PortRx::NONE ? (int8_t)n++ : (int8_t)-1;
+        return p;
+    }
+
+    // One bit per grid slot (row * MODULE_PORT_COLS + col), sized from the layout
+    struct PortMask
+    {
+        static constexpr int SLOTS = MODULE_PORT_ROWS * MODULE_PORT_COLS;
+        uint32_t words[(SLOTS + 31) / 32];
+
+        constexpr bool test(int i) const { return words[i / 32] & (1u << (i % 32)); }
+        constexpr void set(int i) { words[i / 32] |= 1u << (i % 32); }
+        constexpr void clear(int i) { words[i / 32] &= ~(1u << (i % 32)); }
+    };
+
+    // Every pin exists and is used once
+    constexpr bool pinsValid()
+    {
+        bool used[GPIO_COUNT] = {};
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                const BoardPort &p = BOARD_LAYOUT[r][c];
+                if (p.mode == PortRx::NONE)
+                    continue;
+                if (p.tx >= GPIO_COUNT || p.rx >= GPIO_COUNT || p.tx == p.rx || used[p.tx] || used[p.rx])
+                    return false;
+                used[p.tx] = true;
+                used[p.rx] = true;
+            }
+        }
+        return true;
+    }
+
+    // Every SM is unused, owned by one dedicated port, or shared by at most
+    // ISPIO_SHARED_MAX shared ports
+    constexpr bool smsValid()
+    {
+        int dedicated[2][4] = {};
+        int shared[2][4] = {};
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                const BoardPort &p = BOARD_LAYOUT[r][c];
+                if (p.mode == PortRx::NONE)
+                    continue;
+                if (p.pio > 1 || p.sm > 3)
+                    return false;
+                if (p.mode == PortRx::DEDICATED)
+                    dedicated[p.pio][p.sm]++;
+                else
+                    shared[p.pio][p.sm]++;
+            }
+        }
+        for (int pio = 0; pio < 2; pio++)
+        {
+            for (int sm = 0; sm < 4; sm++)
+            {
+                if (dedicated[pio][sm] > 1 || (dedicated[pio][sm] && shared[pio][sm]) || shared[pio][sm] > ISPIO_SHARED_MAX)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+static_assert(Board::pinsValid(), "BOARD_LAYOUT: pin out of range or used twice");
+static_assert(Board::smsValid(), "BOARD_LAYOUT: PIO state machine over-allocated");
+
+static constexpr int MODULE_PORT_COUNT = Board::portCount();
 
-static constexpr uint8_t portTxPins[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {
-    {PORT_PIN_UNUSED, 26, 28},
-    {20, 22, 24},
-    {12, 16, 18}};
-
-static constexpr uint8_t portRxPins[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {
-    {PORT_PIN_UNUSED, 27, 29},
-    {21, 23, 25},
-    {13, 17, 19}};
-
-// Instantiate UARTs for all populated ports in a single translation unit.
-// Declarations here; definitions live in boardconfig.cpp
-extern InterruptSerialPIO port1b;
-extern InterruptSerialPIO port1c;
-extern InterruptSerialPIO port2a;
-extern InterruptSerialPIO port2b;
-extern InterruptSerialPIO port2c;
-extern InterruptSerialPIO port3a;
-extern InterruptSerialPIO port3b;
-extern InterruptSerialPIO port3c;
+// GPIO pin map for each port (tx, rx), PORT_PIN_UNUSED for a missing slot
+static constexpr Board::PinMap portTxPins = Board::pinMap(true);
+static constexpr Board::PinMap portRxPins = Board::pinMap(false);
 
+// Serial instances live in boardconfig.cpp; nullptr for a missing slot
 extern InterruptSerialPIO *modulePorts[MODULE_PORT_ROWS][MODULE_PORT_COLS];
 
 void initBoardSerial();
@@ -51,8 +51,38 @@ enum ModuleCapabilities : uint8_t
 {
     MODULE_CAP_AUTOUPDATE = 1u << 0,
     MODULE_CAP_ROTATION_AWARE = 1u << 1, // When rotated 180°, flip output values using min/max (except bool)
+    MODULE_CAP_CRC16 = 1u << 2,          // Accepts CMD_SET_LINK_MODE with LINK_MODE_CRC16
+    MODULE_CAP_COBS = 1u << 3,           // Accepts CMD_SET_LINK_MODE with LINK_MODE_COBS
 };
 
+// Module UART framing. Every link starts in LINK_MODE_SUM8:
+//   0xAA, commandId, payloadLenLo, payloadLenHi, payload, sum8
+// where sum8 is the 8-bit sum of all preceding bytes. LINK_MODE_CRC16 frames
+// start with 0xAB and end in CRC-16/CCITT (poly 0x1021, init 0xFFFF) over the
+// same bytes, low byte first.
+//
+// LINK_MODE_COBS frames carry no start byte: commandId, payloadLenLo,
+// payloadLenHi, payload and the CRC-16 over those bytes are COBS encoded and
+// followed by a 0x00 delimiter. Zero never occurs inside a frame, so a
+// receiver that loses a byte or reads a bad length is back in step at the next
+// delimiter instead of hunting for a start byte through payload data. Empty
+// frames (consecutive delimiters) are ignored.
+//
+// The host switches with CMD_SET_LINK_MODE and sends in the new framing right
+// after it. The module acknowledges in the old framing and sends in the new
+// one from then on. CRC-16 modules must keep accepting 0xAA frames; COBS
+// modules switch their receiver as soon as CMD_SET_LINK_MODE is in.
+// A module that resets or is re-plugged starts over in LINK_MODE_SUM8.
+enum ModuleLinkMode : uint8_t
+{
+    LINK_MODE_SUM8 = 0,
+    LINK_MODE_CRC16 = 1,
+    LINK_MODE_COBS = 2,
+};
+
+static constexpr uint8_t MODULE_FRAME_START_SUM8 = 0xAA;
+static constexpr uint8_t MODULE_FRAME_START_CRC16 = 0xAB;
+
 enum ModuleParameterAccess : uint8_t
 {
     ACCESS_READ = 1 << 0,
@@ -151,6 +181,19 @@ typedef struct
 
 namespace Port
 {
+    // Bring-up of a module after it is detected, driven by Port::task(). Only a
+    // few ports are identified and configured at a time; see the admission
+    // controller in port.cpp.
+    enum class BringUp : uint8_t
+    {
+        NONE,        // no module detected
+        DETECTED,    // serial running, waiting for an identification slot
+        IDENTIFYING, // GET_PROPERTIES outstanding
+        CONFIGURING, // link mode, autoupdate and GET_MAPPINGS being sent
+        MAPPED,      // host mappings pushed, waiting for the module to take them
+        LIVE,        // bring-up done
+    };
+
     typedef struct
     {
         int row;
@@ -166,6 +209,7 @@ namespace Port
         bool configured;
         uint8_t txPin;
         uint8_t rxPin;
+        BringUp bringUp;
     } State;
 
     // Convert State to packed format for transmission
@@ -194,6 +238,7 @@ typedef enum : uint8_t
     CMD_GET_MAPPINGS = 0x06,
     CMD_SET_MAPPINGS = 0x07,
     CMD_SET_CALIB = 0x08,
+    CMD_SET_LINK_MODE = 0x09,
     CMD_RESPONSE = 0x80,
 } ModuleMessageId;
 
@@ -250,6 +295,11 @@ typedef struct
     int32_t maxValue;
 } ModuleMessageSetCalibPayload;
 
+typedef struct
+{
+    uint8_t mode; // ModuleLinkMode
+} ModuleMessageSetLinkModePayload;
+
 // Mapping structures for wire protocol
 // Must match ModuleMapping in module_mapping_config.h but packed
 #pragma pack(push, 1)
@@ -266,14 +316,29 @@ struct WireCurve
     WireCurvePoint controls[3]; // 6 bytes
 };
 
-// Convert host-side Curve (single h param) to wire WireCurve (15 bytes).
-// Module stores this opaquely; h is packed into points[0] as LE int16.
+// Convert host-side Curve to wire WireCurve (15 bytes).
+// Module stores this opaquely. An h curve (count 0) keeps the original
+// encoding, h packed into points[0] as LE int16; piecewise curves map 1:1.
 static inline WireCurve curveToWireCurve(const Curve &c)
 {
     WireCurve wc{};
-    wc.count = 0;
-    wc.points[0].x = static_cast<uint8_t>(c.h & 0xFF);
-    wc.points[0].y = static_cast<uint8_t>((c.h >> 8) & 0xFF);
+    wc.count = c.count;
+    if (c.count == 0)
+    {
+        wc.points[0].x = static_cast<uint8_t>(c.h & 0xFF);
+        wc.points[0].y = static_cast<uint8_t>((c.h >> 8) & 0xFF);
+        return wc;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        wc.points[i].x = c.points[i].x;
+        wc.points[i].y = c.points[i].y;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        wc.controls[i].x = c.controls[i].x;
+        wc.controls[i].y = c.controls[i].y;
+    }
     return wc;
 }
 
@@ -281,7 +346,23 @@ static inline WireCurve curveToWireCurve(const Curve &c)
 static inline Curve wireCurveToCurve(const WireCurve &wc)
 {
     Curve c{};
-    c.h = static_cast<int16_t>(wc.points[0].x | (wc.points[0].y << 8));
+    c.count = wc.count;
+    if (wc.count == 0)
+    {
+        c.h = static_cast<int16_t>(wc.points[0].x | (wc.points[0].y << 8));
+        return c;
+    }
+    c.h = 16384;
+    for (int i = 0; i < 4; i++)
+    {
+        c.points[i].x = wc.points[i].x;
+        c.points[i].y = wc.points[i].y;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        c.controls[i].x = wc.controls[i].x;
+        c.controls[i].y = wc.controls[i].y;
+    }
     return c;
 }
 
@@ -305,11 +386,34 @@ struct WireActionTargetKeyboard
     uint8_t modifier;
 };
 
+struct WireActionTargetBankSelect
+{
+    uint8_t bank;
+    uint8_t mode;
+};
+
+struct WireActionTargetMidiParam
+{
+    uint8_t channel;
+    uint8_t paramMsb;
+    uint8_t paramLsb;
+};
+
+struct WireActionTargetMidiRelative
+{
+    uint8_t channel;
+    uint8_t ccNumber;
+    uint8_t mode;
+};
+
 union WireActionTarget
 {
     WireActionTargetMidiNote midiNote;
     WireActionTargetMidiCC midiCC;
     WireActionTargetKeyboard keyboard;
+    WireActionTargetBankSelect bankSelect;
+    WireActionTargetMidiParam midiParam;
+    WireActionTargetMidiRelative midiRelative;
 };
 
 struct WireModuleMapping
@@ -343,4 +447,6 @@ typedef struct
 #pragma pack(pop)
 
 static_assert(sizeof(ModuleMessageGetPropertiesPayload) <= MODULE_MAX_PAYLOAD, "GetProperties payload exceeds protocol maximum");
-static_assert(sizeof(ModuleMessageResponsePayload) <= MODULE_MAX_PAYLOAD, "Response payload exceeds protocol maximum");
\ No newline at end of file
+static_assert(sizeof(ModuleMessageResponsePayload) <= MODULE_MAX_PAYLOAD, "Response payload exceeds protocol maximum");
+static_assert(sizeof(ModuleMessageGetPropertiesPayload) <= sizeof(ModuleMessageResponsePayload::payload), "GetProperties payload does not fit a response");
+static_assert(sizeof(ModuleMessageGetMappingsPayload) <= sizeof(ModuleMessageResponsePayload::payload), "GetMappings payload does not fit a response");
\ No newline at end of file
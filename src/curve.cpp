@@ -1,81 +1,178 @@
 #include "curve.h"
 
-uint8_t CurveEvaluator::eval(const Curve &curve, uint8_t x)
+namespace
 {
-    // Boundary cases: always pass through (0,0) and (255,255)
-    if (x == 0)
-        return 0;
-    if (x == 255)
-        return 255;
-
-    // Convert x from 0-255 to Q15 (0-32768)
-    int32_t X = ((int32_t)x * 32768 + 127) / 255;
-    int32_t H = curve.h;
-    const int64_t ONE = 32768;
-
-    // Use 64-bit temporaries to avoid overflow in intermediate multiplications.
-    // Formula: y = x*h / (x*h + (1-x)*(1-h))
-    int64_t X64 = X;
-    int64_t H64 = (int64_t)(uint16_t)H; // treat stored int16_t as unsigned Q15 value
-
-    int64_t term1 = X64 * H64;                 // x*h
-    int64_t term2 = (ONE - X64) * (ONE - H64); // (1-x)*(1-h)
-
-    int64_t denominator = term1 + term2;
-
-    if (denominator == 0)
-        return 0;
-
-    int64_t result64 = (term1 * ONE) / denominator;
-
-    int32_t result = (int32_t)result64;
-
-    // Clamp to valid range
-    if (result < 0)
-        result = 0;
-    if (result > 32768)
-        result = 32768;
-
-    // Convert back from Q15 to 0-255
-    return (uint8_t)((result * 255 + 16384) / 32768);
+    // Piecewise curves are sampled in 8.16 fixed point: 0..255 → 0..255 << 16,
+    // so input x (0-65536) lands on X = x * 255 with nothing rounded off.
+    constexpr int32_t PW_ONE = 255 << 16;
+
+    // Rational h curve at X (Q16, 0-65536). Returns y in 0-65535. X is kept at
+    // full input resolution: near the ends of a strong h one input step moves
+    // y by up to ~65.
+    int32_t evalRational(int16_t h, int32_t X)
+    {
+        const int64_t ONE = 65536;
+
+        // Use 64-bit temporaries to avoid overflow in intermediate multiplications.
+        // Formula: y = x*h / (x*h + (1-x)*(1-h))
+        int64_t X64 = X;
+        int64_t H64 = (int64_t)(uint16_t)h * 2; // stored int16_t is an unsigned Q15 value
+
+        int64_t term1 = X64 * H64;                 // x*h
+        int64_t term2 = (ONE - X64) * (ONE - H64); // (1-x)*(1-h)
+
+        int64_t denominator = term1 + term2;
+
+        if (denominator == 0)
+            return 0;
+
+        int32_t result = (int32_t)((term1 * 65535 + denominator / 2) / denominator);
+
+        // Clamp to valid range
+        if (result < 0)
+            result = 0;
+        if (result > 65535)
+            result = 65535;
+        return result;
+    }
+
+    // Quadratic Bezier of one coordinate at t (Q16, 0-65536).
+    int32_t bezier(int32_t a, int32_t c, int32_t b, int32_t t)
+    {
+        const int64_t u = 65536 - t;
+        const int64_t T = t;
+        return (int32_t)((u * u * a + 2 * u * T * c + T * T * b) >> 32);
+    }
+
+    // Piecewise curve at X (8.16, 0-PW_ONE). Returns y in 8.16.
+    int32_t evalPiecewise(const Curve &c, int32_t X)
+    {
+        const int last = c.count - 1;
+        if (X <= c.points[0].x << 16)
+            return c.points[0].y << 16;
+        if (X >= c.points[last].x << 16)
+            return c.points[last].y << 16;
+
+        int seg = 0;
+        while (seg < last - 1 && X > c.points[seg + 1].x << 16)
+            seg++;
+
+        const int32_t x0 = c.points[seg].x << 16;
+        const int32_t x1 = c.points[seg + 1].x << 16;
+        const int32_t y0 = c.points[seg].y << 16;
+        const int32_t y1 = c.points[seg + 1].y << 16;
+        int32_t cx = c.controls[seg].x << 16;
+        const int32_t cy = c.controls[seg].y << 16;
+        // A control inside [x0, x1] keeps x(t) monotonic, so every x has one t
+        if (cx < x0)
+            cx = x0;
+        if (cx > x1)
+            cx = x1;
+
+        // Solve x(t) = X by bisection; 17 steps resolve t to one Q16 step
+        int32_t lo = 0;
+        int32_t hi = 65536;
+        for (int i = 0; i < 17 && lo < hi; i++)
+        {
+            const int32_t mid = (lo + hi) / 2;
+            if (bezier(x0, cx, x1, mid) < X)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        int32_t y = bezier(y0, cy, y1, lo);
+        if (y < 0)
+            y = 0;
+        if (y > PW_ONE)
+            y = PW_ONE;
+        return y;
+    }
+
+    // The curve at x (0-65536, LUT entry i sits at i * 1024), scaled to 0-65535
+    uint16_t sample(const Curve &c, uint32_t x)
+    {
+        if (c.count == 0)
+        {
+            // Boundary cases: always pass through (0,0) and (max,max)
+            if (x == 0)
+                return 0;
+            if (x >= 65536)
+                return 65535;
+            return (uint16_t)evalRational(c.h, (int32_t)x);
+        }
+        const int32_t y = evalPiecewise(c, (int32_t)(x * 255));
+        return (uint16_t)(((int64_t)y * 65535 + PW_ONE / 2) / PW_ONE);
+    }
+
+    // Segment i is too curved to interpolate: its midpoint is off, or a
+    // piecewise curve has a corner inside it.
+    bool needsExact(const Curve &c, const CurveLut &lut, int i)
+    {
+        const int32_t a = lut.y[i];
+        const int32_t b = lut.y[i + 1];
+        const int32_t mid = sample(c, (uint32_t)i * 1024 + 512);
+        const int32_t interpolated = a + (((b - a) * 512) >> 10);
+        // Interpolation errors peak near the midpoint; leave margin for the rest
+        if (mid - interpolated > CURVE_LUT_MAX_ERROR / 2 || interpolated - mid > CURVE_LUT_MAX_ERROR / 2)
+            return true;
+        for (int p = 0; p < c.count; p++)
+        {
+            const int32_t px = c.points[p].x << 16;
+            if (px > i * 1024 * 255 && px < (i + 1) * 1024 * 255)
+                return true;
+        }
+        return false;
+    }
 }
 
-uint16_t CurveEvaluator::eval10(const Curve &curve, uint16_t x)
+bool CurveEvaluator::isValid(const Curve &curve)
 {
-    // Boundary cases: always pass through (0,0) and (1023,1023)
-    if (x == 0)
-        return 0;
-    if (x >= 1023)
-        return 1023;
-
-    // Convert x from 0-1023 to Q15 (0-32768)
-    int32_t X = ((int32_t)x * 32768 + 511) / 1023;
-    int32_t H = curve.h;
-    const int64_t ONE = 32768;
-
-    // Use 64-bit temporaries to avoid overflow in intermediate multiplications.
-    // Formula: y = x*h / (x*h + (1-x)*(1-h))
-    int64_t X64 = X;
-    int64_t H64 = (int64_t)(uint16_t)H; // treat stored int16_t as unsigned Q15 value
-
-    int64_t term1 = X64 * H64;                 // x*h
-    int64_t term2 = (ONE - X64) * (ONE - H64); // (1-x)*(1-h)
-
-    int64_t denominator = term1 + term2;
-
-    if (denominator == 0)
-        return 0;
-
-    int64_t result64 = (term1 * ONE) / denominator;
-
-    int32_t result = (int32_t)result64;
+    if (curve.count == 0)
+        return true;
+    if (curve.count < 2 || curve.count > CURVE_MAX_POINTS)
+        return false;
+    for (int i = 1; i < curve.count; i++)
+    {
+        if (curve.points[i].x < curve.points[i - 1].x)
+            return false;
+    }
+    return true;
+}
 
-    // Clamp to valid range
-    if (result < 0)
-        result = 0;
-    if (result > 32768)
-        result = 32768;
+void CurveEvaluator::compile(const Curve &curve, CurveLut &out)
+{
+    if (!isValid(curve))
+    {
+        Curve linear{};
+        linear.h = 16384;
+        compile(linear, out);
+        return;
+    }
+
+    for (int i = 0; i <= CURVE_LUT_SEGMENTS; i++)
+    {
+        out.y[i] = sample(curve, (uint32_t)i * 1024);
+    }
+    out.exact[0] = 0;
+    out.exact[1] = 0;
+    for (int i = 0; i < CURVE_LUT_SEGMENTS; i++)
+    {
+        if (needsExact(curve, out, i))
+            out.exact[i >> 5] |= 1u << (i & 31);
+    }
+    out.curve = curve;
+}
 
-    // Convert back from Q15 to 0-1023
-    return (uint16_t)((result * 1023 + 16384) / 32768);
+uint16_t CurveEvaluator::eval(const CurveLut &lut, uint16_t x)
+{
+    // Entry i sits at x = i * 1024; the last one stands in for 65535
+    if (x == 0xFFFF)
+        return lut.y[CURVE_LUT_SEGMENTS];
+    const uint32_t idx = x >> 10;
+    if (lut.exact[idx >> 5] & (1u << (idx & 31)))
+        return sample(lut.curve, x);
+    const int32_t frac = x & 1023;
+    const int32_t a = lut.y[idx];
+    const int32_t b = lut.y[idx + 1];
+    return (uint16_t)(a + (((b - a) * frac) >> 10));
 }
@@ -1,25 +1,66 @@
 #pragma once
 #include <stdint.h>
 
-// Curve shape defined by a single parameter h (Q15 fixed-point).
-// Formula: y = x*h / (x*h + (1-x)*(1-h))
-// h = 16384 (0.5) → linear, h < 16384 → concave, h > 16384 → convex
-// Q15: 1.0 = 32768
+// Response curve of a mapping, in one of two forms:
+//
+// count == 0: shape defined by a single parameter h (Q15 fixed-point).
+//   Formula: y = x*h / (x*h + (1-x)*(1-h))
+//   h = 16384 (0.5) → linear, h < 16384 → concave, h > 16384 → convex
+//   Q15: 1.0 = 32768
+//
+// count == 2..4: piecewise curve through points[0..count-1] (0-255 on both
+//   axes, x ascending). Segment i runs from points[i] to points[i+1] as a
+//   quadratic Bezier bent towards controls[i]; a control on the chord gives a
+//   straight segment. Inputs left of the first point / right of the last one
+//   hold that point's y, which gives dead zones and saturation for free.
+//
+// Either form is compiled into a CurveLut when the mapping is installed, so
+// evaluating a mapping costs one table lookup whatever the curve looks like.
+// Only segments too curved to interpolate within CURVE_LUT_MAX_ERROR (the steep
+// end of a strong h, a corner between points) evaluate the curve itself.
+
+static constexpr uint8_t CURVE_MAX_POINTS = 4;
 
 #pragma pack(push, 1)
 
+struct CurvePoint
+{
+    uint8_t x;
+    uint8_t y;
+};
+
 struct Curve
 {
-    int16_t h; // Shape parameter Q15: 16384 = linear
+    int16_t h;     // Shape parameter Q15: 16384 = linear (count == 0)
+    uint8_t count; // 0 = h curve, 2..CURVE_MAX_POINTS = piecewise
+    CurvePoint points[CURVE_MAX_POINTS];
+    CurvePoint controls[CURVE_MAX_POINTS - 1];
 };
 
 #pragma pack(pop)
 
+// 64 equal input segments plus the end point, outputs in 0..65535.
+static constexpr int CURVE_LUT_SEGMENTS = 64;
+// Largest error interpolating a LUT segment may add, in output units
+static constexpr int CURVE_LUT_MAX_ERROR = 16;
+
+struct CurveLut
+{
+    uint16_t y[CURVE_LUT_SEGMENTS + 1];
+    uint32_t exact[2]; // bit i: segment i is evaluated from `curve`
+    Curve curve;
+};
+
 class CurveEvaluator
 {
 public:
-    // Evaluate the curve at input x (0-255). Returns y (0-255).
-    static uint8_t eval(const Curve &curve, uint8_t x);
-    // Evaluate the curve at input x (0-1023). Returns y (0-1023).
-    static uint16_t eval10(const Curve &curve, uint16_t x);
+    // Rejects piecewise curves with a bad point count or descending x.
+    static bool isValid(const Curve &curve);
+    // Sample the curve into a LUT. Invalid curves compile to linear.
+    static void compile(const Curve &curve, CurveLut &out);
+
+    // Evaluate at input x (0-65535) with linear interpolation, or exactly in
+    // the segments marked so. Returns 0-65535; 0 and 65535 hit the first and
+    // last LUT entries exactly.
+    static uint16_t eval(const CurveLut &lut, uint16_t x);
 };
@@ -2,6 +2,8 @@
 
 mutex_t g_debugPrintMutex;
 volatile bool g_debugPrintInited = false;
+volatile uint8_t g_logLevel = PICONTROL_LOG_LEVEL;
+volatile uint8_t g_logMask = PICONTROL_LOG_MASK;
 
 void dbg_printf_init()
 {
@@ -12,6 +14,16 @@ void dbg_printf_init()
     }
 }
 
+bool log_set_filter(uint8_t level, uint8_t mask)
+{
+    if (level > LOG_LEVEL_DEBUG)
+        return false;
+    const uint8_t compiledLevel = PICONTROL_LOG_LEVEL;
+    g_logLevel = level > compiledLevel ? compiledLevel : level;
+    g_logMask = mask & PICONTROL_LOG_MASK;
+    return true;
+}
+
 void dbg_printf(const char *fmt, ...)
 {
     if (!g_debugPrintInited)
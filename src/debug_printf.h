@@ -15,6 +15,9 @@
  *
  * Usage: replace every bare printf(...) with dbg_printf(...) in ALL source
  * files that run on either core.
+ *
+ * Code that runs per message or per evaluation should use TRACE() from
+ * trace.h instead: it only stores a format id and raw arguments.
  */
 
 #pragma once
@@ -24,16 +27,83 @@
 #include <cstdarg>
 #include <pico/mutex.h>
 
+// ── Log levels and subsystems ───────────────────────────────────────────────
+//
+// LOG_ERROR/LOG_WARN/LOG_INFO/LOG_DEBUG(subsystem, fmt, ...) print through
+// dbg_printf when both the build and the runtime allow it. Calls above
+// PICONTROL_LOG_LEVEL or outside PICONTROL_LOG_MASK are discarded at compile
+// time, format string included. The runtime level/mask (config CDC, LOG
+// command) can only narrow what was compiled in.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#define LOG_SYS 0x01    // boot, liveness
+#define LOG_USB 0x02    // config CDC commands
+#define LOG_PORT 0x04   // module ports and their responses
+#define LOG_MAP 0x08    // mapping engine
+#define LOG_STORE 0x10  // mapping persistence
+#define LOG_MODMSG 0x20 // hex dumps of every module frame
+#define LOG_ALL 0x3F
+
+// -DDEBUG_MODULE_MESSAGES keeps its old meaning: module frame dumps on
+#ifndef PICONTROL_LOG_LEVEL
+#ifdef DEBUG_MODULE_MESSAGES
+#define PICONTROL_LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define PICONTROL_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#ifndef PICONTROL_LOG_MASK
+#ifdef DEBUG_MODULE_MESSAGES
+#define PICONTROL_LOG_MASK LOG_ALL
+#else
+#define PICONTROL_LOG_MASK (LOG_ALL & ~LOG_MODMSG)
+#endif
+#endif
+
+// Usable in #if as well as in code
+#define LOG_COMPILED(level, subsys) ((level) <= PICONTROL_LOG_LEVEL && ((subsys) & PICONTROL_LOG_MASK) != 0)
+
 // ── Globals (defined in debug_printf.cpp) ───────────────────────────────────
 
 extern mutex_t g_debugPrintMutex;
 extern volatile bool g_debugPrintInited;
 
+// Runtime filter, written by core 0 and read by both cores
+extern volatile uint8_t g_logLevel;
+extern volatile uint8_t g_logMask;
+
+#define LOG_ON(level, subsys) ((level) <= g_logLevel && ((subsys) & g_logMask) != 0)
+
+#define LOG_AT(level, subsys, ...)                           \
+    do                                                       \
+    {                                                        \
+        if constexpr (LOG_COMPILED(level, subsys))           \
+        {                                                    \
+            if (LOG_ON(level, subsys))                       \
+                dbg_printf(__VA_ARGS__);                     \
+        }                                                    \
+    } while (0)
+
+#define LOG_ERROR(subsys, ...) LOG_AT(LOG_LEVEL_ERROR, subsys, __VA_ARGS__)
+#define LOG_WARN(subsys, ...) LOG_AT(LOG_LEVEL_WARN, subsys, __VA_ARGS__)
+#define LOG_INFO(subsys, ...) LOG_AT(LOG_LEVEL_INFO, subsys, __VA_ARGS__)
+#define LOG_DEBUG(subsys, ...) LOG_AT(LOG_LEVEL_DEBUG, subsys, __VA_ARGS__)
+
 // ── API ─────────────────────────────────────────────────────────────────────
 
 /// Call once from core 0's setup() before any debug output.
 void dbg_printf_init();
 
+/// Set the runtime filter. Bits and levels beyond the compiled-in ones are
+/// dropped; returns false (and changes nothing) for an unknown level.
+bool log_set_filter(uint8_t level, uint8_t mask);
+
 /**
  * printf-like debug output that is safe to call from either core.
  *
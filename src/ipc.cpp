@@ -3,6 +3,8 @@
 #include <cstring>
 #include <pico/util/queue.h>
 #include <pico/sync.h>
+#include "boardconfig.h"
+#include "stats.h"
 
 namespace IPC
 {
@@ -10,10 +12,24 @@ namespace IPC
     static queue_t g_setParameterQ;
     static queue_t g_setCalibQ;
     static queue_t g_syncMappingQ;
+    static queue_t g_selectBankQ;
     static bool g_inited = false;
     static critical_section_t g_initLock;
     static bool g_initLockInited = false;
 
+    // Sync requests currently sitting in g_syncMappingQ: one bit per port,
+    // plus g_syncPendingAll for a full sync.
+    static critical_section_t g_syncPendingLock;
+    static Board::PortMask g_syncPendingMask{};
+    static bool g_syncPendingAll = false;
+
+    // Coalesced parameter writes: latest value per parameter plus a pending bit
+    static constexpr int PARAM_WRITE_SLOTS = 8;
+    static critical_section_t g_paramWriteLock;
+    static uint16_t g_paramWriteValue[MODULE_PORT_ROWS][MODULE_PORT_COLS][PARAM_WRITE_SLOTS];
+    static uint8_t g_paramWritePending[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint8_t g_paramWriteNext[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+
     static void initOnce()
     {
 
@@ -24,6 +40,9 @@ namespace IPC
             queue_init(&g_setParameterQ, sizeof(SetParameterRequest), 32);
             queue_init(&g_setCalibQ, sizeof(SetCalibRequest), 32);
             queue_init(&g_syncMappingQ, sizeof(SyncMappingRequest), 32);
+            queue_init(&g_selectBankQ, sizeof(SelectBankRequest), 8);
+            critical_section_init(&g_syncPendingLock);
+            critical_section_init(&g_paramWriteLock);
             g_inited = true;
             critical_section_exit(&g_initLock);
         }
@@ -34,6 +53,16 @@ namespace IPC
         initOnce();
     }
 
+    // queue_try_add that counts a full queue against the calling core
+    static bool tryAdd(queue_t *q, const void *item)
+    {
+        if (queue_try_add(q, item))
+            return true;
+        Stats::CoreCounters &stats = Stats::core();
+        stats.ipcQueueFull = stats.ipcQueueFull + 1;
+        return false;
+    }
+
     bool enqueueSetParameter(int row, int col, uint8_t paramId, uint8_t dataType, const char *valueStr)
     {
         SetParameterRequest req{};
@@ -46,7 +75,7 @@ namespace IPC
             strncpy(req.valueStr, valueStr, sizeof(req.valueStr) - 1);
             req.valueStr[sizeof(req.valueStr) - 1] = '\0';
         }
-        return queue_try_add(&g_setParameterQ, &req);
+        return tryAdd(&g_setParameterQ, &req);
     }
 
     bool tryDequeueSetParameter(SetParameterRequest &out)
@@ -54,13 +83,42 @@ namespace IPC
         return queue_try_remove(&g_setParameterQ, &out);
     }
 
+    // Bit of g_syncPendingMask for a single-port request, -1 if not tracked
+    static int syncPendingSlot(const SyncMappingRequest &req)
+    {
+        if (req.applyToAll || req.row < 0 || req.col < 0 || req.row >= MODULE_PORT_ROWS || req.col >= MODULE_PORT_COLS)
+            return -1;
+        return req.row * MODULE_PORT_COLS + req.col;
+    }
+
+    static bool enqueueSyncCoalesced(const SyncMappingRequest &req)
+    {
+        initOnce();
+        const int slot = syncPendingSlot(req);
+
+        critical_section_enter_blocking(&g_syncPendingLock);
+        if (g_syncPendingAll || (slot >= 0 && g_syncPendingMask.test(slot)))
+        {
+            // Already queued (or a full sync is); it will pick up this change.
+            critical_section_exit(&g_syncPendingLock);
+            return true;
+        }
+        const bool ok = tryAdd(&g_syncMappingQ, &req);
+        if (ok && req.applyToAll)
+            g_syncPendingAll = true;
+        else if (ok && slot >= 0)
+            g_syncPendingMask.set(slot);
+        critical_section_exit(&g_syncPendingLock);
+        return ok;
+    }
+
     bool enqueueSyncMapping(int row, int col)
     {
         SyncMappingRequest req{};
         req.row = static_cast<int8_t>(row);
         req.col = static_cast<int8_t>(col);
         req.applyToAll = 0;
-        return queue_try_add(&g_syncMappingQ, &req);
+        return enqueueSyncCoalesced(req);
     }
 
     bool enqueueSyncMappingAll()
@@ -69,12 +127,76 @@ namespace IPC
         req.row = -1;
         req.col = -1;
         req.applyToAll = 1;
-        return queue_try_add(&g_syncMappingQ, &req);
+        return enqueueSyncCoalesced(req);
     }
 
     bool tryDequeueSyncMapping(SyncMappingRequest &out)
     {
-        return queue_try_remove(&g_syncMappingQ, &out);
+        initOnce();
+        critical_section_enter_blocking(&g_syncPendingLock);
+        const bool ok = queue_try_remove(&g_syncMappingQ, &out);
+        if (ok)
+        {
+            const int slot = syncPendingSlot(out);
+            if (out.applyToAll)
+                g_syncPendingAll = false;
+            else if (slot >= 0)
+                g_syncPendingMask.clear(slot);
+        }
+        critical_section_exit(&g_syncPendingLock);
+        return ok;
+    }
+
+    bool enqueueSelectBank(uint8_t bank, bool resync)
+    {
+        initOnce();
+        SelectBankRequest req{};
+        req.bank = bank;
+        req.resync = resync ? 1 : 0;
+        return tryAdd(&g_selectBankQ, &req);
+    }
+
+    bool tryDequeueSelectBank(SelectBankRequest &out)
+    {
+        initOnce();
+        return queue_try_remove(&g_selectBankQ, &out);
+    }
+
+    void postParameterWrite(int row, int col, uint8_t paramId, uint16_t value)
+    {
+        if (row < 0 || col < 0 || row >= MODULE_PORT_ROWS || col >= MODULE_PORT_COLS || paramId >= PARAM_WRITE_SLOTS)
+            return;
+        initOnce();
+        critical_section_enter_blocking(&g_paramWriteLock);
+        g_paramWriteValue[row][col][paramId] = value;
+        g_paramWritePending[row][col] |= (uint8_t)(1u << paramId);
+        critical_section_exit(&g_paramWriteLock);
+    }
+
+    bool tryTakeParameterWrite(int row, int col, uint8_t &paramId, uint16_t &value)
+    {
+        if (row < 0 || col < 0 || row >= MODULE_PORT_ROWS || col >= MODULE_PORT_COLS)
+            return false;
+        // Unlocked peek: the common case is nothing pending
+        if (!g_paramWritePending[row][col])
+            return false;
+        initOnce();
+        critical_section_enter_blocking(&g_paramWriteLock);
+        bool ok = false;
+        for (int i = 0; i < PARAM_WRITE_SLOTS && !ok; i++)
+        {
+            const uint8_t pid = (uint8_t)((g_paramWriteNext[row][col] + i) % PARAM_WRITE_SLOTS);
+            if (g_paramWritePending[row][col] & (1u << pid))
+            {
+                g_paramWritePending[row][col] &= (uint8_t)~(1u << pid);
+                g_paramWriteNext[row][col] = (uint8_t)((pid + 1) % PARAM_WRITE_SLOTS);
+                paramId = pid;
+                value = g_paramWriteValue[row][col][pid];
+                ok = true;
+            }
+        }
+        critical_section_exit(&g_paramWriteLock);
+        return ok;
     }
 
     bool enqueueSetCalib(int row, int col, uint8_t paramId, int32_t minValue, int32_t maxValue)
@@ -85,7 +207,7 @@ namespace IPC
         req.paramId = paramId;
         req.minValue = minValue;
         req.maxValue = maxValue;
-        return queue_try_add(&g_setCalibQ, &req);
+        return tryAdd(&g_setCalibQ, &req);
     }
 
     bool tryDequeueSetCalib(SetCalibRequest &out)
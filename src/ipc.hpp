@@ -45,7 +45,26 @@ namespace IPC
         int8_t col;
         uint8_t applyToAll; // 0/1
     };
+    // Requests for a port (or "all") that is already queued collapse into the
+    // queued one; the sync reads the mapping table when it is dequeued.
     bool enqueueSyncMapping(int row, int col);
     bool enqueueSyncMappingAll();
     bool tryDequeueSyncMapping(SyncMappingRequest &out);
+
+    // Mapping bank switch request (sent from CDC to core1)
+    struct SelectBankRequest
+    {
+        uint8_t bank;
+        uint8_t resync; // 0/1: also push the new bank to the modules
+    };
+    bool enqueueSelectBank(uint8_t bank, bool resync);
+    bool tryDequeueSelectBank(SelectBankRequest &out);
+
+    // Parameter writes driven by MIDI feedback (core0 to core1). There is one
+    // slot per parameter and a newer value replaces the pending one, so a host
+    // flooding feedback costs at most one module write per parameter.
+    // `value` is normalized 0-65535 over the parameter's range.
+    void postParameterWrite(int row, int col, uint8_t paramId, uint16_t value);
+    // Takes one pending write for the port, rotating over its parameters.
+    bool tryTakeParameterWrite(int row, int col, uint8_t &paramId, uint16_t &value);
 }
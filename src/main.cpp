@@ -2,7 +2,10 @@
 
 #include <Arduino.h>
 #include "usb_device.h"
+#include "mapping_store.h"
 #include "debug_printf.h"
+#include "trace.h"
+#include "stats.h"
 
 bool core1_separate_stack = true;
 
@@ -11,18 +14,25 @@ void setup()
   dbg_printf_init();
   usb::init();
   delay(50);
-  dbg_printf("Picontrol: core0 USB ready\n");
+  LOG_INFO(LOG_SYS, "Picontrol: core0 USB ready\n");
 }
 
+#if LOG_COMPILED(LOG_LEVEL_DEBUG, LOG_SYS)
 static uint32_t lastMillis = 0;
+#endif
 void loop()
 {
+  Stats::loopTick();
   usb::task();
-  uint32_t now = millis();
+  MappingStore::task();
+  Trace::drain();
 
+#if LOG_COMPILED(LOG_LEVEL_DEBUG, LOG_SYS)
+  uint32_t now = millis();
   if (now - lastMillis >= 1000)
   {
     lastMillis = now;
-    dbg_printf("Core0 alive %lu ms \n", lastMillis);
+    LOG_DEBUG(LOG_SYS, "Core0 alive %lu ms \n", lastMillis);
   }
+#endif
 }
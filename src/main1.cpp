@@ -2,21 +2,37 @@
 #include "port.h"
 #include "ipc.hpp"
 #include "mapping.h"
+#include "mapping_store.h"
 #include "debug_printf.h"
+#include "stats.h"
+#include "profiler.h"
+
+// Module links run at 115200 baud: MIDI feedback writes at most one parameter
+// per port this often, the rest stays coalesced in IPC until then
+static constexpr uint32_t FEEDBACK_WRITE_INTERVAL_MS = 10;
+static uint32_t g_feedbackWriteMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
 
 void setup1()
 {
     // Core 1 setup
-    dbg_printf("Picontrol: core1 started\n");
+    LOG_INFO(LOG_SYS, "Picontrol: core1 started\n");
+    // Restore mappings first so they apply as soon as a module reports values
+    MappingStore::load();
     Port::init();
-    dbg_printf("Ports initialized\n");
+    Profiler::init();
+    LOG_INFO(LOG_SYS, "Ports initialized\n");
 }
 void loop1()
 {
     // Core 1 loop
+    Stats::loopTick();
+    Profiler::tick();
+    MappingStore::serviceFlashPark();
     Port::task();
+    MappingManager::tick();
 
     // Check for IPC messages
+    Profiler::enter(Profiler::STAGE_IPC);
 
     IPC::SyncMappingRequest smreq;
     while (IPC::tryDequeueSyncMapping(smreq))
@@ -30,12 +46,16 @@ void loop1()
             ModuleMessageSetMappingsPayload payload{};
             payload.count = 0;
 
+            // The module keeps one mapping per parameter: send each parameter's
+            // first target (the bank is in key order, so it comes first)
+            int lastParam = -1;
             int total = MappingManager::count();
             for (int i = 0; i < total; i++)
             {
                 const ModuleMapping *m = MappingManager::getByIndex(i);
-                if (m && m->row == row && m->col == col)
+                if (m && m->row == row && m->col == col && m->paramId != lastParam)
                 {
+                    lastParam = m->paramId;
                     if (payload.count < 8)
                     {
                         WireModuleMapping &wm = payload.mappings[payload.count];
@@ -75,6 +95,23 @@ void loop1()
                             wm.target.keyboard.keycode = m->target.keyboard.keycode;
                             wm.target.keyboard.modifier = m->target.keyboard.modifier;
                         }
+                        else if (m->type == ACTION_BANK_SELECT)
+                        {
+                            wm.target.bankSelect.bank = m->target.bankSelect.bank;
+                            wm.target.bankSelect.mode = (uint8_t)m->target.bankSelect.mode;
+                        }
+                        else if (m->type == ACTION_MIDI_NRPN || m->type == ACTION_MIDI_RPN)
+                        {
+                            wm.target.midiParam.channel = m->target.midiParam.channel;
+                            wm.target.midiParam.paramMsb = m->target.midiParam.paramMsb;
+                            wm.target.midiParam.paramLsb = m->target.midiParam.paramLsb;
+                        }
+                        else if (m->type == ACTION_MIDI_CC_RELATIVE)
+                        {
+                            wm.target.midiRelative.channel = m->target.midiRelative.channel;
+                            wm.target.midiRelative.ccNumber = m->target.midiRelative.ccNumber;
+                            wm.target.midiRelative.mode = m->target.midiRelative.mode;
+                        }
 
                         payload.count++;
                     }
@@ -100,6 +137,17 @@ void loop1()
         }
     }
 
+    // Bank switches requested from core0 (config command)
+    IPC::SelectBankRequest sbreq;
+    while (IPC::tryDequeueSelectBank(sbreq))
+    {
+        MappingManager::selectBank(sbreq.bank);
+        if (sbreq.resync)
+        {
+            IPC::enqueueSyncMappingAll();
+        }
+    }
+
     // Handle set parameter requests from core0
     IPC::SetParameterRequest spreq;
     while (IPC::tryDequeueSetParameter(spreq))
@@ -143,6 +191,24 @@ void loop1()
         }
     }
 
+    // MIDI feedback writes from core0
+    const uint32_t nowMs = millis();
+    for (int r = 0; r < MODULE_PORT_ROWS; r++)
+    {
+        for (int c = 0; c < MODULE_PORT_COLS; c++)
+        {
+            if (nowMs - g_feedbackWriteMs[r][c] < FEEDBACK_WRITE_INTERVAL_MS)
+                continue;
+            uint8_t pid;
+            uint16_t value;
+            if (IPC::tryTakeParameterWrite(r, c, pid, value))
+            {
+                MappingManager::applyFeedback(Port::get(r, c), pid, value);
+                g_feedbackWriteMs[r][c] = nowMs;
+            }
+        }
+    }
+
     // Handle set calibration requests from core0
     IPC::SetCalibRequest screq;
     while (IPC::tryDequeueSetCalib(screq))
@@ -159,4 +225,6 @@ void loop1()
                               (const uint8_t *)&payload, sizeof(payload));
         }
     }
-}
\ No newline at end of file
+
+    Profiler::exit();
+}
@@ -5,18 +5,50 @@
 
 #include <pico/sync.h>
 #include "usb_device.h"
+#include "midi_state.h"
+#include "port.h"
+#include "boardconfig.h"
+#include "trace.h"
+#include "profiler.h"
 
 namespace
 {
     static critical_section_t g_mapLock;
     static bool g_lockInited = false;
 
-    static void initLockOnce()
+    // Bank select buttons held down, one bit per parameter id (edge detection)
+    static uint8_t g_bankSelectHeld[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+
+    // Banks changed since the last MappingStore commit (guarded by g_mapLock)
+    static uint32_t g_dirtyBanks = 0;
+    static volatile uint32_t g_lastChangeMs = 0;
+    // Bumped whenever the active bank's content changes (guarded by g_mapLock)
+    static volatile uint32_t g_generation = 0;
+
+    static void markDirtyLocked(uint8_t bank)
     {
-        if (g_lockInited)
-            return;
-        critical_section_init(&g_mapLock);
-        g_lockInited = true;
+        g_dirtyBanks |= (1u << bank);
+        g_lastChangeMs = millis();
+        g_generation = g_generation + 1;
+    }
+
+    // Pool free list: g_freeNext links the free entries, g_poolBank tells
+    // which bank owns an entry (POOL_FREE when none). Guarded by g_mapLock.
+    constexpr uint8_t POOL_FREE = 0xFF;
+    static uint8_t g_freeNext[MappingManager::POOL_SIZE];
+    static uint8_t g_poolBank[MappingManager::POOL_SIZE];
+    static uint8_t g_freeHead = 0;
+    static int g_freeCount = 0;
+
+    // LUT of the default curve, for slots that get it without a compile
+    static CurveLut g_linearLut;
+
+    // Keys findPositionLocked() can find again; an entry inserted under any
+    // other key would hold a pool slot nothing can replace or delete
+    static bool keyInRange(int r, int c, uint8_t pid, uint8_t targetIndex)
+    {
+        return r >= 0 && c >= 0 && r < MODULE_PORT_ROWS && c < MODULE_PORT_COLS &&
+               pid < MappingManager::PARAMS_PER_MODULE && targetIndex < MAPPING_TARGETS_PER_PARAM;
     }
 
     static void fillDefaultCurve(Curve &c)
@@ -24,7 +56,25 @@ namespace
         c.h = 16384; // Linear (0.5 in Q15)
     }
 
-    static void fillTarget(ModuleMapping &m, ActionType type, uint8_t d1, uint8_t d2)
+    static void initLockOnce()
+    {
+        if (g_lockInited)
+            return;
+        critical_section_init(&g_mapLock);
+        for (int i = 0; i < MappingManager::POOL_SIZE; i++)
+        {
+            g_freeNext[i] = (uint8_t)(i + 1);
+            g_poolBank[i] = POOL_FREE;
+        }
+        g_freeHead = 0;
+        g_freeCount = MappingManager::POOL_SIZE;
+        Curve linear{};
+        fillDefaultCurve(linear);
+        CurveEvaluator::compile(linear, g_linearLut);
+        g_lockInited = true;
+    }
+
+    static void fillTarget(ModuleMapping &m, ActionType type, uint8_t d1, uint8_t d2, uint8_t d3 = 0)
     {
         m.type = type;
         // Initialize curve to default linear if h=0 (uninitialized)
@@ -61,6 +111,22 @@ namespace
             m.target.keyboard.keycode = d1;
             m.target.keyboard.modifier = d2;
             break;
+        case ACTION_BANK_SELECT:
+            memset(&m.target, 0, sizeof(m.target));
+            m.target.bankSelect.bank = d1; // 0-based
+            m.target.bankSelect.mode = (BankSelectMode)d2;
+            break;
+        case ACTION_MIDI_CC_RELATIVE:
+            m.target.midiRelative.channel = d1; // 1-16
+            m.target.midiRelative.ccNumber = d2;
+            m.target.midiRelative.mode = d3;
+            break;
+        case ACTION_MIDI_NRPN:
+        case ACTION_MIDI_RPN:
+            m.target.midiParam.channel = d1; // 1-16
+            m.target.midiParam.paramMsb = d2 & 0x7F;
+            m.target.midiParam.paramLsb = d3 & 0x7F;
+            break;
         case ACTION_NONE:
         default:
             memset(&m.target, 0, sizeof(m.target));
@@ -68,7 +134,9 @@ namespace
         }
     }
 
-    static uint8_t normalizeToU8(const Port::State *port, uint8_t pid, ModuleParameterDataType dt, const ModuleParameterValue &v)
+    // Normalize a parameter value to 0-65535 over its min/max range. This is
+    // the only quantization step: curve and target scaling all start from it.
+    static uint16_t normalizeToU16(const Port::State *port, uint8_t pid, ModuleParameterDataType dt, const ModuleParameterValue &v)
     {
         if (!port || !port->hasModule || pid >= port->module.parameterCount)
             return 0;
@@ -76,7 +144,7 @@ namespace
 
         if (dt == ModuleParameterDataType::PARAM_TYPE_BOOL)
         {
-            return v.boolValue ? 255 : 0;
+            return v.boolValue ? 65535 : 0;
         }
         if (dt == ModuleParameterDataType::PARAM_TYPE_INT)
         {
@@ -91,8 +159,9 @@ namespace
             if (val > mx)
                 val = mx;
 
-            // (val - min) * 255 / (max - min)
-            return (uint8_t)(((int64_t)(val - mn) * 255) / (mx - mn));
+            // (val - min) * 65535 / (max - min), rounded
+            const int64_t range = (int64_t)mx - mn;
+            return (uint16_t)((((int64_t)val - mn) * 65535 + range / 2) / range);
         }
         if (dt == ModuleParameterDataType::PARAM_TYPE_FLOAT)
         {
@@ -107,53 +176,360 @@ namespace
             if (val > mx)
                 val = mx;
 
-            return (uint8_t)((val - mn) * 255.0f / (mx - mn));
+            return (uint16_t)((val - mn) * 65535.0f / (mx - mn) + 0.5f);
         }
         return 0;
     }
 
-    static uint16_t normalizeToU10(const Port::State *port, uint8_t pid, ModuleParameterDataType dt, const ModuleParameterValue &v)
+    // Steps normalizeToU16() can tell apart over the range, 0 for a float
+    // (treated as continuous)
+    static uint16_t inputSteps(const ModuleParameter &p)
     {
-        if (!port || !port->hasModule || pid >= port->module.parameterCount)
+        if (p.dataType == ModuleParameterDataType::PARAM_TYPE_BOOL)
+            return 1;
+        if (p.dataType != ModuleParameterDataType::PARAM_TYPE_INT)
             return 0;
-        const ModuleParameter &p = port->module.parameters[pid];
+        const int64_t range = (int64_t)p.minMax.intMax - p.minMax.intMin;
+        return range > 0 && range <= 0xFFFF ? (uint16_t)range : 0;
+    }
 
-        if (dt == ModuleParameterDataType::PARAM_TYPE_BOOL)
+    // Nearest value normalizeToU16() can produce for an input of `steps`
+    static uint16_t quantizeInput(uint32_t v, uint16_t steps)
+    {
+        if (!steps)
+            return (uint16_t)v;
+        const uint32_t k = (v * steps + 32767) / 65535;
+        return (uint16_t)((k * 65535 + steps / 2) / steps);
+    }
+
+    // Inverse of normalizeToU16: 0-65535 back to a value of the parameter's
+    // type. LEDs keep their colour and switch on above half scale.
+    static bool denormalizeFromU16(const ModuleParameter &p, uint16_t v, ModuleParameterValue &out)
+    {
+        out = p.value;
+        switch (p.dataType)
         {
-            return v.boolValue ? 1023 : 0;
+        case ModuleParameterDataType::PARAM_TYPE_BOOL:
+            out.boolValue = v >= 32768 ? 1 : 0;
+            return true;
+        case ModuleParameterDataType::PARAM_TYPE_INT:
+        {
+            const int64_t range = (int64_t)p.minMax.intMax - p.minMax.intMin;
+            if (range <= 0)
+                return false;
+            out.intValue = (int32_t)(p.minMax.intMin + ((int64_t)v * range + 32767) / 65535);
+            return true;
         }
-        if (dt == ModuleParameterDataType::PARAM_TYPE_INT)
+        case ModuleParameterDataType::PARAM_TYPE_FLOAT:
+            if (p.minMax.floatMax <= p.minMax.floatMin)
+                return false;
+            out.floatValue = p.minMax.floatMin + (p.minMax.floatMax - p.minMax.floatMin) * (v / 65535.0f);
+            return true;
+        case ModuleParameterDataType::PARAM_TYPE_LED:
+            out.ledValue.status = v >= 32768 ? 1 : 0;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Map 0..65535 into -8192..8191, forcing v=32768 => 0 exactly.
+    static int16_t u16ToPitchBendSigned(uint16_t v)
+    {
+        if (v <= 32768)
         {
-            const int32_t mn = p.minMax.intMin;
-            const int32_t mx = p.minMax.intMax;
-            if (mx <= mn)
-                return 0;
+            const int32_t d = (int32_t)32768 - (int32_t)v; // 0..32768
+            return (int16_t)(-(d >> 2));
+        }
+        const int32_t d = (int32_t)v - (int32_t)32768; // 1..32767
+        return (int16_t)((d * 8191) / 32767);
+    }
 
-            int32_t val = v.intValue;
-            if (val < mn)
-                val = mn;
-            if (val > mx)
-                val = mx;
+    // Input filter state, same index as the pool entry. Core1 advances it
+    // under g_mapLock; any edit of an entry or switch to its bank resets it.
+    struct MappingFilterState
+    {
+        uint32_t ema;     // EMA accumulator, 16.8 fixed point
+        uint16_t anchor;  // last input that cleared the deadband
+        uint16_t out;     // filtered input, fed to the curve
+        uint16_t sentKey; // last emitted value at target resolution
+        uint8_t primed;   // anchor/out/ema hold a real input
+        uint8_t hasSent;
+        uint8_t lastOut7; // pickup: previous output at 7 bits, valid once hasOut7
+        uint8_t hasOut7;
+        uint8_t sent7;    // pickup: last output let through at 7 bits
+        uint8_t settling; // output still moving towards the input, or relative steps unsent
+        uint16_t inputSteps; // input resolution: steps over its range, 0 = continuous
+        // Relative targets: input position, time of the last step, and the
+        // accelerated steps not sent yet
+        int32_t lastPos;
+        uint32_t lastStepUs;
+        int32_t accum;
+    };
+
+    static MappingFilterState g_filters[MappingManager::POOL_SIZE];
+    // Some entry of the active bank has `settling` set (guarded by g_mapLock)
+    static bool g_anySettling = false;
+    static uint32_t g_filterTickUs = 0;
+    // Steps replayed after a long stall; beyond that the filters just resume
+    constexpr uint32_t FILTER_MAX_CATCHUP_MS = 16;
+    // Option units (deadband, slew) are 1/1024 of the 16-bit range
+    constexpr uint32_t FILTER_UNIT = 64;
+    // Relative targets collect steps this long before sending one delta
+    constexpr uint32_t RELATIVE_FLUSH_MS = 4;
+    // Largest delta one relative CC can carry
+    constexpr int32_t RELATIVE_MAX_DELTA = 63;
+    // Acceleration: steps slower than this per detent are sent 1:1, every
+    // ACCEL_STEP_US faster adds `strength` to the multiplier, up to ACCEL_MAX_FACTOR
+    constexpr uint32_t ACCEL_SLOW_US = 50000;
+    constexpr uint32_t ACCEL_STEP_US = 10000;
+    constexpr int32_t ACCEL_MAX_FACTOR = 16;
+    static uint32_t g_tickCount = 0;
+
+    static bool hasFilter(const MappingOptions &o)
+    {
+        return o.deadband || o.smoothing || o.slew || (o.flags & MAPPING_OPTION_PICKUP);
+    }
+
+    static void resetFilterLocked(int idx)
+    {
+        g_filters[idx] = {};
+    }
+
+    static void markSettlingLocked(int idx)
+    {
+        g_filters[idx].settling = 1;
+        g_anySettling = true;
+    }
+
+    static int allocEntryLocked(uint8_t bank)
+    {
+        if (!g_freeCount)
+            return -1;
+        const int idx = g_freeHead;
+        g_freeHead = g_freeNext[idx];
+        g_freeCount--;
+        g_poolBank[idx] = bank;
+        resetFilterLocked(idx);
+        return idx;
+    }
+
+    static void freeEntryLocked(int idx)
+    {
+        g_poolBank[idx] = POOL_FREE;
+        g_freeNext[idx] = g_freeHead;
+        g_freeHead = (uint8_t)idx;
+        g_freeCount++;
+    }
 
-            // (val - min) * 1023 / (max - min)
-            return (uint16_t)(((int64_t)(val - mn) * 1023) / (mx - mn));
+    // Orders mapping `m` against the key (r, c, pid, targetIndex)
+    static int compareKey(const ModuleMapping &m, int r, int c, uint8_t pid, uint8_t targetIndex)
+    {
+        if (m.row != r)
+            return m.row < r ? -1 : 1;
+        if (m.col != c)
+            return m.col < c ? -1 : 1;
+        if (m.paramId != pid)
+            return m.paramId < pid ? -1 : 1;
+        if (m.targetIndex != targetIndex)
+            return m.targetIndex < targetIndex ? -1 : 1;
+        return 0;
+    }
+
+    // Low bits of the curve output that the target's resolution drops
+    static uint8_t outputShift(ActionType type)
+    {
+        switch (type)
+        {
+        case ACTION_MIDI_NOTE:
+        case ACTION_MIDI_CC:
+            return 9; // 7-bit
+        case ACTION_MIDI_PITCH_BEND:
+        case ACTION_MIDI_MOD_WHEEL:
+        case ACTION_MIDI_NRPN:
+        case ACTION_MIDI_RPN:
+            return 2; // 14-bit
+        default:
+            return 15; // on/off
         }
-        if (dt == ModuleParameterDataType::PARAM_TYPE_FLOAT)
+    }
+
+    // Controller a pickup mapping is matched against; false for other targets.
+    static bool pickupControl(const ModuleMapping &m, uint8_t &channel, uint8_t &controller)
+    {
+        if (m.type == ACTION_MIDI_CC)
+            controller = m.target.midiCC.ccNumber;
+        else if (m.type == ACTION_MIDI_MOD_WHEEL)
+            controller = 1; // MSB of the 14-bit pair
+        else
+            return false;
+        channel = m.target.midiCC.channel > 0 ? m.target.midiCC.channel - 1 : 0;
+        return true;
+    }
+
+    // Soft takeover. Output passes while the host still holds what this
+    // mapping sent last; otherwise once the control reaches or crosses the
+    // host's value.
+    static bool pickupAllows(MappingFilterState &f, const ModuleMapping &m, uint16_t mapCur)
+    {
+        uint8_t channel;
+        uint8_t controller;
+        if (!pickupControl(m, channel, controller))
+            return true;
+
+        const uint8_t v = (uint8_t)(mapCur >> 9);
+        const uint8_t host = MidiState::control(channel, controller);
+        const bool crossed = f.hasOut7 && ((f.lastOut7 < host) != (v < host));
+        f.lastOut7 = v;
+        f.hasOut7 = 1;
+        if (host != MidiState::UNKNOWN && !(f.hasSent && f.sent7 == host) && v != host && !crossed)
+            return false;
+        f.sent7 = v;
+        return true;
+    }
+
+    // Runs the filtered input through the curve. Returns false when the
+    // result would not change what the target last sent, or pickup holds it.
+    static bool publishFilter(MappingFilterState &f, const ModuleMapping &m, const CurveLut &lut, uint16_t &mapCur)
+    {
         {
-            const float mn = p.minMax.floatMin;
-            const float mx = p.minMax.floatMax;
-            if (mx <= mn)
-                return 0;
+            PROFILE_STAGE(STAGE_CURVE);
+            mapCur = CurveEvaluator::eval(lut, f.out);
+        }
+        const uint16_t key = (uint16_t)(mapCur >> outputShift(m.type));
+        if (f.hasSent && key == f.sentKey)
+            return false;
+        if ((m.options.flags & MAPPING_OPTION_PICKUP) && !pickupAllows(f, m, mapCur))
+            return false;
+        f.sentKey = key;
+        f.hasSent = 1;
+        return true;
+    }
 
-            float val = v.floatValue;
-            if (val < mn)
-                val = mn;
-            if (val > mx)
-                val = mx;
+    // New input. Returns true when the filtered value moved; EMA and slew
+    // only record the input here and settle it from the 1 ms tick.
+    static bool filterInput(MappingFilterState &f, const MappingOptions &o, uint16_t raw, bool &settling)
+    {
+        settling = false;
+        if (!f.primed)
+        {
+            f.primed = 1;
+            f.anchor = raw;
+            f.out = raw;
+            f.ema = (uint32_t)raw << 8;
+            return true;
+        }
 
-            return (uint16_t)((val - mn) * 1023.0f / (mx - mn));
+        // Hysteresis: ignore wobble around the last accepted input. The ends
+        // of the range always pass, or a fader could stop short of them.
+        if (o.deadband && raw != 0 && raw != 0xFFFF)
+        {
+            const int32_t diff = (int32_t)raw - (int32_t)f.anchor;
+            if ((uint32_t)(diff < 0 ? -diff : diff) < o.deadband * FILTER_UNIT)
+                return false;
         }
-        return 0;
+        if (raw == f.anchor)
+            return false;
+        f.anchor = raw;
+
+        if (o.smoothing || o.slew)
+        {
+            settling = true;
+            return false;
+        }
+        f.out = raw;
+        f.ema = (uint32_t)raw << 8;
+        return true;
+    }
+
+    // Encoder position of a relative mapping's input. Int parameters count
+    // detents; other types are quantized to 128 steps over their range.
+    static int32_t relativePosition(ModuleParameterDataType dt, const ModuleParameterValue &cur, uint16_t raw)
+    {
+        return dt == ModuleParameterDataType::PARAM_TYPE_INT ? cur.intValue : (int32_t)(raw >> 9);
+    }
+
+    // Steps since the last update; an int encoder that wraps from max to min
+    // (or back) moves by the short way round.
+    static int32_t relativeSteps(const ModuleParameter &p, int32_t from, int32_t to)
+    {
+        int32_t d = to - from;
+        if (p.dataType == ModuleParameterDataType::PARAM_TYPE_INT && p.minMax.intMax > p.minMax.intMin)
+        {
+            const int64_t span = (int64_t)p.minMax.intMax - p.minMax.intMin + 1;
+            if (d > span / 2)
+                d = (int32_t)(d - span);
+            else if (d < -span / 2)
+                d = (int32_t)(d + span);
+        }
+        return d;
+    }
+
+    // Multiplier for steps that arrived `intervalUs` apart at `strength` 0-3.
+    static int32_t accelFactor(uint8_t strength, uint32_t intervalUs, int32_t steps)
+    {
+        if (!strength || steps == 0)
+            return 1;
+        const uint32_t perStep = intervalUs / (uint32_t)(steps < 0 ? -steps : steps);
+        if (perStep >= ACCEL_SLOW_US)
+            return 1;
+        const int32_t f = 1 + (int32_t)(strength * (ACCEL_SLOW_US - perStep) / ACCEL_STEP_US);
+        return f > ACCEL_MAX_FACTOR ? ACCEL_MAX_FACTOR : f;
+    }
+
+    static uint8_t encodeRelative(uint8_t mode, int32_t delta)
+    {
+        switch (mode & RELATIVE_MODE_MASK)
+        {
+        case RELATIVE_BINARY_OFFSET:
+            return (uint8_t)(64 + delta);
+        case RELATIVE_SIGN_MAGNITUDE:
+            return (uint8_t)(delta < 0 ? (0x40 | -delta) : delta);
+        case RELATIVE_TWOS_COMPLEMENT:
+        default:
+            return (uint8_t)(delta & 0x7F);
+        }
+    }
+
+    static void emitRelative(const ModuleMapping &m, int32_t delta)
+    {
+        const ActionTargetMidiRelative &t = m.target.midiRelative;
+        const uint8_t ch = t.channel > 0 ? t.channel - 1 : 0;
+        usb::sendMidiCC(ch, t.ccNumber, encodeRelative(t.mode, delta));
+    }
+
+    // One millisecond of EMA and slew towards the anchor. Returns true while
+    // the output has not reached it yet.
+    static bool filterStep(MappingFilterState &f, const MappingOptions &o)
+    {
+        const int32_t target = (int32_t)f.anchor << 8;
+        int32_t v = f.anchor;
+        if (o.smoothing)
+        {
+            const uint8_t n = o.smoothing > MAPPING_SMOOTHING_MAX ? MAPPING_SMOOTHING_MAX : o.smoothing;
+            // Truncating division, so the last step snaps onto the target
+            const int32_t step = (target - (int32_t)f.ema) / (1 << n);
+            f.ema = step ? (uint32_t)((int32_t)f.ema + step) : (uint32_t)target;
+            v = (int32_t)((f.ema + 128) >> 8);
+            if (v > 0xFFFF)
+                v = 0xFFFF;
+            // Held to values the input itself can take: finer steps would send
+            // a message per tick while the tail settles. Within half an input
+            // step of the target the EMA is done.
+            v = quantizeInput((uint32_t)v, f.inputSteps);
+            if (v == f.anchor)
+                f.ema = (uint32_t)target;
+        }
+        if (o.slew)
+        {
+            const int32_t maxStep = (int32_t)(o.slew * FILTER_UNIT);
+            if (v > f.out + maxStep)
+                v = f.out + maxStep;
+            else if (v < f.out - maxStep)
+                v = f.out - maxStep;
+        }
+        f.out = (uint16_t)v;
+        return f.out != f.anchor || (o.smoothing && f.ema != (uint32_t)target);
     }
 
     static void releaseMappingAction(const ModuleMapping &m)
@@ -188,25 +564,95 @@ namespace
     }
 }
 
-ModuleMapping MappingManager::mappings[32];
-int MappingManager::mappingCount = 0;
+ModuleMapping MappingManager::pool[MappingManager::POOL_SIZE];
+CurveLut MappingManager::poolLuts[MappingManager::POOL_SIZE];
+uint8_t MappingManager::bankOrder[MappingManager::BANK_COUNT][MappingManager::BANK_CAPACITY];
+uint8_t MappingManager::bankSizes[MappingManager::BANK_COUNT];
+uint8_t MappingManager::activeBank = 0;
+uint8_t MappingManager::paramFirst[MODULE_PORT_ROWS][MODULE_PORT_COLS][MappingManager::PARAMS_PER_MODULE];
 
 void MappingManager::init()
 {
     initLockOnce();
 }
 
+int MappingManager::findPositionLocked(int r, int c, uint8_t pid, uint8_t targetIndex)
+{
+    if (r < 0 || c < 0 || r >= MODULE_PORT_ROWS || c >= MODULE_PORT_COLS || pid >= PARAMS_PER_MODULE)
+        return -1;
+    const uint8_t first = paramFirst[r][c][pid];
+    if (first == NO_POSITION)
+        return -1;
+    const uint8_t *order = bankOrder[activeBank];
+    for (int pos = first; pos < bankSizes[activeBank]; pos++)
+    {
+        const int cmp = compareKey(pool[order[pos]], r, c, pid, targetIndex);
+        if (cmp == 0)
+            return pos;
+        if (cmp > 0)
+            break;
+    }
+    return -1;
+}
+
+int MappingManager::insertLocked(uint8_t bank, const ModuleMapping &m)
+{
+    if (bankSizes[bank] >= BANK_CAPACITY)
+        return -1;
+    const int idx = allocEntryLocked(bank);
+    if (idx < 0)
+        return -1;
+    pool[idx] = m;
+
+    uint8_t *order = bankOrder[bank];
+    int pos = bankSizes[bank];
+    while (pos > 0 && compareKey(pool[order[pos - 1]], m.row, m.col, m.paramId, m.targetIndex) > 0)
+    {
+        order[pos] = order[pos - 1];
+        pos--;
+    }
+    order[pos] = (uint8_t)idx;
+    bankSizes[bank]++;
+    if (bank == activeBank)
+        reindexLocked();
+    return idx;
+}
+
+void MappingManager::removeAtLocked(int pos)
+{
+    uint8_t *order = bankOrder[activeBank];
+    const int idx = order[pos];
+    releaseMappingAction(pool[idx]);
+    freeEntryLocked(idx);
+    bankSizes[activeBank]--;
+    memmove(&order[pos], &order[pos + 1], bankSizes[activeBank] - pos);
+    reindexLocked();
+}
+
+void MappingManager::reindexLocked()
+{
+    memset(paramFirst, NO_POSITION, sizeof(paramFirst));
+    const uint8_t *order = bankOrder[activeBank];
+    for (int pos = bankSizes[activeBank] - 1; pos >= 0; pos--)
+    {
+        const ModuleMapping &m = pool[order[pos]];
+        if (m.row >= 0 && m.col >= 0 && m.row < MODULE_PORT_ROWS && m.col < MODULE_PORT_COLS && m.paramId < PARAMS_PER_MODULE)
+            paramFirst[m.row][m.col][m.paramId] = (uint8_t)pos;
+    }
+}
+
 void MappingManager::clearMappings()
 {
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
-    mappingCount = 0;
-    for (int i = 0; i < 32; i++)
+    for (int pos = 0; pos < bankSizes[activeBank]; pos++)
     {
-        mappings[i] = {};
-        mappings[i].row = -1;
-        mappings[i].col = -1;
+        freeEntryLocked(bankOrder[activeBank][pos]);
     }
+    bankSizes[activeBank] = 0;
+    g_anySettling = false;
+    reindexLocked();
+    markDirtyLocked(activeBank);
     critical_section_exit(&g_mapLock);
 }
 
@@ -220,65 +666,167 @@ void MappingManager::clearMappingsForPort(int r, int c)
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
 
-    int i = 0;
-    while (i < mappingCount)
+    int pos = 0;
+    while (pos < bankSizes[activeBank])
     {
-        if (mappings[i].row == r && mappings[i].col == c)
+        const ModuleMapping &m = pool[bankOrder[activeBank][pos]];
+        if (m.row == r && m.col == c)
         {
-            // release usb actions
-            releaseMappingAction(mappings[i]);
-            // swap-remove
-            if (i != mappingCount - 1)
-            {
-                mappings[i] = mappings[mappingCount - 1];
-            }
-            mappingCount--;
-            // Don't increment i, check the swapped element
+            // Releases its usb actions; the next entry moves into `pos`
+            removeAtLocked(pos);
         }
         else
         {
-            i++;
+            pos++;
+        }
+    }
+    markDirtyLocked(activeBank);
+
+    critical_section_exit(&g_mapLock);
+}
+
+void MappingManager::releaseMappingsForPort(int r, int c)
+{
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    for (int pos = 0; pos < bankSizes[activeBank]; pos++)
+    {
+        const int idx = bankOrder[activeBank][pos];
+        if (pool[idx].row == r && pool[idx].col == c)
+        {
+            releaseMappingAction(pool[idx]);
+            resetFilterLocked(idx);
         }
     }
+    critical_section_exit(&g_mapLock);
+}
 
+bool MappingManager::hasMappingsForPort(int r, int c)
+{
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    bool found = false;
+    for (int pos = 0; pos < bankSizes[activeBank] && !found; pos++)
+    {
+        const ModuleMapping &m = pool[bankOrder[activeBank][pos]];
+        found = m.row == r && m.col == c;
+    }
     critical_section_exit(&g_mapLock);
+    return found;
 }
 
 void MappingManager::addMapping(int r, int c, const ModuleMapping &m)
 {
+    if (!keyInRange(r, c, m.paramId, m.targetIndex))
+        return;
     initLockOnce();
+    // Compile outside the lock, it keeps interrupts off
+    CurveLut lut;
+    CurveEvaluator::compile(m.curve, lut);
     critical_section_enter_blocking(&g_mapLock);
 
-    // Check if exists
-    for (int i = 0; i < mappingCount; i++)
+    ModuleMapping entry = m;
+    entry.row = r; // Ensure correct coords
+    entry.col = c;
+    const int pos = findPositionLocked(r, c, m.paramId, m.targetIndex);
+    int idx = -1;
+    if (pos >= 0)
+    {
+        idx = bankOrder[activeBank][pos];
+        releaseMappingAction(pool[idx]);
+        pool[idx] = entry;
+        resetFilterLocked(idx);
+    }
+    else
     {
-        if (mappings[i].row == r && mappings[i].col == c && mappings[i].paramId == m.paramId)
+        idx = insertLocked(activeBank, entry);
+    }
+    if (idx >= 0)
+    {
+        poolLuts[idx] = lut;
+        markDirtyLocked(activeBank);
+    }
+
+    critical_section_exit(&g_mapLock);
+}
+
+bool MappingManager::setMappings(const ModuleMapping *batch, int n)
+{
+    if (!batch || n < 0)
+        return false;
+
+    initLockOnce();
+    static CurveLut batchLuts[MAX_BATCH];
+    if (n > MAX_BATCH)
+        return false;
+    for (int i = 0; i < n; i++)
+    {
+        if (!keyInRange(batch[i].row, batch[i].col, batch[i].paramId, batch[i].targetIndex))
+            return false;
+        CurveEvaluator::compile(batch[i].curve, batchLuts[i]);
+    }
+    critical_section_enter_blocking(&g_mapLock);
+
+    // Count the entries this batch needs (keys not present yet, duplicates counted once)
+    int added = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const ModuleMapping &b = batch[i];
+        bool exists = findPositionLocked(b.row, b.col, b.paramId, b.targetIndex) >= 0;
+        for (int j = 0; j < i && !exists; j++)
         {
-            releaseMappingAction(mappings[i]);
-            mappings[i] = m;
-            mappings[i].row = r; // Ensure correct coords
-            mappings[i].col = c;
-            critical_section_exit(&g_mapLock);
-            return;
+            exists = compareKey(batch[j], b.row, b.col, b.paramId, b.targetIndex) == 0;
         }
+        if (!exists)
+            added++;
+    }
+    if (bankSizes[activeBank] + added > BANK_CAPACITY || added > g_freeCount)
+    {
+        critical_section_exit(&g_mapLock);
+        return false;
     }
 
-    if (mappingCount < 32)
+    for (int i = 0; i < n; i++)
     {
-        mappings[mappingCount] = m;
-        mappings[mappingCount].row = r;
-        mappings[mappingCount].col = c;
-        mappingCount++;
+        const ModuleMapping &b = batch[i];
+
+        // Same target rules as updateMapping(), curve taken as sent
+        ModuleMapping entry = {};
+        entry.row = b.row;
+        entry.col = b.col;
+        entry.paramId = b.paramId;
+        entry.targetIndex = b.targetIndex;
+        entry.curve = b.curve;
+        entry.options = b.options;
+        const uint8_t *t = reinterpret_cast<const uint8_t *>(&b.target);
+        fillTarget(entry, b.type, t[0], t[1], t[2]);
+
+        const int pos = findPositionLocked(b.row, b.col, b.paramId, b.targetIndex);
+        int idx;
+        if (pos >= 0)
+        {
+            idx = bankOrder[activeBank][pos];
+            releaseMappingAction(pool[idx]);
+            pool[idx] = entry;
+            resetFilterLocked(idx);
+        }
+        else
+        {
+            idx = insertLocked(activeBank, entry); // fits, checked above
+        }
+        poolLuts[idx] = batchLuts[i];
     }
+    markDirtyLocked(activeBank);
 
     critical_section_exit(&g_mapLock);
+    return true;
 }
 
 int MappingManager::count()
 {
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
-    int c = mappingCount;
+    int c = bankSizes[activeBank];
     critical_section_exit(&g_mapLock);
     return c;
 }
@@ -288,89 +836,349 @@ const ModuleMapping *MappingManager::getByIndex(int idx)
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
     const ModuleMapping *out = nullptr;
-    if (idx >= 0 && idx < mappingCount)
+    if (idx >= 0 && idx < bankSizes[activeBank])
     {
-        out = &mappings[idx];
+        out = &pool[bankOrder[activeBank][idx]];
     }
     critical_section_exit(&g_mapLock);
     return out;
 }
 
-const ModuleMapping *MappingManager::findMapping(int r, int c, uint8_t pid)
+const ModuleMapping *MappingManager::findMapping(int r, int c, uint8_t pid, uint8_t targetIndex)
+{
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    const int pos = findPositionLocked(r, c, pid, targetIndex);
+    const ModuleMapping *out = pos >= 0 ? &pool[bankOrder[activeBank][pos]] : nullptr;
+    critical_section_exit(&g_mapLock);
+    return out;
+}
+
+void MappingManager::selectBank(uint8_t bank)
 {
+    if (bank >= BANK_COUNT)
+        return;
+
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
-    for (int i = 0; i < mappingCount; i++)
+    if (bank != activeBank)
     {
-        const ModuleMapping &m = mappings[i];
-        if (m.row == r && m.col == c && m.paramId == pid)
+        // Nothing the old bank holds (notes, keys, bends) may outlive it
+        for (int pos = 0; pos < bankSizes[activeBank]; pos++)
         {
-            const ModuleMapping *out = &mappings[i];
-            critical_section_exit(&g_mapLock);
-            return out;
+            releaseMappingAction(pool[bankOrder[activeBank][pos]]);
+        }
+        activeBank = bank;
+        for (int pos = 0; pos < bankSizes[bank]; pos++)
+        {
+            resetFilterLocked(bankOrder[bank][pos]);
         }
+        g_anySettling = false;
+        reindexLocked();
+        g_generation = g_generation + 1;
+    }
+    critical_section_exit(&g_mapLock);
+}
+
+uint8_t MappingManager::getActiveBank()
+{
+    return activeBank;
+}
+
+int MappingManager::bankCount(uint8_t bank)
+{
+    if (bank >= BANK_COUNT)
+        return 0;
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    const int n = bankSizes[bank];
+    critical_section_exit(&g_mapLock);
+    return n;
+}
+
+uint32_t MappingManager::takeDirtyBanks()
+{
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    const uint32_t mask = g_dirtyBanks;
+    g_dirtyBanks = 0;
+    critical_section_exit(&g_mapLock);
+    return mask;
+}
+
+void MappingManager::markBanksDirty(uint32_t mask)
+{
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    g_dirtyBanks |= mask;
+    critical_section_exit(&g_mapLock);
+}
+
+uint32_t MappingManager::lastChangeMs()
+{
+    return g_lastChangeMs;
+}
+
+uint32_t MappingManager::generation()
+{
+    return g_generation;
+}
+
+int MappingManager::snapshotBank(uint8_t bank, ModuleMapping *out)
+{
+    if (bank >= BANK_COUNT || !out)
+        return 0;
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    const int n = bankSizes[bank];
+    for (int pos = 0; pos < n; pos++)
+    {
+        out[pos] = pool[bankOrder[bank][pos]];
+    }
+    critical_section_exit(&g_mapLock);
+    return n;
+}
+
+void MappingManager::loadBank(uint8_t bank, const ModuleMapping *in, int n)
+{
+    if (bank >= BANK_COUNT || !in || n < 0)
+        return;
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    for (int pos = 0; pos < bankSizes[bank]; pos++)
+    {
+        freeEntryLocked(bankOrder[bank][pos]);
     }
+    bankSizes[bank] = 0;
     critical_section_exit(&g_mapLock);
-    return nullptr;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (!keyInRange(in[i].row, in[i].col, in[i].paramId, in[i].targetIndex))
+            continue;
+        // Boot only: nothing evaluates this LUT yet, compile it in place
+        critical_section_enter_blocking(&g_mapLock);
+        const int idx = insertLocked(bank, in[i]);
+        critical_section_exit(&g_mapLock);
+        if (idx < 0)
+            break;
+        CurveEvaluator::compile(in[i].curve, poolLuts[idx]);
+    }
+
+    if (bank == activeBank)
+    {
+        critical_section_enter_blocking(&g_mapLock);
+        g_anySettling = false;
+        g_generation = g_generation + 1;
+        critical_section_exit(&g_mapLock);
+    }
 }
 
 void MappingManager::applyMapping(const Port::State *port, uint8_t pid, ModuleParameterDataType dt, const ModuleParameterValue &cur)
 {
-    if (!port)
+    if (!port || pid >= PARAMS_PER_MODULE)
         return;
+    const int r = port->row;
+    const int c = port->col;
+    if (r < 0 || c < 0 || r >= MODULE_PORT_ROWS || c >= MODULE_PORT_COLS)
+        return;
+    PROFILE_STAGE(STAGE_MAPPING);
 
-    const ModuleMapping *m = MappingManager::findMapping(port->row, port->col, pid);
-    if (!m || m->type == ACTION_NONE)
+    // The parameter's targets are adjacent in the bank: one lookup finds them all
+    uint8_t targets[MAPPING_TARGETS_PER_PARAM];
+    int targetCount = 0;
+    critical_section_enter_blocking(&g_mapLock);
+    const uint8_t bank = activeBank;
+    const uint8_t *order = bankOrder[bank];
+    for (int pos = paramFirst[r][c][pid]; pos != NO_POSITION && pos < bankSizes[bank] && targetCount < MAPPING_TARGETS_PER_PARAM; pos++)
+    {
+        const ModuleMapping &m = pool[order[pos]];
+        if (m.row != r || m.col != c || m.paramId != pid)
+            break;
+        targets[targetCount++] = order[pos];
+    }
+    critical_section_exit(&g_mapLock);
+    if (!targetCount)
         return;
 
-    if (m->type == ACTION_MIDI_PITCH_BEND)
+    // 16-bit pipeline: normalize once, then filter, curve and scale per target
+    const uint16_t rawCur = normalizeToU16(port, pid, dt, cur);
+
+    // A bank select among the targets ends the walk: the rest belong to the old bank
+    for (int t = 0; t < targetCount && activeBank == bank; t++)
     {
-        uint16_t rawCur10 = normalizeToU10(port, pid, dt, cur);
-        uint16_t mapCur10 = CurveEvaluator::eval10(m->curve, rawCur10);
+        const int idx = targets[t];
+        const ModuleMapping *m = &pool[idx];
+        if (m->type == ACTION_NONE)
+            continue;
+        TRACE(MAP_CURVE, idx, m->curve.count, m->curve.h, rawCur);
 
-        auto u10ToPitchBendSigned = [](uint16_t v) -> int16_t
+        if (m->type == ACTION_MIDI_CC_RELATIVE)
         {
-            // Map 0..1023 into -8192..8191, forcing v=512 => 0 exactly.
-            if (v <= 512)
+            // Steps are accumulated here and sent as one delta from tick()
+            if (pid >= port->module.parameterCount)
+                continue;
+            const int32_t pos = relativePosition(dt, cur, rawCur);
+            const uint32_t now = time_us_32();
+            critical_section_enter_blocking(&g_mapLock);
+            if (g_poolBank[idx] == activeBank)
             {
-                const int32_t d = (int32_t)512 - (int32_t)v; // 0..512
-                const int32_t neg = -(d * 8192) / 512;
-                return (int16_t)neg;
+                MappingFilterState &f = g_filters[idx];
+                if (f.primed)
+                {
+                    const int32_t steps = relativeSteps(port->module.parameters[pid], f.lastPos, pos);
+                    const uint8_t strength = m->target.midiRelative.mode >> RELATIVE_ACCEL_SHIFT;
+                    f.accum += steps * accelFactor(strength, now - f.lastStepUs, steps);
+                    if (f.accum)
+                        markSettlingLocked(idx);
+                }
+                f.primed = 1;
+                f.lastPos = pos;
+                f.lastStepUs = now;
             }
-            else
+            critical_section_exit(&g_mapLock);
+            continue;
+        }
+
+        if (!hasFilter(m->options))
+        {
+            uint16_t mapCur;
             {
-                const int32_t d = (int32_t)v - (int32_t)512; // 1..511
-                const int32_t pos = (d * 8191) / 511;
-                return (int16_t)pos;
+                PROFILE_STAGE(STAGE_CURVE);
+                mapCur = CurveEvaluator::eval(poolLuts[idx], rawCur);
             }
-        };
+            emitMapping(m, mapCur);
+            continue;
+        }
 
-        uint8_t ch = m->target.midiCC.channel;
-        if (ch > 0)
-            ch -= 1;
+        uint16_t mapCur = 0;
+        bool send = false;
+        critical_section_enter_blocking(&g_mapLock);
+        if (g_poolBank[idx] == activeBank)
+        {
+            MappingFilterState &f = g_filters[idx];
+            bool settling = false;
+            f.inputSteps = inputSteps(port->module.parameters[pid]);
+            send = filterInput(f, m->options, rawCur, settling) && publishFilter(f, *m, poolLuts[idx], mapCur);
+            if (settling)
+                markSettlingLocked(idx);
+        }
+        critical_section_exit(&g_mapLock);
+        if (send)
+            emitMapping(m, mapCur);
+    }
+}
 
-        const int16_t pb = u10ToPitchBendSigned(mapCur10);
-        const uint16_t pb14 = (uint16_t)((int32_t)pb + 8192);
+void MappingManager::applyFeedback(const Port::State *port, uint8_t pid, uint16_t value)
+{
+    PROFILE_STAGE(STAGE_MAPPING);
+    if (!port || !port->configured || !port->hasModule || pid >= port->module.parameterCount)
+        return;
+    const ModuleParameter &p = port->module.parameters[pid];
+    if (!(p.access & ACCESS_WRITE))
+        return;
+    ModuleParameterValue v;
+    if (!denormalizeFromU16(p, value, v))
+        return;
+    Port::sendSetParameter(port->row, port->col, pid, p.dataType, v);
+}
 
-        usb::sendMidiPitchBend(ch, pb14);
+void MappingManager::tick()
+{
+    const uint32_t now = time_us_32();
+    uint32_t steps = (now - g_filterTickUs) / 1000;
+    if (steps == 0)
         return;
+    if (steps > FILTER_MAX_CATCHUP_MS)
+    {
+        steps = FILTER_MAX_CATCHUP_MS;
+        g_filterTickUs = now;
     }
+    else
+    {
+        g_filterTickUs += steps * 1000;
+    }
+    if (!g_anySettling)
+        return;
 
-    // Normalize inputs to 0-255
-    uint8_t rawCur = normalizeToU8(port, pid, dt, cur);
-    // Apply Curve
-    uint8_t mapCur = CurveEvaluator::eval(m->curve, rawCur);
-    printf("Curve: h=%d, input: %d\n", m->curve.h, rawCur);
-    printf("Eval result: %d\n", mapCur);
-
-    // Boolean logic based on 50% threshold of MAPPED value
-    const bool curBool = (mapCur >= 128);
+    PROFILE_STAGE(STAGE_MAPPING);
+    g_tickCount += steps;
+    const bool flushRelative = (g_tickCount % RELATIVE_FLUSH_MS) < steps;
+
+    // Advance under the lock, emit after it (a bank select takes it again)
+    uint8_t pendingIdx[BANK_CAPACITY];
+    uint16_t pendingVal[BANK_CAPACITY];
+    int pending = 0;
+    uint8_t relativeIdx[BANK_CAPACITY];
+    int8_t relativeDelta[BANK_CAPACITY];
+    int relative = 0;
+    bool stillSettling = false;
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+    const uint8_t bank = activeBank;
+    for (int pos = 0; pos < bankSizes[bank]; pos++)
+    {
+        const int i = bankOrder[bank][pos];
+        MappingFilterState &f = g_filters[i];
+        if (!f.settling)
+            continue;
+        if (pool[i].type == ACTION_MIDI_CC_RELATIVE)
+        {
+            if (!flushRelative)
+            {
+                stillSettling = true;
+                continue;
+            }
+            int32_t d = f.accum;
+            if (d > RELATIVE_MAX_DELTA)
+                d = RELATIVE_MAX_DELTA;
+            else if (d < -RELATIVE_MAX_DELTA)
+                d = -RELATIVE_MAX_DELTA;
+            f.accum -= d;
+            f.settling = f.accum != 0;
+            if (d)
+            {
+                relativeIdx[relative] = (uint8_t)i;
+                relativeDelta[relative] = (int8_t)d;
+                relative++;
+            }
+            stillSettling |= f.settling != 0;
+            continue;
+        }
+        bool moving = true;
+        for (uint32_t s = 0; s < steps && moving; s++)
+        {
+            moving = filterStep(f, pool[i].options);
+        }
+        f.settling = moving;
+        stillSettling |= moving;
+        uint16_t mapCur;
+        if (publishFilter(f, pool[i], poolLuts[i], mapCur))
+        {
+            pendingIdx[pending] = (uint8_t)i;
+            pendingVal[pending] = mapCur;
+            pending++;
+        }
+    }
+    g_anySettling = stillSettling;
+    critical_section_exit(&g_mapLock);
 
-    auto u8ToU14 = [](uint8_t v) -> uint16_t
+    for (int k = 0; k < relative; k++)
     {
-        // Scale 0..255 to 0..16383
-        return (uint16_t)(((uint32_t)v * 16383u + 127u) / 255u);
-    };
+        emitRelative(pool[relativeIdx[k]], relativeDelta[k]);
+    }
+    for (int k = 0; k < pending && activeBank == bank; k++)
+    {
+        emitMapping(&pool[pendingIdx[k]], pendingVal[k]);
+    }
+}
+
+void MappingManager::emitMapping(const ModuleMapping *m, uint16_t mapCur)
+{
+    TRACE(MAP_EMIT, m->type, m->row, m->col, mapCur);
+
+    // Boolean logic based on 50% threshold of MAPPED value
+    const bool curBool = (mapCur >= 32768);
 
     switch (m->type)
     {
@@ -381,8 +1189,8 @@ void MappingManager::applyMapping(const Port::State *port, uint8_t pid, ModulePa
         if (ch > 0)
             ch -= 1;
         const uint8_t note = m->target.midiNote.noteNumber;
-        // Use curve output as velocity (0-255 -> 0-127)
-        const uint8_t vel = mapCur >> 1;
+        // Use curve output as velocity (0-65535 -> 0-127)
+        const uint8_t vel = (uint8_t)(mapCur >> 9);
 
         // Note gating must NOT depend on the 50% threshold (which maps to vel>=64).
         // MIDI Note On with velocity 0 is treated as Note Off by many synths, so:
@@ -403,8 +1211,8 @@ void MappingManager::applyMapping(const Port::State *port, uint8_t pid, ModulePa
         if (ch > 0)
             ch -= 1;
         const uint8_t cc = m->target.midiCC.ccNumber;
-        // Map 0-255 to 0-127
-        const uint8_t value = mapCur >> 1;
+        // Map 0-65535 to 0-127
+        const uint8_t value = (uint8_t)(mapCur >> 9);
 
         usb::sendMidiCC(ch, cc, value);
 
@@ -417,12 +1225,62 @@ void MappingManager::applyMapping(const Port::State *port, uint8_t pid, ModulePa
             ch -= 1;
 
         // CC1 (MSB) + CC33 (LSB) as 14-bit value
-        const uint16_t v14 = u8ToU14(mapCur);
+        const uint16_t v14 = (uint16_t)(mapCur >> 2);
 
         usb::sendMidiCC14(ch, 1, v14);
 
         break;
     }
+    case ACTION_MIDI_PITCH_BEND:
+    {
+        uint8_t ch = m->target.midiCC.channel;
+        if (ch > 0)
+            ch -= 1;
+
+        const int16_t pb = u16ToPitchBendSigned(mapCur);
+        const uint16_t pb14 = (uint16_t)((int32_t)pb + 8192);
+
+        usb::sendMidiPitchBend(ch, pb14);
+        break;
+    }
+    case ACTION_MIDI_NRPN:
+    case ACTION_MIDI_RPN:
+    {
+        uint8_t ch = m->target.midiParam.channel;
+        if (ch > 0)
+            ch -= 1;
+        const uint16_t param = (uint16_t)((m->target.midiParam.paramMsb << 7) | m->target.midiParam.paramLsb);
+
+        usb::sendMidiParam(ch, m->type == ACTION_MIDI_RPN, param, (uint16_t)(mapCur >> 2));
+        break;
+    }
+    case ACTION_BANK_SELECT:
+    {
+        // Switch on the rising edge only, so a held (or noisy analog) control
+        // steps through banks once per press.
+        if (m->row < 0 || m->col < 0 || m->row >= MODULE_PORT_ROWS || m->col >= MODULE_PORT_COLS || m->paramId >= 8)
+            break;
+        uint8_t &held = g_bankSelectHeld[m->row][m->col];
+        const uint8_t bit = (uint8_t)(1u << m->paramId);
+        if (!curBool)
+        {
+            held &= (uint8_t)~bit;
+            break;
+        }
+        if (held & bit)
+            break;
+        held |= bit;
+
+        // Copy what we need: the mapping belongs to the bank being left
+        const ActionTargetBankSelect sel = m->target.bankSelect;
+        uint8_t bank = sel.bank;
+        if (sel.mode == BANK_SELECT_NEXT)
+            bank = (uint8_t)((activeBank + 1) % BANK_COUNT);
+        else if (sel.mode == BANK_SELECT_PREV)
+            bank = (uint8_t)((activeBank + BANK_COUNT - 1) % BANK_COUNT);
+        selectBank(bank);
+        break;
+    }
     case ACTION_KEYBOARD:
     {
         // Fire KeyDown on rising edge, KeyUp on falling edge.
@@ -442,95 +1300,113 @@ void MappingManager::applyMapping(const Port::State *port, uint8_t pid, ModulePa
     }
 }
 
-void MappingManager::updateMapping(int r, int c, uint8_t pid, ActionType type, uint8_t d1, uint8_t d2)
+bool MappingManager::updateMapping(int r, int c, uint8_t pid, ActionType type, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t targetIndex)
 {
+    if (!keyInRange(r, c, pid, targetIndex))
+        return false;
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
 
-    for (int i = 0; i < mappingCount; i++)
+    const int pos = findPositionLocked(r, c, pid, targetIndex);
+    if (pos >= 0)
     {
-        if (mappings[i].row == r && mappings[i].col == c && mappings[i].paramId == pid)
-        {
-            releaseMappingAction(mappings[i]);
-            fillTarget(mappings[i], type, d1, d2);
-            critical_section_exit(&g_mapLock);
-            return;
-        }
+        const int idx = bankOrder[activeBank][pos];
+        releaseMappingAction(pool[idx]);
+        const Curve before = pool[idx].curve;
+        fillTarget(pool[idx], type, d1, d2, d3);
+        // fillTarget only ever replaces an uninitialized curve with linear
+        if (memcmp(&before, &pool[idx].curve, sizeof(Curve)) != 0)
+            poolLuts[idx] = g_linearLut;
+        resetFilterLocked(idx);
+        markDirtyLocked(activeBank);
+        critical_section_exit(&g_mapLock);
+        return true;
     }
 
-    if (mappingCount < 32)
+    ModuleMapping m = {};
+    m.row = r;
+    m.col = c;
+    m.paramId = pid;
+    m.targetIndex = targetIndex;
+    fillTarget(m, type, d1, d2, d3);
+    const int idx = insertLocked(activeBank, m);
+    if (idx >= 0)
     {
-        ModuleMapping &m = mappings[mappingCount++];
-        m.row = r;
-        m.col = c;
-        m.paramId = pid;
-        fillTarget(m, type, d1, d2);
+        poolLuts[idx] = g_linearLut;
+        markDirtyLocked(activeBank);
     }
 
     critical_section_exit(&g_mapLock);
+    return idx >= 0;
 }
 
-void MappingManager::updateMappingCurve(int r, int c, uint8_t pid, const Curve &curve)
+bool MappingManager::updateMappingCurve(int r, int c, uint8_t pid, const Curve &curve, uint8_t targetIndex)
 {
+    if (!keyInRange(r, c, pid, targetIndex))
+        return false;
     initLockOnce();
+    CurveLut lut;
+    CurveEvaluator::compile(curve, lut);
     critical_section_enter_blocking(&g_mapLock);
 
-    for (int i = 0; i < mappingCount; i++)
+    // A curve alone does not create a mapping: updateMapping() comes first
+    const int pos = findPositionLocked(r, c, pid, targetIndex);
+    if (pos >= 0)
     {
-        if (mappings[i].row == r && mappings[i].col == c && mappings[i].paramId == pid)
-        {
-            mappings[i].curve = curve;
-            critical_section_exit(&g_mapLock);
-            return;
-        }
+        const int idx = bankOrder[activeBank][pos];
+        pool[idx].curve = curve;
+        poolLuts[idx] = lut;
+        markDirtyLocked(activeBank);
     }
-    // If not found, we don't create it just for curve.
-    // User must create mapping first.
     critical_section_exit(&g_mapLock);
+    return pos >= 0;
 }
 
-bool MappingManager::deleteMapping(int r, int c, uint8_t pid)
+bool MappingManager::updateMappingOptions(int r, int c, uint8_t pid, const MappingOptions &options, uint8_t targetIndex)
 {
+    if (!keyInRange(r, c, pid, targetIndex))
+        return false;
     initLockOnce();
     critical_section_enter_blocking(&g_mapLock);
 
-    for (int i = 0; i < mappingCount; i++)
+    const int pos = findPositionLocked(r, c, pid, targetIndex);
+    if (pos >= 0)
     {
-        if (mappings[i].row == r && mappings[i].col == c && mappings[i].paramId == pid)
-        {
-            releaseMappingAction(mappings[i]);
-            // swap-remove
-            if (i != mappingCount - 1)
-            {
-                mappings[i] = mappings[mappingCount - 1];
-            }
-            mappingCount--;
-            critical_section_exit(&g_mapLock);
-            return true;
-        }
+        const int idx = bankOrder[activeBank][pos];
+        pool[idx].options = options;
+        resetFilterLocked(idx);
+        markDirtyLocked(activeBank);
+    }
+    critical_section_exit(&g_mapLock);
+    return pos >= 0;
+}
+
+bool MappingManager::deleteMapping(int r, int c, uint8_t pid, uint8_t targetIndex)
+{
+    initLockOnce();
+    critical_section_enter_blocking(&g_mapLock);
+
+    const int pos = findPositionLocked(r, c, pid, targetIndex);
+    if (pos >= 0)
+    {
+        removeAtLocked(pos);
+        markDirtyLocked(activeBank);
     }
 
     critical_section_exit(&g_mapLock);
-    return false;
+    return pos >= 0;
 }
 
 bool MappingManager::hexToCurve(uint8_t *data, Curve *outCurve)
 {
-    // Format: h (int16_t little-endian, 2 bytes)
-    outCurve->h = static_cast<int16_t>(data[0] | (data[1] << 8));
-    return true;
+    // Format: packed Curve, h (int16_t LE) + count + points[4] + controls[3]
+    memcpy(outCurve, data, sizeof(Curve));
+    return CurveEvaluator::isValid(*outCurve);
 }
 
 bool MappingManager::curveToHex(const Curve &curve, uint8_t *outData)
 {
-    // Format: h (int16_t little-endian, 2 bytes)
-    outData[0] = static_cast<uint8_t>(curve.h & 0xFF);
-    outData[1] = static_cast<uint8_t>((curve.h >> 8) & 0xFF);
+    // Format: packed Curve, h (int16_t LE) + count + points[4] + controls[3]
+    memcpy(outData, &curve, sizeof(Curve));
     return true;
 }
-
-ModuleMapping *MappingManager::getAllMappings()
-{
-    ModuleMapping *out = mappings;
-    return out;
-}
\ No newline at end of file
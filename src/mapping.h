@@ -1,34 +1,102 @@
 #pragma once
 #include "module_mapping_config.h"
+#include "boardconfig.h"
 
 class MappingManager
 {
+public:
+    static constexpr int BANK_COUNT = 8;
+    // Mappings one bank can hold, and all banks together
+    static constexpr int BANK_CAPACITY = 64;
+    static constexpr int POOL_SIZE = 128;
+    static constexpr int PARAMS_PER_MODULE = 8;
+    // Mappings one setMappings() call (and so one BULK_SET frame) takes. Set by
+    // the USB frame size, not the bank: a full bank is loaded in two batches,
+    // each its own transaction.
+    static constexpr int MAX_BATCH = 32;
+
 private:
-    static ModuleMapping mappings[32];
-    static int mappingCount;
+    // All banks share one fixed-block pool. A bank is a list of pool indices
+    // sorted by (row, col, paramId, targetIndex), so the targets of a parameter
+    // are adjacent; entries never move while they exist.
+    static ModuleMapping pool[POOL_SIZE];
+    // Compiled curves, same index as the pool entry they belong to
+    static CurveLut poolLuts[POOL_SIZE];
+    static uint8_t bankOrder[BANK_COUNT][BANK_CAPACITY];
+    static uint8_t bankSizes[BANK_COUNT];
+    static uint8_t activeBank;
+    // Active bank: position of each parameter's first target, NO_POSITION if none
+    static constexpr uint8_t NO_POSITION = 0xFF;
+    static uint8_t paramFirst[MODULE_PORT_ROWS][MODULE_PORT_COLS][PARAMS_PER_MODULE];
+
+    // Helpers below expect g_mapLock held
+    static int findPositionLocked(int r, int c, uint8_t pid, uint8_t targetIndex);
+    // Adds `m` to `bank` in key order; returns its pool index or -1 when full.
+    static int insertLocked(uint8_t bank, const ModuleMapping &m);
+    // Releases and frees the active bank's entry at `pos`.
+    static void removeAtLocked(int pos);
+    static void reindexLocked();
 
     static void clearMappings();
+    // Sends the curve output `mapCur` (0-65535) to the mapping's target.
+    static void emitMapping(const ModuleMapping *m, uint16_t mapCur);
 
 public:
     // Safe to call multiple times.
     static void init();
 
-    // CRUD
-    static void updateMapping(int r, int c, uint8_t pid, ActionType type, uint8_t d1, uint8_t d2);
-    static void updateMappingCurve(int r, int c, uint8_t pid, const Curve &curve);
-    static bool deleteMapping(int r, int c, uint8_t pid);
+    // CRUD. A parameter drives up to MAPPING_TARGETS_PER_PARAM targets, told
+    // apart by targetIndex; calls without one address the first target.
+    // updateMapping() returns false for a key out of range or a full pool.
+    static bool updateMapping(int r, int c, uint8_t pid, ActionType type, uint8_t d1, uint8_t d2, uint8_t d3 = 0, uint8_t targetIndex = 0);
+    // The curve and options setters return false when there is no such mapping.
+    static bool updateMappingCurve(int r, int c, uint8_t pid, const Curve &curve, uint8_t targetIndex = 0);
+    static bool updateMappingOptions(int r, int c, uint8_t pid, const MappingOptions &options, uint8_t targetIndex = 0);
+    static bool deleteMapping(int r, int c, uint8_t pid, uint8_t targetIndex = 0);
     static void clearAll();
     static void clearMappingsForPort(int r, int c);
+    // Module unplugged: release held actions but keep the mappings, they are
+    // pushed back when a module answers on that port again.
+    static void releaseMappingsForPort(int r, int c);
+    static bool hasMappingsForPort(int r, int c);
     static void addMapping(int r, int c, const ModuleMapping &m);
-    static const ModuleMapping *findMapping(int r, int c, uint8_t pid);
+    // Insert or replace `n` mappings as one transaction: either all of them are
+    // applied under a single lock, or none are (returns false when they don't fit).
+    static bool setMappings(const ModuleMapping *batch, int n);
+    static const ModuleMapping *findMapping(int r, int c, uint8_t pid, uint8_t targetIndex = 0);
+
+    // Banks. CRUD, introspection and execution operate on the active bank.
+    // Switching swaps the active index list, releases the old bank's held actions and
+    // does not touch the modules. Call from core1 (the mapping executor) only.
+    static void selectBank(uint8_t bank);
+    static uint8_t getActiveBank();
+    static int bankCount(uint8_t bank);
+
+    // Persistence (MappingStore). Every CRUD call marks its bank dirty.
+    static uint32_t takeDirtyBanks();
+    static void markBanksDirty(uint32_t mask);
+    static uint32_t lastChangeMs();
+    // Changes with every edit of the active bank and every bank switch, so
+    // readers on core0 can cache derived tables (MidiRouter).
+    static uint32_t generation();
+    // Copies `bank` into out[BANK_CAPACITY] under the lock, returns the mapping count.
+    static int snapshotBank(uint8_t bank, ModuleMapping *out);
+    // Boot only (before ports run): replaces `bank` without marking it dirty.
+    // Entries beyond the bank or pool capacity are dropped.
+    static void loadBank(uint8_t bank, const ModuleMapping *in, int n);
 
     // Execution
     static void applyMapping(const Port::State *port, uint8_t pid, ModuleParameterDataType dt, const ModuleParameterValue &cur);
+    // Core1 loop: advances smoothing/slew of the active bank once per millisecond.
+    static void tick();
+    // Core1: MIDI feedback for a parameter, `value` normalized 0-65535. Only
+    // writable parameters are written; the curve is not inverted.
+    static void applyFeedback(const Port::State *port, uint8_t pid, uint16_t value);
 
     // Introspection (for config UI)
     static int count();
+    // Active bank in key order. The pointer stays valid until that mapping is removed.
     static const ModuleMapping *getByIndex(int idx);
-    static ModuleMapping *getAllMappings();
 
     // Utility
     static bool hexToCurve(uint8_t *data, Curve *outCurve);
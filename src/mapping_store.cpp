@@ -0,0 +1,531 @@
+#include "mapping_store.h"
+
+#include <Arduino.h>
+#include <cstddef>
+#include <cstring>
+#include <hardware/flash.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+
+#include "mapping.h"
+#include "debug_printf.h"
+#include "stats.h"
+
+// Filesystem partition reserved by board_build.filesystem_size (linker symbols)
+extern "C" uint8_t _FS_start;
+extern "C" uint8_t _FS_end;
+
+namespace
+{
+    constexpr uint32_t AREA_MAGIC = 0x50434D41;   // "AMCP"
+    constexpr uint32_t RECORD_MAGIC = 0x50434D52; // "RMCP"
+    constexpr uint32_t PAGES_PER_SECTOR = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+
+    // Write dirty banks only after edits have been quiet this long
+    constexpr uint32_t COMMIT_QUIET_MS = 2000;
+    // How long core0 waits for core1 to park before retrying later
+    constexpr uint32_t PARK_TIMEOUT_US = 50000;
+    // Back-off after a failed commit so core0 doesn't keep spinning on the park
+    constexpr uint32_t RETRY_DELAY_MS = 500;
+    // Sector erases park core1 for tens of milliseconds, so they wait until no
+    // module frame has gone either way for this long...
+    constexpr uint32_t IDLE_MS = 1000;
+    // ...but a commit held back by that waits at most this long
+    constexpr uint32_t ERASE_DEFER_MAX_MS = 30000;
+
+#pragma pack(push, 1)
+    struct AreaHeader
+    {
+        uint32_t magic;
+        uint32_t generation; // highest valid generation is the active area
+        uint32_t check;      // ~(magic ^ generation)
+    };
+
+    struct RecordHeader
+    {
+        uint32_t magic;
+        uint32_t generation; // must match the area, older data is stale
+        uint32_t seq;        // increases with every record written
+        uint8_t bank;
+        uint8_t count;
+        uint8_t mappingSize; // sizeof(ModuleMapping) at write time
+        uint8_t pages;       // record length in flash pages
+        uint16_t crc;        // CRC16 over the header (crc = 0) and the mappings
+        uint16_t reserved;
+    };
+#pragma pack(pop)
+
+    constexpr uint32_t RECORD_MAX_PAGES = 9;
+    // Oldest layout still restored: ModuleMapping before MappingOptions was
+    // appended. Shorter records are widened with zeroed (default) fields.
+    constexpr size_t MAPPING_SIZE_MIN = offsetof(ModuleMapping, options);
+    static_assert(sizeof(RecordHeader) + MappingManager::BANK_CAPACITY * sizeof(ModuleMapping) <= RECORD_MAX_PAGES * FLASH_PAGE_SIZE,
+                  "a bank must fit in RECORD_MAX_PAGES");
+
+    struct Journal
+    {
+        bool usable;
+        uint32_t regionOffset; // flash offset of the partition
+        uint32_t areaPages;
+        uint8_t activeArea;    // 0/1
+        bool hasActiveArea;
+        uint32_t generation;
+        uint32_t nextSeq;
+        uint32_t writePage;    // next free page in the active area
+        uint32_t erasedEnd;    // pages below this are known erased (at/after writePage)
+        uint32_t retryAtMs;    // non-zero after a failed commit
+    };
+
+    // When erasing is allowed, and the measured core1 park times
+    struct Pacing
+    {
+        bool waiting;          // dirty banks held back until erasing is allowed
+        uint32_t waitingSinceMs;
+        uint32_t activity;     // module frames in and out, as of activeMs
+        uint32_t activeMs;
+        uint32_t programParkMaxUs;
+        uint32_t eraseParkMaxUs;
+    };
+
+    static Journal g_journal{};
+    static Pacing g_pacing{};
+    static uint8_t g_pageBuf[RECORD_MAX_PAGES * FLASH_PAGE_SIZE];
+
+    // Core0/core1 handshake around flash operations
+    static volatile bool g_parkRequest = false;
+    static volatile bool g_parked = false;
+
+    static uint16_t crc16Update(uint16_t crc, uint8_t data)
+    {
+        crc ^= (static_cast<uint16_t>(data) << 8);
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+        return crc;
+    }
+
+    static uint16_t crc16(const uint8_t *data, size_t len)
+    {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < len; i++)
+        {
+            crc = crc16Update(crc, data[i]);
+        }
+        return crc;
+    }
+
+    static uint32_t areaOffset(uint8_t area)
+    {
+        return g_journal.regionOffset + area * g_journal.areaPages * FLASH_PAGE_SIZE;
+    }
+
+    static const uint8_t *pagePtr(uint8_t area, uint32_t page)
+    {
+        return reinterpret_cast<const uint8_t *>(XIP_BASE + areaOffset(area) + page * FLASH_PAGE_SIZE);
+    }
+
+    static bool pageIsBlank(uint8_t area, uint32_t page)
+    {
+        const uint32_t *p = reinterpret_cast<const uint32_t *>(pagePtr(area, page));
+        for (uint32_t i = 0; i < FLASH_PAGE_SIZE / sizeof(uint32_t); i++)
+        {
+            if (p[i] != 0xFFFFFFFFu)
+                return false;
+        }
+        return true;
+    }
+
+    static bool readAreaHeader(uint8_t area, uint32_t &generation)
+    {
+        AreaHeader h;
+        memcpy(&h, pagePtr(area, 0), sizeof(h));
+        if (h.magic != AREA_MAGIC || h.check != ~(h.magic ^ h.generation))
+            return false;
+        generation = h.generation;
+        return true;
+    }
+
+    // Returns the record at `page` if it is valid for the active generation.
+    static const RecordHeader *readRecord(uint32_t page)
+    {
+        if (page + 1 > g_journal.areaPages)
+            return nullptr;
+        const uint8_t *base = pagePtr(g_journal.activeArea, page);
+        const RecordHeader *h = reinterpret_cast<const RecordHeader *>(base);
+        if (h->magic != RECORD_MAGIC || h->generation != g_journal.generation)
+            return nullptr;
+        if (h->pages == 0 || h->pages > RECORD_MAX_PAGES || page + h->pages > g_journal.areaPages)
+            return nullptr;
+        if (h->mappingSize < MAPPING_SIZE_MIN || h->mappingSize > sizeof(ModuleMapping) || h->count > MappingManager::BANK_CAPACITY || h->bank >= MappingManager::BANK_COUNT)
+            return nullptr;
+
+        RecordHeader copy;
+        memcpy(&copy, h, sizeof(copy));
+        copy.crc = 0;
+        uint16_t crc = crc16(reinterpret_cast<const uint8_t *>(&copy), sizeof(copy));
+        const uint8_t *data = base + sizeof(RecordHeader);
+        for (size_t i = 0; i < h->count * h->mappingSize; i++)
+        {
+            crc = crc16Update(crc, data[i]);
+        }
+        return crc == h->crc ? h : nullptr;
+    }
+
+    // Runs `op` with core1 parked in RAM and this core's interrupts disabled.
+    // The time core1 spent parked goes into `parkMaxUs` if it is a new worst case.
+    template <typename Op>
+    static bool withFlashExclusive(uint32_t &parkMaxUs, Op op)
+    {
+        // A previous park must have fully ended before we ask again
+        while (g_parked)
+        {
+            tight_loop_contents();
+        }
+
+        g_parkRequest = true;
+        __dmb();
+        const uint32_t start = time_us_32();
+        while (!g_parked)
+        {
+            if (time_us_32() - start > PARK_TIMEOUT_US)
+            {
+                g_parkRequest = false;
+                return false; // Core1 is busy (e.g. long TX), retry on a later task()
+            }
+            tight_loop_contents();
+        }
+
+        const uint32_t parkedAt = time_us_32();
+        const uint32_t irq = save_and_disable_interrupts();
+        op();
+        restore_interrupts(irq);
+
+        __dmb();
+        g_parkRequest = false;
+        const uint32_t parkedUs = time_us_32() - parkedAt;
+        if (parkedUs > parkMaxUs)
+        {
+            parkMaxUs = parkedUs;
+            LOG_INFO(LOG_STORE, "MappingStore: core1 parked %lu us\n", (unsigned long)parkedUs);
+        }
+        return true;
+    }
+
+    static bool eraseSector(uint8_t area, uint32_t sector)
+    {
+        const uint32_t offset = areaOffset(area) + sector * FLASH_SECTOR_SIZE;
+        return withFlashExclusive(g_pacing.eraseParkMaxUs, [offset]()
+                                  { flash_range_erase(offset, FLASH_SECTOR_SIZE); });
+    }
+
+    // One park per page, so core1 never stalls for more than one page program.
+    // Returns the number of pages written.
+    static uint32_t programPages(uint8_t area, uint32_t page, const uint8_t *data, uint32_t pages)
+    {
+        for (uint32_t i = 0; i < pages; i++)
+        {
+            const uint32_t offset = areaOffset(area) + (page + i) * FLASH_PAGE_SIZE;
+            const uint8_t *src = data + i * FLASH_PAGE_SIZE;
+            if (!withFlashExclusive(g_pacing.programParkMaxUs, [offset, src]()
+                                    { flash_range_program(offset, src, FLASH_PAGE_SIZE); }))
+                return i;
+        }
+        return pages;
+    }
+
+    // Make sure pages [page, page + pages) of the active area are erased.
+    // Without allowErase, fails instead of erasing.
+    static bool ensureErased(uint32_t page, uint32_t pages, bool allowErase)
+    {
+        while (g_journal.erasedEnd < page + pages)
+        {
+            const uint32_t sector = g_journal.erasedEnd / PAGES_PER_SECTOR;
+            if (!allowErase || !eraseSector(g_journal.activeArea, sector))
+                return false;
+            g_journal.erasedEnd = (sector + 1) * PAGES_PER_SECTOR;
+        }
+        return true;
+    }
+
+    // Serialize the current content of `bank` into g_pageBuf; returns its page count.
+    static uint32_t buildRecord(uint8_t bank)
+    {
+        static ModuleMapping snapshot[MappingManager::BANK_CAPACITY];
+        const int count = MappingManager::snapshotBank(bank, snapshot);
+
+        RecordHeader h{};
+        h.magic = RECORD_MAGIC;
+        h.generation = g_journal.generation;
+        h.seq = g_journal.nextSeq;
+        h.bank = bank;
+        h.count = static_cast<uint8_t>(count);
+        h.mappingSize = sizeof(ModuleMapping);
+        const size_t bytes = sizeof(RecordHeader) + count * sizeof(ModuleMapping);
+        h.pages = static_cast<uint8_t>((bytes + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE);
+        h.crc = 0;
+
+        memset(g_pageBuf, 0xFF, sizeof(g_pageBuf));
+        memcpy(&g_pageBuf[sizeof(RecordHeader)], snapshot, count * sizeof(ModuleMapping));
+        uint16_t crc = crc16(reinterpret_cast<const uint8_t *>(&h), sizeof(h));
+        for (size_t i = sizeof(RecordHeader); i < bytes; i++)
+        {
+            crc = crc16Update(crc, g_pageBuf[i]);
+        }
+        h.crc = crc;
+        memcpy(g_pageBuf, &h, sizeof(h));
+        return h.pages;
+    }
+
+    static bool appendRecord(uint8_t bank, bool allowErase)
+    {
+        const uint32_t pages = buildRecord(bank);
+        if (g_journal.writePage + pages > g_journal.areaPages)
+            return false;
+        if (!ensureErased(g_journal.writePage, pages, allowErase))
+            return false;
+        const uint32_t written = programPages(g_journal.activeArea, g_journal.writePage, g_pageBuf, pages);
+        if (written == 0)
+            return false;
+        if (written < pages)
+        {
+            // Torn record: continue at the next sector, where load() resumes
+            // scanning past it
+            g_journal.writePage = (g_journal.writePage / PAGES_PER_SECTOR + 1) * PAGES_PER_SECTOR;
+            if (g_journal.erasedEnd < g_journal.writePage)
+                g_journal.erasedEnd = g_journal.writePage;
+            return false;
+        }
+        g_journal.writePage += pages;
+        g_journal.nextSeq++;
+        return true;
+    }
+
+    // Copy every non-empty bank into the other area, then validate it by
+    // writing its header. Until then the old area stays authoritative.
+    static bool compact()
+    {
+        const uint8_t target = g_journal.hasActiveArea ? (uint8_t)(g_journal.activeArea ^ 1) : 0;
+        const Journal previous = g_journal;
+
+        g_journal.activeArea = target;
+        g_journal.generation = previous.hasActiveArea ? previous.generation + 1 : 1;
+        g_journal.writePage = 1;
+        g_journal.erasedEnd = 0;
+
+        bool ok = ensureErased(0, 1, true);
+        for (uint8_t bank = 0; ok && bank < MappingManager::BANK_COUNT; bank++)
+        {
+            if (MappingManager::bankCount(bank) > 0)
+                ok = appendRecord(bank, true);
+        }
+        if (ok)
+        {
+            memset(g_pageBuf, 0xFF, FLASH_PAGE_SIZE);
+            AreaHeader h{AREA_MAGIC, g_journal.generation, ~(AREA_MAGIC ^ g_journal.generation)};
+            memcpy(g_pageBuf, &h, sizeof(h));
+            ok = programPages(target, 0, g_pageBuf, 1) == 1;
+        }
+        if (!ok)
+        {
+            g_journal = previous;
+            return false;
+        }
+        g_journal.hasActiveArea = true;
+        LOG_INFO(LOG_STORE, "MappingStore: compacted into area %d gen %lu\n", target, (unsigned long)g_journal.generation);
+        return true;
+    }
+
+    // Module frames received and sent on all ports; core1 owns the counters
+    static uint32_t portActivity()
+    {
+        uint32_t frames = 0;
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                frames += Stats::g_ports[r][c].rxFrames + Stats::g_ports[r][c].txFrames;
+            }
+        }
+        return frames;
+    }
+
+    // A sector erase may park core1 now: the ports have been idle for a while,
+    // or a commit has been held back long enough.
+    static bool eraseAllowed(uint32_t now)
+    {
+        if (now - g_pacing.activeMs >= IDLE_MS)
+            return true;
+        return g_pacing.waiting && now - g_pacing.waitingSinceMs >= ERASE_DEFER_MAX_MS;
+    }
+
+    // Keep `banks` dirty and try again later
+    static void holdBack(uint32_t banks, uint32_t now)
+    {
+        MappingManager::markBanksDirty(banks);
+        g_journal.retryAtMs = now + RETRY_DELAY_MS;
+        if (!g_pacing.waiting)
+        {
+            g_pacing.waiting = true;
+            g_pacing.waitingSinceMs = now;
+        }
+    }
+}
+
+namespace MappingStore
+{
+    void load()
+    {
+        g_journal = Journal{};
+        const uint32_t start = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&_FS_start));
+        const uint32_t end = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&_FS_end));
+        const uint32_t areaBytes = ((end - start) / 2) & ~(FLASH_SECTOR_SIZE - 1);
+        if (end <= start || areaBytes < 2 * FLASH_SECTOR_SIZE)
+        {
+            LOG_WARN(LOG_STORE, "MappingStore: no flash partition, mappings are not persisted\n");
+            return;
+        }
+        g_journal.usable = true;
+        g_journal.regionOffset = start - XIP_BASE;
+        g_journal.areaPages = areaBytes / FLASH_PAGE_SIZE;
+        g_journal.nextSeq = 1;
+
+        uint32_t gen[2];
+        const bool valid[2] = {readAreaHeader(0, gen[0]), readAreaHeader(1, gen[1])};
+        if (!valid[0] && !valid[1])
+        {
+            LOG_INFO(LOG_STORE, "MappingStore: empty journal\n");
+            return; // First commit compacts into area 0
+        }
+        g_journal.hasActiveArea = true;
+        g_journal.activeArea = (valid[0] && (!valid[1] || gen[0] > gen[1])) ? 0 : 1;
+        g_journal.generation = gen[g_journal.activeArea];
+
+        // Replay: later records of a bank supersede earlier ones. A page that
+        // is neither a record nor blank is a torn write (or stale data in a
+        // sector not yet erased this generation); the journal went on at the
+        // next sector, so scanning does too. Only a blank page ends it.
+        int restored = 0;
+        uint32_t page = 1;
+        uint32_t journalEnd = 1; // just past the last valid record
+        while (page < g_journal.areaPages)
+        {
+            const RecordHeader *h = readRecord(page);
+            if (!h)
+            {
+                if (pageIsBlank(g_journal.activeArea, page))
+                    break;
+                page = (page / PAGES_PER_SECTOR + 1) * PAGES_PER_SECTOR;
+                continue;
+            }
+            static ModuleMapping widened[MappingManager::BANK_CAPACITY];
+            const uint8_t *src = reinterpret_cast<const uint8_t *>(h + 1);
+            for (int i = 0; i < h->count; i++)
+            {
+                widened[i] = {};
+                memcpy(&widened[i], src + i * h->mappingSize, h->mappingSize);
+            }
+            MappingManager::loadBank(h->bank, widened, h->count);
+            if (h->seq >= g_journal.nextSeq)
+                g_journal.nextSeq = h->seq + 1;
+            page += h->pages;
+            journalEnd = page;
+            restored++;
+        }
+        g_journal.writePage = journalEnd;
+
+        // The sector holding the last record was erased in this generation, so
+        // the rest of it is blank; anything else (a torn write or stale data)
+        // moves the journal to the next sector, which is erased before use.
+        if (journalEnd < g_journal.areaPages && journalEnd % PAGES_PER_SECTOR != 0 && pageIsBlank(g_journal.activeArea, journalEnd))
+        {
+            g_journal.erasedEnd = (journalEnd / PAGES_PER_SECTOR + 1) * PAGES_PER_SECTOR;
+        }
+        else
+        {
+            g_journal.writePage = (journalEnd + PAGES_PER_SECTOR - 1) / PAGES_PER_SECTOR * PAGES_PER_SECTOR;
+            g_journal.erasedEnd = g_journal.writePage;
+        }
+        LOG_INFO(LOG_STORE, "MappingStore: area %d gen %lu, %d records replayed\n",
+                   g_journal.activeArea, (unsigned long)g_journal.generation, restored);
+    }
+
+    void task()
+    {
+        if (!g_journal.usable)
+            return;
+        const uint32_t now = millis();
+        const uint32_t activity = portActivity();
+        if (activity != g_pacing.activity)
+        {
+            g_pacing.activity = activity;
+            g_pacing.activeMs = now;
+        }
+        if (now - MappingManager::lastChangeMs() < COMMIT_QUIET_MS)
+            return;
+        if (g_journal.retryAtMs && (int32_t)(now - g_journal.retryAtMs) < 0)
+            return;
+        g_journal.retryAtMs = 0;
+        const bool allowErase = eraseAllowed(now);
+        const uint32_t dirty = MappingManager::takeDirtyBanks();
+        if (dirty == 0)
+        {
+            // Erase ahead while idle, so the next record only needs programming
+            if (allowErase && g_journal.hasActiveArea && g_journal.writePage + RECORD_MAX_PAGES <= g_journal.areaPages &&
+                !ensureErased(g_journal.writePage, RECORD_MAX_PAGES, true))
+            {
+                g_journal.retryAtMs = now + RETRY_DELAY_MS;
+            }
+            return;
+        }
+
+        // No area yet, or the active one can't take another full record:
+        // compaction rewrites every bank, dirty or not.
+        if (!g_journal.hasActiveArea || g_journal.writePage + RECORD_MAX_PAGES > g_journal.areaPages)
+        {
+            if (!allowErase || !compact())
+            {
+                holdBack(dirty, now);
+                return;
+            }
+            g_pacing.waiting = false;
+            return;
+        }
+
+        for (uint8_t bank = 0; bank < MappingManager::BANK_COUNT; bank++)
+        {
+            if ((dirty & (1u << bank)) && !appendRecord(bank, allowErase))
+            {
+                // Core1 busy, a torn write or no erased room yet: retry this
+                // and the remaining banks later
+                holdBack(dirty & ~((1u << bank) - 1), now);
+                return;
+            }
+        }
+        g_pacing.waiting = false;
+    }
+
+    uint32_t programParkMaxUs()
+    {
+        return g_pacing.programParkMaxUs;
+    }
+
+    uint32_t eraseParkMaxUs()
+    {
+        return g_pacing.eraseParkMaxUs;
+    }
+
+    void __not_in_flash_func(serviceFlashPark)()
+    {
+        if (!g_parkRequest)
+            return;
+        g_parked = true;
+        __dmb();
+        while (g_parkRequest)
+        {
+            tight_loop_contents();
+        }
+        __dmb();
+        g_parked = false;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+
+// Host-side persistence of the mapping banks in the (otherwise unused)
+// filesystem partition, as an append-only journal of bank snapshots.
+//
+// Layout: the partition is split into two areas used alternately. Each area
+// starts with a header page (written last, after compaction has copied the
+// live records) followed by page-aligned records, one full bank per record.
+// The newest record of a bank wins at load. A torn record sends the journal on
+// to the next sector, and load skips past it to the records written there.
+// Sectors are erased only as the journal grows into them; when an area is full,
+// the live banks are compacted into the other area, which spreads erases over
+// the whole partition.
+//
+// Flash is only written from core0. While a page is programmed or a sector is
+// erased, core1 parks in a RAM loop with its interrupts enabled, so the
+// RAM-resident PIO RX path and the shared-SM rotation timer keep running
+// (tools/check_ram_isr.py checks that they stay in RAM). Each park covers one
+// flash operation:
+// - a page program, ~0.4 ms (W25Q16JV tPP, 3 ms worst case); records are
+//   programmed a page at a time
+// - a sector erase, ~45 ms (tSE, 400 ms worst case). Sectors are erased ahead
+//   of the journal while no module frames are moving, so a commit normally
+//   only programs. A commit that finds no erased room waits for such an idle
+//   second, for at most 30 s, before it erases anyway.
+namespace MappingStore
+{
+    // Core1, before Port::init(): restore all banks so mappings are live
+    // before any module answers.
+    void load();
+
+    // Core0 loop: writes dirty banks once mapping edits have been quiet for a while.
+    void task();
+
+    // Core1 loop: parks in RAM while core0 has the flash busy.
+    void serviceFlashPark();
+
+    // Longest core1 park so far in microseconds, for a page program and for a
+    // sector erase. A new worst case is also logged (LOG_STORE).
+    uint32_t programParkMaxUs();
+    uint32_t eraseParkMaxUs();
+}
@@ -0,0 +1,141 @@
+#include "midi_router.h"
+
+#include "ipc.hpp"
+#include "mapping.h"
+
+namespace MidiRouter
+{
+    enum RouteKind : uint8_t
+    {
+        ROUTE_NOTE = 0,
+        ROUTE_CC,
+        ROUTE_PITCH_BEND
+    };
+
+    // Open-addressing hash of (kind, channel, number) -> parameter. At most
+    // BANK_CAPACITY mappings, so twice the buckets keep the load factor at or below 1/2.
+    // Several mappings may share a key; lookup visits every match.
+    static constexpr int ROUTE_BUCKETS = 2 * MappingManager::BANK_CAPACITY;
+    static_assert(ROUTE_BUCKETS == 128, "bucketOf() takes the top 7 bits");
+    static constexpr uint16_t ROUTE_EMPTY = 0xFFFF;
+
+    struct Route
+    {
+        uint16_t key;
+        int8_t row;
+        int8_t col;
+        uint8_t paramId;
+    };
+
+    static Route g_routes[ROUTE_BUCKETS];
+    static uint32_t g_builtGeneration = 0;
+    static bool g_built = false;
+
+    static uint16_t makeKey(RouteKind kind, uint8_t channel, uint8_t number)
+    {
+        return (uint16_t)((kind << 11) | ((channel & 0x0F) << 7) | (number & 0x7F));
+    }
+
+    static uint32_t bucketOf(uint16_t key)
+    {
+        // Fibonacci hashing, top 7 bits of a 16-bit product
+        return ((uint32_t)key * 40503u >> 9) & (ROUTE_BUCKETS - 1);
+    }
+
+    static void insert(uint16_t key, const ModuleMapping &m)
+    {
+        for (uint32_t i = 0, b = bucketOf(key); i < ROUTE_BUCKETS; i++, b = (b + 1) & (ROUTE_BUCKETS - 1))
+        {
+            if (g_routes[b].key == ROUTE_EMPTY)
+            {
+                g_routes[b] = {key, (int8_t)m.row, (int8_t)m.col, m.paramId};
+                return;
+            }
+        }
+    }
+
+    static bool routeOf(const ModuleMapping &m, uint16_t &key)
+    {
+        // Channels are stored 1-16
+        const uint8_t ch = m.target.midiCC.channel > 0 ? m.target.midiCC.channel - 1 : 0;
+        switch (m.type)
+        {
+        case ACTION_MIDI_NOTE:
+            key = makeKey(ROUTE_NOTE, ch, m.target.midiNote.noteNumber);
+            return true;
+        case ACTION_MIDI_CC:
+            key = makeKey(ROUTE_CC, ch, m.target.midiCC.ccNumber);
+            return true;
+        case ACTION_MIDI_MOD_WHEEL:
+            key = makeKey(ROUTE_CC, ch, 1); // MSB only, LSB (CC33) is ignored
+            return true;
+        case ACTION_MIDI_PITCH_BEND:
+            key = makeKey(ROUTE_PITCH_BEND, ch, 0);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Rebuild from the active bank when it changed since the last build.
+    static void refresh()
+    {
+        const uint32_t gen = MappingManager::generation();
+        if (g_built && gen == g_builtGeneration)
+            return;
+
+        static ModuleMapping snapshot[MappingManager::BANK_CAPACITY];
+        const int n = MappingManager::snapshotBank(MappingManager::getActiveBank(), snapshot);
+        for (int b = 0; b < ROUTE_BUCKETS; b++)
+        {
+            g_routes[b].key = ROUTE_EMPTY;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            uint16_t key;
+            if (snapshot[i].row >= 0 && snapshot[i].col >= 0 && routeOf(snapshot[i], key))
+                insert(key, snapshot[i]);
+        }
+        // Generation read before the snapshot: a change in between rebuilds again
+        g_builtGeneration = gen;
+        g_built = true;
+    }
+
+    void handlePacket(const uint8_t packet[4])
+    {
+        // packet: cable/CIN, status, data1, data2
+        const uint8_t status = packet[1];
+        const uint8_t channel = status & 0x0F;
+        uint16_t key;
+        uint16_t value;
+        switch (status & 0xF0)
+        {
+        case 0x90: // Note On, velocity as value (0 = off)
+        case 0x80: // Note Off
+            key = makeKey(ROUTE_NOTE, channel, packet[2]);
+            value = (status & 0xF0) == 0x90 ? (uint16_t)(((packet[3] & 0x7F) * 65535u + 63) / 127) : 0;
+            break;
+        case 0xB0:
+            key = makeKey(ROUTE_CC, channel, packet[2]);
+            value = (uint16_t)(((packet[3] & 0x7F) * 65535u + 63) / 127);
+            break;
+        case 0xE0:
+        {
+            key = makeKey(ROUTE_PITCH_BEND, channel, 0);
+            const uint32_t v14 = (uint32_t)(packet[2] & 0x7F) | ((uint32_t)(packet[3] & 0x7F) << 7);
+            value = (uint16_t)((v14 * 65535u + 8191) / 16383);
+            break;
+        }
+        default:
+            return;
+        }
+
+        refresh();
+        for (uint32_t i = 0, b = bucketOf(key); i < ROUTE_BUCKETS && g_routes[b].key != ROUTE_EMPTY;
+             i++, b = (b + 1) & (ROUTE_BUCKETS - 1))
+        {
+            if (g_routes[b].key == key)
+                IPC::postParameterWrite(g_routes[b].row, g_routes[b].col, g_routes[b].paramId, value);
+        }
+    }
+}
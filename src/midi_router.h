@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Inbound MIDI to module parameters (core0). Every Note, CC, mod wheel and
+// pitch bend mapping of the active bank also works in reverse: a message the
+// host sends on the mapping's channel and number is posted as a write to the
+// mapped parameter (IPC::postParameterWrite), so DAW state shows up on module
+// LEDs and motorized controls.
+namespace MidiRouter
+{
+    // One USB-MIDI event packet received from the host.
+    void handlePacket(const uint8_t packet[4]);
+}
@@ -0,0 +1,34 @@
+#include "midi_state.h"
+
+#include <cstring>
+
+namespace MidiState
+{
+    static volatile uint8_t g_control[16][128];
+
+    // USB-MIDI code index number of a Control Change event
+    static constexpr uint8_t CIN_CONTROL_CHANGE = 0x0B;
+
+    void init()
+    {
+        memset((void *)g_control, UNKNOWN, sizeof(g_control));
+    }
+
+    void setControl(uint8_t channel, uint8_t controller, uint8_t value)
+    {
+        g_control[channel & 0x0F][controller & 0x7F] = value & 0x7F;
+    }
+
+    uint8_t control(uint8_t channel, uint8_t controller)
+    {
+        return g_control[channel & 0x0F][controller & 0x7F];
+    }
+
+    void handlePacket(const uint8_t packet[4])
+    {
+        // packet: cable/CIN, status, data1, data2
+        if ((packet[0] & 0x0F) != CIN_CONTROL_CHANGE || (packet[1] & 0xF0) != 0xB0)
+            return;
+        setControl(packet[1] & 0x0F, packet[2], packet[3]);
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Last known value of every MIDI controller, per channel, as seen on the USB
+// MIDI link in both directions: values the host sends us and values we send.
+// It is the host-side picture of where each parameter currently sits.
+//
+// Entries are single bytes, so core0 (MIDI input) and core1 (mapping output)
+// update and read them without locking.
+namespace MidiState
+{
+    // control() result for a controller nothing has been seen for yet
+    constexpr uint8_t UNKNOWN = 0xFF;
+
+    void init();
+
+    // channel 0-15, controller and value 0-127
+    void setControl(uint8_t channel, uint8_t controller, uint8_t value);
+    uint8_t control(uint8_t channel, uint8_t controller);
+
+    // Core0: one USB-MIDI event packet received from the host.
+    void handlePacket(const uint8_t packet[4]);
+}
@@ -10,9 +10,33 @@ enum ActionType : uint8_t
     ACTION_MIDI_CC,
     ACTION_KEYBOARD,
     ACTION_MIDI_PITCH_BEND,
-    ACTION_MIDI_MOD_WHEEL
+    ACTION_MIDI_MOD_WHEEL,
+    ACTION_BANK_SELECT,
+    ACTION_MIDI_NRPN,
+    ACTION_MIDI_RPN,
+    ACTION_MIDI_CC_RELATIVE
 };
 
+enum BankSelectMode : uint8_t
+{
+    BANK_SELECT_ABSOLUTE = 0, // switch to target.bankSelect.bank
+    BANK_SELECT_NEXT,
+    BANK_SELECT_PREV
+};
+
+// Encoding of a relative CC delta (low nibble of ActionTargetMidiRelative::mode)
+enum RelativeMode : uint8_t
+{
+    RELATIVE_TWOS_COMPLEMENT = 0, // +1 = 1, -1 = 127
+    RELATIVE_BINARY_OFFSET,       // +1 = 65, -1 = 63
+    RELATIVE_SIGN_MAGNITUDE       // +1 = 1, -1 = 65
+};
+
+static constexpr uint8_t RELATIVE_MODE_MASK = 0x0F;
+// Acceleration strength 0 (off) to 3, in the high nibble of the mode byte
+static constexpr uint8_t RELATIVE_ACCEL_SHIFT = 4;
+static constexpr uint8_t RELATIVE_ACCEL_MAX = 3;
+
 #pragma pack(push, 1)
 
 struct ActionTargetMidiNote
@@ -35,11 +59,58 @@ struct ActionTargetKeyboard
     uint8_t modifier; // bitmask
 };
 
+struct ActionTargetBankSelect
+{
+    uint8_t bank; // 0-based
+    BankSelectMode mode;
+};
+
+// 14-bit value to a (N)RPN parameter: CC 99/98 (NRPN) or 101/100 (RPN)
+// select the parameter, CC 6/38 carry the value.
+struct ActionTargetMidiParam
+{
+    uint8_t channel;  // 1-16
+    uint8_t paramMsb; // 0-127
+    uint8_t paramLsb; // 0-127
+};
+
+// Encoder steps sent as relative deltas on one CC
+struct ActionTargetMidiRelative
+{
+    uint8_t channel; // 1-16
+    uint8_t ccNumber;
+    uint8_t mode; // RelativeMode | accel << RELATIVE_ACCEL_SHIFT
+};
+
 union ActionTarget
 {
     ActionTargetMidiNote midiNote;
     ActionTargetMidiCC midiCC;
     ActionTargetKeyboard keyboard;
+    ActionTargetBankSelect bankSelect;
+    ActionTargetMidiParam midiParam;
+    ActionTargetMidiRelative midiRelative;
+};
+
+// Host-side input conditioning, applied on core1 before the curve. All zero
+// (the default) passes every value change straight through.
+static constexpr uint8_t MAPPING_SMOOTHING_MAX = 8;
+
+// One parameter can drive this many mappings (ModuleMapping::targetIndex)
+static constexpr uint8_t MAPPING_TARGETS_PER_PARAM = 4;
+
+// MappingOptions::flags
+// Soft takeover: after a bank switch or a change from the host, output stays
+// muted until the control crosses the value the host last reported (CC and
+// mod wheel targets).
+static constexpr uint8_t MAPPING_OPTION_PICKUP = 0x01;
+
+struct MappingOptions
+{
+    uint8_t deadband;  // hysteresis, in 1/1024 of full scale (0 = off)
+    uint8_t smoothing; // one-pole EMA, time constant ~2^n ms (0 = off, max MAPPING_SMOOTHING_MAX)
+    uint8_t slew;      // max travel per ms, in 1/1024 of full scale (0 = unlimited)
+    uint8_t flags;     // MAPPING_OPTION_*
 };
 
 struct ModuleMapping
@@ -56,6 +127,10 @@ struct ModuleMapping
     Curve curve;
 
     ActionTarget target;
+
+    // Appended last: records written before these existed load with zeros
+    MappingOptions options;
+    uint8_t targetIndex; // which of the parameter's targets, < MAPPING_TARGETS_PER_PARAM
 };
 
 #pragma pack(pop)
\ No newline at end of file
@@ -2,13 +2,30 @@
 #include <cstring>
 #include "usb_device.h"
 #include "mapping.h"
+#include "ipc.hpp"
 #include "debug_printf.h"
+#include "trace.h"
+#include "stats.h"
+#include "profiler.h"
+#include "hardware/sync.h"
 
-// Framing: 0xAA, commandId, payloadLenLo, payloadLenHi, payload, checksum
-static constexpr uint8_t FRAME_START = 0xAA;
+// Framing: see ModuleLinkMode in common.hpp
 static constexpr uint32_t DETECTION_DEBOUNCE_MS = 10;
 static constexpr uint32_t PING_INTERVAL_MS = 500;
 static constexpr uint32_t RESPONSE_TIMEOUT_MS = 500;
+// Ports identified and configured at once. Bring-up commands are bit-banged
+// with interrupts masked, so a full grid coming up together would otherwise
+// flood core 1; each Port::task() pass sends at most one of them.
+static constexpr int MAX_BRINGUPS = 2;
+// Unanswered GET_PROPERTIES before a port gives its slot to the next one
+static constexpr uint8_t IDENTIFY_TRIES = 4;
+// Quiet time after the last parameter write before its confirmation read
+static constexpr uint32_t CONFIRM_SETTLE_MS = 50;
+// Ports on a shared RX state machine would lose autoupdate frames sent while
+// the SM listens to a neighbour, so they are polled: one GET_PARAMETER per
+// port this often, readable parameters in turn. Each poll is a bit-banged
+// frame with interrupts masked, hence the modest rate.
+static constexpr uint32_t SHARED_POLL_MS = 20;
 
 namespace Port
 {
@@ -20,12 +37,40 @@ namespace Port
     static volatile uint8_t messageCount = 0;
 
     static uint32_t lastDetectMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
-    static uint32_t lastPingSentMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
-    static volatile uint32_t lastHeardMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    // Bring-up: detection time, place in the admission queue, last command
+    // sent, GET_PROPERTIES sent while identifying, configuring commands still
+    // to send
+    static uint32_t bringUpStartMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint32_t bringUpQueuedMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint32_t bringUpStepMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint8_t bringUpTries[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint8_t bringUpSteps[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    // Microseconds (time_us_32), written from the RX IRQ which must not touch flash
+    static volatile uint32_t lastHeardUs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
     static uint32_t lastRxHighMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
 
-    static uint8_t pendingSetParamPid[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    // SET_PARAMETER waiting for its answer: one per port at a time
     static bool pendingSetParamValid[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint32_t pendingSetParamMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+
+    // Coalesced parameter writes: latest value per parameter, a pending bit
+    // while it waits for the port, and a confirm bit until it has been read
+    // back. Core1 only.
+    static constexpr int PARAM_WRITE_SLOTS = 8;
+    static ModuleParameterValue writeValue[MODULE_PORT_ROWS][MODULE_PORT_COLS][PARAM_WRITE_SLOTS];
+    static ModuleParameterDataType writeType[MODULE_PORT_ROWS][MODULE_PORT_COLS][PARAM_WRITE_SLOTS];
+    static uint8_t writePending[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint8_t writeConfirm[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint8_t writeNext[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint32_t lastWriteMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+
+    // Shared-SM polling: last poll, and the parameter asked for next
+    static uint32_t pollMs[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint8_t pollNext[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+
+    // Ports start at generation 1 so that LIST_SINCE(0) returns every port.
+    static volatile uint32_t currentGeneration = 1;
+    static volatile uint32_t portGeneration[MODULE_PORT_ROWS][MODULE_PORT_COLS];
 
     static const char *orientationToString(ModuleOrientation o)
     {
@@ -44,7 +89,7 @@ namespace Port
         }
     }
 
-#ifdef DEBUG_MODULE_MESSAGES
+#if LOG_COMPILED(LOG_LEVEL_DEBUG, LOG_MODMSG)
     static const char *commandToStringTx(ModuleMessageId id)
     {
         switch (id)
@@ -65,6 +110,8 @@ namespace Port
             return "GET_MAPPINGS";
         case ModuleMessageId::CMD_SET_MAPPINGS:
             return "SET_MAPPINGS";
+        case ModuleMessageId::CMD_SET_LINK_MODE:
+            return "SET_LINK_MODE";
         case ModuleMessageId::CMD_RESPONSE:
             return "RESPONSE";
         default:
@@ -100,6 +147,216 @@ namespace Port
     }
 #endif
 
+    // Ask a module for the strongest framing both sides support. Properties
+    // are fetched again after a re-plug, which starts the link over.
+    static void negotiateLinkMode(const State &port)
+    {
+        if (!port.serial || port.serial->pendingLinkMode != LINK_MODE_SUM8)
+            return;
+        ModuleLinkMode mode;
+        if (port.module.capabilities & MODULE_CAP_COBS)
+            mode = LINK_MODE_COBS;
+        else if (port.module.capabilities & MODULE_CAP_CRC16)
+            mode = LINK_MODE_CRC16;
+        else
+            return;
+        // The transmitter switches TX framing once this frame is out
+        sendSetLinkMode(port.row, port.col, mode);
+    }
+
+    // Bring-up admission. A detected port waits for one of MAX_BRINGUPS slots,
+    // then goes through identification and configuration one command per
+    // pass. Ports whose mappings the host still holds (re-plugged, or restored
+    // from flash at boot) go first, then the longest waiting.
+    enum : uint8_t
+    {
+        STEP_LINK_MODE = 1u << 0,
+        STEP_AUTOUPDATE = 1u << 1,
+        STEP_GET_MAPPINGS = 1u << 2,
+    };
+
+    static bool bringUpInFlight(const State &port)
+    {
+        return port.bringUp == BringUp::IDENTIFYING || port.bringUp == BringUp::CONFIGURING || port.bringUp == BringUp::MAPPED;
+    }
+
+    static void bringUpLive(State &port, uint32_t now)
+    {
+        port.bringUp = BringUp::LIVE;
+        const uint32_t took = now - bringUpStartMs[port.row][port.col];
+        Stats::g_ports[port.row][port.col].bringUpMs = took;
+        LOG_INFO(LOG_PORT, "[PORT] r=%d c=%d live after %lu ms\n", port.row, port.col, (unsigned long)took);
+
+        if (Stats::g_gridReadyMs != 0)
+            return;
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                if (ports[r][c].bringUp != BringUp::NONE && ports[r][c].bringUp != BringUp::LIVE)
+                    return;
+            }
+        }
+        Stats::g_gridReadyMs = now ? now : 1;
+        LOG_INFO(LOG_PORT, "[PORT] grid ready %lu ms after boot\n", (unsigned long)now);
+    }
+
+    // GET_MAPPINGS answered or timed out: push the host's mappings if it has any
+    static void bringUpMapped(State &port, bool pushed, uint32_t now)
+    {
+        if (pushed)
+        {
+            port.bringUp = BringUp::MAPPED;
+            bringUpStepMs[port.row][port.col] = now;
+        }
+        else
+        {
+            bringUpLive(port, now);
+        }
+    }
+
+    // Properties are in: queue the configuration the module asks for
+    static void bringUpIdentified(State &port, uint32_t now)
+    {
+        uint8_t steps = STEP_GET_MAPPINGS;
+        if (port.module.capabilities & (MODULE_CAP_COBS | MODULE_CAP_CRC16))
+            steps |= STEP_LINK_MODE;
+        if (port.module.capabilities & MODULE_CAP_AUTOUPDATE)
+            steps |= STEP_AUTOUPDATE;
+        bringUpSteps[port.row][port.col] = steps;
+        bringUpStepMs[port.row][port.col] = now;
+        port.bringUp = BringUp::CONFIGURING;
+    }
+
+    // Sends the port's next bring-up command if one is due, handles timeouts.
+    // Returns true when something was sent.
+    static bool bringUpStep(State &port, uint32_t now)
+    {
+        const int r = port.row;
+        const int c = port.col;
+        const uint32_t since = now - bringUpStepMs[r][c];
+        switch (port.bringUp)
+        {
+        case BringUp::IDENTIFYING:
+            if (since <= PING_INTERVAL_MS)
+                return false;
+            if (bringUpTries[r][c] >= IDENTIFY_TRIES)
+            {
+                // Silent module: queue it again behind the others
+                port.bringUp = BringUp::DETECTED;
+                bringUpQueuedMs[r][c] = now;
+                return false;
+            }
+            bringUpTries[r][c]++;
+            bringUpStepMs[r][c] = now;
+            sendGetProperties(r, c);
+            return true;
+
+        case BringUp::CONFIGURING:
+        {
+            uint8_t &steps = bringUpSteps[r][c];
+            if (steps == 0)
+            {
+                // Waiting for the GET_MAPPINGS answer
+                if (since > RESPONSE_TIMEOUT_MS)
+                {
+                    const bool push = MappingManager::hasMappingsForPort(r, c);
+                    if (push)
+                        IPC::enqueueSyncMapping(r, c);
+                    bringUpMapped(port, push, now);
+                }
+                return false;
+            }
+            bringUpStepMs[r][c] = now;
+            if (steps & STEP_LINK_MODE)
+            {
+                steps &= (uint8_t)~STEP_LINK_MODE;
+                negotiateLinkMode(port);
+            }
+            else if (steps & STEP_AUTOUPDATE)
+            {
+                // On-change only, or off where the port is polled instead
+                steps &= (uint8_t)~STEP_AUTOUPDATE;
+                sendSetAutoupdate(r, c, BOARD_LAYOUT[r][c].mode != PortRx::SHARED, 0);
+            }
+            else
+            {
+                steps &= (uint8_t)~STEP_GET_MAPPINGS;
+                sendGetMappings(r, c);
+            }
+            return true;
+        }
+
+        case BringUp::MAPPED:
+            // Modules that do not acknowledge SET_MAPPINGS still go live
+            if (since > RESPONSE_TIMEOUT_MS)
+                bringUpLive(port, now);
+            return false;
+
+        default:
+            return false;
+        }
+    }
+
+    // Ports with mappings waiting for the module first, then queue order
+    static bool bringUpBefore(const State &a, bool aMapped, const State &b, bool bMapped)
+    {
+        if (aMapped != bMapped)
+            return aMapped;
+        return (int32_t)(bringUpQueuedMs[a.row][a.col] - bringUpQueuedMs[b.row][b.col]) < 0;
+    }
+
+    static void serviceBringUp(uint32_t now)
+    {
+        // Admitted ports in priority order; at most MAX_BRINGUPS of them
+        State *active[MAX_BRINGUPS];
+        bool activeMapped[MAX_BRINGUPS];
+        int inFlight = 0;
+        State *admit = nullptr;
+        bool admitMapped = false;
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                State &port = ports[r][c];
+                if (bringUpInFlight(port) && inFlight < MAX_BRINGUPS)
+                {
+                    const bool mapped = MappingManager::hasMappingsForPort(r, c);
+                    int i = inFlight++;
+                    for (; i > 0 && bringUpBefore(port, mapped, *active[i - 1], activeMapped[i - 1]); i--)
+                    {
+                        active[i] = active[i - 1];
+                        activeMapped[i] = activeMapped[i - 1];
+                    }
+                    active[i] = &port;
+                    activeMapped[i] = mapped;
+                }
+                else if (port.bringUp == BringUp::DETECTED)
+                {
+                    const bool mapped = MappingManager::hasMappingsForPort(r, c);
+                    if (!admit || bringUpBefore(port, mapped, *admit, admitMapped))
+                    {
+                        admit = &port;
+                        admitMapped = mapped;
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < inFlight; i++)
+        {
+            if (bringUpStep(*active[i], now))
+                return;
+        }
+        if (admit && inFlight < MAX_BRINGUPS)
+        {
+            admit->bringUp = BringUp::IDENTIFYING;
+            bringUpStepMs[admit->row][admit->col] = now;
+            bringUpTries[admit->row][admit->col] = 1;
+            sendGetProperties(admit->row, admit->col);
+        }
+    }
+
     static bool parseValueFromResponse(const Port::State *port, uint8_t pid, const ModuleMessageResponsePayload &resp, ModuleParameterValue &outValue)
     {
         if (!port || !port->hasModule)
@@ -188,6 +445,100 @@ namespace Port
         }
     }
 
+    static void markChanged(int r, int c)
+    {
+        const uint32_t gen = currentGeneration + 1;
+        portGeneration[r][c] = gen;
+        __dmb();
+        currentGeneration = gen;
+    }
+
+    // Sends the next coalesced write unless a SET is still unanswered. Writes
+    // arriving meanwhile replace the pending value, so a burst costs one frame
+    // per round trip rather than one per write. A write the TX queue has no
+    // room for stays pending and goes out on a later pass.
+    static bool flushParamWrite(int r, int c, uint32_t now)
+    {
+        if (pendingSetParamValid[r][c])
+        {
+            if (now - pendingSetParamMs[r][c] <= RESPONSE_TIMEOUT_MS)
+                return false;
+            pendingSetParamValid[r][c] = false; // answer lost
+        }
+        if (!writePending[r][c])
+            return false;
+        for (int i = 0; i < PARAM_WRITE_SLOTS; i++)
+        {
+            const uint8_t pid = (uint8_t)((writeNext[r][c] + i) % PARAM_WRITE_SLOTS);
+            if (!(writePending[r][c] & (1u << pid)))
+                continue;
+
+            ModuleMessageSetParameterPayload payload{};
+            payload.parameterId = pid;
+            payload.dataType = writeType[r][c][pid];
+            payload.value = writeValue[r][c][pid];
+            if (!sendMessage(r, c, ModuleMessageId::CMD_SET_PARAMETER, reinterpret_cast<uint8_t *>(&payload), sizeof(payload)))
+                return false;
+            writePending[r][c] &= (uint8_t)~(1u << pid);
+            writeConfirm[r][c] |= (uint8_t)(1u << pid);
+            writeNext[r][c] = (uint8_t)((pid + 1) % PARAM_WRITE_SLOTS);
+            pendingSetParamValid[r][c] = true;
+            pendingSetParamMs[r][c] = now;
+            return true;
+        }
+        return false;
+    }
+
+    // Once the writes to a port have settled, reads each written parameter
+    // back once; the answer corrects the optimistic cache if the module
+    // clamped or refused the value.
+    static void confirmParamWrites(int r, int c, uint32_t now)
+    {
+        if (!writeConfirm[r][c] || writePending[r][c] || pendingSetParamValid[r][c] || now - lastWriteMs[r][c] < CONFIRM_SETTLE_MS)
+            return;
+        for (uint8_t pid = 0; pid < PARAM_WRITE_SLOTS; pid++)
+        {
+            if (writeConfirm[r][c] & (1u << pid))
+            {
+                if (sendGetParameter(r, c, pid))
+                    writeConfirm[r][c] &= (uint8_t)~(1u << pid);
+                return;
+            }
+        }
+    }
+
+    // Reads the next readable parameter of a live port on a shared SM. Writes
+    // in flight go first.
+    static void pollSharedPort(int r, int c, uint32_t now)
+    {
+        const State &port = ports[r][c];
+        if (BOARD_LAYOUT[r][c].mode != PortRx::SHARED || port.bringUp != BringUp::LIVE)
+            return;
+        if (pendingSetParamValid[r][c] || writePending[r][c] || now - pollMs[r][c] < SHARED_POLL_MS)
+            return;
+        const uint8_t count = port.module.parameterCount;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const uint8_t pid = (uint8_t)((pollNext[r][c] + i) % count);
+            if (!(port.module.parameters[pid].access & ACCESS_READ))
+                continue;
+            pollNext[r][c] = (uint8_t)((pid + 1) % count);
+            pollMs[r][c] = now;
+            sendGetParameter(r, c, pid);
+            return;
+        }
+    }
+
+    static void resetParamWrites(int r, int c)
+    {
+        pendingSetParamValid[r][c] = false;
+        pendingSetParamMs[r][c] = 0;
+        writePending[r][c] = 0;
+        writeConfirm[r][c] = 0;
+        writeNext[r][c] = 0;
+        lastWriteMs[r][c] = 0;
+    }
+
     static void ensureDetectionPinModes(int r, int c)
     {
         if (portTxPins[r][c] != PORT_PIN_UNUSED)
@@ -202,16 +553,12 @@ namespace Port
 
     static void logPortInsertion(int r, int c, const State &port)
     {
-#ifdef DEBUG_MODULE_MESSAGES
-        dbg_printf("[PORT] Insert r=%d c=%d hostTX=%d hostRX=%d orientation=%s\n", r, c, port.txPin, port.rxPin, orientationToString(port.orientation));
-#endif
+        LOG_INFO(LOG_PORT, "[PORT] Insert r=%d c=%d hostTX=%d hostRX=%d orientation=%s\n", r, c, port.txPin, port.rxPin, orientationToString(port.orientation));
     }
 
     static void logPortRemoval(int r, int c, const State &port)
     {
-#ifdef DEBUG_MODULE_MESSAGES
-        dbg_printf("[PORT] Remove r=%d c=%d hostTX=%d hostRX=%d\n", r, c, port.txPin, port.rxPin);
-#endif
+        LOG_INFO(LOG_PORT, "[PORT] Remove r=%d c=%d hostTX=%d hostRX=%d\n", r, c, port.txPin, port.rxPin);
     }
 
     static uint8_t calcChecksum(const uint8_t *data, size_t len)
@@ -224,7 +571,318 @@ namespace Port
         return static_cast<uint8_t>(sum & 0xFF);
     }
 
-    extern "C" ModuleMessage *allocateMessageFromIRQ()
+    // LINK_MODE_COBS frame body: header, payload and CRC-16 back to back
+    struct CobsFrame
+    {
+        const uint8_t *header;
+        const uint8_t *payload;
+        uint16_t payloadLen;
+        const uint8_t *check;
+
+        uint32_t size() const { return 3u + payloadLen + 2u; }
+        uint8_t at(uint32_t i) const
+        {
+            if (i < 3)
+                return header[i];
+            i -= 3;
+            return i < payloadLen ? payload[i] : check[i - payloadLen];
+        }
+    };
+
+    // COBS-encode the frame into put(byte), then the 0x00 delimiter. Each
+    // block is found by looking ahead for the next zero, so nothing is buffered.
+    template <typename Put>
+    static void encodeCobs(const CobsFrame &f, Put put)
+    {
+        const uint32_t total = f.size();
+        uint32_t pos = 0;
+        for (;;)
+        {
+            uint32_t run = 0;
+            while (run < 254 && pos + run < total && f.at(pos + run) != 0)
+            {
+                run++;
+            }
+            put(static_cast<uint8_t>(run + 1));
+            for (uint32_t i = 0; i < run; i++)
+            {
+                put(f.at(pos + i));
+            }
+            pos += run;
+            if (pos >= total)
+            {
+                break;
+            }
+            if (run < 254)
+            {
+                pos++; // the zero that ended the block; a trailing one gets an empty block
+            }
+        }
+        put(0);
+    }
+
+    // Frame a command in link mode `mode` (see ModuleLinkMode) into put(byte)
+    template <typename Put>
+    static void encodeFrame(uint8_t mode, ModuleMessageId commandId, const uint8_t *payload, uint16_t payloadLen, Put put)
+    {
+        if (mode == LINK_MODE_COBS)
+        {
+            const uint8_t header[3] = {static_cast<uint8_t>(commandId), static_cast<uint8_t>(payloadLen & 0xFF), static_cast<uint8_t>((payloadLen >> 8) & 0xFF)};
+            uint16_t check = ispio_crc16(0xFFFF, header, sizeof(header));
+            if (payloadLen > 0)
+            {
+                check = ispio_crc16(check, payload, payloadLen);
+            }
+            const uint8_t checkBytes[2] = {static_cast<uint8_t>(check & 0xFF), static_cast<uint8_t>(check >> 8)};
+            encodeCobs(CobsFrame{header, payload, payloadLen, checkBytes}, put);
+            return;
+        }
+
+        const bool crc = mode == LINK_MODE_CRC16;
+        uint8_t frameHeader[4];
+        frameHeader[0] = crc ? MODULE_FRAME_START_CRC16 : MODULE_FRAME_START_SUM8;
+        frameHeader[1] = static_cast<uint8_t>(commandId);
+        frameHeader[2] = static_cast<uint8_t>(payloadLen & 0xFF);
+        frameHeader[3] = static_cast<uint8_t>((payloadLen >> 8) & 0xFF);
+
+        for (uint8_t b : frameHeader)
+        {
+            put(b);
+        }
+        for (uint16_t i = 0; i < payloadLen; i++)
+        {
+            put(payload[i]);
+        }
+        if (crc)
+        {
+            uint16_t check = ispio_crc16(0xFFFF, frameHeader, sizeof(frameHeader));
+            if (payloadLen > 0)
+            {
+                check = ispio_crc16(check, payload, payloadLen);
+            }
+            put(static_cast<uint8_t>(check & 0xFF));
+            put(static_cast<uint8_t>(check >> 8));
+        }
+        else
+        {
+            uint8_t checksum = calcChecksum(frameHeader, sizeof(frameHeader));
+            for (uint16_t i = 0; i < payloadLen; i++)
+            {
+                checksum = static_cast<uint8_t>(checksum + payload[i]);
+            }
+            put(checksum);
+        }
+    }
+
+    // Module TX. sendMessage() queues frames per port and Port::task() puts a
+    // few bytes per pass on the wire, so no caller waits out a frame at 115200
+    // baud with interrupts masked byte by byte. The next frame is picked at
+    // frame boundaries: real-time writes first, then control, then bulk
+    // mapping transfers, oldest first within a class. A command queued again
+    // while its key is still waiting replaces the queued payload in place.
+    enum TxPriority : uint8_t
+    {
+        TX_REALTIME, // parameter writes
+        TX_CONTROL,
+        TX_BULK, // SET_MAPPINGS
+    };
+
+    static constexpr int TX_QUEUE_DEPTH = 8;
+    static constexpr uint16_t TX_MAX_PAYLOAD = sizeof(ModuleMessageSetMappingsPayload);
+    // Largest framing: COBS adds a block header per 254 bytes and the delimiter
+    static constexpr uint16_t TX_FRAME_MAX = TX_MAX_PAYLOAD + 3 + 2 + 2 + (TX_MAX_PAYLOAD + 5) / 254;
+    static constexpr uint16_t TX_NO_KEY = 0xFFFF;
+    static constexpr int TX_BYTES_PER_PASS = 8;
+
+    struct TxEntry
+    {
+        uint32_t seq;
+        uint16_t key;
+        uint16_t len;
+        ModuleMessageId commandId;
+        uint8_t priority;
+        uint8_t payload[TX_MAX_PAYLOAD];
+    };
+
+    struct TxPort
+    {
+        TxEntry queue[TX_QUEUE_DEPTH]; // unordered, picked by (priority, seq)
+        uint8_t count;
+        // Frame on the wire
+        uint8_t frame[TX_FRAME_MAX];
+        uint16_t frameLen;
+        uint16_t framePos;
+    };
+
+    static TxPort txPorts[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    static uint32_t txSeq = 0;
+    static int txNextPort = 0;
+
+    static uint8_t txPriority(ModuleMessageId commandId)
+    {
+        switch (commandId)
+        {
+        case ModuleMessageId::CMD_SET_PARAMETER:
+            return TX_REALTIME;
+        case ModuleMessageId::CMD_SET_MAPPINGS:
+            return TX_BULK;
+        default:
+            return TX_CONTROL;
+        }
+    }
+
+    // Commands whose newest payload supersedes a queued one share a key:
+    // per parameter for parameter and calibration commands, per command for
+    // the idempotent rest. Order-sensitive commands are never merged.
+    static uint16_t txKey(ModuleMessageId commandId, const uint8_t *payload, uint16_t payloadLen)
+    {
+        const uint16_t cmd = static_cast<uint16_t>(static_cast<uint8_t>(commandId) << 8);
+        switch (commandId)
+        {
+        case ModuleMessageId::CMD_SET_PARAMETER:
+        case ModuleMessageId::CMD_GET_PARAMETER:
+        case ModuleMessageId::CMD_SET_CALIB:
+            return payloadLen > 0 ? static_cast<uint16_t>(cmd | payload[0]) : TX_NO_KEY;
+        case ModuleMessageId::CMD_PING:
+        case ModuleMessageId::CMD_GET_PROPERTIES:
+        case ModuleMessageId::CMD_SET_AUTOUPDATE:
+        case ModuleMessageId::CMD_GET_MAPPINGS:
+        case ModuleMessageId::CMD_SET_MAPPINGS:
+            return cmd;
+        default:
+            return TX_NO_KEY;
+        }
+    }
+
+    static bool enqueueTx(int r, int c, ModuleMessageId commandId, const uint8_t *payload, uint16_t payloadLen)
+    {
+        TxPort &tx = txPorts[r][c];
+        const uint16_t key = txKey(commandId, payload, payloadLen);
+        TxEntry *e = nullptr;
+        for (int i = 0; key != TX_NO_KEY && i < tx.count && !e; i++)
+        {
+            if (tx.queue[i].key == key)
+            {
+                e = &tx.queue[i]; // keeps its place in line
+            }
+        }
+        if (!e)
+        {
+            if (tx.count == TX_QUEUE_DEPTH)
+            {
+                TRACE(PORT_TX_FULL, r, c, static_cast<uint8_t>(commandId));
+                return false;
+            }
+            e = &tx.queue[tx.count++];
+            e->seq = txSeq++;
+            e->key = key;
+            e->commandId = commandId;
+            e->priority = txPriority(commandId);
+        }
+        e->len = payloadLen;
+        if (payloadLen > 0)
+        {
+            memcpy(e->payload, payload, payloadLen);
+        }
+        return true;
+    }
+
+    // Encodes the most urgent queued command into the port's frame buffer
+    static void startTxFrame(State &port, TxPort &tx)
+    {
+        int best = 0;
+        for (int i = 1; i < tx.count; i++)
+        {
+            const TxEntry &a = tx.queue[i];
+            const TxEntry &b = tx.queue[best];
+            if (a.priority < b.priority || (a.priority == b.priority && (int32_t)(a.seq - b.seq) < 0))
+            {
+                best = i;
+            }
+        }
+        const TxEntry &e = tx.queue[best];
+        tx.frameLen = 0;
+        tx.framePos = 0;
+        encodeFrame(port.serial->txLinkMode, e.commandId, e.payload, e.len, [&](uint8_t b)
+                    { tx.frame[tx.frameLen++] = b; });
+        if (e.commandId == ModuleMessageId::CMD_SET_LINK_MODE && e.len > 0)
+        {
+            // Frames after this one use the new framing
+            ispio_request_link_mode(port.serial, e.payload[0]);
+        }
+        Stats::g_ports[port.row][port.col].txFrames = Stats::g_ports[port.row][port.col].txFrames + 1;
+
+        tx.queue[best] = tx.queue[tx.count - 1];
+        tx.count--;
+    }
+
+    // A frame is in flight on another port listening through the same shared
+    // RX state machine. Its reply must not be cut off, so wait for it.
+    static bool sharedTxBusy(const State &port)
+    {
+        if (!port.serial->sharedSM)
+        {
+            return false;
+        }
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                const InterruptSerialPIO *other = ports[r][c].serial;
+                const TxPort &tx = txPorts[r][c];
+                if (other && other != port.serial && other->sharedSM && other->rxPIO == port.serial->rxPIO &&
+                    other->rxSM == port.serial->rxSM && tx.framePos < tx.frameLen)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Puts up to TX_BYTES_PER_PASS bytes on the wire, one per port in turn
+    static void serviceTx()
+    {
+        PROFILE_STAGE(STAGE_TX);
+        constexpr int portCount = MODULE_PORT_ROWS * MODULE_PORT_COLS;
+        int budget = TX_BYTES_PER_PASS;
+        bool sent = true;
+        while (budget > 0 && sent)
+        {
+            sent = false;
+            for (int i = 0; i < portCount && budget > 0; i++)
+            {
+                const int idx = (txNextPort + i) % portCount;
+                State &port = ports[idx / MODULE_PORT_COLS][idx % MODULE_PORT_COLS];
+                TxPort &tx = txPorts[port.row][port.col];
+                if (!port.configured || port.serial == nullptr)
+                {
+                    continue;
+                }
+                if (tx.framePos == tx.frameLen)
+                {
+                    if (tx.count == 0 || sharedTxBusy(port) || !ispio_tx_ready(port.serial))
+                    {
+                        continue;
+                    }
+                    startTxFrame(port, tx);
+                }
+                ispio_write(port.serial, tx.frame[tx.framePos++]);
+                budget--;
+                sent = true;
+            }
+        }
+        txNextPort = (txNextPort + 1) % portCount;
+    }
+
+    static void resetTx(int r, int c)
+    {
+        txPorts[r][c].count = 0;
+        txPorts[r][c].frameLen = 0;
+        txPorts[r][c].framePos = 0;
+    }
+
+    extern "C" ModuleMessage *__not_in_flash_func(allocateMessageFromIRQ)()
     {
         uint8_t cap = sizeof(messageQueue) / sizeof(messageQueue[0]);
         if (messageCount == cap)
@@ -232,28 +890,30 @@ namespace Port
             // Drop oldest to make room
             messageTail = (messageTail + 1) % cap;
             messageCount--;
+            Stats::CoreCounters &stats = Stats::core();
+            stats.messageDrops = stats.messageDrops + 1;
         }
         return &messageQueue[messageHead];
     }
 
-    extern "C" void commitMessageFromIRQ()
+    extern "C" void __not_in_flash_func(commitMessageFromIRQ)()
     {
         uint8_t cap = sizeof(messageQueue) / sizeof(messageQueue[0]);
         messageHead = (messageHead + 1) % cap;
         messageCount++;
     }
 
-    static void messageSinkFromIRQ(ModuleMessage *msg)
+    static void __not_in_flash_func(messageSinkFromIRQ)(ModuleMessage *msg)
     {
-        State *p = get(msg->moduleRow, msg->moduleCol);
-        if (p)
+        // Inline bounds check: get() lives in flash, which may be busy being programmed
+        if (msg->moduleRow < MODULE_PORT_ROWS && msg->moduleCol < MODULE_PORT_COLS)
         {
             // Do NOT set hasModule = true here.
             // hasModule implies we have successfully fetched the module properties (name, params, etc).
             // That logic is handled in module_task.cpp upon receiving CMD_GET_PROPERTIES response.
 
             // Any valid frame counts as proof-of-life.
-            lastHeardMs[msg->moduleRow][msg->moduleCol] = millis();
+            lastHeardUs[msg->moduleRow][msg->moduleCol] = time_us_32();
         }
     }
 
@@ -273,13 +933,17 @@ namespace Port
         port.hasModule = false;
         port.module = {};
 
-        MappingManager::clearMappingsForPort(r, c);
+        // Keep the mappings: they are host state and go back to the next module here
+        MappingManager::releaseMappingsForPort(r, c);
 
-        lastPingSentMs[r][c] = 0;
-        lastHeardMs[r][c] = 0;
+        port.bringUp = BringUp::NONE;
+        bringUpSteps[r][c] = 0;
+        lastHeardUs[r][c] = 0;
         lastRxHighMs[r][c] = 0;
-        pendingSetParamPid[r][c] = 0;
-        pendingSetParamValid[r][c] = false;
+        resetParamWrites(r, c);
+        pollMs[r][c] = 0;
+        pollNext[r][c] = 0;
+        resetTx(r, c);
 
         if (port.txPin != PORT_PIN_UNUSED)
         {
@@ -290,7 +954,8 @@ namespace Port
             pinMode(port.rxPin, INPUT_PULLDOWN);
         }
 
-        dbg_printf("event port_disconnected r=%d c=%d\n", r, c);
+        markChanged(r, c);
+        LOG_INFO(LOG_PORT, "event port_disconnected r=%d c=%d\n", r, c);
     }
 
     static void configurePortIfDetected(int r, int c)
@@ -360,14 +1025,17 @@ namespace Port
         lastDetectMs[r][c] = now;
 
         // Start liveness tracking.
-        lastPingSentMs[r][c] = now;
-        lastHeardMs[r][c] = now;
+        lastHeardUs[r][c] = time_us_32();
         lastRxHighMs[r][c] = digitalRead(port.rxPin) == HIGH ? now : 0;
 
-        logPortInsertion(r, c, port);
+        // Identified once serviceBringUp() admits it
+        port.bringUp = BringUp::DETECTED;
+        bringUpStartMs[r][c] = now;
+        bringUpQueuedMs[r][c] = now;
+        bringUpSteps[r][c] = 0;
 
-        // Get module properties
-        sendGetProperties(r, c);
+        logPortInsertion(r, c, port);
+        markChanged(r, c);
     }
 
     State *get(int row, int col)
@@ -384,6 +1052,22 @@ namespace Port
         return &ports[0][0];
     }
 
+    uint32_t getGeneration()
+    {
+        const uint32_t gen = currentGeneration;
+        __dmb();
+        return gen;
+    }
+
+    uint32_t getPortGeneration(int row, int col)
+    {
+        if (row < 0 || col < 0 || row >= MODULE_PORT_ROWS || col >= MODULE_PORT_COLS)
+        {
+            return 0;
+        }
+        return portGeneration[row][col];
+    }
+
     void init()
     {
         initBoardSerial();
@@ -401,11 +1085,19 @@ namespace Port
                 ports[r][c].orientation = ModuleOrientation::UP;
                 ports[r][c].module = {};
                 lastDetectMs[r][c] = 0;
-                lastPingSentMs[r][c] = 0;
-                lastHeardMs[r][c] = 0;
+                ports[r][c].bringUp = BringUp::NONE;
+                bringUpStartMs[r][c] = 0;
+                bringUpQueuedMs[r][c] = 0;
+                bringUpStepMs[r][c] = 0;
+                bringUpTries[r][c] = 0;
+                bringUpSteps[r][c] = 0;
+                lastHeardUs[r][c] = 0;
                 lastRxHighMs[r][c] = 0;
-                pendingSetParamPid[r][c] = 0;
-                pendingSetParamValid[r][c] = false;
+                resetParamWrites(r, c);
+                pollMs[r][c] = 0;
+                pollNext[r][c] = 0;
+                resetTx(r, c);
+                portGeneration[r][c] = 1;
 
                 ports[r][c].txPin = portTxPins[r][c];
                 ports[r][c].rxPin = portRxPins[r][c];
@@ -426,6 +1118,7 @@ namespace Port
     {
         uint32_t now = millis();
         // Scan ports for insertion/removal
+        Profiler::enter(Profiler::STAGE_SCAN);
         for (int r = 0; r < MODULE_PORT_ROWS; r++)
         {
             for (int c = 0; c < MODULE_PORT_COLS; c++)
@@ -450,7 +1143,7 @@ namespace Port
                 uint32_t heard;
                 uint32_t rxHigh;
                 noInterrupts();
-                heard = lastHeardMs[r][c];
+                heard = lastHeardUs[r][c];
                 interrupts();
 
                 rxHigh = lastRxHighMs[r][c];
@@ -458,7 +1151,7 @@ namespace Port
                 // A port is considered removed if:
                 // - we have not received any valid frame (any response) in RESPONSE_TIMEOUT_MS, AND
                 // - the RX line has not been observed HIGH (UART idle) at any point during that same window.
-                const bool noRecentResponse = heard && (now - heard) > RESPONSE_TIMEOUT_MS;
+                const bool noRecentResponse = heard && (time_us_32() - heard) > RESPONSE_TIMEOUT_MS * 1000u;
                 const bool rxNeverHighInWindow = (rxHigh == 0) || ((now - rxHigh) > RESPONSE_TIMEOUT_MS);
 
                 if (noRecentResponse && rxNeverHighInWindow)
@@ -466,34 +1159,41 @@ namespace Port
                     removePort(r, c);
                     continue;
                 }
-
-                // Retry identification if module is plugged in but not valid
-                if (!port.hasModule)
+            }
+        }
+        serviceBringUp(now);
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                if (ports[r][c].configured && ports[r][c].hasModule)
                 {
-                    if (now - lastPingSentMs[r][c] > PING_INTERVAL_MS)
-                    {
-                        lastPingSentMs[r][c] = now;
-                        sendGetProperties(r, c);
-                    }
+                    flushParamWrite(r, c, now);
+                    confirmParamWrites(r, c, now);
+                    pollSharedPort(r, c, now);
                 }
             }
         }
+        Profiler::exit();
+
+        serviceTx();
 
         // Process any queued messages
         ModuleMessage msg;
         while (Port::getNextMessage(msg))
         {
+            PROFILE_STAGE(STAGE_RX);
             Port::State *port = Port::get(msg.moduleRow, msg.moduleCol);
 
             if (!port)
             {
-                dbg_printf("warn: received message for non-existent port r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
+                TRACE(PORT_RX_NO_PORT, msg.moduleRow, msg.moduleCol);
                 continue;
             }
 
             if (msg.commandId != ModuleMessageId::CMD_RESPONSE || msg.payloadLength < 4)
             {
-                dbg_printf("warn: received malformed response message r=%d c=%d cmd=%d len=%d\n", msg.moduleRow, msg.moduleCol, msg.commandId, msg.payloadLength);
+                TRACE(PORT_RX_MALFORMED, msg.moduleRow, msg.moduleCol, msg.commandId, msg.payloadLength);
                 continue;
             }
 
@@ -502,10 +1202,22 @@ namespace Port
             if (copyLen > sizeof(resp))
                 copyLen = sizeof(resp);
             memcpy(&resp, msg.payload, copyLen);
+            // The module's own length field may claim more than arrived; the
+            // handlers below size their reads from it
+            if (resp.payloadLength > copyLen - 4u)
+            {
+                resp.payloadLength = static_cast<uint16_t>(copyLen - 4u);
+            }
 
             if (resp.status != ModuleStatus::MODULE_STATUS_OK)
             {
-                dbg_printf("warn: received error response from module r=%d c=%d in response to cmd=%d\n", msg.moduleRow, msg.moduleCol, resp.inResponseTo);
+                TRACE(PORT_RX_ERROR, msg.moduleRow, msg.moduleCol, resp.inResponseTo);
+                if (resp.inResponseTo == ModuleMessageId::CMD_SET_PARAMETER)
+                {
+                    // Refused: the confirmation read restores the module's value
+                    pendingSetParamValid[port->row][port->col] = false;
+                    flushParamWrite(port->row, port->col, millis());
+                }
                 continue;
             }
 
@@ -517,7 +1229,7 @@ namespace Port
             {
                 if (resp.payloadLength < 1)
                 {
-                    dbg_printf("warn: malformed GET_PARAMETER response from module r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
+                    LOG_WARN(LOG_PORT, "warn: malformed GET_PARAMETER response from module r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
                     continue;
                 }
                 const uint8_t pid = resp.payload[0];
@@ -530,7 +1242,7 @@ namespace Port
                     {
                         if (!isValueInRange(port->module.parameters[pid], cur))
                         {
-                            dbg_printf("warn Param r=%d c=%d pid=%d value out of range, resetting\n", port->row, port->col, pid);
+                            TRACE(PORT_PARAM_RANGE, port->row, port->col, pid);
                             ModuleParameterValue resetVal = getResetValue(port->module.parameters[pid]);
                             sendSetParameter(port->row, port->col, pid, dt, resetVal);
                             continue;
@@ -541,6 +1253,7 @@ namespace Port
                         if (!valueEquals(dt, cached, cur))
                         {
                             cached = cur;
+                            markChanged(port->row, port->col);
                             MappingManager::applyMapping(port, pid, dt, cur);
                         }
                     }
@@ -548,16 +1261,26 @@ namespace Port
                 break;
             }
 
+            case ModuleMessageId::CMD_SET_LINK_MODE:
+            {
+                // The RX IRQ already switched framing when the acknowledgement came in
+                if (port->serial)
+                {
+                    LOG_INFO(LOG_PORT, "[PORT] r=%d c=%d link mode %d\n", port->row, port->col, port->serial->linkMode);
+                }
+                break;
+            }
+
             case ModuleMessageId::CMD_SET_PARAMETER:
             {
                 if (!pendingSetParamValid[port->row][port->col])
                 {
-                    dbg_printf("warn: SET_PARAMETER response with no pending pid r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
+                    LOG_WARN(LOG_PORT, "warn: SET_PARAMETER response with no pending pid r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
                     break;
                 }
-                const uint8_t pid = pendingSetParamPid[port->row][port->col];
+                // Read back by confirmParamWrites() once the writes settle
                 pendingSetParamValid[port->row][port->col] = false;
-                sendGetParameter(port->row, port->col, pid);
+                flushParamWrite(port->row, port->col, millis());
                 break;
             }
                 // if is a successful response to GET_PROPERTIES, update module info and mappings cache
@@ -566,7 +1289,7 @@ namespace Port
             {
                 if (resp.payloadLength < (uint16_t)(1u + offsetof(Module, parameterCount) + 1u))
                 {
-                    dbg_printf("warn: malformed CMD_GET_PROPERTIES response from module r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
+                    LOG_WARN(LOG_PORT, "warn: malformed CMD_GET_PROPERTIES response from module r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
                     continue;
                 }
                 ModuleMessageGetPropertiesPayload props{};
@@ -590,20 +1313,13 @@ namespace Port
                 }
 
                 port->module = props.module;
-                bool wasNew = !port->hasModule;
                 port->hasModule = true;
+                markChanged(port->row, port->col);
 
-                // Check for auto update capability
-                if (port->module.capabilities & MODULE_CAP_AUTOUPDATE)
+                // Link mode, autoupdate and mappings follow through serviceBringUp()
+                if (port->bringUp == BringUp::IDENTIFYING)
                 {
-                    // Enable auto update with on-change only
-                    sendSetAutoupdate(port->row, port->col, 1, 0);
-                }
-
-                if (wasNew)
-                {
-                    // Fetch mappings from module
-                    sendGetMappings(port->row, port->col);
+                    bringUpIdentified(*port, millis());
                 }
                 break;
             }
@@ -613,7 +1329,7 @@ namespace Port
             {
                 if (resp.payloadLength < 1)
                 {
-                    dbg_printf("warn: malformed CMD_GET_MAPPINGS response from module r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
+                    LOG_WARN(LOG_PORT, "warn: malformed CMD_GET_MAPPINGS response from module r=%d c=%d\n", msg.moduleRow, msg.moduleCol);
                     continue;
                 }
                 ModuleMessageGetMappingsPayload mappingsPayload{};
@@ -622,9 +1338,22 @@ namespace Port
                     copyLen = sizeof(mappingsPayload);
                 memcpy(&mappingsPayload, resp.payload, copyLen);
 
+                // Host mappings (restored from flash or kept across a re-plug) win:
+                // push them to the module instead of adopting what it reports.
+                if (MappingManager::hasMappingsForPort(port->row, port->col))
+                {
+                    IPC::enqueueSyncMapping(port->row, port->col);
+                    if (port->bringUp == BringUp::CONFIGURING)
+                    {
+                        bringUpMapped(*port, true, millis());
+                    }
+                    break;
+                }
+
                 MappingManager::clearMappingsForPort(port->row, port->col);
 
-                for (int i = 0; i < mappingsPayload.count && i < 8; i++)
+                const uint16_t mappingsReceived = static_cast<uint16_t>((resp.payloadLength - 1u) / sizeof(WireModuleMapping));
+                for (int i = 0; i < mappingsPayload.count && i < 8 && i < mappingsReceived; i++)
                 {
                     const WireModuleMapping &wm = mappingsPayload.mappings[i];
                     ModuleMapping m{};
@@ -666,9 +1395,39 @@ namespace Port
                         m.target.keyboard.keycode = wm.target.keyboard.keycode;
                         m.target.keyboard.modifier = wm.target.keyboard.modifier;
                     }
+                    else if (m.type == ACTION_BANK_SELECT)
+                    {
+                        m.target.bankSelect.bank = wm.target.bankSelect.bank;
+                        m.target.bankSelect.mode = (BankSelectMode)wm.target.bankSelect.mode;
+                    }
+                    else if (m.type == ACTION_MIDI_NRPN || m.type == ACTION_MIDI_RPN)
+                    {
+                        m.target.midiParam.channel = wm.target.midiParam.channel;
+                        m.target.midiParam.paramMsb = wm.target.midiParam.paramMsb;
+                        m.target.midiParam.paramLsb = wm.target.midiParam.paramLsb;
+                    }
+                    else if (m.type == ACTION_MIDI_CC_RELATIVE)
+                    {
+                        m.target.midiRelative.channel = wm.target.midiRelative.channel;
+                        m.target.midiRelative.ccNumber = wm.target.midiRelative.ccNumber;
+                        m.target.midiRelative.mode = wm.target.midiRelative.mode;
+                    }
 
                     MappingManager::addMapping(port->row, port->col, m);
                 }
+                if (port->bringUp == BringUp::CONFIGURING)
+                {
+                    bringUpMapped(*port, false, millis());
+                }
+                break;
+            }
+
+            case ModuleMessageId::CMD_SET_MAPPINGS:
+            {
+                if (port->bringUp == BringUp::MAPPED)
+                {
+                    bringUpLive(*port, millis());
+                }
                 break;
             }
             }
@@ -688,31 +1447,32 @@ namespace Port
             payloadLen = MODULE_MAX_PAYLOAD;
         }
 
-#ifdef DEBUG_MODULE_MESSAGES
-        dbg_printf("[TX] Port %d,%d cmd=%s (0x%02X) len=%u data=",
-                   row, col, commandToStringTx(commandId), static_cast<uint8_t>(commandId), payloadLen);
-        printHexBytesTx(payload, payloadLen);
-        dbg_printf("\n");
+#if LOG_COMPILED(LOG_LEVEL_DEBUG, LOG_MODMSG)
+        if (LOG_ON(LOG_LEVEL_DEBUG, LOG_MODMSG))
+        {
+            dbg_printf("[TX] Port %d,%d cmd=%s (0x%02X) len=%u data=",
+                       row, col, commandToStringTx(commandId), static_cast<uint8_t>(commandId), payloadLen);
+            printHexBytesTx(payload, payloadLen);
+            dbg_printf("\n");
+        }
 #endif
 
-        uint8_t frameHeader[4];
-        frameHeader[0] = FRAME_START;
-        frameHeader[1] = static_cast<uint8_t>(commandId);
-        frameHeader[2] = static_cast<uint8_t>(payloadLen & 0xFF);
-        frameHeader[3] = static_cast<uint8_t>((payloadLen >> 8) & 0xFF);
-
-        uint8_t checksum = calcChecksum(frameHeader, sizeof(frameHeader));
-        for (uint16_t i = 0; i < payloadLen; i++)
+        if (payloadLen <= TX_MAX_PAYLOAD)
         {
-            checksum = static_cast<uint8_t>(checksum + payload[i]);
+            return enqueueTx(row, col, commandId, payload, payloadLen);
         }
 
-        ispio_write_buffer(port->serial, frameHeader, sizeof(frameHeader));
-        if (payloadLen > 0)
+        // Too big for a queue slot: finish the frame on the wire, then send
+        // this one directly
+        PROFILE_STAGE(STAGE_TX);
+        TxPort &tx = txPorts[row][col];
+        while (tx.framePos < tx.frameLen)
         {
-            ispio_write_buffer(port->serial, payload, payloadLen);
+            ispio_write(port->serial, tx.frame[tx.framePos++]);
         }
-        ispio_write(port->serial, checksum);
+        encodeFrame(port->serial->txLinkMode, commandId, payload, payloadLen, [&](uint8_t b)
+                    { ispio_write(port->serial, b); });
+        Stats::g_ports[row][col].txFrames = Stats::g_ports[row][col].txFrames + 1;
         return true;
     }
 
@@ -729,16 +1489,30 @@ namespace Port
 
     bool sendSetParameter(int row, int col, uint8_t parameterId, ModuleParameterDataType dataType, ModuleParameterValue value)
     {
-        ModuleMessageSetParameterPayload payload{};
-        payload.parameterId = parameterId;
-        payload.dataType = dataType;
-        payload.value = value;
-        if (row >= 0 && col >= 0 && row < MODULE_PORT_ROWS && col < MODULE_PORT_COLS)
+        State *port = get(row, col);
+        if (!port || !port->configured || port->serial == nullptr || parameterId >= PARAM_WRITE_SLOTS)
+        {
+            return false;
+        }
+        const uint32_t now = millis();
+        writeValue[row][col][parameterId] = value;
+        writeType[row][col][parameterId] = dataType;
+        writePending[row][col] |= (uint8_t)(1u << parameterId);
+        lastWriteMs[row][col] = now;
+
+        // Optimistic: the cache shows the value right away
+        if (port->hasModule && parameterId < port->module.parameterCount && port->module.parameters[parameterId].dataType == dataType)
         {
-            pendingSetParamPid[row][col] = parameterId;
-            pendingSetParamValid[row][col] = true;
+            ModuleParameterValue &cached = port->module.parameters[parameterId].value;
+            if (!valueEquals(dataType, cached, value))
+            {
+                cached = value;
+                markChanged(row, col);
+            }
         }
-        return sendMessage(row, col, ModuleMessageId::CMD_SET_PARAMETER, reinterpret_cast<uint8_t *>(&payload), sizeof(payload));
+
+        flushParamWrite(row, col, now);
+        return true;
     }
 
     bool sendGetParameter(int row, int col, uint8_t parameterId)
@@ -761,6 +1535,12 @@ namespace Port
         return sendMessage(row, col, ModuleMessageId::CMD_SET_AUTOUPDATE, reinterpret_cast<uint8_t *>(&payload), sizeof(payload));
     }
 
+    bool sendSetLinkMode(int row, int col, ModuleLinkMode mode)
+    {
+        ModuleMessageSetLinkModePayload payload{mode};
+        return sendMessage(row, col, ModuleMessageId::CMD_SET_LINK_MODE, &payload.mode, sizeof(payload));
+    }
+
     bool sendSetMappings(int row, int col, const ModuleMessageSetMappingsPayload &payload)
     {
         return sendMessage(row, col, ModuleMessageId::CMD_SET_MAPPINGS, (const uint8_t *)&payload, sizeof(payload));
@@ -819,21 +1599,24 @@ namespace Port
 
         if (messageCount >= 16)
         {
-            dbg_printf("[WARN]: messageCount >= 16, may overflow");
+            TRACE(PORT_RX_BACKLOG, messageCount);
         }
 
         messageTail = (messageTail + 1) % cap;
         messageCount--;
         interrupts();
-#ifdef DEBUG_MODULE_MESSAGES
-        dbg_printf("[RX] Port %u,%u cmd=%s (0x%02X) len=%u data=",
-                   out.moduleRow,
-                   out.moduleCol,
-                   commandToStringTx(out.commandId),
-                   static_cast<uint8_t>(out.commandId),
-                   out.payloadLength);
-        printHexBytesTx(out.payload, out.payloadLength);
-        dbg_printf("\n");
+#if LOG_COMPILED(LOG_LEVEL_DEBUG, LOG_MODMSG)
+        if (LOG_ON(LOG_LEVEL_DEBUG, LOG_MODMSG))
+        {
+            dbg_printf("[RX] Port %u,%u cmd=%s (0x%02X) len=%u data=",
+                       out.moduleRow,
+                       out.moduleCol,
+                       commandToStringTx(out.commandId),
+                       static_cast<uint8_t>(out.commandId),
+                       out.payloadLength);
+            printHexBytesTx(out.payload, out.payloadLength);
+            dbg_printf("\n");
+        }
 #endif
         return true;
     }
@@ -8,6 +8,13 @@ namespace Port
     State *get(int row, int col);
     State *getAll();
 
+    // Change tracking. Every insertion, removal, properties update or parameter
+    // change stamps the port with the next value of a global generation counter.
+    // Written on core1 only; the port stamp is published before the global one,
+    // so a reader that loads getGeneration() first never misses a change <= it.
+    uint32_t getGeneration();
+    uint32_t getPortGeneration(int row, int col);
+
     // ISR-facing queue helpers (do not use outside interrupt context)
 #ifdef __cplusplus
     extern "C"
@@ -28,10 +35,14 @@ namespace Port
     // Typed helpers
     bool sendPing(int row, int col);
     bool sendGetProperties(int row, int col, uint8_t requestId = 0);
+    // Updates the cached value at once and queues the write. Writes to the same
+    // parameter coalesce (last one wins) while an earlier SET is unanswered;
+    // one GET_PARAMETER confirms the result after the writes settle.
     bool sendSetParameter(int row, int col, uint8_t parameterId, ModuleParameterDataType dataType, ModuleParameterValue value);
     bool sendGetParameter(int row, int col, uint8_t parameterId);
     bool sendResetModule(int row, int col);
     bool sendSetAutoupdate(int row, int col, bool enable, uint16_t intervalMs = 0);
+    bool sendSetLinkMode(int row, int col, ModuleLinkMode mode);
     bool sendSetMappings(int row, int col, const ModuleMessageSetMappingsPayload &payload);
     bool sendGetMappings(int row, int col);
     bool sendResponse(int row, int col, ModuleMessageId inResponseTo, ModuleStatus status, const uint8_t *payload, uint16_t payloadLen);
@@ -0,0 +1,112 @@
+#include "profiler.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+namespace Profiler
+{
+    Accumulator g_acc;
+
+    namespace
+    {
+        struct Window
+        {
+            uint32_t us;
+            uint32_t cycles;
+            uint32_t stageCycles[STAGE_COUNT];
+        };
+
+        // Odd while core 1 is publishing
+        volatile uint32_t g_seq = 0;
+        Window g_published;
+
+        uint32_t g_windowStartUs = 0;
+
+        uint8_t *putU32(uint8_t *out, uint32_t v)
+        {
+            out[0] = (uint8_t)(v & 0xFF);
+            out[1] = (uint8_t)((v >> 8) & 0xFF);
+            out[2] = (uint8_t)((v >> 16) & 0xFF);
+            out[3] = (uint8_t)((v >> 24) & 0xFF);
+            return out + 4;
+        }
+
+        uint8_t *putU16(uint8_t *out, uint16_t v)
+        {
+            out[0] = (uint8_t)(v & 0xFF);
+            out[1] = (uint8_t)(v >> 8);
+            return out + 2;
+        }
+
+        uint16_t permille(uint32_t part, uint32_t whole)
+        {
+            if (!whole)
+                return 0;
+            const uint64_t p = (uint64_t)part * 1000u / whole;
+            return (uint16_t)(p > 1000 ? 1000 : p);
+        }
+    }
+
+    void init()
+    {
+        // Same setup as ispio_write(), which leaves it alone once running
+        if ((systick_hw->csr & 0x5) != 0x5)
+        {
+            systick_hw->rvr = 0x00FFFFFF;
+            systick_hw->cvr = 0;
+            systick_hw->csr = 0x5;
+        }
+        g_acc = Accumulator{};
+        g_acc.last = systick_hw->cvr;
+        g_windowStartUs = time_us_32();
+    }
+
+    void tick()
+    {
+        const uint32_t now = time_us_32();
+        const uint32_t us = now - g_windowStartUs;
+        if (us < PROFILE_WINDOW_US)
+            return;
+
+        g_seq = g_seq + 1;
+        __dmb();
+        g_published.us = us;
+        g_published.cycles = (uint32_t)((uint64_t)us * clock_get_hz(clk_sys) / 1000000u);
+        for (int s = 0; s < STAGE_COUNT; s++)
+        {
+            g_published.stageCycles[s] = g_acc.cycles[s];
+            g_acc.cycles[s] = 0;
+        }
+        __dmb();
+        g_seq = g_seq + 1;
+
+        g_windowStartUs = now;
+    }
+
+    void snapshot(uint8_t *out)
+    {
+        Window w;
+        uint32_t seq;
+        do
+        {
+            seq = g_seq;
+            __dmb();
+            w = g_published;
+            __dmb();
+        } while ((seq & 1) || seq != g_seq);
+
+        uint32_t busy = 0;
+        for (int s = 0; s < STAGE_COUNT; s++)
+            busy += w.stageCycles[s];
+
+        out = putU32(out, w.us);
+        out = putU32(out, w.cycles);
+        out = putU16(out, w.cycles > busy ? permille(w.cycles - busy, w.cycles) : 0);
+        *out++ = STAGE_COUNT;
+        for (int s = 0; s < STAGE_COUNT; s++)
+        {
+            out = putU32(out, w.stageCycles[s]);
+            out = putU16(out, permille(w.stageCycles[s], w.cycles));
+        }
+    }
+}
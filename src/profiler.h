@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/platform.h"
+#include "hardware/structs/systick.h"
+
+// Core 1 load profiler. PROFILE_STAGE(STAGE_x) charges the CPU cycles until
+// the end of the enclosing scope to that stage; nested stages are exclusive
+// (a UART write inside RX handling counts as TX only). Everything loop1()
+// spends outside any stage, mostly polling empty queues, is idle.
+//
+// Cycles come from core 1's SysTick (24-bit, CPU clock; the soft UART TX
+// already runs it that way), so a single stage must stay under 2^24 cycles
+// (~130 ms at 125 MHz). Interrupts are charged to whichever stage they hit.
+// Every PROFILE_WINDOW_US the totals are published under a sequence count
+// so core 0 can read a consistent window without locking.
+//
+// Scopes opened on core 0 are ignored.
+
+namespace Profiler
+{
+    enum Stage : uint8_t
+    {
+        STAGE_SCAN,    // port insertion/removal scan, identification pings
+        STAGE_RX,      // handling module responses
+        STAGE_MAPPING, // mapping evaluation, filters, output
+        STAGE_CURVE,   // curve LUT evaluation
+        STAGE_TX,      // module frame writes (blocking soft UART)
+        STAGE_IPC,     // requests from core 0
+        STAGE_COUNT
+    };
+
+    static constexpr uint32_t PROFILE_WINDOW_US = 1000000;
+    static constexpr int MAX_DEPTH = 8;
+
+    struct Accumulator
+    {
+        uint32_t cycles[STAGE_COUNT];
+        uint32_t last; // SysTick value at the last enter/exit
+        uint8_t stack[MAX_DEPTH];
+        uint8_t depth;
+    };
+
+    extern Accumulator g_acc;
+
+    // SysTick counts down
+    inline uint32_t elapsedSince(uint32_t now)
+    {
+        return (g_acc.last - now) & 0x00FFFFFF;
+    }
+
+    inline void enter(Stage stage)
+    {
+        if (get_core_num() != 1)
+            return;
+        const uint32_t now = systick_hw->cvr;
+        if (g_acc.depth > 0 && g_acc.depth <= MAX_DEPTH)
+            g_acc.cycles[g_acc.stack[g_acc.depth - 1]] += elapsedSince(now);
+        if (g_acc.depth < MAX_DEPTH)
+            g_acc.stack[g_acc.depth] = stage;
+        g_acc.depth++;
+        g_acc.last = now;
+    }
+
+    inline void exit()
+    {
+        if (get_core_num() != 1 || g_acc.depth == 0)
+            return;
+        const uint32_t now = systick_hw->cvr;
+        g_acc.depth--;
+        if (g_acc.depth < MAX_DEPTH)
+            g_acc.cycles[g_acc.stack[g_acc.depth]] += elapsedSince(now);
+        g_acc.last = now;
+    }
+
+    struct Scope
+    {
+        explicit Scope(Stage stage) { enter(stage); }
+        ~Scope() { exit(); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // Core 1: start SysTick, open the first window. Call from setup1().
+    void init();
+    // Core 1: publish the window once it is complete. Call once per loop1().
+    void tick();
+
+    // STATS PROFILE reply: windowUs(4) + windowCycles(4) + idlePermille(2) +
+    // stageCount(1), then per stage cycles(4) + permille(2); little-endian.
+    // All zero until the first window completes.
+    static constexpr size_t SNAPSHOT_SIZE = 11 + STAGE_COUNT * 6;
+
+    // Core 0: copy the last complete window
+    void snapshot(uint8_t *out);
+}
+
+#define PROFILE_STAGE(stage) Profiler::Scope profileScope_(Profiler::stage)
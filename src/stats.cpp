@@ -0,0 +1,50 @@
+#include "stats.h"
+
+namespace Stats
+{
+    CoreCounters g_core[2];
+    PortCounters g_ports[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    volatile uint32_t g_resetRequest = 0;
+    volatile uint32_t g_gridReadyMs = 0;
+
+    static uint8_t *putU32(uint8_t *out, uint32_t v)
+    {
+        out[0] = (uint8_t)(v & 0xFF);
+        out[1] = (uint8_t)((v >> 8) & 0xFF);
+        out[2] = (uint8_t)((v >> 16) & 0xFF);
+        out[3] = (uint8_t)((v >> 24) & 0xFF);
+        return out + 4;
+    }
+
+    void snapshot(uint8_t *out, bool resetMax)
+    {
+        out = putU32(out, time_us_32());
+        *out++ = MODULE_PORT_ROWS;
+        *out++ = MODULE_PORT_COLS;
+        for (const CoreCounters &c : g_core)
+        {
+            out = putU32(out, c.loops);
+            out = putU32(out, c.loopMaxUs);
+            out = putU32(out, c.ipcQueueFull);
+            out = putU32(out, c.hidQueueFull);
+            out = putU32(out, c.messageDrops);
+        }
+        for (int r = 0; r < MODULE_PORT_ROWS; r++)
+        {
+            for (int c = 0; c < MODULE_PORT_COLS; c++)
+            {
+                const PortCounters &p = g_ports[r][c];
+                out = putU32(out, p.rxFrames);
+                out = putU32(out, p.txFrames);
+                out = putU32(out, p.checksumErrors);
+                out = putU32(out, p.crcErrors);
+                out = putU32(out, p.parserResets);
+                out = putU32(out, p.parserTimeouts);
+                out = putU32(out, p.bringUpMs);
+            }
+        }
+        out = putU32(out, g_gridReadyMs);
+        if (resetMax)
+            g_resetRequest = g_resetRequest + 1;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include "boardconfig.h"
+#include "pico/platform.h"
+#include "hardware/timer.h"
+
+// Runtime counters, read over the config protocol (STATS command).
+//
+// Every field has exactly one writer: a core's own block is only updated by
+// that core, and the per-port counters only by core 1 (which owns the ports
+// and their RX interrupts; RX fields from the IRQ, TX from the task). Readers
+// on the other core just load the 32-bit words, so nothing is locked and
+// reading does not disturb the writers. Counters wrap; consumers work with
+// differences.
+
+namespace Stats
+{
+    struct CoreCounters
+    {
+        volatile uint32_t loops;         // loop()/loop1() iterations
+        volatile uint32_t loopMaxUs;     // longest iteration since the last reset
+        volatile uint32_t ipcQueueFull;  // IPC requests dropped on a full queue
+        volatile uint32_t hidQueueFull;  // HID key events dropped on a full queue
+        volatile uint32_t messageDrops;  // module messages overwritten (drop-oldest)
+        uint32_t lastLoopUs;
+        uint32_t resetSeen;
+    };
+
+    struct PortCounters
+    {
+        volatile uint32_t rxFrames;
+        volatile uint32_t txFrames;
+        volatile uint32_t checksumErrors; // sum-framed frames
+        volatile uint32_t crcErrors;      // CRC-16 framed frames
+        volatile uint32_t parserResets;   // framing lost: bad length or overflow
+        volatile uint32_t parserTimeouts; // frame abandoned mid-way
+        volatile uint32_t bringUpMs;      // last module bring-up, detection to live (not a counter)
+    };
+
+    extern CoreCounters g_core[2];
+    extern PortCounters g_ports[MODULE_PORT_ROWS][MODULE_PORT_COLS];
+    // Bumped by the reader to ask both cores to restart their loopMaxUs
+    extern volatile uint32_t g_resetRequest;
+    // Boot to the first time every detected module was live, in ms; 0 until then
+    extern volatile uint32_t g_gridReadyMs;
+
+    inline CoreCounters &core()
+    {
+        return g_core[get_core_num()];
+    }
+
+    inline PortCounters *port(int row, int col)
+    {
+        if (row < 0 || col < 0 || row >= MODULE_PORT_ROWS || col >= MODULE_PORT_COLS)
+            return nullptr;
+        return &g_ports[row][col];
+    }
+
+    // Call once at the top of loop()/loop1()
+    inline void loopTick()
+    {
+        CoreCounters &c = core();
+        const uint32_t now = time_us_32();
+        if (c.resetSeen != g_resetRequest)
+        {
+            c.resetSeen = g_resetRequest;
+            c.loopMaxUs = 0;
+        }
+        else if (c.loops)
+        {
+            const uint32_t elapsed = now - c.lastLoopUs;
+            if (elapsed > c.loopMaxUs)
+                c.loopMaxUs = elapsed;
+        }
+        c.lastLoopUs = now;
+        c.loops = c.loops + 1;
+    }
+
+    // STATS GET reply: uptimeUs(4) + rows(1) + cols(1),
+    // then per core (0, 1) loops, loopMaxUs, ipcQueueFull, hidQueueFull, messageDrops,
+    // then per port [row][col] rxFrames, txFrames, checksumErrors, crcErrors,
+    // parserResets, parserTimeouts, bringUpMs, then gridReadyMs; all u32
+    // little-endian
+    static constexpr size_t SNAPSHOT_SIZE = 6 + 2 * 5 * 4 + MODULE_PORT_ROWS * MODULE_PORT_COLS * 7 * 4 + 4;
+
+    // Fill `out` (SNAPSHOT_SIZE bytes); with resetMax the worst-case loop
+    // times restart after this read
+    void snapshot(uint8_t *out, bool resetMax);
+}
@@ -0,0 +1,152 @@
+#include "trace.h"
+#include "debug_printf.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/platform.h"
+
+namespace Trace
+{
+    namespace
+    {
+        constexpr uint32_t RING_SIZE = 128; // records per core, power of two
+        static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "RING_SIZE must be a power of two");
+
+        constexpr uint8_t FRAME_MAGIC = 0xA5;
+        constexpr int FRAME_MAX = 8 + MAX_ARGS * 4 + 1;
+        // Records written per drain() call, keeps loop() latency bounded
+        constexpr int DRAIN_BUDGET = 16;
+        constexpr uint32_t HELLO_INTERVAL_MS = 2000;
+
+        struct Entry
+        {
+            uint32_t stamp;
+            uint16_t id;
+            uint8_t nargs;
+            uint32_t args[MAX_ARGS];
+        };
+
+        // Single producer (the owning core, IRQs masked while pushing), single
+        // consumer (drain() on core 0). head and dropped are only written by
+        // the producer, tail and reported only by the consumer.
+        struct Ring
+        {
+            Entry entries[RING_SIZE];
+            volatile uint32_t head;
+            volatile uint32_t tail;
+            volatile uint32_t dropped;
+            uint32_t reported;
+        };
+
+        Ring g_rings[2];
+        uint32_t g_lastHelloMs = 0;
+        bool g_helloDue = true;
+
+        int encode(uint8_t *out, uint8_t core, uint16_t id, uint32_t stamp, uint8_t nargs, const uint32_t *args)
+        {
+            int n = 0;
+            out[n++] = FRAME_MAGIC;
+            out[n++] = (uint8_t)(core << 7 | nargs);
+            out[n++] = (uint8_t)(id & 0xFF);
+            out[n++] = (uint8_t)(id >> 8);
+            for (int i = 0; i < 4; i++)
+                out[n++] = (uint8_t)(stamp >> (8 * i));
+            for (int a = 0; a < nargs; a++)
+                for (int i = 0; i < 4; i++)
+                    out[n++] = (uint8_t)(args[a] >> (8 * i));
+            uint8_t sum = 0;
+            for (int i = 0; i < n; i++)
+                sum = (uint8_t)(sum + out[i]);
+            out[n++] = sum;
+            return n;
+        }
+
+        void writeRecord(uint8_t core, Id id, uint8_t nargs, const uint32_t *args)
+        {
+            uint8_t frame[FRAME_MAX];
+            const int len = encode(frame, core, id, time_us_32(), nargs, args);
+            Serial.write(frame, len);
+        }
+    }
+
+    void __not_in_flash_func(push)(Id id, uint8_t nargs, const uint32_t *args)
+    {
+        Ring &ring = g_rings[get_core_num()];
+        const uint32_t irq = save_and_disable_interrupts();
+        const uint32_t head = ring.head;
+        if (head - ring.tail >= RING_SIZE)
+        {
+            ring.dropped = ring.dropped + 1;
+            restore_interrupts(irq);
+            return;
+        }
+        Entry &e = ring.entries[head & (RING_SIZE - 1)];
+        e.stamp = time_us_32();
+        e.id = id;
+        e.nargs = nargs;
+        for (int i = 0; i < nargs; i++)
+            e.args[i] = args[i];
+        // Entry must be visible to core 0 before the new head
+        __dmb();
+        ring.head = head + 1;
+        restore_interrupts(irq);
+    }
+
+    void drain()
+    {
+        if (!g_debugPrintInited)
+            return;
+        if (!Serial)
+        {
+            // Resend the table hash once a host opens the port
+            g_helloDue = true;
+            return;
+        }
+        // Shares Serial with dbg_printf on core 1; try again next loop if busy
+        if (!mutex_try_enter(&g_debugPrintMutex, nullptr))
+            return;
+
+        const uint32_t now = millis();
+        if (g_helloDue || now - g_lastHelloMs >= HELLO_INTERVAL_MS)
+        {
+            if (Serial.availableForWrite() >= FRAME_MAX)
+            {
+                const uint32_t hello[] = {formatTableHash(), ID_COUNT};
+                writeRecord(0, TRACE_HELLO, 2, hello);
+                g_lastHelloMs = now;
+                g_helloDue = false;
+            }
+        }
+
+        int budget = DRAIN_BUDGET;
+        for (uint8_t core = 0; core < 2; core++)
+        {
+            Ring &ring = g_rings[core];
+
+            const uint32_t dropped = ring.dropped;
+            if (dropped != ring.reported && Serial.availableForWrite() >= FRAME_MAX)
+            {
+                const uint32_t info[] = {core, dropped - ring.reported};
+                writeRecord(core, TRACE_DROPPED, 2, info);
+                ring.reported = dropped;
+            }
+
+            const uint32_t head = ring.head;
+            __dmb();
+            uint32_t tail = ring.tail;
+            for (; tail != head && budget > 0; tail++, budget--)
+            {
+                if (Serial.availableForWrite() < FRAME_MAX)
+                    break;
+                const Entry &e = ring.entries[tail & (RING_SIZE - 1)];
+                uint8_t frame[FRAME_MAX];
+                const int len = encode(frame, core, e.id, e.stamp, e.nargs, e.args);
+                Serial.write(frame, len);
+            }
+            // Slots are reusable only after the copy above
+            __dmb();
+            ring.tail = tail;
+        }
+
+        mutex_exit(&g_debugPrintMutex);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "trace_formats.h"
+
+// Binary trace log for hot paths. TRACE(ID, args...) stores the format id, a
+// microsecond timestamp and up to four raw 32-bit arguments in the calling
+// core's ring; nothing is formatted on the device. Core 0 drains both rings
+// to Serial from loop() and tools/trace_decode.py renders the records with
+// the table in trace_formats.h. A full ring drops the record and counts it.
+//
+// Safe from either core, from interrupt handlers and while flash is parked.
+// Records interleave with dbg_printf text on Serial; the decoder passes text
+// through.
+//
+// Wire format, little-endian:
+//   0xA5, core << 7 | nargs, id (2), timestamp us (4), args (4 each), checksum
+// so the id is at offset 2, the timestamp at 4 and the args from 8; checksum
+// is the 8-bit sum of all preceding bytes.
+
+namespace Trace
+{
+    enum Id : uint16_t
+    {
+#define TRACE_ID(name, fmt) name,
+        TRACE_FORMATS(TRACE_ID)
+#undef TRACE_ID
+        ID_COUNT
+    };
+
+    static constexpr int MAX_ARGS = 4;
+
+    // FNV-1a over the format strings in table order, each followed by '\n'
+    constexpr uint32_t formatTableHash()
+    {
+        uint32_t h = 2166136261u;
+        const char *formats[] = {
+#define TRACE_FORMAT(name, fmt) fmt "\n",
+            TRACE_FORMATS(TRACE_FORMAT)
+#undef TRACE_FORMAT
+        };
+        for (const char *s : formats)
+        {
+            for (; *s; s++)
+            {
+                h ^= (uint8_t)*s;
+                h *= 16777619u;
+            }
+        }
+        return h;
+    }
+
+    void push(Id id, uint8_t nargs, const uint32_t *args);
+
+    // Called from core 0's loop(). Writes what fits in the Serial TX buffer.
+    void drain();
+
+    template <typename T>
+    inline uint32_t arg(T v)
+    {
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            const float f = (float)v;
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            return u;
+        }
+        else
+        {
+            return (uint32_t)v;
+        }
+    }
+
+    inline void record(Id id)
+    {
+        push(id, 0, nullptr);
+    }
+
+    template <typename... Args>
+    inline void record(Id id, Args... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "trace records carry at most 4 arguments");
+        const uint32_t values[] = {arg(args)...};
+        push(id, sizeof...(Args), values);
+    }
+}
+
+#define TRACE(id, ...) Trace::record(Trace::id, ##__VA_ARGS__)
@@ -0,0 +1,17 @@
+#pragma once
+
+// Trace format table: X(id, "printf format"). Records carry the id and up to
+// four 32-bit arguments; tools/trace_decode.py reads this file to render them
+// and checks it against the table hash the firmware sends in TRACE_HELLO.
+// Conversions: %d %i %u %x %X %c, and %f for float arguments.
+#define TRACE_FORMATS(X)                                                  \
+    X(TRACE_HELLO, "trace: table %08x, %u formats")                       \
+    X(TRACE_DROPPED, "trace: core%u dropped %u records")                  \
+    X(MAP_CURVE, "map %u curve count=%u h=%d input=%u")                   \
+    X(MAP_EMIT, "map type=%u r=%d c=%d value=%u")                         \
+    X(PORT_RX_BACKLOG, "warn: %u module messages queued, may overflow")   \
+    X(PORT_RX_NO_PORT, "warn: message for non-existent port r=%d c=%d")   \
+    X(PORT_RX_MALFORMED, "warn: malformed response r=%d c=%d cmd=%u len=%u") \
+    X(PORT_RX_ERROR, "warn: error response r=%d c=%d to cmd=%u")          \
+    X(PORT_PARAM_RANGE, "warn: param r=%d c=%d pid=%u out of range, resetting") \
+    X(PORT_TX_FULL, "warn: TX queue full r=%d c=%d, cmd=%u dropped")
@@ -9,9 +9,13 @@
 #include <pico/util/queue.h>
 #include <pico/sync.h>
 #include "ipc.hpp"
+#include "midi_state.h"
+#include "midi_router.h"
 #include "port.h"
 #include "mapping.h"
 #include "debug_printf.h"
+#include "stats.h"
+#include "profiler.h"
 
 static Adafruit_USBD_MIDI g_midi;
 static Adafruit_USBD_HID g_hid;
@@ -51,7 +55,9 @@ namespace Message
         INFO = 0,
         VERSION,
         MAP,
-        MODULES
+        MODULES,
+        LOG,
+        STATS
     };
 
     enum class ResponseType : uint8_t
@@ -61,7 +67,9 @@ namespace Message
         INFO,
         VERSION,
         MAP,
-        MODULES
+        MODULES,
+        LOG,
+        STATS
     };
 
     enum class EventType : uint8_t
@@ -78,14 +86,30 @@ namespace Message
         SET_CURVE,
         DEL,
         LIST,
-        CLEAR
+        CLEAR,
+        BULK_SET,
+        BANK,
+        SET_OPTIONS
     };
 
     enum class CommandSubModuleType : uint8_t
     {
         LIST = 0,
         PARAM_SET,
-        CALIB_SET
+        CALIB_SET,
+        LIST_SINCE
+    };
+
+    enum class CommandSubLogType : uint8_t
+    {
+        GET = 0,
+        SET
+    };
+
+    enum class CommandSubStatsType : uint8_t
+    {
+        GET = 0,
+        PROFILE
     };
 
     struct __attribute__((packed)) Message
@@ -96,7 +120,10 @@ namespace Message
         {
             CommandSubMapType mapSub;
             CommandSubModuleType modulesSub;
+            CommandSubLogType logSub;
+            CommandSubStatsType statsSub;
         } subcommand;
+        uint8_t seq;     // Host-chosen tag, echoed in the response
         uint16_t length; // Only contain len(data)
         uint16_t checksum;
         uint8_t *data;
@@ -105,29 +132,53 @@ namespace Message
 
 namespace usb
 {
-    // Minimum message size: header(5) + checksum(2) = 7 bytes
-    constexpr uint8_t MIN_MESSAGE_SIZE = 7;
-    // serial input circular buffer
-    constexpr uint32_t INPUT_BUF_SIZE = 512;
-    static uint8_t inputBuffer[INPUT_BUF_SIZE];
-    static size_t inputPos = 0;
+    // Header size: type(1) + command(1) + subcommand(1) + seq(1) + length(2) = 6 bytes
+    constexpr size_t HEADER_SIZE = 6;
+    // Minimum message size: header(6) + checksum(2) = 8 bytes
+    constexpr uint8_t MIN_MESSAGE_SIZE = 8;
+    // Largest accepted command frame (header + checksum + payload)
+    constexpr size_t MAX_FRAME_SIZE = 1280;
+    static_assert(HEADER_SIZE + 2 + 1 + MappingManager::MAX_BATCH * sizeof(ModuleMapping) <= MAX_FRAME_SIZE,
+                  "a full BULK_SET must fit in one frame");
+    // Stands in for a mapping removed while MAP LIST streams
+    static const ModuleMapping EMPTY_MAPPING = {};
+    // Commands parsed per task() call, so a burst cannot starve MIDI/HID
+    constexpr int MAX_MESSAGES_PER_TASK = 8;
+    // MIDI event packets read per task() call; the rest wait in the endpoint FIFO
+    constexpr int MAX_MIDI_IN_PER_TASK = 32;
+    // Timeout in microseconds (50ms)
+    constexpr uint64_t MESSAGE_TIMEOUT_US = 50000;
+
+    // Receive ring: the host may pipeline several commands back to back.
+    // Only core0 touches it; head/tail are free-running indices.
+    constexpr uint32_t RX_RING_SIZE = 2048;
+    static_assert((RX_RING_SIZE & (RX_RING_SIZE - 1)) == 0, "RX_RING_SIZE must be a power of two");
+    static uint8_t rxRing[RX_RING_SIZE];
+    static uint32_t rxHead = 0; // next write
+    static uint32_t rxTail = 0; // next read
     static uint64_t g_lastByteTime = 0;
-    static size_t g_expectedLength = 0;
-    static Message::Message g_currentMessage;
 
-    // Output buffer for preparing data to be packed (e.g., module list)
-    constexpr uint32_t OUTPUT_BUF_SIZE = 8192;
-    static uint8_t outputBuffer[OUTPUT_BUF_SIZE];
+    // Linear copy of the frame being processed (frames may wrap in the ring)
+    static uint8_t frameBuffer[MAX_FRAME_SIZE];
 
-    // Packed output buffer for sending responses (separate to avoid overwrite issues)
-    static uint8_t packedOutputBuffer[OUTPUT_BUF_SIZE];
+    // Sequence byte of the command being handled, echoed in every reply to it
+    static uint8_t g_replySeq = 0;
 
     static uint8_t desc_buffer[512];
 
-    // Header size: type(1) + command(1) + subcommand(1) + length(2) = 5 bytes
-    constexpr size_t HEADER_SIZE = 5;
-    // Timeout in microseconds (50ms)
-    constexpr uint64_t MESSAGE_TIMEOUT_US = 50000;
+    // (N)RPN parameter currently selected per MIDI channel, so repeated values
+    // to the same parameter only cost the two data entry CCs
+    static constexpr uint8_t MIDI_CC_NRPN_LSB = 98;
+    static constexpr uint8_t MIDI_CC_NRPN_MSB = 99;
+    static constexpr uint8_t MIDI_CC_RPN_LSB = 100;
+    static constexpr uint8_t MIDI_CC_RPN_MSB = 101;
+    static constexpr uint16_t PARAM_SELECT_RPN = 0x4000;
+    static constexpr uint16_t PARAM_SELECT_UNKNOWN = 0xFFFF;
+    static uint16_t g_paramSelected[16] = {
+        PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN,
+        PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN,
+        PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN,
+        PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN, PARAM_SELECT_UNKNOWN};
 
     static uint16_t crc16_update(uint16_t crc, uint8_t data)
     {
@@ -156,121 +207,196 @@ namespace usb
         return crc;
     }
 
-    // Send a response message with optional payload
-    static void sendResponse(Message::ResponseType responseType, uint8_t subcommand = 0,
-                             const uint8_t *data = nullptr, uint16_t dataLength = 0)
+    // Streams a response payload straight into the CDC TX FIFO, optionally
+    // zero run-length encoding it on the fly.
+    // Packed format: repeating blocks of [zeroCount(1), validCount(1), validBytes(validCount)]
+    //
+    // A stream runs in one of two modes: measuring only counts the encoded bytes
+    // and accumulates their CRC (initial value 0), emitting also writes them out
+    // through a small chunk buffer. Emitting is clamped/padded to `limit` so the
+    // frame length announced in the header always holds.
+    struct ResponseStream
     {
-        // Response format: type(1) + response(1) + subcommand(1) + length(2) + checksum(2) + data(length)
-        constexpr size_t RESPONSE_HEADER_SIZE = 5;
-        size_t totalSize = RESPONSE_HEADER_SIZE + sizeof(uint16_t) + dataLength;
+        static constexpr size_t CHUNK_SIZE = 64; // one CDC packet
 
-        // Use static output buffer for responses
-        if (totalSize > OUTPUT_BUF_SIZE)
-        {
-            dbg_printf("Response too large: %u bytes\n", totalSize);
-            return; // Response too large
-        }
+        bool packed;
+        bool emit;
+        uint32_t length; // encoded payload bytes produced so far
+        uint32_t limit;  // emit mode: exact number of payload bytes to send
+        uint16_t crc;    // CRC16 (initial value 0) over the encoded payload
 
-        outputBuffer[0] = static_cast<uint8_t>(Message::MessageType::RESPONSE);
-        outputBuffer[1] = static_cast<uint8_t>(responseType);
-        outputBuffer[2] = subcommand;
-        outputBuffer[3] = static_cast<uint8_t>(dataLength & 0xFF);        // Length LSB
-        outputBuffer[4] = static_cast<uint8_t>((dataLength >> 8) & 0xFF); // Length MSB
+        // Zero-RLE state of the block being built
+        uint8_t zeroCount;
+        uint8_t validCount;
+        uint8_t valid[255];
 
-        // Copy data payload directly
-        size_t dataOffset = RESPONSE_HEADER_SIZE + sizeof(uint16_t); // After checksum slot
-        if (dataLength > 0)
+        uint8_t chunk[CHUNK_SIZE];
+        uint8_t chunkLen;
+
+        ResponseStream(bool packed_, bool emit_, uint32_t limit_ = 0)
+            : packed(packed_), emit(emit_), length(0), limit(limit_), crc(0),
+              zeroCount(0), validCount(0), chunkLen(0)
         {
-            memcpy(&outputBuffer[dataOffset], data, dataLength);
         }
 
-        // Calculate checksum over header + data (excluding checksum slot)
-        // Checksum is calculated over: header(5) + data(dataLength)
-        uint16_t checksum = calculate_crc16(outputBuffer, RESPONSE_HEADER_SIZE);
-        for (uint16_t i = 0; i < dataLength; i++)
+        void flushChunk()
         {
-            checksum = crc16_update(checksum, outputBuffer[dataOffset + i]);
+            if (chunkLen > 0)
+            {
+                // Blocks (running tud_task) only while the CDC FIFO is full.
+                g_cdc_bin.write(chunk, chunkLen);
+                chunkLen = 0;
+            }
         }
-        // Insert checksum at fixed position (bytes 5-6)
-        outputBuffer[5] = static_cast<uint8_t>(checksum & 0xFF);        // Checksum LSB
-        outputBuffer[6] = static_cast<uint8_t>((checksum >> 8) & 0xFF); // Checksum MSB
-
-        size_t totalLen = RESPONSE_HEADER_SIZE + sizeof(uint16_t) + dataLength;
 
-        g_cdc_bin.write(outputBuffer, totalLen);
-        g_cdc_bin.flush();
-    }
-
-    // Use zero run length encoding to pack data
-    // Only to be used when sending resp to MODULES LIST
-    static void sendResponsePacked(Message::ResponseType responseType, uint8_t subcommand = 0,
-                                   const uint8_t *data = nullptr, uint16_t dataLength = 0)
-    {
-        // Response format: type(1) + response(1) + subcommand(1) + length(2) + checksum(2) + packed_data(length)
-        // Uses packedOutputBuffer to avoid overwriting input data if it's in outputBuffer
-        constexpr size_t RESPONSE_HEADER_SIZE = 5;
-
-        packedOutputBuffer[0] = static_cast<uint8_t>(Message::MessageType::RESPONSE);
-        packedOutputBuffer[1] = static_cast<uint8_t>(responseType);
-        packedOutputBuffer[2] = subcommand;
-
-        size_t packedOffset = RESPONSE_HEADER_SIZE + sizeof(uint16_t);
+        void rawByte(uint8_t b)
+        {
+            chunk[chunkLen++] = b;
+            if (chunkLen == CHUNK_SIZE)
+            {
+                flushChunk();
+            }
+        }
 
-        size_t i = 0;
-        while (i < dataLength)
+        // One byte of encoded payload
+        void out(uint8_t b)
         {
-            // Count zeros
-            uint8_t zeroCount = 0;
-            while (i < dataLength && data[i] == 0 && zeroCount < 255)
+            if (emit)
             {
-                zeroCount++;
-                i++;
+                if (length >= limit)
+                {
+                    return; // Source changed between passes; keep the framing intact.
+                }
+                rawByte(b);
             }
+            crc = crc16_update(crc, b);
+            length++;
+        }
 
-            // Count valid (non-zero) bytes
-            uint8_t validCount = 0;
-            size_t validStart = i;
-            while (i < dataLength && data[i] != 0 && validCount < 255)
+        void flushBlock()
+        {
+            out(zeroCount);
+            out(validCount);
+            for (uint8_t i = 0; i < validCount; i++)
             {
-                validCount++;
-                i++;
+                out(valid[i]);
             }
+            zeroCount = 0;
+            validCount = 0;
+        }
 
-            // Ensure we have space in packedOutputBuffer
-            if (packedOffset + 2 + validCount > OUTPUT_BUF_SIZE)
+        void put(uint8_t b)
+        {
+            if (!packed)
             {
-                dbg_printf("Packed response too large\n");
+                out(b);
                 return;
             }
+            if (b == 0)
+            {
+                // A zero after valid bytes, or a full zero run, closes the block.
+                if (validCount > 0 || zeroCount == 255)
+                {
+                    flushBlock();
+                }
+                zeroCount++;
+            }
+            else
+            {
+                if (validCount == 255)
+                {
+                    flushBlock();
+                }
+                valid[validCount++] = b;
+            }
+        }
 
-            packedOutputBuffer[packedOffset++] = zeroCount;
-            packedOutputBuffer[packedOffset++] = validCount;
-            if (validCount > 0)
+        void write(const void *data, size_t len)
+        {
+            const uint8_t *p = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < len; i++)
             {
-                memcpy(&packedOutputBuffer[packedOffset], &data[validStart], validCount);
-                packedOffset += validCount;
+                put(p[i]);
             }
         }
 
-        uint16_t packedDataLen = packedOffset - (RESPONSE_HEADER_SIZE + sizeof(uint16_t));
+        void finish()
+        {
+            if (packed && (zeroCount > 0 || validCount > 0))
+            {
+                flushBlock();
+            }
+            if (emit)
+            {
+                while (length < limit)
+                {
+                    out(0);
+                }
+                flushChunk();
+            }
+        }
+    };
 
-        // Update length in header
-        packedOutputBuffer[3] = static_cast<uint8_t>(packedDataLen & 0xFF);        // Length LSB
-        packedOutputBuffer[4] = static_cast<uint8_t>((packedDataLen >> 8) & 0xFF); // Length MSB
+    // Send a response whose payload is generated by `produce(ResponseStream &)`.
+    // The producer runs twice: once to measure the payload and once to stream it,
+    // so no staging buffer is needed. CRC16 is linear, hence
+    //   crc(header + data) = crc(header advanced over len zero bytes) ^ crc0(data)
+    // and the checksum in the header is known before the first payload byte.
+    // Response format: type(1) + response(1) + subcommand(1) + seq(1) + length(2) + checksum(2) + data(length)
+    template <typename Producer>
+    static void sendResponseStream(Message::ResponseType responseType, uint8_t subcommand, bool packed, Producer produce)
+    {
+        ResponseStream measure(packed, false);
+        produce(measure);
+        measure.finish();
 
-        // Calculate checksum over header + packed data
-        uint16_t checksum = calculate_crc16(packedOutputBuffer, RESPONSE_HEADER_SIZE);
-        for (size_t k = (RESPONSE_HEADER_SIZE + sizeof(uint16_t)); k < packedOffset; k++)
+        if (measure.length > 0xFFFF)
         {
-            checksum = crc16_update(checksum, packedOutputBuffer[k]);
+            LOG_WARN(LOG_USB, "Response too large: %lu bytes\n", (unsigned long)measure.length);
+            return;
         }
+        const uint16_t dataLength = static_cast<uint16_t>(measure.length);
+
+        uint8_t header[HEADER_SIZE];
+        header[0] = static_cast<uint8_t>(Message::MessageType::RESPONSE);
+        header[1] = static_cast<uint8_t>(responseType);
+        header[2] = subcommand;
+        header[3] = g_replySeq;
+        header[4] = static_cast<uint8_t>(dataLength & 0xFF);        // Length LSB
+        header[5] = static_cast<uint8_t>((dataLength >> 8) & 0xFF); // Length MSB
 
-        // Insert checksum at fixed position (bytes 5-6)
-        packedOutputBuffer[5] = static_cast<uint8_t>(checksum & 0xFF);        // Checksum LSB
-        packedOutputBuffer[6] = static_cast<uint8_t>((checksum >> 8) & 0xFF); // Checksum MSB
+        uint16_t checksum = calculate_crc16(header, HEADER_SIZE);
+        for (uint16_t i = 0; i < dataLength; i++)
+        {
+            checksum = crc16_update(checksum, 0);
+        }
+        checksum ^= measure.crc;
 
-        g_cdc_bin.write(packedOutputBuffer, packedOffset);
+        ResponseStream stream(packed, true, dataLength);
+        for (size_t i = 0; i < HEADER_SIZE; i++)
+        {
+            stream.rawByte(header[i]);
+        }
+        stream.rawByte(static_cast<uint8_t>(checksum & 0xFF));        // Checksum LSB
+        stream.rawByte(static_cast<uint8_t>((checksum >> 8) & 0xFF)); // Checksum MSB
+        produce(stream);
+        stream.finish();
         g_cdc_bin.flush();
+
+        if (stream.crc != measure.crc)
+        {
+            // Port state is owned by core1 and may change between the two passes;
+            // the host drops this frame on CRC mismatch and asks again.
+            LOG_WARN(LOG_USB, "Response changed while streaming\n");
+        }
+    }
+
+    // Send a response message with optional payload
+    static void sendResponse(Message::ResponseType responseType, uint8_t subcommand = 0,
+                             const uint8_t *data = nullptr, uint16_t dataLength = 0)
+    {
+        sendResponseStream(responseType, subcommand, false, [&](ResponseStream &s)
+                           { s.write(data, dataLength); });
     }
 
     void sendAck()
@@ -289,9 +415,9 @@ namespace usb
         {
         case Message::CommandSubMapType::SET:
         {
-            // Payload format: row(1) + col(1) + paramId(1) + type(1) + d1(1) + d2(1)
-
-            if (msg->length != 6)
+            // Payload format: row(1) + col(1) + paramId(1) + type(1) + d1(1) + d2(1) [+ d3(1) [+ target(1)]]
+            // d3 is only used by (N)RPN targets (parameter LSB) and relative CCs.
+            if (msg->length < 6 || msg->length > 8)
             {
                 sendNack();
                 return; // Invalid length
@@ -302,7 +428,23 @@ namespace usb
             uint8_t type = msg->data[3];
             uint8_t d1 = msg->data[4];
             uint8_t d2 = msg->data[5];
-            MappingManager::updateMapping((int)row, (int)col, paramId, (ActionType)type, d1, d2);
+            uint8_t d3 = msg->length >= 7 ? msg->data[6] : 0;
+            uint8_t target = msg->length == 8 ? msg->data[7] : 0;
+            if (target >= MAPPING_TARGETS_PER_PARAM)
+            {
+                sendNack();
+                return; // Invalid target index
+            }
+            if (type > ACTION_MIDI_CC_RELATIVE)
+            {
+                sendNack();
+                return; // Unknown action type
+            }
+            if (!MappingManager::updateMapping((int)row, (int)col, paramId, (ActionType)type, d1, d2, d3, target))
+            {
+                sendNack();
+                return; // No such port or parameter, or the pool is full
+            }
             // Sync after update
             IPC::enqueueSyncMapping((int)row, (int)col);
             sendAck();
@@ -310,10 +452,10 @@ namespace usb
         }
         case Message::CommandSubMapType::SET_CURVE:
         {
-            // Payload format: row(1) + col(1) + paramId(1) + curve(sizeof(Curve))
-            if (msg->length != 3 + sizeof(Curve))
+            // Payload format: row(1) + col(1) + paramId(1) + curve(sizeof(Curve)) [+ target(1)]
+            if (msg->length != 3 + sizeof(Curve) && msg->length != 4 + sizeof(Curve))
             {
-                dbg_printf("SET_CURVE: expected length %d, got %d\n", (int)(3 + sizeof(Curve)), msg->length);
+                LOG_WARN(LOG_USB, "SET_CURVE: expected length %d, got %d\n", (int)(3 + sizeof(Curve)), msg->length);
                 sendNack();
                 return; // Invalid length
             }
@@ -326,16 +468,42 @@ namespace usb
                 sendNack();
                 return; // Invalid curve data
             }
-            MappingManager::updateMappingCurve((int)row, (int)col, paramId, curve);
+            uint8_t target = msg->length == 4 + sizeof(Curve) ? msg->data[3 + sizeof(Curve)] : 0;
+            if (!MappingManager::updateMappingCurve((int)row, (int)col, paramId, curve, target))
+            {
+                sendNack();
+                return; // Target out of range or no such mapping
+            }
             // Sync after update
             IPC::enqueueSyncMapping((int)row, (int)col);
             sendAck();
             return;
         }
+        case Message::CommandSubMapType::SET_OPTIONS:
+        {
+            // Payload format: row(1) + col(1) + paramId(1) + deadband(1) + smoothing(1) + slew(1) + flags(1) [+ target(1)]
+            // Filters run on the host only, so the module is not synced.
+            if (msg->length != 3 + sizeof(MappingOptions) && msg->length != 4 + sizeof(MappingOptions))
+            {
+                sendNack();
+                return; // Invalid length
+            }
+            MappingOptions options;
+            memcpy(&options, &msg->data[3], sizeof(options));
+            uint8_t target = msg->length == 4 + sizeof(MappingOptions) ? msg->data[3 + sizeof(MappingOptions)] : 0;
+            if (options.smoothing > MAPPING_SMOOTHING_MAX ||
+                !MappingManager::updateMappingOptions((int)msg->data[0], (int)msg->data[1], msg->data[2], options, target))
+            {
+                sendNack();
+                return; // Out of range or no such mapping
+            }
+            sendAck();
+            return;
+        }
         case Message::CommandSubMapType::DEL:
         {
-            // Payload format: row(1) + col(1) + paramId(1)
-            if (msg->length != 3)
+            // Payload format: row(1) + col(1) + paramId(1) [+ target(1)]
+            if (msg->length != 3 && msg->length != 4)
             {
                 sendNack();
                 return; // Invalid length
@@ -343,7 +511,8 @@ namespace usb
             uint8_t row = msg->data[0];
             uint8_t col = msg->data[1];
             uint8_t paramId = msg->data[2];
-            bool deleted = MappingManager::deleteMapping((int)row, (int)col, paramId);
+            uint8_t target = msg->length == 4 ? msg->data[3] : 0;
+            bool deleted = MappingManager::deleteMapping((int)row, (int)col, paramId, target);
             if (deleted)
             {
                 // Sync after delete
@@ -364,18 +533,21 @@ namespace usb
                 sendNack();
                 return; // Invalid length
             }
-            uint8_t totalMappings = MappingManager::count();
-            uint32_t responseSize = totalMappings * sizeof(ModuleMapping) + 1;
-            if (responseSize > OUTPUT_BUF_SIZE)
-            {
-                sendNack();
-                return; // Response too large (impossible but check anyway)
-            }
-
-            outputBuffer[0] = totalMappings;
-            memcpy(&outputBuffer[1], MappingManager::getAllMappings(), totalMappings * sizeof(ModuleMapping));
-            sendResponsePacked(Message::ResponseType::MAP, static_cast<uint8_t>(Message::CommandSubMapType::LIST),
-                               outputBuffer, responseSize);
+            // Zero-RLE packed: count(1) + ModuleMapping[count], in key order
+            sendResponseStream(Message::ResponseType::MAP, static_cast<uint8_t>(Message::CommandSubMapType::LIST), true,
+                               [](ResponseStream &s)
+                               {
+                                   const uint8_t totalMappings = static_cast<uint8_t>(MappingManager::count());
+                                   s.put(totalMappings);
+                                   for (uint8_t i = 0; i < totalMappings; i++)
+                                   {
+                                       const ModuleMapping *m = MappingManager::getByIndex(i);
+                                       if (m)
+                                           s.write(m, sizeof(ModuleMapping));
+                                       else
+                                           s.write(&EMPTY_MAPPING, sizeof(ModuleMapping)); // removed meanwhile, keep the length
+                                   }
+                               });
             return;
         }
         case Message::CommandSubMapType::CLEAR:
@@ -390,6 +562,85 @@ namespace usb
             sendAck();
             return;
         }
+        case Message::CommandSubMapType::BULK_SET:
+        {
+            // Payload format: count(1, up to MappingManager::MAX_BATCH) + ModuleMapping[count]
+            // All mappings are validated and applied as one transaction, then
+            // every affected port is synced once.
+            if (msg->length < 1)
+            {
+                sendNack();
+                return; // Invalid length
+            }
+            const uint8_t count = msg->data[0];
+            if (count > MappingManager::MAX_BATCH || msg->length != 1 + count * sizeof(ModuleMapping))
+            {
+                LOG_WARN(LOG_USB, "BULK_SET: bad length %d for count %d\n", msg->length, count);
+                sendNack();
+                return; // Invalid length
+            }
+
+            static ModuleMapping batch[MappingManager::MAX_BATCH];
+            memcpy(batch, &msg->data[1], count * sizeof(ModuleMapping));
+
+            bool affected[MODULE_PORT_ROWS][MODULE_PORT_COLS] = {};
+            for (int i = 0; i < count; i++)
+            {
+                const ModuleMapping &m = batch[i];
+                if (m.row < 0 || m.col < 0 || m.row >= MODULE_PORT_ROWS || m.col >= MODULE_PORT_COLS ||
+                    m.paramId >= MappingManager::PARAMS_PER_MODULE || m.type > ACTION_MIDI_CC_RELATIVE || !CurveEvaluator::isValid(m.curve) ||
+                    m.options.smoothing > MAPPING_SMOOTHING_MAX || m.targetIndex >= MAPPING_TARGETS_PER_PARAM)
+                {
+                    sendNack();
+                    return; // Invalid mapping, nothing applied
+                }
+                affected[m.row][m.col] = true;
+            }
+
+            if (!MappingManager::setMappings(batch, count))
+            {
+                sendNack();
+                return; // Mapping table full, nothing applied
+            }
+
+            for (int r = 0; r < MODULE_PORT_ROWS; r++)
+            {
+                for (int c = 0; c < MODULE_PORT_COLS; c++)
+                {
+                    if (affected[r][c])
+                    {
+                        IPC::enqueueSyncMapping(r, c);
+                    }
+                }
+            }
+            sendAck();
+            return;
+        }
+        case Message::CommandSubMapType::BANK:
+        {
+            // Payload format: empty (query) or bank(1) [+ flags(1), bit0 = resync modules]
+            // Response: activeBank(1) + bankCount(1)
+            if (msg->length > 2)
+            {
+                sendNack();
+                return; // Invalid length
+            }
+            uint8_t reply[2] = {MappingManager::getActiveBank(), static_cast<uint8_t>(MappingManager::BANK_COUNT)};
+            if (msg->length >= 1)
+            {
+                const uint8_t bank = msg->data[0];
+                const bool resync = msg->length == 2 && (msg->data[1] & 0x01);
+                if (bank >= MappingManager::BANK_COUNT || !IPC::enqueueSelectBank(bank, resync))
+                {
+                    sendNack();
+                    return;
+                }
+                // Core1 performs the switch; report the bank it is about to activate
+                reply[0] = bank;
+            }
+            sendResponse(Message::ResponseType::MAP, static_cast<uint8_t>(Message::CommandSubMapType::BANK), reply, sizeof(reply));
+            return;
+        }
         default:
             sendNack();
             return;
@@ -402,18 +653,70 @@ namespace usb
         {
         case Message::CommandSubModuleType::LIST:
         {
-            // Convert port states to packed format for transmission
-            static PortStatePacked packedPorts[MODULE_PORT_ROWS * MODULE_PORT_COLS];
-            Port::State *ports = Port::getAll();
+            // Zero-RLE packed PortStatePacked[MODULE_PORT_ROWS * MODULE_PORT_COLS], converted one port at a time
+            sendResponseStream(Message::ResponseType::MODULES, static_cast<uint8_t>(Message::CommandSubModuleType::LIST), true,
+                               [](ResponseStream &s)
+                               {
+                                   Port::State *ports = Port::getAll();
+                                   PortStatePacked packed;
+                                   for (int i = 0; i < MODULE_PORT_ROWS * MODULE_PORT_COLS; i++)
+                                   {
+                                       Port::toPackedState(ports[i], packed);
+                                       s.write(&packed, sizeof(packed));
+                                   }
+                               });
+            break;
+        }
+        case Message::CommandSubModuleType::LIST_SINCE:
+        {
+            // Payload: since(4, u32 LE)
+            // Response (zero-RLE packed): generation(4) + count(1) + PortStatePacked[count]
+            // holding only the ports whose generation is greater than `since`.
+            if (msg->length < 4)
+            {
+                sendNack();
+                return; // Invalid length
+            }
+            uint32_t since = 0;
+            memcpy(&since, msg->data, sizeof(since));
+
+            // Load the global generation before the per-port ones: every change
+            // up to `generation` is then guaranteed to be selected below.
+            const uint32_t generation = Port::getGeneration();
+            if (since > generation)
+            {
+                since = 0; // Host is ahead of us (device restarted), resend everything
+            }
 
+            // Select ports once so both streaming passes agree on the set.
+            Board::PortMask changedMask{};
+            uint8_t changedCount = 0;
+            static_assert(Board::PortMask::SLOTS <= 0xFF, "LIST_SINCE port count is one byte");
             for (int i = 0; i < MODULE_PORT_ROWS * MODULE_PORT_COLS; i++)
             {
-                Port::toPackedState(ports[i], packedPorts[i]);
+                if (Port::getPortGeneration(i / MODULE_PORT_COLS, i % MODULE_PORT_COLS) > since)
+                {
+                    changedMask.set(i);
+                    changedCount++;
+                }
             }
 
-            sendResponsePacked(Message::ResponseType::MODULES, static_cast<uint8_t>(Message::CommandSubModuleType::LIST),
-                               reinterpret_cast<uint8_t *>(packedPorts),
-                               sizeof(PortStatePacked) * MODULE_PORT_ROWS * MODULE_PORT_COLS);
+            sendResponseStream(Message::ResponseType::MODULES, static_cast<uint8_t>(Message::CommandSubModuleType::LIST_SINCE), true,
+                               [&](ResponseStream &s)
+                               {
+                                   s.write(&generation, sizeof(generation));
+                                   s.put(changedCount);
+                                   Port::State *ports = Port::getAll();
+                                   PortStatePacked packed;
+                                   for (int i = 0; i < MODULE_PORT_ROWS * MODULE_PORT_COLS; i++)
+                                   {
+                                       if (changedMask.test(i))
+                                       {
+                                           Port::toPackedState(ports[i], packed);
+                                           s.write(&packed, sizeof(packed));
+                                       }
+                                   }
+                               });
             break;
         }
         case Message::CommandSubModuleType::PARAM_SET:
@@ -427,7 +730,11 @@ namespace usb
             uint8_t col = msg->data[1];
             uint8_t paramId = msg->data[2];
             uint8_t dataType = msg->data[3];
-            const char *valueStr = reinterpret_cast<const char *>(&msg->data[4]);
+            // The value text is not NUL-terminated on the wire: bound it by the frame
+            char valueStr[sizeof(IPC::SetParameterRequest::valueStr)];
+            const size_t valueLen = msg->length - 4u < sizeof(valueStr) - 1 ? msg->length - 4u : sizeof(valueStr) - 1;
+            memcpy(valueStr, &msg->data[4], valueLen);
+            valueStr[valueLen] = '\0';
 
             Port::State *p = Port::get(row, col);
             if (!p || !p->configured || !p->hasModule)
@@ -464,6 +771,69 @@ namespace usb
         }
     }
 
+    void handleLog(Message::Message *msg)
+    {
+        // SET payload: level(1) + subsystem mask(1), see debug_printf.h
+        // Response: level(1) + mask(1) + compiled level(1) + compiled mask(1)
+        switch (msg->subcommand.logSub)
+        {
+        case Message::CommandSubLogType::GET:
+            break;
+        case Message::CommandSubLogType::SET:
+            if (msg->length != 2 || !log_set_filter(msg->data[0], msg->data[1]))
+            {
+                sendNack();
+                return;
+            }
+            break;
+        default:
+            sendNack();
+            return;
+        }
+        const uint8_t reply[4] = {g_logLevel, g_logMask, PICONTROL_LOG_LEVEL, PICONTROL_LOG_MASK};
+        sendResponse(Message::ResponseType::LOG, static_cast<uint8_t>(msg->subcommand.logSub), reply, sizeof(reply));
+    }
+
+    void handleStats(Message::Message *msg)
+    {
+        switch (msg->subcommand.statsSub)
+        {
+        case Message::CommandSubStatsType::GET:
+        {
+            // Payload: empty or flags(1), bit0 = restart the worst-case loop times
+            // Response: Stats::snapshot() layout, see stats.h
+            if (msg->length > 1)
+            {
+                sendNack();
+                return;
+            }
+            const bool resetMax = msg->length == 1 && (msg->data[0] & 0x01);
+            // Snapshot first: the response is produced twice and must not change
+            static uint8_t snapshot[Stats::SNAPSHOT_SIZE];
+            Stats::snapshot(snapshot, resetMax);
+            sendResponse(Message::ResponseType::STATS, static_cast<uint8_t>(Message::CommandSubStatsType::GET), snapshot, sizeof(snapshot));
+            return;
+        }
+        case Message::CommandSubStatsType::PROFILE:
+        {
+            // Payload: empty
+            // Response: core 1 load over the last window, see Profiler::snapshot()
+            if (msg->length != 0)
+            {
+                sendNack();
+                return;
+            }
+            uint8_t profile[Profiler::SNAPSHOT_SIZE];
+            Profiler::snapshot(profile);
+            sendResponse(Message::ResponseType::STATS, static_cast<uint8_t>(Message::CommandSubStatsType::PROFILE), profile, sizeof(profile));
+            return;
+        }
+        default:
+            sendNack();
+            return;
+        }
+    }
+
     void init()
     {
         if (g_usbStarted)
@@ -489,6 +859,7 @@ namespace usb
         // MIDI
         g_midi.setStringDescriptor("Picontrol MIDI Interface");
         MIDI.begin(MIDI_CHANNEL_OMNI);
+        MidiState::init();
 
         // HID keyboard
         g_hid.setBootProtocol(HID_ITF_PROTOCOL_KEYBOARD);
@@ -516,7 +887,8 @@ namespace usb
         }
         if (length < usb::MIN_MESSAGE_SIZE)
         {
-            dbg_printf("Message too short\n");
+            g_replySeq = (length > 3) ? messageBuffer[3] : 0;
+            LOG_WARN(LOG_USB, "Message too short\n");
             sendNack();
             return; // too short to be valid
         }
@@ -526,27 +898,30 @@ namespace usb
         msg.type = static_cast<Message::MessageType>(messageBuffer[0]);
         msg.command = static_cast<Message::CommandType>(messageBuffer[1]);
         msg.subcommand.mapSub = static_cast<Message::CommandSubMapType>(messageBuffer[2]);
-        msg.length = static_cast<uint16_t>(messageBuffer[3]) | (static_cast<uint16_t>(messageBuffer[4]) << 8);
-        msg.checksum = static_cast<uint16_t>(messageBuffer[5]) | (static_cast<uint16_t>(messageBuffer[6]) << 8);
-        msg.data = &messageBuffer[HEADER_SIZE + sizeof(uint16_t)]; // Payload starts at byte 7
+        msg.seq = messageBuffer[3];
+        msg.length = static_cast<uint16_t>(messageBuffer[4]) | (static_cast<uint16_t>(messageBuffer[5]) << 8);
+        msg.checksum = static_cast<uint16_t>(messageBuffer[6]) | (static_cast<uint16_t>(messageBuffer[7]) << 8);
+        msg.data = &messageBuffer[HEADER_SIZE + sizeof(uint16_t)]; // Payload starts at byte 8
+
+        g_replySeq = msg.seq;
 
-        // Calculate checksum over header(5) + payload (excluding checksum bytes)
+        // Calculate checksum over header(6) + payload (excluding checksum bytes)
         uint16_t calculatedChecksum = calculate_crc16(messageBuffer, HEADER_SIZE);
-        // Continue CRC over payload portion (starts at byte 7)
+        // Continue CRC over payload portion (starts at byte 8)
         for (size_t i = HEADER_SIZE + sizeof(uint16_t); i < length; i++)
         {
             calculatedChecksum = crc16_update(calculatedChecksum, messageBuffer[i]);
         }
         if (calculatedChecksum != msg.checksum)
         {
-            dbg_printf("Checksum mismatch: calc=%04X recv=%04X\n", calculatedChecksum, msg.checksum);
+            LOG_WARN(LOG_USB, "Checksum mismatch: calc=%04X recv=%04X\n", calculatedChecksum, msg.checksum);
             sendNack();
             return; // checksum mismatch
         }
         // Only COMMAND messages are allowed for incoming messages
         if (msg.type != Message::MessageType::COMMAND)
         {
-            dbg_printf("Invalid message type\n");
+            LOG_WARN(LOG_USB, "Invalid message type\n");
             sendNack();
             return;
         }
@@ -554,15 +929,21 @@ namespace usb
         switch (msg.command)
         {
         case Message::CommandType::MAP:
-            dbg_printf("MAP command received\n");
+            LOG_DEBUG(LOG_USB, "MAP command received\n");
             handleMap(&msg);
             break;
         case Message::CommandType::MODULES:
-            dbg_printf("MODULES command received\n");
+            LOG_DEBUG(LOG_USB, "MODULES command received\n");
             handleModules(&msg);
             break;
+        case Message::CommandType::LOG:
+            handleLog(&msg);
+            break;
+        case Message::CommandType::STATS:
+            handleStats(&msg);
+            break;
         default:
-            dbg_printf("Unknown command received\n");
+            LOG_WARN(LOG_USB, "Unknown command received\n");
             sendNack();
             return;
             // Unknown command
@@ -589,8 +970,12 @@ namespace usb
     bool sendMidiCC(uint8_t channel, uint8_t controller, uint8_t value, uint8_t cable)
     {
         (void)cable;
+        // A plain CC mapping may target the (N)RPN select controllers itself
+        if (controller >= MIDI_CC_NRPN_LSB && controller <= MIDI_CC_RPN_MSB)
+            g_paramSelected[channel & 0x0F] = PARAM_SELECT_UNKNOWN;
         uint8_t ch = (channel & 0x0F) + 1;
         MIDI.sendControlChange((uint8_t)(controller & 0x7F), (uint8_t)(value & 0x7F), ch);
+        MidiState::setControl(channel, controller, value);
         return true;
     }
 
@@ -609,6 +994,8 @@ namespace usb
         uint8_t ch = (channel & 0x0F) + 1;
         MIDI.sendControlChange(ctrlMsb, msb, ch);
         MIDI.sendControlChange(ctrlLsb, lsb, ch);
+        MidiState::setControl(channel, ctrlMsb, msb);
+        MidiState::setControl(channel, ctrlLsb, lsb);
         return true;
     }
 
@@ -624,6 +1011,39 @@ namespace usb
         return true;
     }
 
+    bool sendMidiParam(uint8_t channel, bool rpn, uint16_t param14, uint16_t value14, uint8_t cable)
+    {
+        (void)cable;
+        if (value14 > 16383)
+            value14 = 16383;
+        param14 &= 0x3FFF;
+
+        const uint8_t idx = channel & 0x0F;
+        const uint8_t ch = idx + 1;
+        const uint16_t select = (uint16_t)(param14 | (rpn ? PARAM_SELECT_RPN : 0));
+        if (g_paramSelected[idx] != select)
+        {
+            MIDI.sendControlChange(rpn ? MIDI_CC_RPN_MSB : MIDI_CC_NRPN_MSB, (uint8_t)(param14 >> 7), ch);
+            MIDI.sendControlChange(rpn ? MIDI_CC_RPN_LSB : MIDI_CC_NRPN_LSB, (uint8_t)(param14 & 0x7F), ch);
+            g_paramSelected[idx] = select;
+        }
+
+        // Data entry MSB then LSB
+        MIDI.sendControlChange(6, (uint8_t)((value14 >> 7) & 0x7F), ch);
+        MIDI.sendControlChange(38, (uint8_t)(value14 & 0x7F), ch);
+        return true;
+    }
+
+    // queue_try_add on the HID queue, counting drops against the calling core
+    static bool enqueueHid(const HidKeyMsg &msg)
+    {
+        if (queue_try_add(&g_hidQ, &msg))
+            return true;
+        Stats::CoreCounters &stats = Stats::core();
+        stats.hidQueueFull = stats.hidQueueFull + 1;
+        return false;
+    }
+
     bool sendKeypress(uint8_t hidKeycode, uint8_t modifier)
     {
         HidKeyMsg press{modifier, hidKeycode, true};
@@ -631,9 +1051,9 @@ namespace usb
 
         // If press enqueues but release doesn't, host may see stuck key
         // Hence both or none must succeed
-        if (!queue_try_add(&g_hidQ, &press))
+        if (!enqueueHid(press))
             return false;
-        if (!queue_try_add(&g_hidQ, &release))
+        if (!enqueueHid(release))
             return false;
         return true;
     }
@@ -641,89 +1061,93 @@ namespace usb
     bool sendKeyDown(uint8_t hidKeycode, uint8_t modifier)
     {
         HidKeyMsg press{modifier, hidKeycode, true};
-        return queue_try_add(&g_hidQ, &press);
+        return enqueueHid(press);
     }
 
     bool sendKeyUp(uint8_t hidKeycode)
     {
         HidKeyMsg release{0, hidKeycode, false};
-        return queue_try_add(&g_hidQ, &release);
+        return enqueueHid(release);
     }
 
     void task()
     {
         uint64_t timestamp = to_us_since_boot(get_absolute_time());
 
-        // Check for timeout (50ms) - clear current message if no data received
-        if (inputPos > 0 && (timestamp - g_lastByteTime) > MESSAGE_TIMEOUT_US)
+        // MIDI from the host: keeps MidiState in step with the DAW and feeds
+        // matching values back to the modules
+        uint8_t midiPacket[4];
+        for (int n = 0; n < MAX_MIDI_IN_PER_TASK && g_midi.readPacket(midiPacket); n++)
         {
-            inputPos = 0;
-            g_expectedLength = 0;
+            MidiState::handlePacket(midiPacket);
+            MidiRouter::handlePacket(midiPacket);
         }
 
         // Drain Serial
         if (g_cdc_bin)
         {
-            // Parse incoming serial data
-            while (g_cdc_bin.available())
+            // Move whatever fits into the ring; the rest waits in the CDC FIFO
+            // (the host is throttled by USB flow control instead of losing data).
+            while (g_cdc_bin.available() && (rxHead - rxTail) < RX_RING_SIZE)
             {
-                uint8_t byte = g_cdc_bin.read();
+                const uint32_t free = RX_RING_SIZE - (rxHead - rxTail);
+                const uint32_t offset = rxHead & (RX_RING_SIZE - 1);
+                uint32_t chunk = RX_RING_SIZE - offset; // contiguous space up to the wrap
+                if (chunk > free)
+                    chunk = free;
+                const size_t n = g_cdc_bin.read(&rxRing[offset], chunk);
+                if (n == 0)
+                    break;
+                rxHead += static_cast<uint32_t>(n);
                 g_lastByteTime = timestamp;
+            }
 
-                // Store byte in buffer
-                if (inputPos < INPUT_BUF_SIZE)
+            // Parse as many complete messages as are buffered
+            bool partial = false;
+            for (int handled = 0; handled < MAX_MESSAGES_PER_TASK; handled++)
+            {
+                const uint32_t buffered = rxHead - rxTail;
+                if (buffered < HEADER_SIZE)
                 {
-                    inputBuffer[inputPos++] = byte;
+                    partial = buffered > 0;
+                    break;
                 }
-                else
+
+                // length is little-endian uint16_t at index 4-5
+                const uint16_t payloadLength = static_cast<uint16_t>(rxRing[(rxTail + 4) & (RX_RING_SIZE - 1)]) |
+                                               (static_cast<uint16_t>(rxRing[(rxTail + 5) & (RX_RING_SIZE - 1)]) << 8);
+                // Expected total: header + checksum (2 bytes) + data (length bytes)
+                const size_t expectedLength = HEADER_SIZE + sizeof(uint16_t) + payloadLength;
+
+                // Sanity check - an impossible length means we lost framing, drop what we have
+                if (expectedLength > MAX_FRAME_SIZE)
                 {
-                    // Buffer overflow - reset
-                    inputPos = 0;
-                    g_expectedLength = 0;
-                    continue;
+                    LOG_WARN(LOG_USB, "Message too large: %u bytes\n", (unsigned)expectedLength);
+                    rxTail = rxHead;
+                    break;
                 }
-
-                // Once we have the header, calculate expected total length
-                if (inputPos >= HEADER_SIZE && g_expectedLength == 0)
+                if (buffered < expectedLength)
                 {
-                    // Parse header fields
-                    g_currentMessage.type = static_cast<Message::MessageType>(inputBuffer[0]);
-                    g_currentMessage.command = static_cast<Message::CommandType>(inputBuffer[1]);
-                    // subcommand at index 2 (will be parsed based on command type)
-                    g_currentMessage.subcommand.mapSub = static_cast<Message::CommandSubMapType>(inputBuffer[2]);
-                    // length is little-endian uint16_t at index 3-4
-                    g_currentMessage.length = static_cast<uint16_t>(inputBuffer[3]) |
-                                              (static_cast<uint16_t>(inputBuffer[4]) << 8);
-
-                    // Expected total: header + data (length bytes) + checksum (2 bytes)
-                    g_expectedLength = HEADER_SIZE + g_currentMessage.length + sizeof(uint16_t);
-
-                    // Sanity check - if expected length exceeds buffer, reset
-                    if (g_expectedLength > INPUT_BUF_SIZE)
-                    {
-                        inputPos = 0;
-                        g_expectedLength = 0;
-                        continue;
-                    }
+                    partial = true;
+                    break; // Wait for the rest
                 }
 
-                // Check if we have received the complete message
-                if (g_expectedLength > 0 && inputPos >= g_expectedLength)
+                for (size_t i = 0; i < expectedLength; i++)
                 {
-                    // Wire format: header(5) + checksum(2) + payload(length)
-                    // Extract checksum from bytes 5-6 (right after header)
-                    g_currentMessage.checksum = static_cast<uint16_t>(inputBuffer[HEADER_SIZE]) |
-                                                (static_cast<uint16_t>(inputBuffer[HEADER_SIZE + 1]) << 8);
-
-                    // Set data pointer to the payload portion (starts at byte 7)
-                    g_currentMessage.data = &inputBuffer[HEADER_SIZE + sizeof(uint16_t)];
+                    frameBuffer[i] = rxRing[(rxTail + i) & (RX_RING_SIZE - 1)];
+                }
+                rxTail += static_cast<uint32_t>(expectedLength);
 
-                    processMessage(inputBuffer, g_expectedLength);
+                processMessage(frameBuffer, expectedLength);
+            }
 
-                    // Reset
-                    inputPos = 0;
-                    g_expectedLength = 0;
-                }
+            // A frame whose rest has not come for 50ms lost bytes: drop it.
+            // Only the frame at the head can be partial (everything buffered
+            // behind it belongs to it); complete frames left over from the
+            // per-call budget are kept for the next call.
+            if (partial && (timestamp - g_lastByteTime) > MESSAGE_TIMEOUT_US)
+            {
+                rxTail = rxHead;
             }
         }
 
@@ -17,6 +17,9 @@ namespace usb
     bool sendMidiCC(uint8_t channel, uint8_t controller, uint8_t value, uint8_t cable = 0);
     bool sendMidiCC14(uint8_t channel, uint8_t controllerMsb, uint16_t value14, uint8_t cable = 0);
     bool sendMidiPitchBend(uint8_t channel, uint16_t value14, uint8_t cable = 0);
+    // 14-bit NRPN/RPN value. The parameter number is only (re)selected when it
+    // differs from the last one selected on that channel.
+    bool sendMidiParam(uint8_t channel, bool rpn, uint16_t param14, uint16_t value14, uint8_t cable = 0);
 
     bool sendKeypress(uint8_t hidKeycode, uint8_t modifier = 0);
     bool sendKeyDown(uint8_t hidKeycode, uint8_t modifier = 0);
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Check that the code core1 runs while it is parked for a flash write is in RAM.
+
+MappingStore parks core1 in a RAM loop while core0 programs or erases flash,
+with core1's interrupts enabled. XIP is unavailable meanwhile, so the park
+loop, every IRQ handler enabled on core1 and everything they call must be
+RAM-resident (__not_in_flash_func, or inlined into such a function).
+
+The firmware is disassembled, direct calls and branches are followed from the
+roots below, and every function reached that lives in flash is reported. A
+flash function that the linker reached through a RAM veneer counts as flash.
+Indirect calls (blx rN) can't be followed; the functions they reach must be
+listed as roots.
+
+    tools/check_ram_isr.py .pio/build/pico/firmware.elf
+
+Also runs after every PlatformIO build (extra_scripts in platformio.ini).
+There it only warns, until its output has been checked against a real ELF;
+`custom_ram_isr_strict = yes` in the environment makes a finding fail the
+build. tools/test_check_ram_isr.py covers the parser on canned disassembly.
+"""
+
+import re
+import subprocess
+import sys
+
+# Demangled names (without the argument list) of the functions core1 may run
+# during a park
+ROOTS = [
+    "MappingStore::serviceFlashPark",  # the park loop
+    "pio0_irq",                        # PIO0_IRQ_0, module RX
+    "pio1_irq",                        # PIO1_IRQ_0, module RX
+    "shared_rotate_irq",               # TIMER_IRQ_n, shared-SM rotation
+    "Port::messageSinkFromIRQ",        # called through g_messageSink
+    "Trace::push",                     # TRACE() from interrupt context
+    "multicore_lockout_handler",       # SIO_IRQ_PROC1, when the core installs it
+]
+
+FLASH_START = 0x10000000
+FLASH_END = 0x20000000
+
+FUNC_RE = re.compile(r"^([0-9a-f]{8}) <(.+)>:$")
+BRANCH_RE = re.compile(r"^\s*([0-9a-f]+):\s+(b[a-z]*(?:\.[nw])?)\s+([0-9a-f]+)\s+<([^>]+)>")
+INDIRECT_RE = re.compile(r"^\s*([0-9a-f]+):\s+blx\s+(r\d+|ip|lr)")
+
+
+def parse(lines):
+    """Return ({name: address}, {name: [(mnemonic, target name)]}, {name: indirect call count})."""
+    address = {}
+    branches = {}
+    indirect = {}
+    current = None
+    for line in lines:
+        line = line.rstrip("\n")
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(2)
+            if current.startswith("$"):
+                continue
+            address.setdefault(current, int(m.group(1), 16))
+            branches.setdefault(current, [])
+            indirect.setdefault(current, 0)
+            continue
+        if current is None:
+            continue
+        m = BRANCH_RE.match(line)
+        if m:
+            target = re.sub(r"\+0x[0-9a-f]+$", "", m.group(4))
+            if target != current:
+                branches[current].append((m.group(2), target))
+            continue
+        if INDIRECT_RE.match(line):
+            indirect[current] += 1
+    return address, branches, indirect
+
+
+def is_root(name, root):
+    """C symbols demangle to the bare name, C++ ones carry an argument list."""
+    return name == root or name.startswith(root + "(")
+
+
+def veneer_target(name):
+    m = re.match(r"^__(.+)_veneer$", name)
+    return m.group(1) if m else None
+
+
+def in_flash(addr):
+    return FLASH_START <= addr < FLASH_END
+
+
+def check(lines, roots=ROOTS):
+    """Return (problems, warnings) as lists of strings."""
+    address, branches, indirect = parse(lines)
+    problems = []
+    warnings = []
+
+    todo = []
+    for root in roots:
+        found = [n for n in address if is_root(n, root)]
+        if not found:
+            warnings.append("root not found: %s (inlined, renamed or not linked?)" % root)
+        todo.extend((n, [n]) for n in found)
+
+    seen = set()
+    while todo:
+        name, path = todo.pop()
+        if name in seen:
+            continue
+        seen.add(name)
+        real = veneer_target(name)
+        if real is not None and real in address:
+            todo.append((real, path + [real]))
+            continue
+        addr = address.get(name)
+        if addr is None:
+            warnings.append("unknown call target %s via %s" % (name, " -> ".join(path)))
+            continue
+        if in_flash(addr):
+            problems.append("%s is in flash (0x%08x): %s" % (name, addr, " -> ".join(path)))
+            continue
+        if indirect.get(name):
+            warnings.append("%s makes %d indirect call(s); their targets must be roots" % (name, indirect[name]))
+        for _, target in branches.get(name, []):
+            todo.append((target, path + [target]))
+    return problems, warnings
+
+
+def disassemble(objdump, elf):
+    # -D: RAM functions sit in data sections, which -d skips
+    out = subprocess.run([objdump, "-D", "-C", "--no-show-raw-insn", elf],
+                         check=True, capture_output=True, text=True).stdout
+    return out.splitlines()
+
+
+def run(objdump, elf, strict=True):
+    problems, warnings = check(disassemble(objdump, elf))
+    for w in warnings:
+        print("check_ram_isr: warning: %s" % w)
+    for p in problems:
+        print("check_ram_isr: %s: %s" % ("error" if strict else "warning", p))
+    if not problems:
+        print("check_ram_isr: core1 park path is RAM-resident")
+    return 1 if problems else 0
+
+
+def main(argv):
+    import argparse
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--objdump", default="arm-none-eabi-objdump")
+    args = parser.parse_args(argv)
+    return run(args.objdump, args.elf)
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
+else:
+    # PlatformIO extra script
+    try:
+        Import("env")  # noqa: F821 (SCons)
+    except NameError:
+        pass
+    else:
+        def _post_build(target, source, env):  # noqa: ARG001
+            import os
+            objcopy = env.subst("$OBJCOPY")
+            head, tail = os.path.split(objcopy)
+            objdump = os.path.join(head, re.sub(r"objcopy(\.exe)?$", r"objdump\1", tail))
+            strict = env.GetProjectOption("custom_ram_isr_strict", "no").lower() in ("yes", "true", "1")
+            try:
+                failed = run(objdump, str(target[0]), strict) != 0
+            except (OSError, subprocess.CalledProcessError) as e:
+                print("check_ram_isr: warning: could not disassemble with %s: %s" % (objdump, e))
+                failed = strict
+            if failed and strict:
+                env.Exit(1)
+
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", _post_build)  # noqa: F821
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Self-test for check_ram_isr.py on canned `objdump -D -C --no-show-raw-insn`
+output: a RAM IRQ handler that calls into flash directly, one that reaches
+flash through a linker veneer, a root the compiler inlined away, and a clean
+RAM-only path.
+
+    tools/test_check_ram_isr.py
+"""
+
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import check_ram_isr  # noqa: E402
+
+DISASSEMBLY = """
+firmware.elf:     file format elf32-littlearm
+
+
+Disassembly of section .text:
+
+10004000 <flash_helper(int)>:
+10004000:	adds	r0, #1
+10004002:	bx	lr
+
+10004010 <__aeabi_uidivmod>:
+10004010:	push	{r4, lr}
+10004012:	pop	{r4, pc}
+
+Disassembly of section .data:
+
+20000100 <pio0_irq()>:
+20000100:	push	{r4, lr}
+20000102:	bl	20000180 <ispio_handle_irq(InterruptSerialPIO*)>
+20000106:	beq.n	2000010c <pio0_irq()+0xc>
+20000108:	bl	10004000 <flash_helper(int)>
+2000010c:	pop	{r4, pc}
+
+20000140 <pio1_irq()>:
+20000140:	push	{r4, lr}
+20000142:	bl	20000180 <ispio_handle_irq(InterruptSerialPIO*)>
+20000146:	pop	{r4, pc}
+
+20000180 <ispio_handle_irq(InterruptSerialPIO*)>:
+20000180:	push	{r4, r5, lr}
+20000182:	ldr	r3, [r0, #4]
+20000184:	blx	r3
+20000186:	pop	{r4, r5, pc}
+
+200001c0 <shared_rotate_irq()>:
+200001c0:	push	{r4, lr}
+200001c2:	bl	20000300 <____aeabi_uidivmod_veneer>
+200001c6:	pop	{r4, pc}
+
+20000200 <MappingStore::serviceFlashPark()>:
+20000200:	push	{r4, lr}
+20000202:	b.n	20000200 <MappingStore::serviceFlashPark()>
+
+20000240 <Port::messageSinkFromIRQ(ModuleMessage*)>:
+20000240:	bx	lr
+
+20000260 <multicore_lockout_handler>:
+20000260:	bx	lr
+
+20000300 <____aeabi_uidivmod_veneer>:
+20000300:	ldr.w	pc, [pc, #-4]
+20000304:	.word	0x10004011
+"""
+
+
+class CheckRamIsrTest(unittest.TestCase):
+    def setUp(self):
+        self.lines = DISASSEMBLY.splitlines()
+        self.problems, self.warnings = check_ram_isr.check(self.lines)
+
+    def test_parse(self):
+        address, branches, indirect = check_ram_isr.parse(self.lines)
+        self.assertEqual(address["pio0_irq()"], 0x20000100)
+        self.assertEqual(address["flash_helper(int)"], 0x10004000)
+        # The branch back into pio0_irq itself is not a call
+        self.assertEqual(branches["pio0_irq()"],
+                         [("bl", "ispio_handle_irq(InterruptSerialPIO*)"), ("bl", "flash_helper(int)")])
+        self.assertEqual(indirect["ispio_handle_irq(InterruptSerialPIO*)"], 1)
+
+    def test_direct_call_into_flash(self):
+        hits = [p for p in self.problems if p.startswith("flash_helper(int) is in flash")]
+        self.assertEqual(len(hits), 1, self.problems)
+        self.assertIn("pio0_irq() -> flash_helper(int)", hits[0])
+
+    def test_veneer_resolves_to_flash(self):
+        hits = [p for p in self.problems if p.startswith("__aeabi_uidivmod is in flash")]
+        self.assertEqual(len(hits), 1, self.problems)
+        self.assertIn("shared_rotate_irq() -> ____aeabi_uidivmod_veneer -> __aeabi_uidivmod", hits[0])
+
+    def test_only_the_flash_calls_are_problems(self):
+        self.assertEqual(len(self.problems), 2, self.problems)
+
+    def test_inlined_root_warns(self):
+        # Trace::push was inlined into its callers: no symbol left
+        self.assertIn("root not found: Trace::push (inlined, renamed or not linked?)", self.warnings)
+
+    def test_c_root_without_argument_list(self):
+        self.assertFalse([w for w in self.warnings if "multicore_lockout_handler" in w])
+        _, warnings = check_ram_isr.check(self.lines, ["multicore_lockout_handler", "multicore_lockout_handler_missing"])
+        self.assertEqual(warnings, ["root not found: multicore_lockout_handler_missing (inlined, renamed or not linked?)"])
+
+    def test_indirect_call_warns(self):
+        self.assertIn("ispio_handle_irq(InterruptSerialPIO*) makes 1 indirect call(s); their targets must be roots",
+                      self.warnings)
+
+    def test_clean_path(self):
+        problems, warnings = check_ram_isr.check(self.lines, ["pio1_irq", "MappingStore::serviceFlashPark"])
+        self.assertEqual(problems, [])
+        self.assertEqual(len(warnings), 1, warnings)  # the indirect call only
+
+
+if __name__ == "__main__":
+    unittest.main()
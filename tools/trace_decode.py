@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Render the firmware's binary trace records (src/trace.h).
+
+Reads the Serial (CDC #0) stream from a serial port, a capture file or stdin.
+Trace records are decoded with the format table in src/trace_formats.h;
+everything else (dbg_printf output) is passed through as text.
+
+    tools/trace_decode.py /dev/ttyACM0
+    tools/trace_decode.py capture.bin
+    tools/trace_decode.py --table        # print the parsed format table
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+FRAME_MAGIC = 0xA5
+HEADER_LEN = 8  # magic, core/nargs, id (2), timestamp (4)
+MAX_ARGS = 4
+
+DEFAULT_TABLE = os.path.join(os.path.dirname(__file__), "..", "src", "trace_formats.h")
+
+ENTRY_RE = re.compile(r'X\(\s*(\w+)\s*,\s*((?:"(?:[^"\\]|\\.)*"\s*)+)\)')
+STRING_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+CONVERSION_RE = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diuxXcf%])")
+
+
+def load_table(path):
+    """Return [(name, format)] in id order, as TRACE_FORMATS expands."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    body = text[text.index("#define TRACE_FORMATS(X)"):]
+    table = []
+    for name, literals in ENTRY_RE.findall(body):
+        fmt = "".join(STRING_RE.findall(literals))
+        fmt = fmt.encode().decode("unicode_escape")
+        table.append((name, fmt))
+    return table
+
+
+def table_hash(table):
+    """FNV-1a as in Trace::formatTableHash()."""
+    h = 2166136261
+    for _, fmt in table:
+        for b in (fmt + "\n").encode():
+            h ^= b
+            h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def render(fmt, args):
+    out = []
+    pos = 0
+    i = 0
+    for m in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, conv = m.group(1), m.group(2)
+        if conv == "%":
+            out.append("%")
+            continue
+        if i >= len(args):
+            out.append("<?>")
+            continue
+        raw = args[i]
+        i += 1
+        if conv in "di":
+            value = struct.unpack("<i", struct.pack("<I", raw))[0]
+        elif conv == "f":
+            value = struct.unpack("<f", struct.pack("<I", raw))[0]
+        elif conv == "c":
+            value = chr(raw & 0xFF)
+        else:
+            value = raw
+        out.append(("%" + flags + conv) % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+class Decoder:
+    def __init__(self, table, table_path, out):
+        self.table = table
+        self.table_path = table_path
+        self.hash = table_hash(table)
+        self.out = out
+        self.buf = bytearray()
+        self.text = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            start = self.buf.find(FRAME_MAGIC)
+            if start < 0:
+                self.emit_text(self.buf)
+                self.buf.clear()
+                break
+            if start:
+                self.emit_text(self.buf[:start])
+                del self.buf[:start]
+            if len(self.buf) < 2:
+                break
+            nargs = self.buf[1] & 0x7F
+            length = HEADER_LEN + 4 * nargs + 1
+            if nargs > MAX_ARGS:
+                self.emit_text(self.buf[:1])
+                del self.buf[:1]
+                continue
+            if len(self.buf) < length:
+                break
+            frame = bytes(self.buf[:length])
+            if (sum(frame[:-1]) & 0xFF) != frame[-1] or frame[2] | frame[3] << 8 >= len(self.table):
+                # Not a record: a 0xA5 byte in text output
+                self.emit_text(self.buf[:1])
+                del self.buf[:1]
+                continue
+            del self.buf[:length]
+            self.emit_record(frame, nargs)
+
+    def emit_text(self, data):
+        self.text += data
+        while True:
+            nl = self.text.find(b"\n")
+            if nl < 0:
+                break
+            self.out.write(self.text[:nl].decode("utf-8", "replace") + "\n")
+            del self.text[:nl + 1]
+        self.out.flush()
+
+    def emit_record(self, frame, nargs):
+        core = frame[1] >> 7
+        rec_id, stamp = struct.unpack_from("<HI", frame, 2)
+        args = list(struct.unpack_from("<%dI" % nargs, frame, HEADER_LEN))
+        name, fmt = self.table[rec_id]
+        line = render(fmt, args)
+        if name == "TRACE_HELLO" and args and args[0] != self.hash:
+            line += "  ** firmware table %08x != %s (%08x), records may be misnamed **" % (
+                args[0], os.path.basename(self.table_path), self.hash)
+        self.out.write("[%10.6f c%d] %s\n" % (stamp / 1e6, core, line))
+        self.out.flush()
+
+
+def open_source(path, baud):
+    if path == "-":
+        return sys.stdin.buffer, lambda f: f.read1(4096) if hasattr(f, "read1") else f.read(4096)
+    if os.path.exists(path) and not path.startswith("/dev/"):
+        return open(path, "rb"), lambda f: f.read(4096)
+    import serial  # pyserial, only needed for live capture
+
+    port = serial.Serial(path, baud, timeout=0.1)
+    return port, lambda f: f.read(max(1, f.in_waiting))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", nargs="?", default="-", help="serial port, capture file or - for stdin")
+    parser.add_argument("--formats", default=DEFAULT_TABLE, help="path to trace_formats.h")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--table", action="store_true", help="print the format table and its hash")
+    opts = parser.parse_args()
+
+    table = load_table(opts.formats)
+    if opts.table:
+        print("hash %08x, %d formats" % (table_hash(table), len(table)))
+        for i, (name, fmt) in enumerate(table):
+            print("%3d %-20s %s" % (i, name, fmt))
+        return
+
+    decoder = Decoder(table, opts.formats, sys.stdout)
+    source, read = open_source(opts.source, opts.baud)
+    try:
+        while True:
+            data = read(source)
+            if not data:
+                if not hasattr(source, "in_waiting"):
+                    break
+                continue
+            decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    decoder.emit_text(b"\n" if decoder.text else b"")
+
+
+if __name__ == "__main__":
+    main()
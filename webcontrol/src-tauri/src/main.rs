@@ -10,7 +10,7 @@ use std::thread::JoinHandle;
 use std::time::{Duration, Instant};
 use tauri::Emitter;
 
-const HEADER_SIZE: usize = 5;
+const HEADER_SIZE: usize = 6; // type, command, subcommand, seq, length(2)
 const CHECKSUM_SIZE: usize = 2;
 const MIN_MESSAGE_SIZE: usize = HEADER_SIZE + CHECKSUM_SIZE;
 const MAX_MESSAGE_SIZE: usize = 8192;
@@ -74,7 +74,7 @@ fn has_valid_firmware_frame(buffer: &[u8]) -> bool {
             continue;
         }
 
-        let length = (buffer[offset + 3] as usize) | ((buffer[offset + 4] as usize) << 8);
+        let length = (buffer[offset + 4] as usize) | ((buffer[offset + 5] as usize) << 8);
         let expected_total = HEADER_SIZE + CHECKSUM_SIZE + length;
 
         if expected_total > MAX_MESSAGE_SIZE {
@@ -85,7 +85,7 @@ fn has_valid_firmware_frame(buffer: &[u8]) -> bool {
             continue;
         }
 
-        let checksum_offset = offset + 5;
+        let checksum_offset = offset + HEADER_SIZE;
         let checksum = u16::from_le_bytes([buffer[checksum_offset], buffer[checksum_offset + 1]]);
 
         let mut crc = calculate_crc16(&buffer[offset..offset + HEADER_SIZE]);
@@ -2,9 +2,13 @@ import { reactive } from 'vue';
 import type { State } from '../types';
 
 const state = reactive<State>({
-    ports: { rows: 0, cols: 0, items: {} },
+    ports: { rows: 0, cols: 0, items: {}, generation: 0 },
     modules: {},
     mappings: [],
+    bank: { active: 0, count: 0 },
+    deviceLog: null,
+    stats: { current: null, previous: null },
+    profile: null,
     selected: null,
     connection: { connected: false },
     moduleUi: {
@@ -14,9 +18,13 @@ const state = reactive<State>({
 
 export function useStore() {
     function reset() {
-        state.ports = { rows: 0, cols: 0, items: {} };
+        state.ports = { rows: 0, cols: 0, items: {}, generation: 0 };
         state.modules = {};
         state.mappings = [];
+        state.bank = { active: 0, count: 0 };
+        state.deviceLog = null;
+        state.stats = { current: null, previous: null };
+        state.profile = null;
         state.selected = null;
     }
 
@@ -2,16 +2,17 @@
  * Binary protocol implementation for Picontrol device communication.
  *
  * Wire format (little-endian):
- *   Header:   type(1) + command(1) + subcommand(1) + length(2)  = 5 bytes
- *   Checksum: CRC16-CCITT (2 bytes, at byte offset 5-6)
+ *   Header:   type(1) + command(1) + subcommand(1) + seq(1) + length(2)  = 6 bytes
+ *   Checksum: CRC16-CCITT (2 bytes, at byte offset 6-7)
  *   Data:     variable length (length bytes)
  *
- * CRC16 is calculated over header(5) + data(length), NOT including the checksum bytes.
+ * CRC16 is calculated over header(6) + data(length), NOT including the checksum bytes.
+ * The device echoes `seq` in its reply, so several commands can be in flight.
  */
 
 import { useStore } from '../composables/useStore';
 import { useLogger } from '../composables/useLogger';
-import type { Curve, Mapping, Module, ModuleParam, PortItem } from '../types';
+import type { Curve, CurvePoint, DeviceProfile, DeviceStats, Mapping, MappingOptions, Module, ModuleParam, PortItem } from '../types';
 
 // ── Enums matching firmware ─────────────────────────────────────────────────
 
@@ -26,6 +27,8 @@ export enum CommandType {
     VERSION = 1,
     MAP = 2,
     MODULES = 3,
+    LOG = 4,
+    STATS = 5,
 }
 
 export enum ResponseType {
@@ -35,6 +38,8 @@ export enum ResponseType {
     VERSION = 3,
     MAP = 4,
     MODULES = 5,
+    LOG = 6,
+    STATS = 7,
 }
 
 export enum EventType {
@@ -50,14 +55,50 @@ export enum MapSubcommand {
     DEL = 2,
     LIST = 3,
     CLEAR = 4,
+    BULK_SET = 5,
+    BANK = 6,
+    SET_OPTIONS = 7,
 }
 
 export enum ModuleSubcommand {
     LIST = 0,
     PARAM_SET = 1,
     CALIB_SET = 2,
+    LIST_SINCE = 3,
 }
 
+export enum LogSubcommand {
+    GET = 0,
+    SET = 1,
+}
+
+export enum StatsSubcommand {
+    GET = 0,
+    PROFILE = 1,
+}
+
+/** Core 1 profiler stages, in firmware order (profiler.h) */
+export const PROFILE_STAGES = ['Port scan', 'RX handling', 'Mapping', 'Curve eval', 'UART TX', 'IPC'];
+
+/** Firmware log levels (debug_printf.h) */
+export enum LogLevel {
+    NONE = 0,
+    ERROR = 1,
+    WARN = 2,
+    INFO = 3,
+    DEBUG = 4,
+}
+
+/** Firmware log subsystem bits (debug_printf.h) */
+export const LOG_SUBSYSTEMS: { bit: number; name: string }[] = [
+    { bit: 0x01, name: 'System' },
+    { bit: 0x02, name: 'USB' },
+    { bit: 0x04, name: 'Ports' },
+    { bit: 0x08, name: 'Mapping' },
+    { bit: 0x10, name: 'Storage' },
+    { bit: 0x20, name: 'Module frames' },
+];
+
 export enum ParamDataType {
     INT = 0,
     FLOAT = 1,
@@ -72,14 +113,38 @@ export enum ActionType {
     KEYBOARD = 3,
     MIDI_PITCH_BEND = 4,
     MIDI_MOD_WHEEL = 5,
+    BANK_SELECT = 6,
+    MIDI_NRPN = 7,
+    MIDI_RPN = 8,
+    MIDI_CC_RELATIVE = 9,
+}
+
+/** Low nibble of d3 of a MIDI_CC_RELATIVE mapping; the high nibble is acceleration 0-3 */
+export enum RelativeMode {
+    TWOS_COMPLEMENT = 0,
+    BINARY_OFFSET = 1,
+    SIGN_MAGNITUDE = 2,
+}
+
+/** Bits of MappingOptions.flags */
+export enum MappingOptionFlag {
+    /** Soft takeover: mute output until the control crosses the host's value (CC, mod wheel) */
+    PICKUP = 0x01,
+}
+
+/** d2 of a BANK_SELECT mapping */
+export enum BankSelectMode {
+    ABSOLUTE = 0,
+    NEXT = 1,
+    PREV = 2,
 }
 
 // ── Struct sizes (packed, matching firmware #pragma pack(push,1)) ───────────
 
 export const SIZES = {
-    HEADER: 5,
+    HEADER: 6,
     CHECKSUM: 2,
-    MIN_MESSAGE: 7, // HEADER + CHECKSUM
+    MIN_MESSAGE: 8, // HEADER + CHECKSUM
     LED_VALUE: 4,
     LED_RANGE: 6,
     PARAM_VALUE: 4,
@@ -88,9 +153,12 @@ export const SIZES = {
     MODULE: 465, // 1+1+32+32+16+1+1+1+1+1+1+1 + 8*47
     PORT_STATE_PACKED: 476, // 4+4+1+465+1+1
     CURVE_POINT: 2,
-    CURVE: 2, // int16_t h
+    CURVE: 17, // h(2) + count(1) + points(4*2) + controls(3*2)
+    CURVE_MAX_POINTS: 4,
     ACTION_TARGET: 3,
-    MODULE_MAPPING: 15, // 4+4+1+1+2+3
+    MAPPING_OPTIONS: 4, // deadband + smoothing + slew + flags
+    MODULE_MAPPING: 35, // 4+4+1+1+17+3+4+1
+    TARGETS_PER_PARAM: 4,
 } as const;
 
 // ── CRC16-CCITT ─────────────────────────────────────────────────────────────
@@ -179,6 +247,7 @@ export interface ParsedMessage {
     type: MessageType;
     command: number; // CommandType | ResponseType | EventType
     subcommand: number;
+    seq: number;
     length: number;
     checksum: number;
     data: Uint8Array;
@@ -186,11 +255,13 @@ export interface ParsedMessage {
 
 /**
  * Build a binary command message ready for wire transmission.
+ * `seq` 0 is used for fire-and-forget commands; see setCommandSeq().
  */
 export function buildCommand(
     command: CommandType,
     subcommand: number,
     data?: Uint8Array,
+    seq = 0,
 ): Uint8Array {
     const payload = data ?? new Uint8Array(0);
     const totalSize = SIZES.HEADER + SIZES.CHECKSUM + payload.length;
@@ -199,21 +270,34 @@ export function buildCommand(
     buf[0] = MessageType.COMMAND;
     buf[1] = command;
     buf[2] = subcommand;
-    buf[3] = payload.length & 0xFF;
-    buf[4] = (payload.length >> 8) & 0xFF;
+    buf[3] = seq & 0xFF;
+    buf[4] = payload.length & 0xFF;
+    buf[5] = (payload.length >> 8) & 0xFF;
 
     // Copy payload after header + checksum
     buf.set(payload, SIZES.HEADER + SIZES.CHECKSUM);
 
-    // Calculate CRC over header + payload
+    writeChecksum(buf);
+    return buf;
+}
+
+/** Calculate CRC over header + payload and store it after the header. */
+function writeChecksum(buf: Uint8Array): void {
     let crc = calculateCrc16(buf, 0, SIZES.HEADER);
-    for (let i = 0; i < payload.length; i++) {
-        crc = crc16Update(crc, payload[i]!);
+    for (let i = SIZES.HEADER + SIZES.CHECKSUM; i < buf.length; i++) {
+        crc = crc16Update(crc, buf[i]!);
     }
+    buf[SIZES.HEADER] = crc & 0xFF;
+    buf[SIZES.HEADER + 1] = (crc >> 8) & 0xFF;
+}
 
-    buf[5] = crc & 0xFF;
-    buf[6] = (crc >> 8) & 0xFF;
-
+/**
+ * Return a copy of a built command tagged with `seq` (checksum updated).
+ */
+export function setCommandSeq(frame: Uint8Array, seq: number): Uint8Array {
+    const buf = frame.slice();
+    buf[3] = seq & 0xFF;
+    writeChecksum(buf);
     return buf;
 }
 
@@ -227,8 +311,9 @@ export function parseMessage(buf: Uint8Array): ParsedMessage | null {
     const type = buf[0] as MessageType;
     const command = buf[1]!;
     const subcommand = buf[2]!;
-    const length = buf[3]! | (buf[4]! << 8);
-    const checksum = buf[5]! | (buf[6]! << 8);
+    const seq = buf[3]!;
+    const length = buf[4]! | (buf[5]! << 8);
+    const checksum = buf[6]! | (buf[7]! << 8);
 
     const expectedTotal = SIZES.HEADER + SIZES.CHECKSUM + length;
     if (buf.length < expectedTotal) return null;
@@ -242,7 +327,7 @@ export function parseMessage(buf: Uint8Array): ParsedMessage | null {
     }
     if (crc !== checksum) return null;
 
-    return { type, command, subcommand, length, checksum, data };
+    return { type, command, subcommand, seq, length, checksum, data };
 }
 
 /**
@@ -254,7 +339,7 @@ export function extractMessage(
 ): { message: ParsedMessage; remaining: Uint8Array } | null {
     if (buf.length < SIZES.MIN_MESSAGE) return null;
 
-    const length = buf[3]! | (buf[4]! << 8);
+    const length = buf[4]! | (buf[5]! << 8);
     const expectedTotal = SIZES.HEADER + SIZES.CHECKSUM + length;
 
     if (expectedTotal > 8192) {
@@ -281,6 +366,16 @@ export function buildModulesListCmd(): Uint8Array {
     return buildCommand(CommandType.MODULES, ModuleSubcommand.LIST);
 }
 
+/**
+ * Request only the ports that changed after `since` (a generation previously
+ * returned by the device). `since = 0` returns every port.
+ */
+export function buildModulesListSinceCmd(since: number): Uint8Array {
+    const data = new Uint8Array(4);
+    new DataView(data.buffer).setUint32(0, since >>> 0, true);
+    return buildCommand(CommandType.MODULES, ModuleSubcommand.LIST_SINCE, data);
+}
+
 export function buildMapListCmd(): Uint8Array {
     return buildCommand(CommandType.MAP, MapSubcommand.LIST);
 }
@@ -291,26 +386,84 @@ export function buildMapClearCmd(): Uint8Array {
 
 export function buildMapSetCmd(
     row: number, col: number, paramId: number,
-    actionType: number, d1: number, d2: number,
+    actionType: number, d1: number, d2: number, d3?: number, target?: number,
 ): Uint8Array {
-    const data = new Uint8Array([row, col, paramId, actionType, d1, d2]);
+    // d3 and target are only sent when given; the firmware accepts the shorter forms too
+    const bytes = [row, col, paramId, actionType, d1, d2];
+    if (d3 !== undefined || target !== undefined) bytes.push(d3 ?? 0);
+    if (target !== undefined) bytes.push(target);
+    const data = new Uint8Array(bytes);
     return buildCommand(CommandType.MAP, MapSubcommand.SET, data);
 }
 
+export function buildMapSetOptionsCmd(
+    row: number, col: number, paramId: number, options: MappingOptions, target = 0,
+): Uint8Array {
+    const data = new Uint8Array([row, col, paramId, options.deadband, options.smoothing, options.slew, options.flags, target]);
+    return buildCommand(CommandType.MAP, MapSubcommand.SET_OPTIONS, data);
+}
+
 export function buildMapSetCurveCmd(
-    row: number, col: number, paramId: number, curve: Curve,
+    row: number, col: number, paramId: number, curve: Curve, target = 0,
 ): Uint8Array {
-    // Curve is sent as the packed struct: count(1) + points(4*2) + controls(3*2) = 15 bytes
-    const data = new Uint8Array(3 + SIZES.CURVE);
+    // Curve is sent as the packed struct: h(2) + count(1) + points(4*2) + controls(3*2), then the target
+    const data = new Uint8Array(4 + SIZES.CURVE);
     data[0] = row;
     data[1] = col;
     data[2] = paramId;
     serializeCurve(curve, data, 3);
+    data[3 + SIZES.CURVE] = target;
     return buildCommand(CommandType.MAP, MapSubcommand.SET_CURVE, data);
 }
 
-export function buildMapDelCmd(row: number, col: number, paramId: number): Uint8Array {
-    const data = new Uint8Array([row, col, paramId]);
+/**
+ * Insert or replace several mappings in one transaction.
+ * Payload: count(1) + ModuleMapping[count]; the device applies all or none.
+ */
+export function buildMapBulkSetCmd(mappings: Mapping[]): Uint8Array {
+    const data = new Uint8Array(1 + mappings.length * SIZES.MODULE_MAPPING);
+    data[0] = mappings.length;
+    mappings.forEach((m, i) => serializeModuleMapping(m, data, 1 + i * SIZES.MODULE_MAPPING));
+    return buildCommand(CommandType.MAP, MapSubcommand.BULK_SET, data);
+}
+
+/**
+ * Query the mapping banks, or switch to `bank` (0-based) when given.
+ * `resync` also pushes the new bank's mappings to the modules.
+ */
+export function buildMapBankCmd(bank?: number, resync = false): Uint8Array {
+    if (bank === undefined) {
+        return buildCommand(CommandType.MAP, MapSubcommand.BANK);
+    }
+    return buildCommand(CommandType.MAP, MapSubcommand.BANK, new Uint8Array([bank, resync ? 1 : 0]));
+}
+
+/**
+ * Query the firmware debug log filter, or set it when `level` is given.
+ * The device clamps both to what the build compiled in.
+ */
+export function buildLogCmd(level?: LogLevel, mask?: number): Uint8Array {
+    if (level === undefined) {
+        return buildCommand(CommandType.LOG, LogSubcommand.GET);
+    }
+    return buildCommand(CommandType.LOG, LogSubcommand.SET, new Uint8Array([level, (mask ?? 0xff) & 0xff]));
+}
+
+/**
+ * Read the runtime counters. `resetMax` restarts the worst-case loop times
+ * after this snapshot.
+ */
+export function buildStatsCmd(resetMax = false): Uint8Array {
+    return buildCommand(CommandType.STATS, StatsSubcommand.GET, new Uint8Array([resetMax ? 1 : 0]));
+}
+
+/** Read core 1's load breakdown over the last profiling window (1 s). */
+export function buildProfileCmd(): Uint8Array {
+    return buildCommand(CommandType.STATS, StatsSubcommand.PROFILE);
+}
+
+export function buildMapDelCmd(row: number, col: number, paramId: number, target = 0): Uint8Array {
+    const data = new Uint8Array([row, col, paramId, target]);
     return buildCommand(CommandType.MAP, MapSubcommand.DEL, data);
 }
 
@@ -351,6 +504,26 @@ export function serializeCurve(curve: Curve, outBuf: Uint8Array, offset = 0): vo
     const h = curve.h;
     outBuf[offset] = h & 0xFF;
     outBuf[offset + 1] = (h >> 8) & 0xFF;
+
+    // Piecewise part; unused slots are zero
+    const points = (curve.points ?? []).slice(0, SIZES.CURVE_MAX_POINTS);
+    const controls = curve.controls ?? [];
+    outBuf.fill(0, offset + 2, offset + SIZES.CURVE);
+    outBuf[offset + 2] = points.length >= 2 ? points.length : 0;
+    if (points.length < 2) return;
+    points.forEach((p, i) => {
+        outBuf[offset + 3 + i * 2] = p.x;
+        outBuf[offset + 4 + i * 2] = p.y;
+    });
+    for (let i = 0; i < points.length - 1; i++) {
+        // Missing control: chord midpoint, i.e. a straight segment
+        const c = controls[i] ?? {
+            x: Math.round((points[i]!.x + points[i + 1]!.x) / 2),
+            y: Math.round((points[i]!.y + points[i + 1]!.y) / 2),
+        };
+        outBuf[offset + 11 + i * 2] = c.x;
+        outBuf[offset + 12 + i * 2] = c.y;
+    }
 }
 
 export function deserializeCurve(data: Uint8Array, offset = 0): Curve {
@@ -360,7 +533,18 @@ export function deserializeCurve(data: Uint8Array, offset = 0): Curve {
     let h = lo | (hi << 8);
     // Sign-extend from 16-bit
     if (h >= 0x8000) h -= 0x10000;
-    return { h };
+
+    const count = data[offset + 2]!;
+    if (count < 2 || count > SIZES.CURVE_MAX_POINTS) return { h };
+    const points: CurvePoint[] = [];
+    const controls: CurvePoint[] = [];
+    for (let i = 0; i < count; i++) {
+        points.push({ x: data[offset + 3 + i * 2]!, y: data[offset + 4 + i * 2]! });
+    }
+    for (let i = 0; i < count - 1; i++) {
+        controls.push({ x: data[offset + 11 + i * 2]!, y: data[offset + 12 + i * 2]! });
+    }
+    return { h, points, controls };
 }
 
 // ── Binary Struct Parsers ───────────────────────────────────────────────────
@@ -493,6 +677,63 @@ export interface ParsedPortState {
     configured: boolean;
 }
 
+/**
+ * STATS GET reply: uptimeUs(4) + rows(1) + cols(1), then 5 u32 per core
+ * (2 cores), then 7 u32 per port in row-major order, then gridReadyMs.
+ */
+export function parseStats(data: Uint8Array): DeviceStats | null {
+    if (data.length < 6) return null;
+    const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+    const rows = data[4]!;
+    const cols = data[5]!;
+    if (data.length < 6 + 2 * 20 + rows * cols * 28 + 4) return null;
+    let offset = 6;
+    const next = () => {
+        const v = view.getUint32(offset, true);
+        offset += 4;
+        return v;
+    };
+    const cores = [0, 1].map(() => ({
+        loops: next(),
+        loopMaxUs: next(),
+        ipcQueueFull: next(),
+        hidQueueFull: next(),
+        messageDrops: next(),
+    }));
+    const ports = Array.from({ length: rows * cols }, () => ({
+        rxFrames: next(),
+        txFrames: next(),
+        checksumErrors: next(),
+        crcErrors: next(),
+        parserResets: next(),
+        parserTimeouts: next(),
+        bringUpMs: next(),
+    }));
+    const gridReadyMs = next();
+    return { uptimeUs: view.getUint32(0, true), rows, cols, cores, ports, gridReadyMs };
+}
+
+/**
+ * STATS PROFILE reply: windowUs(4) + windowCycles(4) + idlePermille(2) +
+ * stageCount(1), then cycles(4) + permille(2) per stage.
+ */
+export function parseProfile(data: Uint8Array): DeviceProfile | null {
+    if (data.length < 11) return null;
+    const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+    const count = data[10]!;
+    if (data.length < 11 + count * 6) return null;
+    const stages = Array.from({ length: count }, (_, i) => ({
+        cycles: view.getUint32(11 + i * 6, true),
+        permille: view.getUint16(15 + i * 6, true),
+    }));
+    return {
+        windowUs: view.getUint32(0, true),
+        windowCycles: view.getUint32(4, true),
+        idlePermille: view.getUint16(8, true),
+        stages,
+    };
+}
+
 export function parsePortStatePacked(data: Uint8Array, offset: number): ParsedPortState {
     const view = new DataView(data.buffer, data.byteOffset + offset, SIZES.PORT_STATE_PACKED);
     const row = view.getInt32(0, true);
@@ -505,6 +746,27 @@ export function parsePortStatePacked(data: Uint8Array, offset: number): ParsedPo
     return { row, col, hasModule, module: mod, orientation, configured };
 }
 
+export function serializeModuleMapping(m: Mapping, outBuf: Uint8Array, offset: number): void {
+    const view = new DataView(outBuf.buffer, outBuf.byteOffset + offset, SIZES.MODULE_MAPPING);
+    view.setInt32(0, m.r, true);
+    view.setInt32(4, m.c, true);
+    outBuf[offset + 8] = m.pid;
+    outBuf[offset + 9] = m.type;
+    serializeCurve(m.curve ?? { h: 16384 }, outBuf, offset + 10);
+
+    const targetOffset = offset + 10 + SIZES.CURVE;
+    outBuf[targetOffset] = m.d1;
+    outBuf[targetOffset + 1] = m.d2;
+    outBuf[targetOffset + 2] = m.d3 ?? 0; // NRPN/RPN param LSB; unused by other types
+
+    const optionsOffset = targetOffset + SIZES.ACTION_TARGET;
+    outBuf[optionsOffset] = m.options?.deadband ?? 0;
+    outBuf[optionsOffset + 1] = m.options?.smoothing ?? 0;
+    outBuf[optionsOffset + 2] = m.options?.slew ?? 0;
+    outBuf[optionsOffset + 3] = m.options?.flags ?? 0;
+    outBuf[optionsOffset + SIZES.MAPPING_OPTIONS] = m.target ?? 0;
+}
+
 export function parseModuleMapping(data: Uint8Array, offset: number): Mapping {
     const view = new DataView(data.buffer, data.byteOffset + offset, SIZES.MODULE_MAPPING);
     const r = view.getInt32(0, true);
@@ -516,8 +778,18 @@ export function parseModuleMapping(data: Uint8Array, offset: number): Mapping {
     const targetOffset = offset + 10 + SIZES.CURVE;
     const d1 = data[targetOffset]!;
     const d2 = data[targetOffset + 1]!;
+    const d3 = data[targetOffset + 2]!;
+
+    const optionsOffset = targetOffset + SIZES.ACTION_TARGET;
+    const options: MappingOptions = {
+        deadband: data[optionsOffset]!,
+        smoothing: data[optionsOffset + 1]!,
+        slew: data[optionsOffset + 2]!,
+        flags: data[optionsOffset + 3]!,
+    };
+    const target = data[optionsOffset + SIZES.MAPPING_OPTIONS]!;
 
-    return { r, c, pid, type, d1, d2, curve };
+    return { r, c, pid, type, d1, d2, d3, curve, options, target };
 }
 
 // ── Response Handlers (store-updating) ──────────────────────────────────────
@@ -590,6 +862,49 @@ export function useProtocol() {
                 return;
             }
 
+            if (respType === ResponseType.MODULES && msg.subcommand === ModuleSubcommand.LIST_SINCE) {
+                const decoded = decodeZeroRLE(msg.data);
+                handleModulesDelta(decoded);
+                return;
+            }
+
+            if (respType === ResponseType.MAP && msg.subcommand === MapSubcommand.BANK) {
+                // activeBank(1) + bankCount(1)
+                if (msg.data.length >= 2) {
+                    state.bank = { active: msg.data[0]!, count: msg.data[1]! };
+                }
+                return;
+            }
+
+            if (respType === ResponseType.LOG) {
+                // level(1) + mask(1) + compiled level(1) + compiled mask(1)
+                if (msg.data.length >= 4) {
+                    state.deviceLog = {
+                        level: msg.data[0]!,
+                        mask: msg.data[1]!,
+                        compiledLevel: msg.data[2]!,
+                        compiledMask: msg.data[3]!,
+                    };
+                }
+                return;
+            }
+
+            if (respType === ResponseType.STATS && msg.subcommand === StatsSubcommand.GET) {
+                const stats = parseStats(msg.data);
+                if (stats) {
+                    state.stats = { current: stats, previous: state.stats.current };
+                }
+                return;
+            }
+
+            if (respType === ResponseType.STATS && msg.subcommand === StatsSubcommand.PROFILE) {
+                const profile = parseProfile(msg.data);
+                if (profile && profile.windowUs > 0) {
+                    state.profile = profile;
+                }
+                return;
+            }
+
             if (respType === ResponseType.MAP && msg.subcommand === MapSubcommand.LIST) {
                 const decoded = decodeZeroRLE(msg.data);
                 handleMapList(decoded);
@@ -620,13 +935,38 @@ export function useProtocol() {
     function handleModulesList(data: Uint8Array): void {
         // Data is an array of PortStatePacked structs
         const portCount = Math.floor(data.length / SIZES.PORT_STATE_PACKED);
-
-        // Determine grid dimensions from the data
-        let maxRow = 0, maxCol = 0;
         const parsedPorts: ParsedPortState[] = [];
         for (let i = 0; i < portCount; i++) {
-            const ps = parsePortStatePacked(data, i * SIZES.PORT_STATE_PACKED);
-            parsedPorts.push(ps);
+            parsedPorts.push(parsePortStatePacked(data, i * SIZES.PORT_STATE_PACKED));
+        }
+        applyPortStates(parsedPorts, true);
+    }
+
+    function handleModulesDelta(data: Uint8Array): void {
+        // Data: generation(4, u32 LE) + count(1) + PortStatePacked[count]
+        if (data.length < 5) return;
+        const generation = new DataView(data.buffer, data.byteOffset, data.byteLength).getUint32(0, true);
+        const count = data[4]!;
+        const parsedPorts: ParsedPortState[] = [];
+        for (let i = 0; i < count; i++) {
+            const offset = 5 + i * SIZES.PORT_STATE_PACKED;
+            if (offset + SIZES.PORT_STATE_PACKED > data.length) return; // Truncated, keep old generation
+            parsedPorts.push(parsePortStatePacked(data, offset));
+        }
+        // A reply to LIST_SINCE(0) covers every port and may replace the grid
+        applyPortStates(parsedPorts, state.ports.generation === 0);
+        state.ports.generation = generation;
+    }
+
+    /**
+     * Merge parsed port states into the store. A full list replaces the port
+     * set; a delta only touches the ports it contains.
+     */
+    function applyPortStates(parsedPorts: ParsedPortState[], full: boolean): void {
+        // Determine grid dimensions from the data
+        let maxRow = full ? 0 : state.ports.rows - 1;
+        let maxCol = full ? 0 : state.ports.cols - 1;
+        for (const ps of parsedPorts) {
             if (ps.row > maxRow) maxRow = ps.row;
             if (ps.col > maxCol) maxCol = ps.col;
         }
@@ -635,7 +975,7 @@ export function useProtocol() {
         state.ports.cols = maxCol + 1;
 
         // Build a new items map
-        const newItems: Record<string, PortItem> = {};
+        const newItems: Record<string, PortItem> = full ? {} : { ...state.ports.items };
         const newModules: Record<string, Module> = {};
 
         for (const ps of parsedPorts) {
@@ -1,60 +1,119 @@
 import { useSerial } from './serial';
-import type { Curve } from '../types';
+import { useLogger } from '../composables/useLogger';
+import type { Curve, Mapping, MappingOptions } from '../types';
 import {
+    ResponseType,
     buildModulesListCmd,
     buildMapListCmd,
     buildMapSetCmd,
     buildMapSetCurveCmd,
+    buildMapSetOptionsCmd,
+    buildMapBulkSetCmd,
+    buildMapBankCmd,
     buildMapDelCmd,
     buildMapClearCmd,
     buildParamSetCmd,
     buildCalibSetCmd,
+    buildLogCmd,
+    buildStatsCmd,
+    buildProfileCmd,
 } from './protocol';
+import type { LogLevel } from './protocol';
 
+/**
+ * Device operations. Every call is a tagged request that resolves to true once
+ * the device acknowledged it (or returned the requested data), so callers can
+ * issue many of them without waiting for each round trip.
+ */
 export function useRouter() {
-    const { sendBinary } = useSerial();
+    const { request } = useSerial();
+    const { add: logAdd } = useLogger();
 
-    async function listModules() {
-        await sendBinary(buildModulesListCmd());
+    async function send(frame: Uint8Array): Promise<boolean> {
+        try {
+            const reply = await request(frame);
+            return reply.command !== ResponseType.NACK;
+        } catch (err) {
+            logAdd(`Request failed: ${err}`);
+            return false;
+        }
     }
 
-    async function listMappings() {
-        await sendBinary(buildMapListCmd());
+    async function listModules(): Promise<boolean> {
+        return send(buildModulesListCmd());
+    }
+
+    async function listMappings(): Promise<boolean> {
+        return send(buildMapListCmd());
     }
 
     async function setMapping(
         row: number, col: number, paramId: number,
-        actionType: number, d1: number, d2: number,
-    ) {
-        await sendBinary(buildMapSetCmd(row, col, paramId, actionType, d1, d2));
+        actionType: number, d1: number, d2: number, d3?: number, target?: number,
+    ): Promise<boolean> {
+        return send(buildMapSetCmd(row, col, paramId, actionType, d1, d2, d3, target));
     }
 
     async function setCurve(
-        row: number, col: number, paramId: number, curve: Curve,
-    ) {
-        await sendBinary(buildMapSetCurveCmd(row, col, paramId, curve));
+        row: number, col: number, paramId: number, curve: Curve, target = 0,
+    ): Promise<boolean> {
+        return send(buildMapSetCurveCmd(row, col, paramId, curve, target));
+    }
+
+    async function setOptions(
+        row: number, col: number, paramId: number, options: MappingOptions, target = 0,
+    ): Promise<boolean> {
+        return send(buildMapSetOptionsCmd(row, col, paramId, options, target));
+    }
+
+    async function setMappings(mappings: Mapping[]): Promise<boolean> {
+        return send(buildMapBulkSetCmd(mappings));
+    }
+
+    async function queryBank(): Promise<boolean> {
+        return send(buildMapBankCmd());
+    }
+
+    async function selectBank(bank: number, resync = false): Promise<boolean> {
+        return send(buildMapBankCmd(bank, resync));
+    }
+
+    async function queryLogFilter(): Promise<boolean> {
+        return send(buildLogCmd());
+    }
+
+    async function setLogFilter(level: LogLevel, mask: number): Promise<boolean> {
+        return send(buildLogCmd(level, mask));
+    }
+
+    async function queryStats(resetMax = false): Promise<boolean> {
+        return send(buildStatsCmd(resetMax));
+    }
+
+    async function queryProfile(): Promise<boolean> {
+        return send(buildProfileCmd());
     }
 
-    async function deleteMapping(row: number, col: number, paramId: number) {
-        await sendBinary(buildMapDelCmd(row, col, paramId));
+    async function deleteMapping(row: number, col: number, paramId: number, target = 0): Promise<boolean> {
+        return send(buildMapDelCmd(row, col, paramId, target));
     }
 
-    async function clearMappings() {
-        await sendBinary(buildMapClearCmd());
+    async function clearMappings(): Promise<boolean> {
+        return send(buildMapClearCmd());
     }
 
     async function setParameter(
         row: number, col: number, paramId: number,
         dataType: number, valueStr: string,
-    ) {
-        await sendBinary(buildParamSetCmd(row, col, paramId, dataType, valueStr));
+    ): Promise<boolean> {
+        return send(buildParamSetCmd(row, col, paramId, dataType, valueStr));
     }
 
     async function setCalibration(
         row: number, col: number, paramId: number,
         minValue: number, maxValue: number,
-    ) {
-        await sendBinary(buildCalibSetCmd(row, col, paramId, minValue, maxValue));
+    ): Promise<boolean> {
+        return send(buildCalibSetCmd(row, col, paramId, minValue, maxValue));
     }
 
     return {
@@ -62,6 +121,14 @@ export function useRouter() {
         listMappings,
         setMapping,
         setCurve,
+        setOptions,
+        setMappings,
+        queryBank,
+        selectBank,
+        queryLogFilter,
+        setLogFilter,
+        queryStats,
+        queryProfile,
         deleteMapping,
         clearMappings,
         setParameter,
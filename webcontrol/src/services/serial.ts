@@ -5,8 +5,12 @@ import { invoke } from '@tauri-apps/api/core';
 import { listen, type UnlistenFn } from '@tauri-apps/api/event';
 import {
     extractMessage,
+    setCommandSeq,
     buildModulesListCmd,
+    buildModulesListSinceCmd,
     buildMapListCmd,
+    buildMapBankCmd,
+    type ParsedMessage,
 } from './protocol';
 
 interface SerialPortInfo {
@@ -22,8 +26,24 @@ let pollIntervalId: number | null = null;
 let refreshModulesRequested = false;
 let refreshMappingsRequested = false;
 
-/** Polling interval in ms for module/mapping list updates */
-const POLL_INTERVAL_MS = 500;
+/** In-flight tagged requests keyed by sequence byte (1..255; 0 = untagged) */
+interface PendingRequest {
+    resolve: (msg: ParsedMessage) => void;
+    reject: (err: Error) => void;
+    timer: number;
+}
+const pendingRequests = new Map<number, PendingRequest>();
+let nextSeq = 1;
+
+/** How long a tagged request waits for its reply */
+const REQUEST_TIMEOUT_MS = 1000;
+
+/** Polling interval in ms for module list deltas */
+const POLL_INTERVAL_MS = 100;
+/** Every Nth poll also refreshes mappings (500 ms) */
+const MAPPINGS_POLL_DIVIDER = 5;
+/** Every Nth poll requests the full module list (2 s) so pending UI values can time out */
+const FULL_LIST_POLL_DIVIDER = 20;
 
 export function useSerial() {
     const { state, reset } = useStore();
@@ -94,14 +114,26 @@ export function useSerial() {
             logAdd(`Connected to ${selectedPort.name} (native serial)`);
 
             // Initial data fetch
-            await sendBinary(buildModulesListCmd());
+            await sendBinary(buildModulesListSinceCmd(0));
+            await sendBinary(buildMapBankCmd());
             await sendBinary(buildMapListCmd());
 
-            // Poll periodically since firmware does not send events on the binary CDC
+            // Poll periodically since firmware does not send events on the binary CDC.
+            // Module polls only carry ports changed since the last merged generation.
+            let pollCount = 0;
             pollIntervalId = window.setInterval(async () => {
                 if (!connectedPortName) return;
-                await sendBinary(buildModulesListCmd());
-                await sendBinary(buildMapListCmd());
+                pollCount++;
+                if (pollCount % FULL_LIST_POLL_DIVIDER === 0) {
+                    await sendBinary(buildModulesListCmd());
+                } else {
+                    await sendBinary(buildModulesListSinceCmd(state.ports.generation));
+                }
+                if (pollCount % MAPPINGS_POLL_DIVIDER === 0) {
+                    // Banks can also be switched from a mapped control
+                    await sendBinary(buildMapBankCmd());
+                    await sendBinary(buildMapListCmd());
+                }
             }, POLL_INTERVAL_MS);
         } catch (err) {
             logAdd(`Connect failed: ${err}`);
@@ -111,6 +143,8 @@ export function useSerial() {
     }
 
     async function disconnect() {
+        rejectPendingRequests('Disconnected');
+
         if (pollIntervalId) {
             clearInterval(pollIntervalId);
             pollIntervalId = null;
@@ -151,6 +185,53 @@ export function useSerial() {
         await invoke('write_serial', { data: Array.from(data) });
     }
 
+    /**
+     * Send a command tagged with a fresh sequence byte and resolve with the
+     * device reply carrying the same tag. Any number of requests may be in
+     * flight; replies are matched by tag, not by order.
+     */
+    async function request(frame: Uint8Array): Promise<ParsedMessage> {
+        if (!connectedPortName) {
+            throw new Error('Not connected');
+        }
+        if (pendingRequests.size >= 255) {
+            throw new Error('Too many requests in flight');
+        }
+        while (pendingRequests.has(nextSeq)) {
+            nextSeq = (nextSeq % 255) + 1;
+        }
+        const seq = nextSeq;
+        nextSeq = (nextSeq % 255) + 1;
+
+        const reply = new Promise<ParsedMessage>((resolve, reject) => {
+            const timer = window.setTimeout(() => {
+                pendingRequests.delete(seq);
+                reject(new Error(`Request ${seq} timed out`));
+            }, REQUEST_TIMEOUT_MS);
+            pendingRequests.set(seq, { resolve, reject, timer });
+        });
+
+        try {
+            await invoke('write_serial', { data: Array.from(setCommandSeq(frame, seq)) });
+        } catch (err) {
+            const pending = pendingRequests.get(seq);
+            if (pending) {
+                clearTimeout(pending.timer);
+                pendingRequests.delete(seq);
+            }
+            throw err;
+        }
+        return reply;
+    }
+
+    function rejectPendingRequests(reason: string) {
+        for (const pending of pendingRequests.values()) {
+            clearTimeout(pending.timer);
+            pending.reject(new Error(reason));
+        }
+        pendingRequests.clear();
+    }
+
     /**
      * Process accumulated binary data, extracting and handling complete messages.
      */
@@ -161,6 +242,13 @@ export function useSerial() {
             inputBuffer = new Uint8Array(remaining);
 
             const action = handleResponse(message);
+
+            const pending = message.seq !== 0 ? pendingRequests.get(message.seq) : undefined;
+            if (pending) {
+                clearTimeout(pending.timer);
+                pendingRequests.delete(message.seq);
+                pending.resolve(message);
+            }
             if (action && action.action === 'refresh_modules') {
                 refreshModulesRequested = true;
             }
@@ -174,7 +262,7 @@ export function useSerial() {
         // Handle refresh requests triggered by events (future-proofing)
         if (refreshModulesRequested) {
             refreshModulesRequested = false;
-            sendBinary(buildModulesListCmd());
+            sendBinary(buildModulesListSinceCmd(state.ports.generation));
         }
         if (refreshMappingsRequested) {
             refreshMappingsRequested = false;
@@ -186,5 +274,5 @@ export function useSerial() {
         return !!connectedPortName;
     }
 
-    return { connect, disconnect, sendBinary, isConnected };
+    return { connect, disconnect, sendBinary, request, isConnected };
 }
@@ -43,8 +43,17 @@ export interface Module {
     portLocC: number;
 }
 
+export interface CurvePoint {
+    x: number; // 0-255
+    y: number; // 0-255
+}
+
 export interface Curve {
     h: number; // Shape parameter Q15: 16384 = linear, <16384 = concave, >16384 = convex
+    // Piecewise curve: 2-4 points (x ascending), segment i bends towards controls[i].
+    // Absent or empty points means the h curve is used.
+    points?: CurvePoint[];
+    controls?: CurvePoint[];
 }
 
 export interface Mapping {
@@ -54,7 +63,63 @@ export interface Mapping {
     type: number;
     d1: number;
     d2: number;
+    d3?: number;
     curve?: Curve;
+    options?: MappingOptions;
+    /** Which of the parameter's targets (0-3); one parameter can drive several */
+    target?: number;
+}
+
+/** Input filters, run by the firmware before the curve. 0 disables each one. */
+export interface MappingOptions {
+    deadband: number;  // hysteresis in 1/1024 of full scale
+    smoothing: number; // EMA time constant ~2^n ms, 0-8
+    slew: number;      // max travel per ms in 1/1024 of full scale
+    flags: number;     // MappingOptionFlag bits
+}
+
+/** One core's counters from a STATS reply; all wrap at 2^32 */
+export interface DeviceCoreStats {
+    loops: number;
+    loopMaxUs: number;
+    ipcQueueFull: number;
+    hidQueueFull: number;
+    messageDrops: number;
+}
+
+export interface DevicePortStats {
+    rxFrames: number;
+    txFrames: number;
+    /** Failed frames on the sum-checked framing */
+    checksumErrors: number;
+    /** Failed frames on the CRC-16 framing */
+    crcErrors: number;
+    parserResets: number;
+    parserTimeouts: number;
+    /** Last module bring-up, detection to live, ms (0 = none yet) */
+    bringUpMs: number;
+}
+
+export interface DeviceStats {
+    /** Device clock at the snapshot, wraps at 2^32 us */
+    uptimeUs: number;
+    rows: number;
+    cols: number;
+    /** Core 0, core 1 */
+    cores: DeviceCoreStats[];
+    /** Row-major, rows * cols entries */
+    ports: DevicePortStats[];
+    /** Boot until every detected module was live, ms (0 = not yet) */
+    gridReadyMs: number;
+}
+
+/** Core 1 load over the device's last profiling window */
+export interface DeviceProfile {
+    windowUs: number;
+    windowCycles: number;
+    /** Shares in 1/1000 of the window */
+    idlePermille: number;
+    stages: { cycles: number; permille: number }[];
 }
 
 export interface ModuleUiOverride {
@@ -68,9 +133,18 @@ export interface State {
         rows: number;
         cols: number;
         items: Record<string, PortItem>;
+        /** Device generation of the last merged LIST_SINCE reply (0 = none yet) */
+        generation: number;
     };
     modules: Record<string, Module>;
     mappings: Mapping[];
+    /** Mapping bank state; `mappings` always lists the active bank */
+    bank: { active: number; count: number };
+    /** Firmware debug log filter; the compiled values bound the runtime ones */
+    deviceLog: { level: number; mask: number; compiledLevel: number; compiledMask: number } | null;
+    /** The last two STATS snapshots, rates are computed between them */
+    stats: { current: DeviceStats | null; previous: DeviceStats | null };
+    profile: DeviceProfile | null;
     selected: { r: number; c: number; pid?: number | null } | null;
     connection: { connected: boolean };
     moduleUi: {